@@ -18,6 +18,33 @@
     'chromium_code': 1,
   },
   'targets': [
+    {
+      'target_name': 'base64_benchmark_bin',
+      'type': 'executable',
+      'dependencies': [
+        '<(DEPTH)/base/base.gyp:base',
+        '<(DEPTH)/third_party/modp_b64/modp_b64.gyp:modp_b64',
+        '<(pagespeed_root)/pagespeed/core/core.gyp:pagespeed_core',
+        '<(pagespeed_root)/pagespeed/har/har.gyp:pagespeed_har',
+      ],
+      'sources': [
+        'base64_benchmark.cc',
+      ],
+    },
+    {
+      'target_name': 'har_to_archive_bin',
+      'type': 'executable',
+      'dependencies': [
+        '<(DEPTH)/base/base.gyp:base',
+        '<(DEPTH)/third_party/gflags/gflags.gyp:gflags',
+        '<(pagespeed_root)/pagespeed/core/core.gyp:pagespeed_core',
+        '<(pagespeed_root)/pagespeed/core/init.gyp:pagespeed_init',
+        '<(pagespeed_root)/pagespeed/har/har.gyp:pagespeed_har',
+      ],
+      'sources': [
+        'har_to_archive.cc',
+      ],
+    },
     {
       'target_name': 'minify_html_bin',
       'type': 'executable',
@@ -60,6 +87,7 @@
         '<(DEPTH)/third_party/gflags/gflags.gyp:gflags',
         '<(pagespeed_root)/pagespeed/core/init.gyp:pagespeed_init',
         '<(pagespeed_root)/pagespeed/dom/dom.gyp:pagespeed_json_dom',
+        '<(pagespeed_root)/pagespeed/filters/filters.gyp:pagespeed_filters',
         '<(pagespeed_root)/pagespeed/formatters/formatters.gyp:pagespeed_formatters',
         '<(pagespeed_root)/pagespeed/har/har.gyp:pagespeed_har',
         '<(pagespeed_root)/pagespeed/image_compression/image_compression.gyp:pagespeed_image_attributes_factory',
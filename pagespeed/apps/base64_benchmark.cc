@@ -0,0 +1,202 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Command line utility that compares the speed of modp_b64 against each
+// of the base64 decoders supported by this CPU, using the base64
+// encoded response bodies of the given HAR files.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/time.h"
+#include "base/values.h"
+#include "pagespeed/core/json_stream_parser.h"
+#include "pagespeed/har/base64_decoder.h"
+#include "third_party/modp_b64/modp_b64.h"
+
+namespace {
+
+// Number of times each decoder decodes the whole set of payloads.
+const int kIterations = 20;
+
+// Collects the base64 encoded content.text of every HAR entry.
+class PayloadCollector : public pagespeed::JsonStreamParser::Delegate {
+ public:
+  explicit PayloadCollector(std::vector<std::string>* payloads)
+      : payloads_(payloads) {}
+
+  virtual bool ShouldStreamArrayElements(
+      const pagespeed::JsonStreamParser::Path& path) {
+    return path.size() == 2 && path[0] == "log" && path[1] == "entries";
+  }
+
+  virtual bool OnArrayElement(const pagespeed::JsonStreamParser::Path& path,
+                              base::Value* element) {
+    scoped_ptr<base::Value> entry(element);
+    if (!entry->IsType(base::Value::TYPE_DICTIONARY)) {
+      return true;
+    }
+    const base::DictionaryValue* content = NULL;
+    std::string encoding;
+    std::string text;
+    if (static_cast<const base::DictionaryValue*>(entry.get())->
+            GetDictionary("response.content", &content) &&
+        content->GetString("encoding", &encoding) &&
+        encoding == "base64" &&
+        content->GetString("text", &text)) {
+      payloads_->push_back(std::string());
+      payloads_->back().swap(text);
+    }
+    return true;
+  }
+
+ private:
+  std::vector<std::string>* payloads_;
+
+  DISALLOW_COPY_AND_ASSIGN(PayloadCollector);
+};
+
+bool ReadFile(const char* filename, std::string* out) {
+  std::ifstream in(filename, std::ios::in | std::ios::binary);
+  if (!in) {
+    fprintf(stderr, "Could not read input from %s\n", filename);
+    return false;
+  }
+  in.seekg(0, std::ios::end);
+  const int length = in.tellg();
+  in.seekg(0, std::ios::beg);
+  out->resize(length);
+  if (length > 0) {
+    in.read(&(*out)[0], length);
+  }
+  return true;
+}
+
+const char* GetImplementationName(pagespeed::Base64Implementation impl) {
+  switch (impl) {
+    case pagespeed::BASE64_SCALAR:
+      return "scalar";
+    case pagespeed::BASE64_SSSE3:
+      return "ssse3";
+    case pagespeed::BASE64_AVX2:
+      return "avx2";
+  }
+  return "unknown";
+}
+
+// Decode every payload kIterations times, using the given implementation,
+// or modp_b64 directly if use_modp is true. Returns false if any payload
+// fails to decode.
+bool TimeDecoder(bool use_modp,
+                 pagespeed::Base64Implementation impl,
+                 const std::vector<std::string>& payloads,
+                 base::TimeDelta* elapsed_out) {
+  std::string output;
+  const base::TimeTicks start = base::TimeTicks::HighResNow();
+  for (int i = 0; i < kIterations; ++i) {
+    for (std::vector<std::string>::const_iterator it = payloads.begin(),
+             end = payloads.end(); it != end; ++it) {
+      output.resize(pagespeed::Base64DecodedLengthBound(it->size()));
+      int decoded;
+      if (use_modp) {
+        decoded = modp_b64_decode(&output[0], it->data(), it->size());
+      } else {
+        decoded = pagespeed::Base64DecodeWithImplementation(
+            impl, it->data(), it->size(), &output[0]);
+      }
+      if (decoded < 0) {
+        return false;
+      }
+    }
+  }
+  *elapsed_out = base::TimeTicks::HighResNow() - start;
+  return true;
+}
+
+void PrintResult(const char* name,
+                 int64 total_bytes,
+                 const base::TimeDelta& elapsed) {
+  const double seconds = elapsed.InSecondsF();
+  const double megabytes =
+      static_cast<double>(total_bytes) * kIterations / (1024 * 1024);
+  printf("%-8s %10.2f ms %10.1f MB/s\n",
+         name,
+         elapsed.InMillisecondsF() / kIterations,
+         seconds > 0 ? megabytes / seconds : 0.0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: base64_benchmark <har file> [<har file>...]\n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::string> payloads;
+  int64 total_bytes = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::string har;
+    if (!ReadFile(argv[i], &har)) {
+      return EXIT_FAILURE;
+    }
+    PayloadCollector collector(&payloads);
+    pagespeed::JsonStreamParser parser(&collector);
+    std::string error;
+    scoped_ptr<base::Value> root(parser.Parse(har, &error));
+    if (root == NULL) {
+      fprintf(stderr, "Failed to parse %s: %s\n", argv[i], error.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+  for (std::vector<std::string>::const_iterator it = payloads.begin(),
+           end = payloads.end(); it != end; ++it) {
+    total_bytes += it->size();
+  }
+  if (payloads.empty()) {
+    fprintf(stderr, "No base64 encoded response bodies found.\n");
+    return EXIT_FAILURE;
+  }
+  printf("%d payloads, %lld base64 bytes, %d iterations\n",
+         static_cast<int>(payloads.size()),
+         static_cast<long long>(total_bytes),
+         kIterations);
+
+  base::TimeDelta elapsed;
+  if (!TimeDecoder(true, pagespeed::BASE64_SCALAR, payloads, &elapsed)) {
+    fprintf(stderr, "modp_b64 failed to decode a payload.\n");
+    return EXIT_FAILURE;
+  }
+  PrintResult("modp_b64", total_bytes, elapsed);
+
+  const pagespeed::Base64Implementation best =
+      pagespeed::GetBestBase64Implementation();
+  for (int impl = pagespeed::BASE64_SCALAR; impl <= best; ++impl) {
+    const pagespeed::Base64Implementation implementation =
+        static_cast<pagespeed::Base64Implementation>(impl);
+    if (!TimeDecoder(false, implementation, payloads, &elapsed)) {
+      fprintf(stderr, "%s failed to decode a payload.\n",
+              GetImplementationName(implementation));
+      return EXIT_FAILURE;
+    }
+    PrintResult(GetImplementationName(implementation), total_bytes, elapsed);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Command line utility that converts HAR files into a single input
+// archive (see pagespeed/core/input_archive.h), which the pagespeed
+// tool reads with --input_format=archive. Each page of each HAR becomes
+// a page of the archive, and identical response bodies are stored once
+// across all of them.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/logging.h"
+#include "base/stl_util.h"
+#include "pagespeed/core/input_archive.h"
+#include "pagespeed/core/pagespeed_init.h"
+#include "pagespeed/core/pagespeed_input.h"
+#include "pagespeed/core/thread_pool.h"
+#include "pagespeed/har/http_archive.h"
+#include "third_party/gflags/src/google/gflags.h"
+
+DEFINE_string(output_file, "", "Path to the archive to write.");
+DEFINE_bool(compress, false,
+            "Compress the response bodies in the archive with zlib. "
+            "Compressed bodies take less space, but must be inflated into "
+            "memory when the archive is read.");
+DEFINE_int32(num_threads, 1,
+             "Number of threads to use when parsing each HAR. "
+             "Use 0 to run one thread per processor.");
+
+namespace {
+
+bool ReadFileToString(const std::string& file_name, std::string* dest) {
+  std::ifstream file_stream;
+  file_stream.open(
+      file_name.c_str(), std::ifstream::in | std::ifstream::binary);
+  if (file_stream.fail()) {
+    return false;
+  }
+  dest->assign(std::istreambuf_iterator<char>(file_stream),
+               std::istreambuf_iterator<char>());
+  file_stream.close();
+  return true;
+}
+
+bool WriteStringToFile(const std::string& file_name,
+                       const std::string& contents) {
+  std::ofstream file_stream(file_name.c_str(),
+                            std::ios::out | std::ios::binary);
+  if (!file_stream) {
+    return false;
+  }
+  file_stream.write(contents.data(), contents.size());
+  return file_stream.good();
+}
+
+// Add each page of the given HAR file to the writer.
+bool AddHarFile(const std::string& har_filename,
+                int num_threads,
+                pagespeed::InputArchiveWriter* writer,
+                int* num_resources) {
+  std::string har_data;
+  if (!ReadFileToString(har_filename, &har_data)) {
+    fprintf(stderr, "Could not read input from %s.\n", har_filename.c_str());
+    return false;
+  }
+  std::vector<pagespeed::PagespeedInput*> inputs;
+  if (!pagespeed::ParseMultiPageHttpArchive(har_data, num_threads, &inputs)) {
+    fprintf(stderr, "Failed to parse %s.\n", har_filename.c_str());
+    return false;
+  }
+  for (std::vector<pagespeed::PagespeedInput*>::const_iterator
+           it = inputs.begin(), end = inputs.end(); it != end; ++it) {
+    writer->AddPage(**it, "", "");
+    *num_resources += (*it)->num_resources();
+  }
+  STLDeleteElements(&inputs);
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (!pagespeed::Init()) {
+    LOG(ERROR) << "Failed to initialize PageSpeed. Aborting.";
+    return EXIT_FAILURE;
+  }
+  base::AtExitManager at_exit_manager;
+
+  ::google::SetUsageMessage(
+      "Converts HAR files into an input archive.\n"
+      "Usage: har_to_archive --output_file=<archive> <har file> "
+      "[<har file>...]");
+  ::google::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_output_file.empty() || argc < 2) {
+    ::google::ShowUsageWithFlagsRestrict(argv[0], __FILE__);
+    return EXIT_FAILURE;
+  }
+
+  const int num_threads = FLAGS_num_threads > 0 ?
+      FLAGS_num_threads : pagespeed::ThreadPool::GetNumberOfProcessors();
+
+  pagespeed::InputArchiveWriter writer;
+  writer.set_compress_blobs(FLAGS_compress);
+  int num_resources = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (!AddHarFile(argv[i], num_threads, &writer, &num_resources)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::string archive;
+  if (!writer.Finish(&archive)) {
+    fprintf(stderr, "Failed to build the archive.\n");
+    return EXIT_FAILURE;
+  }
+  if (!WriteStringToFile(FLAGS_output_file, archive)) {
+    fprintf(stderr, "Could not write output to %s.\n",
+            FLAGS_output_file.c_str());
+    return EXIT_FAILURE;
+  }
+  printf("Wrote %d pages, %d resources and %d unique blobs to %s "
+         "(%d bytes).\n",
+         writer.num_pages(), num_resources, writer.num_blobs(),
+         FLAGS_output_file.c_str(), static_cast<int>(archive.size()));
+  return EXIT_SUCCESS;
+}
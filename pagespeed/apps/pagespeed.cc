@@ -21,24 +21,30 @@
 
 #include "base/at_exit.h"
 #include "base/command_line.h"
-#include "base/json/json_reader.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/stl_util.h"
-#include "base/values.h"
+#include "base/string_split.h"
+#include "base/stringprintf.h"
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "google/protobuf/stubs/common.h"
+#include "pagespeed/core/cost_timer.h"
 #include "pagespeed/core/dom.h"
 #include "pagespeed/core/engine.h"
+#include "pagespeed/core/input_archive.h"
 #include "pagespeed/core/input_capabilities.h"
 #include "pagespeed/core/pagespeed_init.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/pagespeed_input_util.h"
 #include "pagespeed/core/pagespeed_version.h"
 #include "pagespeed/core/resource.h"
+#include "pagespeed/core/resource_result_cache.h"
 #include "pagespeed/core/rule.h"
+#include "pagespeed/core/shared_buffer.h"
 #include "pagespeed/core/string_util.h"
+#include "pagespeed/core/thread_pool.h"
 #include "pagespeed/dom/json_dom.h"
+#include "pagespeed/filters/rule_name_result_filter.h"
 #include "pagespeed/formatters/proto_formatter.h"
 #include "pagespeed/har/http_archive.h"
 #include "pagespeed/image_compression/image_attributes_factory.h"
@@ -54,12 +60,16 @@
 #include "pagespeed/proto/proto_resource_utils.h"
 #include "pagespeed/proto/results_to_json_converter.h"
 #include "pagespeed/proto/timeline.pb.h"
+#include "pagespeed/rules/minifier_artifact_computer.h"
 #include "pagespeed/rules/rule_provider.h"
 #include "pagespeed/timeline/json_importer.h"
 #include "third_party/gflags/src/google/gflags.h"
 
 DEFINE_string(input_format, "har",
-              "Format of input_file. One of 'har' or 'proto'.");
+              "Format of input_file. One of 'har', 'proto' or 'archive'.");
+DEFINE_int32(archive_page, 0,
+             "Index of the page to analyze, when the input_format is "
+             "'archive'.");
 DEFINE_string(output_format, "text",
               "Format of the output. "
               "One of 'proto', 'text', 'unformatted_json', "
@@ -80,6 +90,40 @@ DEFINE_string(log_file, "",
               "Logs will be printed only to console if not specified.");
 DEFINE_bool(also_log_to_stderr, false,
             "Output logs to error console along with the log file. ");
+DEFINE_int32(num_threads, 1,
+             "Number of threads to use when loading the input and "
+             "running rules. "
+             "Use 0 to run one thread per processor.");
+DEFINE_bool(profile_rules, false,
+            "Measure the cost of running each rule, and print a table of "
+            "rules sorted by cost to stderr.");
+DEFINE_string(rules, "",
+              "Comma-separated names of the rules to run. Runs all rules if "
+              "empty.");
+DEFINE_int32(rule_time_budget_ms, 0,
+             "Maximum time, in milliseconds, that each rule may spend "
+             "computing results. Rules that run out of time report partial "
+             "results. Use 0 for no limit.");
+DEFINE_bool(estimate_compressed_sizes, false,
+            "Estimate the gzipped sizes of resources by compressing them "
+            "at a faster level. Speeds up inputs with a lot of text, but "
+            "makes the savings reported by compression and minification "
+            "rules approximate.");
+DEFINE_string(resource_result_cache_file, "",
+              "Path to a file in which to persist the results of rules that "
+              "analyze each resource independently, so that later runs only "
+              "analyze new or modified resources with those rules. Created "
+              "if it does not exist. Optional.");
+DEFINE_bool(evict_unused_resource_results, false,
+            "Drop the results in --resource_result_cache_file that this run "
+            "did not use before writing it back, so that the file does not "
+            "grow as resources change. Only use this if every run analyzes "
+            "the same page with the same rules, since the results of other "
+            "pages and rules are dropped too.");
+DEFINE_bool(stream_results, false,
+            "Write the results of each rule as soon as it completes, rather "
+            "than once all rules have completed. Only supported for the "
+            "'text' and 'formatted_json' output formats.");
 
 // gflags defines its own version flag, which doesn't actually provide
 // any way to show the version of the program. We disable processing
@@ -134,6 +178,53 @@ pagespeed::PagespeedInput* ParseProtoInput(const std::string& file_contents) {
   return input;
 }
 
+// Opens the archive held in the given buffer with the given reader, and
+// returns the input of the given page of the archive, or NULL on error.
+pagespeed::PagespeedInput* ParseArchiveInput(
+    pagespeed::SharedBuffer* archive_buffer,
+    int page_index,
+    pagespeed::InputArchiveReader* reader) {
+  if (!reader->Open(archive_buffer)) {
+    return NULL;
+  }
+  if (page_index < 0 || page_index >= reader->num_pages()) {
+    fprintf(stderr, "Invalid archive page %d: the archive has %d pages.\n",
+            page_index, reader->num_pages());
+    return NULL;
+  }
+  scoped_ptr<pagespeed::PagespeedInput> input(new pagespeed::PagespeedInput);
+  if (!reader->PopulatePagespeedInput(page_index, input.get())) {
+    return NULL;
+  }
+  return input.release();
+}
+
+// Get the types of the timeline records inspected by the given rules
+// that the filter accepts. Returns false if one of those rules uses the
+// timeline without saying which record types it inspects, in which case
+// the whole timeline must be kept.
+bool GetTimelineRecordTypes(
+    const std::vector<pagespeed::Rule*>& rules,
+    const pagespeed::ResultFilter& filter,
+    std::vector<pagespeed::InstrumentationData::RecordType>* out) {
+  const pagespeed::InputCapabilities timeline_data(
+      pagespeed::InputCapabilities::TIMELINE_DATA);
+  for (std::vector<pagespeed::Rule*>::const_iterator it = rules.begin(),
+           end = rules.end(); it != end; ++it) {
+    const pagespeed::Rule& rule = **it;
+    if (!filter.IsRuleAccepted(rule) ||
+        !rule.capability_requirements().satisfies(timeline_data)) {
+      continue;
+    }
+    const size_t num_types = out->size();
+    rule.AppendTimelineRecordTypes(out);
+    if (out->size() == num_types) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void PrintUsage() {
   ::google::ShowUsageWithFlagsRestrict(::google::GetArgv0(), __FILE__);
 }
@@ -159,6 +250,183 @@ void PrintVersion() {
 #endif
 }
 
+// Orders RuleTimings by decreasing CPU time, or by decreasing wall
+// time if CPU time is not available.
+bool IsMoreCostly(const pagespeed::RuleTiming* a,
+                  const pagespeed::RuleTiming* b) {
+  if (a->has_cpu_time_millis() && b->has_cpu_time_millis() &&
+      a->cpu_time_millis() != b->cpu_time_millis()) {
+    return a->cpu_time_millis() > b->cpu_time_millis();
+  }
+  return a->wall_time_millis() > b->wall_time_millis();
+}
+
+void PrintRuleTimings(const pagespeed::Results& results,
+                      const pagespeed::RuleTiming* format_timing) {
+  std::vector<const pagespeed::RuleTiming*> timings;
+  for (int i = 0; i < results.stage_timings_size(); ++i) {
+    timings.push_back(&results.stage_timings(i));
+  }
+  for (int i = 0; i < results.rule_results_size(); ++i) {
+    if (results.rule_results(i).has_timing()) {
+      timings.push_back(&results.rule_results(i).timing());
+    }
+  }
+  if (format_timing != NULL) {
+    timings.push_back(format_timing);
+  }
+  std::stable_sort(timings.begin(), timings.end(), IsMoreCostly);
+
+  fprintf(stderr, "%-40s %12s %12s %14s %8s\n",
+          "Name", "Wall (ms)", "CPU (ms)", "Heap delta", "Results");
+  for (std::vector<const pagespeed::RuleTiming*>::const_iterator
+           it = timings.begin(), end = timings.end();
+       it != end;
+       ++it) {
+    const pagespeed::RuleTiming& timing = **it;
+    std::string cpu_time = "-";
+    if (timing.has_cpu_time_millis()) {
+      cpu_time = base::StringPrintf("%.3f", timing.cpu_time_millis());
+    }
+    std::string heap_bytes_delta = "-";
+    if (timing.has_heap_bytes_delta()) {
+      heap_bytes_delta = base::StringPrintf(
+          "%lld", static_cast<long long>(timing.heap_bytes_delta()));
+    }
+    std::string num_results = "-";
+    if (timing.has_num_results()) {
+      num_results = pagespeed::string_util::IntToString(timing.num_results());
+    }
+    fprintf(stderr, "%-40s %12.3f %12s %14s %8s\n",
+            timing.name().c_str(),
+            timing.wall_time_millis(),
+            cpu_time.c_str(),
+            heap_bytes_delta.c_str(),
+            num_results.c_str());
+  }
+}
+
+// Writes the formatted results of each rule to an output stream as soon
+// as the rule has been formatted, in the same format that converting the
+// complete FormattedResults would produce.
+class StreamingOutputListener
+    : public pagespeed::formatters::FormattedResultsListener {
+ public:
+  StreamingOutputListener(OutputFormat output_format,
+                          const std::string& locale,
+                          std::ostream* out)
+      : output_format_(output_format),
+        locale_(locale),
+        out_(out),
+        num_rules_(0),
+        success_(true) {}
+
+  virtual void OnRuleResults(const pagespeed::FormattedRuleResults& rules) {
+    std::string out;
+    bool converted = true;
+    if (output_format_ == TEXT_OUTPUT) {
+      converted = pagespeed::proto::FormattedResultsToTextConverter::
+          ConvertFormattedRuleResults(rules, &out);
+    } else {
+      if (num_rules_ == 0) {
+        converted = pagespeed::proto::FormattedResultsToJsonConverter::
+            ConvertStreamingBegin(locale_, &out);
+      }
+      converted = pagespeed::proto::FormattedResultsToJsonConverter::
+          ConvertStreamingRuleResults(rules, num_rules_ == 0, &out) &&
+          converted;
+    }
+    if (!converted) {
+      LOG(ERROR) << "Failed to convert results of " << rules.rule_name();
+      success_ = false;
+    }
+    ++num_rules_;
+    Write(out);
+  }
+
+  virtual void OnFinalize(const pagespeed::FormattedResults& results) {
+    std::string out;
+    bool converted = true;
+    if (output_format_ == TEXT_OUTPUT) {
+      pagespeed::proto::FormattedResultsToTextConverter::ConvertScore(
+          results, &out);
+    } else {
+      if (num_rules_ == 0) {
+        converted = pagespeed::proto::FormattedResultsToJsonConverter::
+            ConvertStreamingBegin(locale_, &out);
+      }
+      converted = pagespeed::proto::FormattedResultsToJsonConverter::
+          ConvertStreamingEnd(results, &out) && converted;
+    }
+    if (!converted) {
+      LOG(ERROR) << "Failed to convert overall results.";
+      success_ = false;
+    }
+    Write(out);
+  }
+
+  // Whether all of the results were converted and written successfully.
+  bool success() const { return success_; }
+
+ private:
+  const OutputFormat output_format_;
+  const std::string locale_;
+  std::ostream* const out_;
+  void Write(const std::string& out) {
+    *out_ << out;
+    out_->flush();
+    if (!*out_) {
+      success_ = false;
+    }
+  }
+
+  int num_rules_;
+  bool success_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamingOutputListener);
+};
+
+// Computes the results, writing each rule's formatted results to the
+// output as soon as they are available.
+bool ComputeAndStreamResults(const pagespeed::Engine& engine,
+                             const pagespeed::PagespeedInput& input,
+                             const pagespeed::ResultFilter& filter,
+                             const pagespeed::l10n::Localizer* localizer,
+                             OutputFormat output_format,
+                             const std::string& out_filename,
+                             pagespeed::Results* results) {
+  std::ofstream out_file_stream;
+  std::ostream* out_stream = &std::cout;
+  if (out_filename != "-") {
+    out_file_stream.open(out_filename.c_str(),
+                         std::ios::out | std::ios::binary);
+    if (!out_file_stream) {
+      fprintf(stderr, "Could not write output to %s.\n", out_filename.c_str());
+      return false;
+    }
+    out_stream = &out_file_stream;
+  }
+
+  pagespeed::FormattedResults formatted_results;
+  formatted_results.set_locale(localizer->GetLocale());
+  StreamingOutputListener listener(output_format, formatted_results.locale(),
+                                   out_stream);
+  pagespeed::formatters::ProtoFormatter formatter(localizer,
+                                                  &formatted_results);
+  formatter.set_listener(&listener);
+  if (!engine.ComputeAndFormatResultsStreaming(input, filter, &formatter,
+                                               results)) {
+    // As with ComputeResults, rules that fail still leave the results of
+    // the others, which have been written out.
+    LOG(WARNING) << "Some rules failed to compute their results.";
+  }
+  if (!listener.success()) {
+    fprintf(stderr, "Failed to write results.\n");
+    return false;
+  }
+  return true;
+}
+
 bool RunPagespeed(const std::string& out_format,
                   const std::string& in_format,
                   const std::string& in_filename,
@@ -200,7 +468,17 @@ bool RunPagespeed(const std::string& out_format,
   }
 
   std::string file_contents;
-  if (in_filename == "-") {
+  scoped_refptr<pagespeed::SharedBuffer> archive_buffer;
+  if (in_format == "archive" && in_filename != "-") {
+    // Map archives rather than reading them, so that the resources can
+    // reference their response bodies in the mapped file.
+    archive_buffer = pagespeed::SharedBuffer::MapFile(in_filename);
+    if (archive_buffer == NULL) {
+      fprintf(stderr, "Could not read input from %s.\n", in_filename.c_str());
+      PrintUsage();
+      return false;
+    }
+  } else if (in_filename == "-") {
     // Special case: if user specifies input file as '-', read the
     // input from stdin.
     file_contents.assign(std::istreambuf_iterator<char>(std::cin),
@@ -231,11 +509,22 @@ bool RunPagespeed(const std::string& out_format,
     LOG(INFO) << "Byte order mark ignored.";
   }
 
+  const int num_threads = FLAGS_num_threads > 0 ?
+      FLAGS_num_threads : pagespeed::ThreadPool::GetNumberOfProcessors();
+
+  pagespeed::InputArchiveReader archive_reader;
   scoped_ptr<pagespeed::PagespeedInput> input;
   if (in_format == "har") {
-    input.reset(pagespeed::ParseHttpArchive(file_contents));
+    input.reset(pagespeed::ParseHttpArchiveWithThreads(
+        file_contents, NULL, num_threads));
   } else if (in_format == "proto") {
     input.reset(ParseProtoInput(file_contents));
+  } else if (in_format == "archive") {
+    if (archive_buffer == NULL) {
+      archive_buffer = pagespeed::SharedBuffer::TakeString(&file_contents);
+    }
+    input.reset(ParseArchiveInput(archive_buffer.get(), FLAGS_archive_page,
+                                  &archive_reader));
   } else {
     fprintf(stderr, "Invalid input format %s.\n", in_format.c_str());
     PrintUsage();
@@ -254,10 +543,38 @@ bool RunPagespeed(const std::string& out_format,
   input->AcquireImageAttributesFactory(
       new pagespeed::image_compression::ImageAttributesFactory());
 
+  std::vector<pagespeed::Rule*> rules;
+
+  // In environments where exceptions can be thrown, use
+  // STLElementDeleter to make sure we free the rules in the event
+  // that they are not transferred to the Engine.
+  STLElementDeleter<std::vector<pagespeed::Rule*> > rule_deleter(&rules);
+
+  const bool save_optimized_content = true;
+  pagespeed::rule_provider::AppendPageSpeedRules(save_optimized_content,
+                                                 &rules);
+  if (strategy == MOBILE) {
+    pagespeed::rule_provider::AppendRuleSet(
+        save_optimized_content,
+        pagespeed::rule_provider::MOBILE_BROWSER_RULES,
+        &rules);
+  }
+
+  scoped_ptr<pagespeed::ResultFilter> filter;
+  if (FLAGS_rules.empty()) {
+    filter.reset(new pagespeed::AlwaysAcceptResultFilter());
+  } else {
+    std::vector<std::string> rule_names;
+    base::SplitString(FLAGS_rules, ',', &rule_names);
+    filter.reset(new pagespeed::RuleNameResultFilter(rule_names));
+  }
+
   std::vector<const pagespeed::InstrumentationData*> instrumentation_data;
   {
+    std::string instrumentation_source(instrumentation_filename);
+    std::string instrumentation_file_contents;
+    base::StringPiece timeline_json;
     if (!instrumentation_filename.empty()) {
-      std::string instrumentation_file_contents;
       if (!ReadFileToString(instrumentation_filename,
                             &instrumentation_file_contents)) {
         fprintf(stderr, "Could not read input from %s.\n",
@@ -265,11 +582,32 @@ bool RunPagespeed(const std::string& out_format,
         PrintUsage();
         return false;
       }
+      timeline_json = instrumentation_file_contents;
+    } else if (in_format == "archive") {
+      // Fall back to the timeline stored in the archive, if any. It is
+      // parsed in place, without being copied out of the archive.
+      if (!archive_reader.GetTimelineJson(FLAGS_archive_page, &timeline_json)) {
+        fprintf(stderr, "Failed to read instrumentation data from %s.\n",
+                in_filename.c_str());
+        return false;
+      }
+      if (!timeline_json.empty()) {
+        instrumentation_source = in_filename;
+      }
+    }
 
-      if (!pagespeed::timeline::CreateTimelineProtoFromJsonString(
-              instrumentation_file_contents, &instrumentation_data)) {
+    if (!instrumentation_source.empty()) {
+      // Only keep the records that the rules we run will inspect.
+      std::vector<pagespeed::InstrumentationData::RecordType> record_types;
+      const bool parsed =
+          GetTimelineRecordTypes(rules, *filter, &record_types) ?
+          pagespeed::timeline::CreateFilteredTimelineProtoFromJsonString(
+              timeline_json, record_types, &instrumentation_data) :
+          pagespeed::timeline::CreateTimelineProtoFromJsonString(
+              timeline_json, &instrumentation_data);
+      if (!parsed) {
         fprintf(stderr, "Failed to parse instrumentation data from %s.\n",
-                instrumentation_filename.c_str());
+                instrumentation_source.c_str());
         PrintUsage();
         return false;
       }
@@ -282,34 +620,36 @@ bool RunPagespeed(const std::string& out_format,
 
   scoped_ptr<pagespeed::DomDocument> document;
   {
+    std::string dom_source(dom_filename);
+    std::string dom_file_contents;
     if (!dom_filename.empty()) {
-      std::string dom_file_contents;
       if (!ReadFileToString(dom_filename, &dom_file_contents)) {
         fprintf(stderr, "Could not read input from %s.\n",
                 dom_filename.c_str());
         PrintUsage();
         return false;
       }
-
-      std::string error_msg_out;
-      scoped_ptr<const base::Value> document_json(
-          base::JSONReader::ReadAndReturnError(
-              dom_file_contents,
-              true,  // allow_trailing_comma
-              NULL,  // error_code_out (ReadAndReturnError permits NULL here)
-              &error_msg_out));
-      if (document_json == NULL) {
-        fprintf(stderr, "Could not parse DOM: %s.\n", error_msg_out.c_str());
-        PrintUsage();
+    } else if (in_format == "archive") {
+      // Fall back to the DOM stored in the archive, if any.
+      base::StringPiece dom_json;
+      if (!archive_reader.GetDomJson(FLAGS_archive_page, &dom_json)) {
+        fprintf(stderr, "Failed to read DOM from %s.\n",
+                in_filename.c_str());
         return false;
       }
-      if (document_json->IsType(base::Value::TYPE_DICTIONARY)) {
-        document.reset(pagespeed::dom::CreateDocument(
-            static_cast<const base::DictionaryValue*>(document_json.release())));
+      if (!dom_json.empty()) {
+        dom_json.CopyToString(&dom_file_contents);
+        dom_source = in_filename;
       }
+    }
+
+    if (!dom_source.empty()) {
+      std::string error_msg_out;
+      document.reset(pagespeed::dom::CreateDocumentFromJson(dom_file_contents,
+                                                            &error_msg_out));
       if (document == NULL) {
-        fprintf(stderr, "Failed to parse DOM from %s.\n",
-                dom_filename.c_str());
+        fprintf(stderr, "Failed to parse DOM from %s: %s.\n",
+                dom_source.c_str(), error_msg_out.c_str());
         PrintUsage();
         return false;
       }
@@ -326,24 +666,17 @@ bool RunPagespeed(const std::string& out_format,
     input->SetClientCharacteristics(cc);
   }
 
-  input->Freeze();
-
-  std::vector<pagespeed::Rule*> rules;
-
-  // In environments where exceptions can be thrown, use
-  // STLElementDeleter to make sure we free the rules in the event
-  // that they are not transferred to the Engine.
-  STLElementDeleter<std::vector<pagespeed::Rule*> > rule_deleter(&rules);
-
-  const bool save_optimized_content = true;
-  pagespeed::rule_provider::AppendPageSpeedRules(save_optimized_content,
-                                                 &rules);
-  if (strategy == MOBILE) {
-    pagespeed::rule_provider::AppendRuleSet(
-        save_optimized_content,
-        pagespeed::rule_provider::MOBILE_BROWSER_RULES,
-        &rules);
+  pagespeed::RuleTiming freeze_timing;
+  if (FLAGS_profile_rules) {
+    // Freezing runs on a single thread, so we can also measure heap use.
+    pagespeed::CostTimer timer(true);
+    input->Freeze();
+    timer.Stop(&freeze_timing);
+    freeze_timing.set_name("PagespeedInput::Freeze");
+  } else {
+    input->Freeze();
   }
+
   pagespeed::InputCapabilities capabilities = input->EstimateCapabilities();
   std::vector<std::string> incompatible_rule_names;
   pagespeed::rule_provider::RemoveIncompatibleRules(
@@ -355,16 +688,83 @@ bool RunPagespeed(const std::string& out_format,
               << "; Capabilities: " << capabilities.DebugString();
   }
 
+  pagespeed::rules::MinifierArtifactComputer artifact_computer;
   // Ownership of rules is transferred to the Engine instance.
   pagespeed::Engine engine(&rules);
+  engine.set_artifact_computer(&artifact_computer);
+  engine.set_num_threads(num_threads);
+  engine.set_profile_rules(FLAGS_profile_rules);
+  engine.set_rule_time_budget_millis(FLAGS_rule_time_budget_ms);
+  engine.set_estimate_compressed_sizes(FLAGS_estimate_compressed_sizes);
+  pagespeed::ResourceResultCache resource_result_cache;
+  if (!FLAGS_resource_result_cache_file.empty()) {
+    std::string cache_contents;
+    if (ReadFileToString(FLAGS_resource_result_cache_file, &cache_contents) &&
+        !resource_result_cache.ParseFromString(cache_contents)) {
+      LOG(WARNING) << "Ignoring unusable resource result cache "
+                   << FLAGS_resource_result_cache_file;
+    }
+    engine.set_resource_result_cache(&resource_result_cache);
+  }
   engine.Init();
 
   pagespeed::Results results;
-  engine.ComputeResults(*input, &results);
+  if (FLAGS_profile_rules) {
+    results.add_stage_timings()->CopyFrom(freeze_timing);
+  }
+  const bool stream_results =
+      FLAGS_stream_results &&
+      (output_format == TEXT_OUTPUT || output_format == FORMATTED_JSON_OUTPUT);
+  if (FLAGS_stream_results && !stream_results) {
+    LOG(WARNING) << "--stream_results is not supported for output format "
+                 << out_format << ". Ignoring.";
+  }
+  if (stream_results) {
+    if (!ComputeAndStreamResults(engine, *input, *filter, localizer.get(),
+                                 output_format, out_filename, &results)) {
+      return false;
+    }
+  } else {
+    engine.ComputeResults(*input, *filter, &results);
+  }
+  for (int i = 0; i < results.timed_out_rules_size(); ++i) {
+    LOG(WARNING) << "Rule " << results.timed_out_rules(i)
+                 << " ran out of time. Its results are incomplete.";
+  }
+  if (!FLAGS_resource_result_cache_file.empty()) {
+    if (FLAGS_evict_unused_resource_results) {
+      resource_result_cache.EvictUnusedEntries();
+    }
+    std::string cache_contents;
+    std::ofstream cache_stream(FLAGS_resource_result_cache_file.c_str(),
+                               std::ios::out | std::ios::binary);
+    if (resource_result_cache.SerializeToString(&cache_contents) &&
+        cache_stream) {
+      cache_stream << cache_contents;
+    } else {
+      LOG(WARNING) << "Could not write resource result cache to "
+                   << FLAGS_resource_result_cache_file;
+    }
+  }
+
+  if (stream_results) {
+    if (FLAGS_profile_rules) {
+      PrintRuleTimings(results, NULL);
+    }
+    return true;
+  }
+
+  scoped_ptr<pagespeed::RuleTiming> format_timing;
 
   // If the output format is "proto", print the raw results proto; otherwise,
   // use an appropriate converter.
   std::string out;
+  if (output_format == PROTO_OUTPUT || output_format == JSON_OUTPUT) {
+    // The raw results are written out as they are, so filter them first.
+    // They are not needed unfiltered afterwards, so filter them in place
+    // rather than copying them.
+    engine.FilterResultsInPlace(*filter, &results);
+  }
   if (output_format == PROTO_OUTPUT) {
     ::google::protobuf::io::StringOutputStream out_stream(&out);
     results.SerializeToZeroCopyStream(&out_stream);
@@ -377,7 +777,15 @@ bool RunPagespeed(const std::string& out_format,
     formatted_results.set_locale(localizer->GetLocale());
     pagespeed::formatters::ProtoFormatter formatter(localizer.get(),
                                                     &formatted_results);
-    engine.FormatResults(results, &formatter);
+    if (FLAGS_profile_rules) {
+      pagespeed::CostTimer timer(true);
+      engine.FormatResults(results, *filter, &formatter);
+      format_timing.reset(new pagespeed::RuleTiming());
+      timer.Stop(format_timing.get());
+      format_timing->set_name("Engine::FormatResults");
+    } else {
+      engine.FormatResults(results, *filter, &formatter);
+    }
 
     // Convert the FormattedResults into text/json.
     if (output_format == TEXT_OUTPUT) {
@@ -392,6 +800,9 @@ bool RunPagespeed(const std::string& out_format,
     } else if (output_format == PDF_OUTPUT) {
       // We only over write PDF output to a file (enforced in main()).
       DCHECK(out_filename != "-");
+      if (FLAGS_profile_rules) {
+        PrintRuleTimings(results, format_timing.get());
+      }
       return GeneratePdfReportToFile(formatted_results, out_filename);
     } else {
       LOG(DFATAL) << "unexpected output_format value: " << output_format;
@@ -413,6 +824,9 @@ bool RunPagespeed(const std::string& out_format,
     out_stream.close();
   }
 
+  if (FLAGS_profile_rules) {
+    PrintRuleTimings(results, format_timing.get());
+  }
   return true;
 }
 
@@ -499,8 +913,9 @@ int main(int argc, char** argv) {
   logging::InitLogging(
       log_file_path.c_str(),
       log_destination,
-      // Since we are entirely single-threaded no need to lock the log file.
-      logging::DONT_LOCK_LOG_FILE,
+      // When running single-threaded there is no need to lock the log file.
+      FLAGS_num_threads == 1 ?
+          logging::DONT_LOCK_LOG_FILE : logging::LOCK_LOG_FILE,
       logging::APPEND_TO_OLD_LOG_FILE,
       logging::DISABLE_DCHECK_FOR_NON_OFFICIAL_RELEASE_BUILDS);
 
@@ -109,8 +109,8 @@ void BrowsingContextDomResourceVisitor::VisitUrl(const DomElement& node,
       html::ExternalResourceFilter html_resource_filter(&html_parse);
       html_parse.AddFilter(&html_resource_filter);
       html_parse.StartParse(resource->GetRequestUrl());
-      html_parse.ParseText(resource->GetResponseBody().data(),
-                           resource->GetResponseBody().length());
+      html_parse.ParseText(resource->GetResponseBodyPiece().data(),
+                           resource->GetResponseBodyPiece().length());
       html_parse.FinishParse();
 
       std::vector<std::string> url_list;
@@ -0,0 +1,76 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PAGESPEED_CORE_ARTIFACT_COMPUTER_H_
+#define PAGESPEED_CORE_ARTIFACT_COMPUTER_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+
+namespace pagespeed {
+
+class Deadline;
+class Resource;
+
+// Computes the artifacts that RuleInput derives from response bodies
+// and caches for rules, such as minified content. The minifiers live
+// above core, so the rules layer provides the implementation, which is
+// passed to the Engine (see Engine::set_artifact_computer) or to a
+// RuleInput directly (see RuleInput::set_artifact_computer).
+//
+// Each method returns true on success, and false on failure, or if the
+// given deadline (which may be NULL) expires before it is done.
+// Methods may be called concurrently from several threads.
+class ArtifactComputer {
+ public:
+  ArtifactComputer();
+  virtual ~ArtifactComputer();
+
+  virtual bool MinifyJavaScript(const Resource& resource,
+                                const Deadline* deadline,
+                                std::string* output) const = 0;
+
+  // Compute the size of the minified JavaScript, without keeping it.
+  virtual bool GetMinifiedJavaScriptSize(const Resource& resource,
+                                         const Deadline* deadline,
+                                         int* output) const = 0;
+
+  // Compute the size of the JavaScript after minifying it and
+  // collapsing its string literals.
+  virtual bool GetStringCollapsedMinifiedJavaScriptSize(
+      const Resource& resource,
+      const Deadline* deadline,
+      int* output) const = 0;
+
+  virtual bool MinifyCss(const Resource& resource,
+                         const Deadline* deadline,
+                         std::string* output) const = 0;
+
+  // Compute the size of the minified CSS, without keeping it.
+  virtual bool GetMinifiedCssSize(const Resource& resource,
+                                  const Deadline* deadline,
+                                  int* output) const = 0;
+
+  virtual bool MinifyHtml(const Resource& resource,
+                          const Deadline* deadline,
+                          std::string* output) const = 0;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ArtifactComputer);
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_CORE_ARTIFACT_COMPUTER_H_
@@ -0,0 +1,207 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pagespeed/core/cache_policy.h"
+
+#include <string>
+
+#include "base/logging.h"
+#include "pagespeed/core/directive_enumerator.h"
+#include "pagespeed/core/resource_util.h"
+#include "pagespeed/core/string_util.h"
+
+namespace {
+
+using pagespeed::CachePolicy;
+using pagespeed::string_util::StringCaseEqual;
+using pagespeed::string_util::StringToInt;
+
+struct DirectiveName {
+  const char* name;
+  CachePolicy::Directive directive;
+};
+
+const DirectiveName kDirectiveNames[] = {
+  { "no-cache", CachePolicy::NO_CACHE },
+  { "no-store", CachePolicy::NO_STORE },
+  { "must-revalidate", CachePolicy::MUST_REVALIDATE },
+  { "proxy-revalidate", CachePolicy::PROXY_REVALIDATE },
+  { "private", CachePolicy::PRIVATE },
+  { "public", CachePolicy::PUBLIC },
+  { "no-transform", CachePolicy::NO_TRANSFORM },
+};
+
+// Parse the Cache-Control header in a single pass. As with
+// resource_util::GetHeaderDirectives, a directive that appears more
+// than once takes its last value, and nothing is kept if the header
+// cannot be parsed.
+bool ParseCacheControl(const std::string& cache_control, CachePolicy* out) {
+  pagespeed::DirectiveEnumerator e(cache_control);
+  std::string key;
+  std::string value;
+  while (e.GetNext(&key, &value)) {
+    if (key.empty()) {
+      LOG(DFATAL) << "Received empty key.";
+      return false;
+    }
+    if (StringCaseEqual(key, "max-age")) {
+      out->has_max_age = StringToInt(value, &out->max_age_seconds);
+      continue;
+    }
+    if (StringCaseEqual(key, "s-maxage")) {
+      out->has_s_maxage = StringToInt(value, &out->s_maxage_seconds);
+      continue;
+    }
+    for (size_t i = 0; i < arraysize(kDirectiveNames); ++i) {
+      if (StringCaseEqual(key, kDirectiveNames[i].name)) {
+        out->directives |= kDirectiveNames[i].directive;
+        break;
+      }
+    }
+  }
+  if (!e.error() && !e.done()) {
+    LOG(DFATAL) << "Failed to reach terminal state.";
+    return false;
+  }
+  return !e.error();
+}
+
+void ParseTimeHeader(const std::string& header,
+                     bool* out_has_header,
+                     bool* out_valid,
+                     int64* out_millis) {
+  *out_has_header = !header.empty();
+  *out_valid = *out_has_header &&
+      pagespeed::resource_util::ParseTimeValuedHeader(header.c_str(),
+                                                      out_millis);
+  if (!*out_valid) {
+    *out_millis = 0;
+  }
+}
+
+}  // namespace
+
+namespace pagespeed {
+
+CachePolicy::CachePolicy()
+    : cache_control_valid(true),
+      directives(0),
+      has_max_age(false),
+      max_age_seconds(0),
+      has_s_maxage(false),
+      s_maxage_seconds(0),
+      has_date_header(false),
+      has_valid_date(false),
+      date_millis(0),
+      has_expires_header(false),
+      has_valid_expires(false),
+      expires_millis(0),
+      has_last_modified_header(false),
+      has_valid_last_modified(false),
+      last_modified_millis(0),
+      pragma_no_cache(false),
+      vary_star(false),
+      has_query_string(false),
+      has_explicit_no_cache_directive(false),
+      has_explicit_freshness_lifetime(false),
+      freshness_lifetime_millis(0),
+      allows_heuristic_freshness(false) {
+}
+
+void CachePolicy::Compute(const std::string& url,
+                          const HeaderMap& response_headers,
+                          CachePolicy* out) {
+  CachePolicy policy;
+  if (!ParseCacheControl(response_headers.Get(HEADER_CACHE_CONTROL),
+                         &policy)) {
+    LOG(INFO) << "Failed to parse cache control directives for " << url;
+    // Discard any directives seen before the error.
+    policy = CachePolicy();
+    policy.cache_control_valid = false;
+  }
+  ParseTimeHeader(response_headers.Get(HEADER_DATE),
+                  &policy.has_date_header,
+                  &policy.has_valid_date,
+                  &policy.date_millis);
+  ParseTimeHeader(response_headers.Get(HEADER_EXPIRES),
+                  &policy.has_expires_header,
+                  &policy.has_valid_expires,
+                  &policy.expires_millis);
+  ParseTimeHeader(response_headers.Get(HEADER_LAST_MODIFIED),
+                  &policy.has_last_modified_header,
+                  &policy.has_valid_last_modified,
+                  &policy.last_modified_millis);
+  policy.pragma_no_cache =
+      response_headers.Get(HEADER_PRAGMA).find("no-cache") !=
+      std::string::npos;
+  policy.vary_star =
+      response_headers.Get(HEADER_VARY).find('*') != std::string::npos;
+  policy.has_query_string = url.find('?') != std::string::npos;
+
+  policy.has_explicit_no_cache_directive =
+      !policy.cache_control_valid ||
+      policy.HasDirective(NO_CACHE) ||
+      policy.HasDirective(NO_STORE) ||
+      // Cache-Control: max-age=0 means do not cache.
+      (policy.has_max_age && policy.max_age_seconds == 0) ||
+      // An invalid Expires header (e.g. Expires: 0) means do not cache.
+      (policy.has_expires_header && !policy.has_valid_expires) ||
+      policy.pragma_no_cache ||
+      policy.vary_star;
+
+  if (policy.has_explicit_no_cache_directive) {
+    // The resource is never fresh.
+    policy.has_explicit_freshness_lifetime = true;
+  } else if (policy.has_max_age) {
+    // The HTTP/1.1 RFC indicates that Cache-Control: max-age takes
+    // precedence over Expires.
+    policy.has_explicit_freshness_lifetime = true;
+    policy.freshness_lifetime_millis = 1000LL * policy.max_age_seconds;
+  } else if (policy.has_expires_header && policy.has_valid_date) {
+    // Expires is only meaningful relative to Date. Without a valid
+    // Date, the resource may still be heuristically cacheable, but it
+    // is not explicitly cacheable. Expires is known to be valid here,
+    // since an invalid one is a no-cache directive.
+    policy.has_explicit_freshness_lifetime = true;
+    if (policy.expires_millis > policy.date_millis) {
+      policy.freshness_lifetime_millis =
+          policy.expires_millis - policy.date_millis;
+    }
+  }
+
+  // must-revalidate indicates that a non-fresh response should not be
+  // used without validating it at the origin. As for query strings,
+  // the HTTP RFC says:
+  //
+  // ...since some applications have traditionally used GETs and
+  // HEADs with query URLs (those containing a "?" in the rel_path
+  // part) to perform operations with significant side effects,
+  // caches MUST NOT treat responses to such URIs as fresh unless
+  // the server provides an explicit expiration time.
+  //
+  // In practice most browsers do not implement this policy. For
+  // instance, Chrome and IE8 do not look for the query string, while
+  // Firefox (as of version 3.6) does. For the time being we implement
+  // the RFC but it might make sense to revisit this decision in the
+  // future, given that major browser implementations do not match.
+  policy.allows_heuristic_freshness =
+      !policy.has_explicit_freshness_lifetime &&
+      policy.cache_control_valid &&
+      !policy.HasDirective(MUST_REVALIDATE) &&
+      !policy.has_query_string;
+
+  *out = policy;
+}
+
+}  // namespace pagespeed
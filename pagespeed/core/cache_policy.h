@@ -0,0 +1,104 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PAGESPEED_CORE_CACHE_POLICY_H_
+#define PAGESPEED_CORE_CACHE_POLICY_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "pagespeed/core/header_map.h"
+
+namespace pagespeed {
+
+// The caching information in a response: the Cache-Control, Pragma
+// and Vary directives, the Date, Expires and Last-Modified times, and
+// the freshness lifetime derived from them, following the HTTP/1.1
+// RFC. A resource computes its CachePolicy once, when it is frozen, so
+// that the caching rules do not parse the same headers again for each
+// question they ask. ResourceCacheComputer builds its answers on it.
+struct CachePolicy {
+  // Cache-Control directives, as bits of the directives field.
+  enum Directive {
+    NO_CACHE = 1 << 0,
+    NO_STORE = 1 << 1,
+    MUST_REVALIDATE = 1 << 2,
+    PROXY_REVALIDATE = 1 << 3,
+    PRIVATE = 1 << 4,
+    PUBLIC = 1 << 5,
+    NO_TRANSFORM = 1 << 6,
+  };
+
+  CachePolicy();
+
+  // Compute the policy of a response to a request for the given URL.
+  static void Compute(const std::string& url,
+                      const HeaderMap& response_headers,
+                      CachePolicy* out);
+
+  bool HasDirective(Directive directive) const {
+    return (directives & directive) != 0;
+  }
+
+  // False if the Cache-Control header could not be parsed. Such a
+  // response is treated as not cacheable, and has no directives.
+  bool cache_control_valid;
+  // The Directive bits present in Cache-Control.
+  int directives;
+  // Cache-Control: max-age and s-maxage, in seconds. Each is only valid
+  // if present, i.e. if the header contains it with an integer value.
+  bool has_max_age;
+  int max_age_seconds;
+  bool has_s_maxage;
+  int s_maxage_seconds;
+
+  // Whether each header is present and, if so, whether it parsed as a
+  // time, in milliseconds since the epoch.
+  bool has_date_header;
+  bool has_valid_date;
+  int64 date_millis;
+  bool has_expires_header;
+  bool has_valid_expires;
+  int64 expires_millis;
+  bool has_last_modified_header;
+  bool has_valid_last_modified;
+  int64 last_modified_millis;
+
+  // Pragma: no-cache.
+  bool pragma_no_cache;
+  // Vary: *.
+  bool vary_star;
+  // Whether the request URL has a query string, which prevents caches
+  // from treating the response as heuristically fresh.
+  bool has_query_string;
+
+  // The values below are derived from the ones above.
+
+  // Whether any header explicitly prevents caching, e.g.
+  // Cache-Control: no-cache or an invalid Expires header.
+  bool has_explicit_no_cache_directive;
+  // Whether the response has an explicit freshness lifetime, and if
+  // so, what it is. The lifetime is 0 when it has none.
+  bool has_explicit_freshness_lifetime;
+  int64 freshness_lifetime_millis;
+  // Whether the headers and URL allow caches to use heuristics to
+  // decide the response is fresh. This does not consider the status
+  // code or resource type, which ResourceCacheComputer lets its
+  // subclasses decide.
+  bool allows_heuristic_freshness;
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_CORE_CACHE_POLICY_H_
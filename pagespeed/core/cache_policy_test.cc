@@ -0,0 +1,161 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "pagespeed/core/cache_policy.h"
+#include "pagespeed/core/header_map.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using pagespeed::CachePolicy;
+using pagespeed::HeaderMap;
+
+namespace {
+
+const char* kUrl = "http://www.example.com/foo.png";
+
+class CachePolicyTest : public ::testing::Test {
+ protected:
+  void Compute(const std::string& url) {
+    CachePolicy::Compute(url, headers_, &policy_);
+  }
+
+  HeaderMap headers_;
+  CachePolicy policy_;
+};
+
+TEST_F(CachePolicyTest, NoHeaders) {
+  Compute(kUrl);
+  EXPECT_TRUE(policy_.cache_control_valid);
+  EXPECT_EQ(0, policy_.directives);
+  EXPECT_FALSE(policy_.has_max_age);
+  EXPECT_FALSE(policy_.has_date_header);
+  EXPECT_FALSE(policy_.has_expires_header);
+  EXPECT_FALSE(policy_.has_last_modified_header);
+  EXPECT_FALSE(policy_.has_explicit_no_cache_directive);
+  EXPECT_FALSE(policy_.has_explicit_freshness_lifetime);
+  EXPECT_EQ(0, policy_.freshness_lifetime_millis);
+  EXPECT_TRUE(policy_.allows_heuristic_freshness);
+}
+
+TEST_F(CachePolicyTest, CacheControl) {
+  headers_.Add("Cache-Control",
+               "Public, max-age=3600, s-maxage=60, proxy-revalidate");
+  Compute(kUrl);
+  EXPECT_TRUE(policy_.cache_control_valid);
+  EXPECT_TRUE(policy_.HasDirective(CachePolicy::PUBLIC));
+  EXPECT_TRUE(policy_.HasDirective(CachePolicy::PROXY_REVALIDATE));
+  EXPECT_FALSE(policy_.HasDirective(CachePolicy::PRIVATE));
+  EXPECT_FALSE(policy_.HasDirective(CachePolicy::NO_CACHE));
+  ASSERT_TRUE(policy_.has_max_age);
+  EXPECT_EQ(3600, policy_.max_age_seconds);
+  ASSERT_TRUE(policy_.has_s_maxage);
+  EXPECT_EQ(60, policy_.s_maxage_seconds);
+  EXPECT_FALSE(policy_.has_explicit_no_cache_directive);
+  EXPECT_TRUE(policy_.has_explicit_freshness_lifetime);
+  EXPECT_EQ(3600000, policy_.freshness_lifetime_millis);
+  EXPECT_FALSE(policy_.allows_heuristic_freshness);
+}
+
+TEST_F(CachePolicyTest, LastMaxAgeWins) {
+  headers_.Add("Cache-Control", "max-age=10, max-age=20");
+  Compute(kUrl);
+  ASSERT_TRUE(policy_.has_max_age);
+  EXPECT_EQ(20, policy_.max_age_seconds);
+
+  headers_.Remove("Cache-Control");
+  headers_.Add("Cache-Control", "max-age=10, max-age=foo");
+  Compute(kUrl);
+  EXPECT_FALSE(policy_.has_max_age);
+  EXPECT_FALSE(policy_.has_explicit_freshness_lifetime);
+}
+
+TEST_F(CachePolicyTest, NoCacheDirectives) {
+  const char* kNoCacheHeaders[][2] = {
+    { "Cache-Control", "no-cache" },
+    { "Cache-Control", "no-store" },
+    { "Cache-Control", "max-age=0" },
+    { "Expires", "0" },
+    { "Pragma", "no-cache" },
+    { "Vary", "*" },
+  };
+  for (size_t i = 0; i < arraysize(kNoCacheHeaders); ++i) {
+    HeaderMap headers;
+    headers.Add(kNoCacheHeaders[i][0], kNoCacheHeaders[i][1]);
+    CachePolicy policy;
+    CachePolicy::Compute(kUrl, headers, &policy);
+    EXPECT_TRUE(policy.has_explicit_no_cache_directive)
+        << kNoCacheHeaders[i][0] << ": " << kNoCacheHeaders[i][1];
+    EXPECT_TRUE(policy.has_explicit_freshness_lifetime);
+    EXPECT_EQ(0, policy.freshness_lifetime_millis);
+    EXPECT_FALSE(policy.allows_heuristic_freshness);
+  }
+}
+
+TEST_F(CachePolicyTest, InvalidCacheControl) {
+  headers_.Add("Cache-Control", "private, =");
+  Compute(kUrl);
+  EXPECT_FALSE(policy_.cache_control_valid);
+  EXPECT_EQ(0, policy_.directives);
+  EXPECT_TRUE(policy_.has_explicit_no_cache_directive);
+  EXPECT_FALSE(policy_.allows_heuristic_freshness);
+}
+
+TEST_F(CachePolicyTest, HeuristicFreshness) {
+  Compute("http://www.example.com/foo.png?v=1");
+  EXPECT_TRUE(policy_.has_query_string);
+  EXPECT_FALSE(policy_.allows_heuristic_freshness);
+
+  headers_.Add("Cache-Control", "must-revalidate");
+  Compute(kUrl);
+  EXPECT_TRUE(policy_.HasDirective(CachePolicy::MUST_REVALIDATE));
+  EXPECT_FALSE(policy_.has_explicit_freshness_lifetime);
+  EXPECT_FALSE(policy_.allows_heuristic_freshness);
+}
+
+TEST_F(CachePolicyTest, ExpiresIsRelativeToDate) {
+  headers_.Add("Expires", "Tue, 15 Nov 1994 09:12:31 GMT");
+  Compute(kUrl);
+  EXPECT_TRUE(policy_.has_valid_expires);
+  // Without a Date, the Expires header gives no explicit lifetime.
+  EXPECT_FALSE(policy_.has_explicit_freshness_lifetime);
+  EXPECT_TRUE(policy_.allows_heuristic_freshness);
+
+  headers_.Add("Date", "Tue, 15 Nov 1994 08:12:31 GMT");
+  Compute(kUrl);
+  EXPECT_TRUE(policy_.has_valid_date);
+  EXPECT_TRUE(policy_.has_explicit_freshness_lifetime);
+  EXPECT_EQ(3600000, policy_.freshness_lifetime_millis);
+
+  // Cache-Control: max-age takes precedence over Expires.
+  headers_.Add("Cache-Control", "max-age=60");
+  Compute(kUrl);
+  EXPECT_EQ(60000, policy_.freshness_lifetime_millis);
+}
+
+TEST_F(CachePolicyTest, LastModified) {
+  headers_.Add("Last-Modified", "Tue, 15 Nov 1994 08:12:31 GMT");
+  Compute(kUrl);
+  EXPECT_TRUE(policy_.has_last_modified_header);
+  EXPECT_TRUE(policy_.has_valid_last_modified);
+
+  headers_.Remove("Last-Modified");
+  headers_.Add("Last-Modified", "yesterday");
+  Compute(kUrl);
+  EXPECT_TRUE(policy_.has_last_modified_header);
+  EXPECT_FALSE(policy_.has_valid_last_modified);
+  EXPECT_EQ(0, policy_.last_modified_millis);
+}
+
+}  // namespace
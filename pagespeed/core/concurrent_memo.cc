@@ -0,0 +1,103 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pagespeed/core/concurrent_memo.h"
+
+#include "base/lazy_instance.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/time.h"
+#include "pagespeed/util/deadline.h"
+
+namespace {
+
+// How often a thread waiting with a deadline checks whether it has
+// expired. Deadlines can be cancelled at any time, so waiters can not
+// just sleep until the deadline's expiration time.
+const int64 kDeadlinePollIntervalMillis = 5;
+
+// The lock and condition variable that threads waiting for any memo
+// block on.
+struct WaitList {
+  WaitList() : condition(&lock) {}
+
+  base::Lock lock;
+  base::ConditionVariable condition;
+};
+
+base::LazyInstance<WaitList>::Leaky g_wait_list = LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+namespace pagespeed {
+
+bool ConcurrentMemoBase::BeginCompute(const Deadline* deadline) {
+  while (true) {
+    const base::subtle::Atomic32 previous_state =
+        base::subtle::Acquire_CompareAndSwap(&state_, EMPTY, COMPUTING);
+    if (previous_state == EMPTY) {
+      return true;
+    }
+    if (previous_state == PUBLISHED) {
+      return false;
+    }
+    // Another thread is computing the value. Wait for it to either
+    // publish the value or abandon the computation, in which case we
+    // try to claim it ourselves.
+    if (!WaitWhileComputing(deadline)) {
+      return false;
+    }
+  }
+}
+
+bool ConcurrentMemoBase::WaitWhileComputing(const Deadline* deadline) {
+  WaitList* wait_list = g_wait_list.Pointer();
+  base::AutoLock lock(wait_list->lock);
+  while (true) {
+    // Let the computing thread know that it must wake us. It can only
+    // do so while holding the lock, so it can not miss us between this
+    // check and the wait below.
+    const base::subtle::Atomic32 previous_state =
+        base::subtle::Acquire_CompareAndSwap(
+            &state_, COMPUTING, COMPUTING_WITH_WAITERS);
+    if (previous_state != COMPUTING &&
+        previous_state != COMPUTING_WITH_WAITERS) {
+      return true;
+    }
+    if (deadline == NULL) {
+      wait_list->condition.Wait();
+    } else if (deadline->IsExpired()) {
+      return false;
+    } else {
+      wait_list->condition.TimedWait(
+          base::TimeDelta::FromMilliseconds(kDeadlinePollIntervalMillis));
+    }
+  }
+}
+
+void ConcurrentMemoBase::EndCompute(State state) {
+  DCHECK(state == EMPTY || state == PUBLISHED);
+  // If no thread is waiting, there is no one to wake.
+  if (base::subtle::Release_CompareAndSwap(&state_, COMPUTING, state) ==
+      COMPUTING) {
+    return;
+  }
+  WaitList* wait_list = g_wait_list.Pointer();
+  base::AutoLock lock(wait_list->lock);
+  DCHECK_EQ(COMPUTING_WITH_WAITERS, base::subtle::NoBarrier_Load(&state_));
+  base::subtle::Release_Store(&state_, state);
+  wait_list->condition.Broadcast();
+}
+
+}  // namespace pagespeed
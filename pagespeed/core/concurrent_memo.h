@@ -0,0 +1,156 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PAGESPEED_CORE_CONCURRENT_MEMO_H_
+#define PAGESPEED_CORE_CONCURRENT_MEMO_H_
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/logging.h"
+
+namespace pagespeed {
+
+class Deadline;
+
+// The state shared by all ConcurrentMemos, whatever the type of their
+// value. Threads waiting for another thread to finish computing a value
+// block on a condition variable shared by every memo, so that memos
+// stay small; a memo only touches it when some thread is waiting for
+// its value.
+class ConcurrentMemoBase {
+ protected:
+  enum State {
+    EMPTY,
+    COMPUTING,
+    // Like COMPUTING, but at least one thread is waiting for the
+    // computation to finish.
+    COMPUTING_WITH_WAITERS,
+    PUBLISHED,
+  };
+
+  ConcurrentMemoBase() : state_(EMPTY) {}
+  ~ConcurrentMemoBase() {}
+
+  bool IsPublished() const {
+    return base::subtle::Acquire_Load(&state_) == PUBLISHED;
+  }
+
+  bool IsComputing() const {
+    const base::subtle::Atomic32 state = base::subtle::NoBarrier_Load(&state_);
+    return state == COMPUTING || state == COMPUTING_WITH_WAITERS;
+  }
+
+  // See ConcurrentMemo::TryBeginCompute.
+  bool BeginCompute(const Deadline* deadline);
+
+  // Leave the COMPUTING state for the given state, which must be EMPTY
+  // or PUBLISHED, waking any threads waiting for the computation.
+  void EndCompute(State state);
+
+  // Discard the state, which must not be COMPUTING.
+  void ResetState() {
+    DCHECK(!IsComputing());
+    base::subtle::NoBarrier_Store(&state_, EMPTY);
+  }
+
+ private:
+  // Block while another thread is computing the value. Returns false if
+  // the given deadline expired first.
+  bool WaitWhileComputing(const Deadline* deadline);
+
+  volatile base::subtle::Atomic32 state_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentMemoBase);
+};
+
+// Holds a value that is computed at most once, even if it is requested
+// concurrently from several threads. Once the value has been published,
+// it can be read from any thread without locking.
+//
+// Typical usage:
+//
+//   const Foo* foo = memo->Get();
+//   if (foo == NULL) {
+//     if (memo->TryBeginCompute(deadline)) {
+//       ComputeFoo(memo->mutable_value());
+//       memo->Publish();
+//     }
+//     foo = memo->Get();  // NULL if the deadline expired.
+//   }
+template <typename T>
+class ConcurrentMemo : public ConcurrentMemoBase {
+ public:
+  ConcurrentMemo() : value_() {}
+
+  // Get the memoized value, or NULL if it has not yet been published.
+  const T* Get() const {
+    return IsPublished() ? &value_ : NULL;
+  }
+
+  // Claim responsibility for computing the value. If this returns
+  // true, the caller must populate mutable_value() and then call
+  // either Publish() or AbandonCompute(). If this returns false, either
+  // the value has been published, or the given deadline (which may be
+  // NULL) expired while waiting for another thread to finish computing
+  // it, in which case Get() still returns NULL. Waiting threads block
+  // rather than spin, and if the other thread abandons the computation,
+  // one of them claims it instead.
+  bool TryBeginCompute(const Deadline* deadline) {
+    return BeginCompute(deadline);
+  }
+
+  // Same as TryBeginCompute(NULL): waits for as long as another thread
+  // takes to compute the value.
+  bool TryBeginCompute() {
+    return BeginCompute(NULL);
+  }
+
+  // Get the value to populate. Must only be called by the thread for
+  // which TryBeginCompute() returned true, before calling Publish().
+  T* mutable_value() {
+    DCHECK(IsComputing());
+    return &value_;
+  }
+
+  // Make the computed value visible to all threads.
+  void Publish() {
+    DCHECK(IsComputing());
+    EndCompute(PUBLISHED);
+  }
+
+  // Give up computing the value, e.g. because the computation was
+  // interrupted, and reset mutable_value() to its default. A later
+  // call to TryBeginCompute() may claim the computation again.
+  void AbandonCompute() {
+    DCHECK(IsComputing());
+    value_ = T();
+    EndCompute(EMPTY);
+  }
+
+  // Discard the value, if any. Unlike the other methods, this must not
+  // be called while any other thread may be using the memo.
+  void Reset() {
+    value_ = T();
+    ResetState();
+  }
+
+ private:
+  T value_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentMemo);
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_CORE_CONCURRENT_MEMO_H_
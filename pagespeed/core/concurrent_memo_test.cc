@@ -0,0 +1,126 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/time.h"
+#include "pagespeed/core/concurrent_memo.h"
+#include "pagespeed/core/thread_pool.h"
+#include "pagespeed/util/deadline.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using pagespeed::ConcurrentMemo;
+using pagespeed::Deadline;
+using pagespeed::ParallelTask;
+using pagespeed::ThreadPool;
+
+namespace {
+
+// Busy-wait for the given time, so that another thread has the chance
+// to start waiting on a memo.
+void Spin(int64 millis) {
+  Deadline done(base::TimeDelta::FromMilliseconds(millis));
+  while (!done.IsExpired()) {
+  }
+}
+
+// Task 0 finishes the computation the test began, publishing the value
+// or abandoning it, while task 1 asks for the value, computing it
+// itself if it can claim the computation.
+class FinishAndWaitTask : public ParallelTask {
+ public:
+  FinishAndWaitTask(ConcurrentMemo<int>* memo, bool abandon)
+      : memo_(memo), abandon_(abandon), waiter_claimed_(false) {}
+
+  virtual void RunTask(int task_index) {
+    if (task_index == 0) {
+      Spin(20);
+      if (abandon_) {
+        memo_->AbandonCompute();
+      } else {
+        *memo_->mutable_value() = 42;
+        memo_->Publish();
+      }
+      return;
+    }
+    if (memo_->TryBeginCompute()) {
+      waiter_claimed_ = true;
+      *memo_->mutable_value() = 7;
+      memo_->Publish();
+    }
+  }
+
+  bool waiter_claimed() const { return waiter_claimed_; }
+
+ private:
+  ConcurrentMemo<int>* const memo_;
+  const bool abandon_;
+  bool waiter_claimed_;
+
+  DISALLOW_COPY_AND_ASSIGN(FinishAndWaitTask);
+};
+
+TEST(ConcurrentMemoTest, ComputesOnce) {
+  ConcurrentMemo<int> memo;
+  ASSERT_TRUE(memo.Get() == NULL);
+  ASSERT_TRUE(memo.TryBeginCompute());
+  *memo.mutable_value() = 42;
+  memo.Publish();
+  ASSERT_FALSE(memo.TryBeginCompute());
+  ASSERT_EQ(42, *memo.Get());
+
+  memo.Reset();
+  ASSERT_TRUE(memo.Get() == NULL);
+  ASSERT_TRUE(memo.TryBeginCompute());
+}
+
+TEST(ConcurrentMemoTest, WaiterGetsPublishedValue) {
+  ConcurrentMemo<int> memo;
+  ASSERT_TRUE(memo.TryBeginCompute());
+  FinishAndWaitTask task(&memo, false);
+  ThreadPool(2).Run(&task, 2);
+  ASSERT_FALSE(task.waiter_claimed());
+  ASSERT_EQ(42, *memo.Get());
+}
+
+TEST(ConcurrentMemoTest, WaiterClaimsAbandonedComputation) {
+  ConcurrentMemo<int> memo;
+  ASSERT_TRUE(memo.TryBeginCompute());
+  FinishAndWaitTask task(&memo, true);
+  ThreadPool(2).Run(&task, 2);
+  ASSERT_TRUE(task.waiter_claimed());
+  ASSERT_EQ(7, *memo.Get());
+}
+
+TEST(ConcurrentMemoTest, WaiterGivesUpAtDeadline) {
+  ConcurrentMemo<int> memo;
+  ASSERT_TRUE(memo.TryBeginCompute());
+
+  Deadline expired((base::TimeDelta()));
+  ASSERT_FALSE(memo.TryBeginCompute(&expired));
+  ASSERT_TRUE(memo.Get() == NULL);
+
+  Deadline short_deadline(base::TimeDelta::FromMilliseconds(10));
+  ASSERT_FALSE(memo.TryBeginCompute(&short_deadline));
+  ASSERT_TRUE(short_deadline.IsExpired());
+  ASSERT_TRUE(memo.Get() == NULL);
+
+  // The computation can still be finished, or abandoned and claimed
+  // again, after waiters have given up.
+  memo.AbandonCompute();
+  ASSERT_TRUE(memo.TryBeginCompute(&expired));
+  *memo.mutable_value() = 42;
+  memo.Publish();
+  ASSERT_EQ(42, *memo.Get());
+}
+
+}  // namespace
@@ -37,17 +37,25 @@
         '<(DEPTH)/third_party/domain_registry_provider/src/domain_registry/domain_registry.gyp:domain_registry_lib',
         '<(DEPTH)/<(instaweb_src_root)/instaweb_core.gyp:instaweb_htmlparse_core',
         '<(DEPTH)/third_party/zlib/zlib.gyp:zlib',
+        '<(pagespeed_root)/pagespeed/util/util.gyp:pagespeed_util',
       ],
       'sources': [
+        'artifact_computer.cc',
         'browsing_context.cc',
+        'cache_policy.cc',
+        'concurrent_memo.cc',
+        'cost_timer.cc',
         'directive_enumerator.cc',
         'dom.cc',
         'engine.cc',
         'file_util.cc',
         'formatter.cc',
+        'header_map.cc',
         'image_attributes.cc',
+        'input_archive.cc',
         'input_capabilities.cc',
         'instrumentation_data.cc',
+        'json_stream_parser.cc',
         'pagespeed_input.cc',
         'pagespeed_input_util.cc',
         'pagespeed_version.cc',
@@ -57,11 +65,14 @@
         'resource_evaluation.cc',
         'resource_fetch.cc',
         'resource_filter.cc',
+        'resource_result_cache.cc',
         'resource_util.cc',
         'result_provider.cc',
         'rule.cc',
         'rule_input.cc',
+        'shared_buffer.cc',
         'string_util.cc',
+        'thread_pool.cc',
         'uri_util.cc',
       ],
       'include_dirs': [
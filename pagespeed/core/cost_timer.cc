@@ -0,0 +1,110 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pagespeed/core/cost_timer.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "pagespeed/proto/pagespeed_output.pb.h"
+
+namespace pagespeed {
+
+CostTimer::CostTimer(bool measure_heap)
+    : start_wall_time_(base::TimeTicks::HighResNow()),
+      has_start_cpu_time_(false),
+      start_cpu_time_micros_(0),
+      has_start_heap_bytes_(false),
+      start_heap_bytes_(0) {
+  has_start_cpu_time_ = GetThreadCpuTimeMicros(&start_cpu_time_micros_);
+  if (measure_heap) {
+    has_start_heap_bytes_ = GetHeapBytesInUse(&start_heap_bytes_);
+  }
+}
+
+CostTimer::~CostTimer() {}
+
+void CostTimer::Stop(RuleTiming* timing) const {
+  const base::TimeDelta wall_time =
+      base::TimeTicks::HighResNow() - start_wall_time_;
+  timing->set_wall_time_millis(wall_time.InMillisecondsF());
+
+  int64 cpu_time_micros = 0;
+  if (has_start_cpu_time_ && GetThreadCpuTimeMicros(&cpu_time_micros)) {
+    timing->set_cpu_time_millis(base::TimeDelta::FromMicroseconds(
+        cpu_time_micros - start_cpu_time_micros_).InMillisecondsF());
+  }
+
+  int64 heap_bytes = 0;
+  if (has_start_heap_bytes_ && GetHeapBytesInUse(&heap_bytes)) {
+    timing->set_heap_bytes_delta(heap_bytes - start_heap_bytes_);
+  }
+}
+
+// static
+bool CostTimer::GetThreadCpuTimeMicros(int64* out_micros) {
+#if defined(_WIN32)
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (!GetThreadTimes(GetCurrentThread(),
+                      &creation_time, &exit_time, &kernel_time, &user_time)) {
+    return false;
+  }
+  // FILETIMEs are in units of 100 nanoseconds.
+  ULARGE_INTEGER kernel, user;
+  kernel.LowPart = kernel_time.dwLowDateTime;
+  kernel.HighPart = kernel_time.dwHighDateTime;
+  user.LowPart = user_time.dwLowDateTime;
+  user.HighPart = user_time.dwHighDateTime;
+  *out_micros = static_cast<int64>((kernel.QuadPart + user.QuadPart) / 10);
+  return true;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return false;
+  }
+  *out_micros = static_cast<int64>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// static
+bool CostTimer::GetHeapBytesInUse(int64* out_bytes) {
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+  const struct mallinfo2 info = mallinfo2();
+  *out_bytes = static_cast<int64>(info.uordblks) +
+      static_cast<int64>(info.hblkhd);
+#else
+  // NOTE: mallinfo, which mallinfo2 replaced, reports sizes as ints, so
+  // this is only accurate for heaps smaller than 4GB.
+  const struct mallinfo info = mallinfo();
+  *out_bytes = static_cast<unsigned int>(info.uordblks) +
+      static_cast<unsigned int>(info.hblkhd);
+#endif
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace pagespeed
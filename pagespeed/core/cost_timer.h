@@ -0,0 +1,60 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PAGESPEED_CORE_COST_TIMER_H_
+#define PAGESPEED_CORE_COST_TIMER_H_
+
+#include "base/basictypes.h"
+#include "base/time.h"
+
+namespace pagespeed {
+
+class RuleTiming;
+
+// CostTimer measures the cost of a unit of work performed on the
+// current thread, from the time the CostTimer is constructed until
+// Stop() is called.
+class CostTimer {
+ public:
+  // If measure_heap is true, the net change in heap bytes in use is
+  // also measured. Heap statistics are process wide, so callers should
+  // only request this when no other threads are running.
+  explicit CostTimer(bool measure_heap);
+  ~CostTimer();
+
+  // Record the cost since construction in the given RuleTiming. Does
+  // not modify the name or num_results fields.
+  void Stop(RuleTiming* timing) const;
+
+  // Get the CPU time used by the current thread, in microseconds.
+  // Return false if this platform does not support per-thread CPU time.
+  static bool GetThreadCpuTimeMicros(int64* out_micros);
+
+  // Get the number of heap bytes currently in use by this process.
+  // Return false if this platform does not expose heap statistics.
+  static bool GetHeapBytesInUse(int64* out_bytes);
+
+ private:
+  const base::TimeTicks start_wall_time_;
+  bool has_start_cpu_time_;
+  int64 start_cpu_time_micros_;
+  bool has_start_heap_bytes_;
+  int64 start_heap_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(CostTimer);
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_CORE_COST_TIMER_H_
@@ -0,0 +1,68 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "pagespeed/core/cost_timer.h"
+#include "pagespeed/proto/pagespeed_output.pb.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using pagespeed::CostTimer;
+using pagespeed::RuleTiming;
+
+namespace {
+
+TEST(CostTimerTest, RecordsWallTime) {
+  CostTimer timer(false);
+  RuleTiming timing;
+  timer.Stop(&timing);
+  ASSERT_TRUE(timing.has_wall_time_millis());
+  ASSERT_GE(timing.wall_time_millis(), 0.0);
+  ASSERT_FALSE(timing.has_heap_bytes_delta());
+
+  // Stop() must not modify the name or number of results.
+  ASSERT_FALSE(timing.has_name());
+  ASSERT_FALSE(timing.has_num_results());
+}
+
+TEST(CostTimerTest, RecordsCpuTimeWhenSupported) {
+  int64 cpu_time_micros = 0;
+  const bool supported = CostTimer::GetThreadCpuTimeMicros(&cpu_time_micros);
+
+  CostTimer timer(false);
+  RuleTiming timing;
+  timer.Stop(&timing);
+  ASSERT_EQ(supported, timing.has_cpu_time_millis());
+  if (supported) {
+    ASSERT_GE(timing.cpu_time_millis(), 0.0);
+  }
+}
+
+TEST(CostTimerTest, RecordsHeapBytesWhenSupported) {
+  int64 heap_bytes = 0;
+  const bool supported = CostTimer::GetHeapBytesInUse(&heap_bytes);
+
+  CostTimer timer(true);
+  std::string* allocation = new std::string(1 << 16, 'a');
+  RuleTiming timing;
+  timer.Stop(&timing);
+  delete allocation;
+
+  ASSERT_EQ(supported, timing.has_heap_bytes_delta());
+  if (supported) {
+    ASSERT_GE(timing.heap_bytes_delta(), 1 << 16);
+  }
+}
+
+}  // namespace
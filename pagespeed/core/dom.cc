@@ -79,6 +79,66 @@ void ExternalResourceVisitorAdaptor::Visit(const DomElement& node) {
   }
 }
 
+// Forwards each element to the visitors that entered its document, and
+// descends into the content document of each IFRAME on their behalf.
+class MultiplexingVisitor : public DomElementVisitor {
+ public:
+  explicit MultiplexingVisitor(
+      const std::vector<DomTraversalVisitor*>& visitors)
+      : visitors_(visitors) {}
+
+  virtual void Visit(const DomElement& node);
+
+ private:
+  const std::vector<DomTraversalVisitor*>& visitors_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiplexingVisitor);
+};
+
+// Traverse the given document with those of the given visitors that
+// enter it. frame is the IFRAME element hosting the document, or NULL
+// for the root document.
+void TraverseDocument(const DomDocument& document,
+                      const DomElement* frame,
+                      const std::vector<DomTraversalVisitor*>& visitors) {
+  std::vector<DomTraversalVisitor*> entered;
+  for (std::vector<DomTraversalVisitor*>::const_iterator
+           it = visitors.begin(), end = visitors.end(); it != end; ++it) {
+    if (!(*it)->IsDone() && (*it)->EnterDocument(document, frame)) {
+      entered.push_back(*it);
+    }
+  }
+  if (entered.empty()) {
+    return;
+  }
+
+  MultiplexingVisitor multiplexer(entered);
+  document.Traverse(&multiplexer);
+
+  for (std::vector<DomTraversalVisitor*>::const_iterator
+           it = entered.begin(), end = entered.end(); it != end; ++it) {
+    (*it)->LeaveDocument(document);
+  }
+}
+
+void MultiplexingVisitor::Visit(const DomElement& node) {
+  bool all_done = true;
+  for (std::vector<DomTraversalVisitor*>::const_iterator
+           it = visitors_.begin(), end = visitors_.end(); it != end; ++it) {
+    if (!(*it)->IsDone()) {
+      (*it)->Visit(node);
+      all_done = all_done && (*it)->IsDone();
+    }
+  }
+  if (all_done || node.GetTagName() != "IFRAME") {
+    return;
+  }
+  scoped_ptr<DomDocument> child_doc(node.GetContentDocument());
+  if (child_doc.get() != NULL) {
+    TraverseDocument(*child_doc, &node, visitors_);
+  }
+}
+
 }  // namespace
 
 DomDocument::DomDocument() {}
@@ -157,6 +217,37 @@ DomElementVisitor::DomElementVisitor() {}
 
 DomElementVisitor::~DomElementVisitor() {}
 
+DomTraversalVisitor::DomTraversalVisitor() {}
+
+DomTraversalVisitor::~DomTraversalVisitor() {}
+
+bool DomTraversalVisitor::EnterDocument(const DomDocument& document,
+                                        const DomElement* frame) {
+  return true;
+}
+
+bool DomTraversalVisitor::IsDone() const {
+  return false;
+}
+
+DomTraversal::DomTraversal() {}
+
+DomTraversal::~DomTraversal() {}
+
+void DomTraversal::AddVisitor(DomTraversalVisitor* visitor) {
+  visitors_.push_back(visitor);
+}
+
+void DomTraversal::Traverse(const DomDocument& document) const {
+  TraverseDocument(document, NULL, visitors_);
+}
+
+void DomTraversal::TraverseWithVisitor(const DomDocument& document,
+                                       DomTraversalVisitor* visitor) {
+  TraverseDocument(document, NULL,
+                   std::vector<DomTraversalVisitor*>(1, visitor));
+}
+
 ExternalResourceDomElementVisitor::ExternalResourceDomElementVisitor() {}
 ExternalResourceDomElementVisitor::~ExternalResourceDomElementVisitor() {}
 
@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "base/basictypes.h"
 
@@ -229,6 +230,64 @@ class DomElementVisitor {
   DISALLOW_COPY_AND_ASSIGN(DomElementVisitor);
 };
 
+// A visitor that a DomTraversal runs over a document, and the content
+// documents of its IFRAMEs, along with any number of other visitors.
+// Visit() is called for the elements of each document the visitor
+// entered, in pre-order.
+class DomTraversalVisitor : public DomElementVisitor {
+ public:
+  DomTraversalVisitor();
+  virtual ~DomTraversalVisitor();
+
+  // Called before visiting the elements of a document: the root
+  // document, for which frame is NULL, or the content document of the
+  // given IFRAME element, which has just been visited. Return false to
+  // skip the document, and the documents nested within it. The
+  // document remains valid until the matching LeaveDocument() call.
+  // The default implementation returns true.
+  virtual bool EnterDocument(const DomDocument& document,
+                             const DomElement* frame);
+
+  // Called after visiting the elements of a document for which
+  // EnterDocument() returned true, and those of its nested documents.
+  virtual void LeaveDocument(const DomDocument& document) {}
+
+  // Return true once the visitor does not need to visit anything else.
+  // It is then not called for any further elements or documents, other
+  // than to leave the documents it already entered.
+  virtual bool IsDone() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(DomTraversalVisitor);
+};
+
+// Runs several DomTraversalVisitors over a document, and the content
+// documents of its IFRAMEs, in a single walk: each document is
+// traversed once, and each IFRAME's content document is built once, for
+// all the visitors that enter it.
+class DomTraversal {
+ public:
+  DomTraversal();
+  ~DomTraversal();
+
+  // Add a visitor to run. Ownership is NOT transferred.
+  void AddVisitor(DomTraversalVisitor* visitor);
+
+  bool empty() const { return visitors_.empty(); }
+
+  // Run all the visitors over the given document.
+  void Traverse(const DomDocument& document) const;
+
+  // Run a single visitor over the given document.
+  static void TraverseWithVisitor(const DomDocument& document,
+                                  DomTraversalVisitor* visitor);
+
+ private:
+  std::vector<DomTraversalVisitor*> visitors_;
+
+  DISALLOW_COPY_AND_ASSIGN(DomTraversal);
+};
+
 // A filtered visitor that only vists nodes that reference external
 // resources. Also provides the fully qualified URL of the external
 // resource.
@@ -12,11 +12,22 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string>
+
+#include "base/memory/scoped_ptr.h"
 #include "pagespeed/core/dom.h"
+#include "pagespeed/testing/fake_dom.h"
 #include "pagespeed/testing/pagespeed_test.h"
 
 namespace {
 
+using pagespeed::DomDocument;
+using pagespeed::DomElement;
+using pagespeed::DomTraversal;
+using pagespeed::DomTraversalVisitor;
+using pagespeed_testing::FakeDomDocument;
+using pagespeed_testing::FakeDomElement;
+
 TEST(DomRectTest, Empty) {
   {
     pagespeed::DomRect r(0, 0, 0, 0);
@@ -80,4 +91,126 @@ TEST(DomRectTest, Intersection3) {
   ASSERT_FALSE(intersection.IsEmpty());
 }
 
+// Records the documents and elements it visits, skipping the document
+// with the given URL, and stopping after max_elements elements.
+class RecordingVisitor : public DomTraversalVisitor {
+ public:
+  RecordingVisitor() : max_elements_(-1), num_elements_(0) {}
+
+  void set_skipped_url(const std::string& url) { skipped_url_ = url; }
+  void set_max_elements(int max_elements) { max_elements_ = max_elements; }
+  const std::string& log() const { return log_; }
+
+  virtual bool EnterDocument(const DomDocument& document,
+                             const DomElement* frame) {
+    if (document.GetDocumentUrl() == skipped_url_) {
+      return false;
+    }
+    log_ += "[" + document.GetDocumentUrl() +
+        (frame != NULL ? " in " + frame->GetTagName() : std::string()) + " ";
+    return true;
+  }
+
+  virtual void Visit(const DomElement& node) {
+    log_ += node.GetTagName() + " ";
+    ++num_elements_;
+  }
+
+  virtual void LeaveDocument(const DomDocument& document) {
+    log_ += "]";
+  }
+
+  virtual bool IsDone() const {
+    return max_elements_ >= 0 && num_elements_ >= max_elements_;
+  }
+
+ private:
+  std::string skipped_url_;
+  int max_elements_;
+  int num_elements_;
+  std::string log_;
+};
+
+class DomTraversalTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    document_.reset(FakeDomDocument::NewRoot("http://example.com/"));
+    FakeDomElement* html = FakeDomElement::NewRoot(document_.get(), "HTML");
+    FakeDomElement* body = FakeDomElement::New(html, "BODY");
+    FakeDomElement* iframe = FakeDomElement::NewIframe(body);
+    FakeDomDocument* iframe_doc =
+        FakeDomDocument::New(iframe, "http://example.com/frame.html");
+    FakeDomElement* iframe_html =
+        FakeDomElement::NewRoot(iframe_doc, "HTML");
+    FakeDomElement* nested_iframe = FakeDomElement::NewIframe(iframe_html);
+    FakeDomDocument* nested_doc =
+        FakeDomDocument::New(nested_iframe, "http://example.com/nested.html");
+    FakeDomElement::NewImg(FakeDomElement::NewRoot(nested_doc, "HTML"),
+                           "http://example.com/a.png");
+    FakeDomElement::NewScript(body, "http://example.com/a.js");
+  }
+
+  scoped_ptr<FakeDomDocument> document_;
+};
+
+const char* kFullLog =
+    "[http://example.com/ HTML BODY IFRAME "
+    "[http://example.com/frame.html in IFRAME HTML IFRAME "
+    "[http://example.com/nested.html in IFRAME HTML IMG ]]SCRIPT ]";
+
+TEST_F(DomTraversalTest, SingleVisitor) {
+  RecordingVisitor visitor;
+  DomTraversal::TraverseWithVisitor(*document_, &visitor);
+  EXPECT_EQ(kFullLog, visitor.log());
+}
+
+TEST_F(DomTraversalTest, MultipleVisitors) {
+  RecordingVisitor visitor1;
+  RecordingVisitor visitor2;
+  DomTraversal traversal;
+  EXPECT_TRUE(traversal.empty());
+  traversal.AddVisitor(&visitor1);
+  traversal.AddVisitor(&visitor2);
+  EXPECT_FALSE(traversal.empty());
+  traversal.Traverse(*document_);
+  EXPECT_EQ(kFullLog, visitor1.log());
+  EXPECT_EQ(kFullLog, visitor2.log());
+}
+
+TEST_F(DomTraversalTest, SkipDocument) {
+  RecordingVisitor visitor;
+  RecordingVisitor skipping_visitor;
+  skipping_visitor.set_skipped_url("http://example.com/frame.html");
+  DomTraversal traversal;
+  traversal.AddVisitor(&skipping_visitor);
+  traversal.AddVisitor(&visitor);
+  traversal.Traverse(*document_);
+  EXPECT_EQ(kFullLog, visitor.log());
+  // The nested document is skipped along with the one that hosts it.
+  EXPECT_EQ("[http://example.com/ HTML BODY IFRAME SCRIPT ]",
+            skipping_visitor.log());
+}
+
+TEST_F(DomTraversalTest, SkipRootDocument) {
+  RecordingVisitor visitor;
+  visitor.set_skipped_url("http://example.com/");
+  DomTraversal::TraverseWithVisitor(*document_, &visitor);
+  EXPECT_EQ("", visitor.log());
+}
+
+TEST_F(DomTraversalTest, Done) {
+  RecordingVisitor visitor;
+  RecordingVisitor done_visitor;
+  done_visitor.set_max_elements(5);
+  DomTraversal traversal;
+  traversal.AddVisitor(&done_visitor);
+  traversal.AddVisitor(&visitor);
+  traversal.Traverse(*document_);
+  EXPECT_EQ(kFullLog, visitor.log());
+  // The documents that were entered are still left.
+  EXPECT_EQ("[http://example.com/ HTML BODY IFRAME "
+            "[http://example.com/frame.html in IFRAME HTML IFRAME ]]",
+            done_visitor.log());
+}
+
 }  // namespace
@@ -18,23 +18,89 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/stl_util.h"  // for STLDeleteContainerPointers
+#include "base/synchronization/lock.h"
+#include "base/time.h"
+#include "pagespeed/core/cost_timer.h"
 #include "pagespeed/core/formatter.h"
+#include "pagespeed/core/input_capabilities.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/pagespeed_version.h"
 #include "pagespeed/core/resource.h"
+#include "pagespeed/core/resource_result_cache.h"
 #include "pagespeed/core/resource_util.h"
 #include "pagespeed/core/result_provider.h"
 #include "pagespeed/core/rule.h"
 #include "pagespeed/core/rule_input.h"
+#include "pagespeed/core/thread_pool.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
+#include "pagespeed/util/deadline.h"
 
 namespace pagespeed {
 
+// Notified by Engine::ComputeResultsForInputs as the results of each
+// rule become final: once the rule and every rule before it for the
+// same input have completed, so that result ids have been assigned.
+// Rules are reported in rule order, one at a time, though not
+// necessarily all from the same thread. The engine holds no lock while
+// it calls the listener, so a slow listener does not stop other rules
+// from completing.
+class RuleCompletionListener {
+ public:
+  RuleCompletionListener() {}
+  virtual ~RuleCompletionListener() {}
+
+  virtual void OnRuleComplete(Rule* rule,
+                              const InputInformation& input_info,
+                              RuleResults* rule_results) = 0;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RuleCompletionListener);
+};
+
 namespace {
 
+// Compute the impact of the given rule's results, clamped to be
+// nonnegative.
+double ComputeRuleImpact(Rule* rule,
+                         const InputInformation& input_info,
+                         const RuleResults& rule_results) {
+  if (rule_results.results_size() == 0) {
+    return 0.0;
+  }
+  double impact = rule->ComputeRuleImpact(input_info, rule_results);
+  if (impact < 0.0) {
+    LOG(ERROR) << "Impact for " << rule->name() << " out of bounds: "
+               << impact;
+    impact = 0.0;
+  }
+  return impact;
+}
+
+// Move the elements of the given field at the given indices, which must
+// be in increasing order, to the front of the field, and delete the
+// other elements.
+template <class T>
+void RetainElements(const std::vector<int>& indices,
+                    google::protobuf::RepeatedPtrField<T>* field) {
+  const int num_retained = indices.size();
+  for (int i = 0; i < num_retained; ++i) {
+    // Since the indices are increasing, indices[i] >= i, and the element
+    // at indices[i] has not been moved yet.
+    DCHECK(indices[i] >= i);
+    if (indices[i] != i) {
+      field->SwapElements(i, indices[i]);
+    }
+  }
+  while (field->size() > num_retained) {
+    delete field->ReleaseLast();
+  }
+}
+
 void FormatRuleResults(const RuleResults& rule_results,
                        const InputInformation& input_info,
                        Rule* rule,
@@ -55,12 +121,444 @@ void FormatRuleResults(const RuleResults& rule_results,
   RuleFormatter* rule_formatter =
       root_formatter->AddRule(*rule, rule_results.rule_impact());
   rule->FormatResults(sorted_results, rule_formatter);
+  root_formatter->FinishRule();
 }
 
+// RuleCompletionListener that formats the results of each rule as soon
+// as they are final.
+class FormattingRuleCompletionListener : public RuleCompletionListener {
+ public:
+  FormattingRuleCompletionListener(const ResultFilter& filter,
+                                   Formatter* formatter)
+      : filter_(filter), formatter_(formatter) {}
+
+  virtual void OnRuleComplete(Rule* rule,
+                              const InputInformation& input_info,
+                              RuleResults* rule_results) {
+    // The impact is computed again, along with the score, once all
+    // rules have completed, but we need it now to format the rule.
+    rule_results->set_rule_impact(
+        ComputeRuleImpact(rule, input_info, *rule_results));
+    if (filter_.IsRuleResultsAccepted(*rule_results)) {
+      FormatRuleResults(*rule_results, input_info, rule, filter_, formatter_);
+    }
+  }
+
+ private:
+  const ResultFilter& filter_;
+  Formatter* const formatter_;
+
+  DISALLOW_COPY_AND_ASSIGN(FormattingRuleCompletionListener);
+};
+
+// Append the results of the given resource-local rule for each resource
+// in the input to rule_results, reusing the results stored in the given
+// cache for resources that have not changed, and adding the results for
+// the other resources to the cache.
+bool AppendResourceLocalResults(Rule* rule,
+                                const RuleInput& rule_input,
+                                ResourceResultCache* cache,
+                                RuleResults* rule_results,
+                                ResultProvider* provider) {
+  bool success = true;
+  const PagespeedInput& input = rule_input.pagespeed_input();
+  const std::string configuration = rule->GetConfigurationFingerprint();
+  for (int i = 0, num = input.num_resources(); i < num; ++i) {
+    if (Deadline::IsExpired(rule_input.deadline())) {
+      // Out of time. Keep the results we have so far.
+      return false;
+    }
+    const Resource& resource = input.GetResource(i);
+    const std::string* content_hash =
+        rule_input.GetResourceContentHash(resource);
+    if (content_hash == NULL) {
+      if (!rule->AppendResultsForResource(rule_input, resource, provider)) {
+        success = false;
+      }
+      continue;
+    }
+
+    const std::string key = ResourceResultCache::GetKey(
+        rule->name(), configuration, *content_hash,
+        rule_input.estimate_compressed_sizes());
+    RuleResults cached_results;
+    if (cache->Lookup(key, &cached_results)) {
+      for (int j = 0, end = cached_results.results_size(); j < end; ++j) {
+        Result* result = provider->NewResult();
+        const int id = result->id();
+        result->CopyFrom(cached_results.results(j));
+        result->set_id(id);
+      }
+      continue;
+    }
+
+    const int first_result_index = rule_results->results_size();
+    if (!rule->AppendResultsForResource(rule_input, resource, provider)) {
+      success = false;
+      continue;
+    }
+    if (Deadline::IsExpired(rule_input.deadline())) {
+      // The results may be incomplete, so don't cache them.
+      continue;
+    }
+    RuleResults resource_results;
+    resource_results.set_rule_name(rule->name());
+    for (int j = first_result_index, end = rule_results->results_size();
+         j < end; ++j) {
+      Result* result = resource_results.add_results();
+      result->CopyFrom(rule_results->results(j));
+      result->clear_id();
+    }
+    cache->Insert(key, resource_results);
+  }
+  return success;
+}
+
+// Settings for the RuleInputs that LazyRuleInputs creates. See the
+// corresponding RuleInput setters.
+struct RuleInputOptions {
+  RuleInputOptions()
+      : num_threads(1),
+        estimate_compressed_sizes(false),
+        dom_visitor_time_budget_millis(0),
+        profile(false),
+        measure_heap(false),
+        artifact_computer(NULL) {}
+
+  int num_threads;
+  bool estimate_compressed_sizes;
+  int dom_visitor_time_budget_millis;
+  // Whether to profile DOM visitors, and record the cost of preparing
+  // each RuleInput in the stage timings of its input's Results.
+  bool profile;
+  bool measure_heap;
+  const ArtifactComputer* artifact_computer;
+};
+
+// Holds the RuleInput of each input only while rules run against it.
+// The first task to acquire an input's RuleInput creates it,
+// initializes it and traverses the input's DOM (see
+// RuleInput::TraverseDom), while the other tasks for that input wait;
+// the last task to release it deletes it. That way the artifacts a
+// RuleInput memoizes are freed as soon as the rules for its input are
+// done, rather than once every input in a batch is done.
+class LazyRuleInputs {
+ public:
+  // input_rules[i] are the rules to run against inputs[i], each in a
+  // task of its own that acquires the RuleInput of inputs[i].
+  LazyRuleInputs(const std::vector<const PagespeedInput*>& inputs,
+                 const std::vector<std::vector<const Rule*> >& input_rules,
+                 const std::vector<Results*>& results,
+                 const RuleInputOptions& options)
+      : inputs_(inputs),
+        input_rules_(input_rules),
+        options_(options),
+        states_(new InputState[inputs.size()]) {
+    DCHECK(input_rules_.size() == inputs_.size());
+    for (size_t i = 0; i < inputs_.size(); ++i) {
+      InputState* state = &states_[i];
+      state->num_pending_tasks = input_rules_[i].size();
+      if (!options_.profile || state->num_pending_tasks == 0) {
+        continue;
+      }
+      state->init_timing = results[i]->add_stage_timings();
+      state->init_timing->set_name("RuleInput::Init");
+      if (inputs_[i]->dom_document() != NULL) {
+        state->traverse_dom_timing = results[i]->add_stage_timings();
+        state->traverse_dom_timing->set_name("RuleInput::TraverseDom");
+      }
+    }
+  }
+
+  ~LazyRuleInputs() {
+    for (size_t i = 0; i < inputs_.size(); ++i) {
+      DCHECK(states_[i].rule_input == NULL);
+      delete states_[i].rule_input;
+    }
+  }
+
+  // Get the RuleInput of the given input, preparing it first if needed.
+  // Each task must call Release once it no longer uses the RuleInput.
+  const RuleInput* Acquire(int input_index) {
+    InputState* state = &states_[input_index];
+    base::AutoLock lock(state->lock);
+    DCHECK(state->num_pending_tasks > 0);
+    if (state->rule_input == NULL) {
+      state->rule_input = NewRuleInput(input_index);
+    }
+    return state->rule_input;
+  }
+
+  void Release(int input_index) {
+    InputState* state = &states_[input_index];
+    RuleInput* rule_input = NULL;
+    {
+      base::AutoLock lock(state->lock);
+      DCHECK(state->num_pending_tasks > 0);
+      if (--state->num_pending_tasks == 0) {
+        rule_input = state->rule_input;
+        state->rule_input = NULL;
+      }
+    }
+    delete rule_input;
+  }
+
+ private:
+  struct InputState {
+    InputState()
+        : rule_input(NULL),
+          num_pending_tasks(0),
+          init_timing(NULL),
+          traverse_dom_timing(NULL) {}
+
+    // Guards rule_input and num_pending_tasks, and is held while the
+    // RuleInput is being prepared.
+    base::Lock lock;
+    RuleInput* rule_input;
+    int num_pending_tasks;
+    RuleTiming* init_timing;
+    RuleTiming* traverse_dom_timing;
+  };
+
+  RuleInput* NewRuleInput(int input_index) const {
+    const InputState& state = states_[input_index];
+    RuleInput* rule_input = new RuleInput(*inputs_[input_index]);
+    rule_input->set_num_threads(options_.num_threads);
+    rule_input->set_estimate_compressed_sizes(
+        options_.estimate_compressed_sizes);
+    rule_input->set_dom_visitor_time_budget_millis(
+        options_.dom_visitor_time_budget_millis);
+    rule_input->set_profile_dom_visitors(options_.profile);
+    rule_input->set_artifact_computer(options_.artifact_computer);
+
+    if (state.init_timing == NULL) {
+      rule_input->Init();
+    } else {
+      CostTimer timer(options_.measure_heap);
+      rule_input->Init();
+      timer.Stop(state.init_timing);
+    }
+
+    // Walk the DOM once for all the rules that inspect it, rather than
+    // once per rule.
+    if (state.traverse_dom_timing == NULL) {
+      rule_input->TraverseDom(input_rules_[input_index]);
+    } else {
+      CostTimer timer(options_.measure_heap);
+      rule_input->TraverseDom(input_rules_[input_index]);
+      timer.Stop(state.traverse_dom_timing);
+    }
+    return rule_input;
+  }
+
+  const std::vector<const PagespeedInput*>& inputs_;
+  const std::vector<std::vector<const Rule*> >& input_rules_;
+  const RuleInputOptions options_;
+  scoped_array<InputState> states_;
+
+  DISALLOW_COPY_AND_ASSIGN(LazyRuleInputs);
+};
+
+// ParallelTask that invokes Rule::AppendResults for each (input, rule)
+// pair to run. Task i runs rules[i] against the input at index
+// task_input_indices[i], whose RuleInput it acquires from rule_inputs
+// for the duration of the task, writing into rule_results[i]. Since the
+// number of results generated by earlier rules is not known until
+// those rules complete, result ids are first assigned relative to the
+// first result of each rule, then offset once every earlier task has
+// completed, at which point the listener (if any) is notified. If
+// rule_time_budget_millis is positive, each task runs under its own
+// Deadline. If resource_result_cache is non-NULL, resource-local rules
+// reuse the results it holds.
+class AppendResultsTask : public ParallelTask {
+ public:
+  AppendResultsTask(const std::vector<Rule*>& rules,
+                    const std::vector<int>& task_input_indices,
+                    LazyRuleInputs* rule_inputs,
+                    const std::vector<RuleResults*>& rule_results,
+                    const std::vector<Results*>& input_results,
+                    bool profile_rules,
+                    bool measure_heap,
+                    int rule_time_budget_millis,
+                    ResourceResultCache* resource_result_cache,
+                    RuleCompletionListener* listener)
+      : rules_(rules),
+        task_input_indices_(task_input_indices),
+        rule_inputs_(rule_inputs),
+        rule_results_(rule_results),
+        input_results_(input_results),
+        profile_rules_(profile_rules),
+        measure_heap_(measure_heap),
+        rule_time_budget_millis_(rule_time_budget_millis),
+        resource_result_cache_(resource_result_cache),
+        listener_(listener),
+        num_new_results_(rule_results.size(), 0),
+        rule_success_(rule_results.size(), 0),
+        rule_timed_out_(rule_results.size(), 0),
+        task_complete_(rule_results.size(), 0),
+        next_task_to_finish_(0),
+        num_input_results_(input_results.size(), 0),
+        next_task_to_notify_(0),
+        notifying_(false) {
+    DCHECK(rules_.size() == rule_results_.size());
+    DCHECK(task_input_indices_.size() == rule_results_.size());
+  }
+
+  int num_tasks() const { return rule_results_.size(); }
+
+  virtual void RunTask(int task_index) {
+    Rule* rule = rules_[task_index];
+    const int input_index = task_input_indices_[task_index];
+    const RuleInput& rule_input = *rule_inputs_->Acquire(input_index);
+    ResultProvider provider(*rule, rule_results_[task_index], 0);
+    scoped_ptr<Deadline> deadline;
+    if (rule_time_budget_millis_ > 0) {
+      deadline.reset(new Deadline(
+          base::TimeDelta::FromMilliseconds(rule_time_budget_millis_)));
+    }
+    RuleInput::ScopedDeadline scoped_deadline(deadline.get());
+    if (profile_rules_) {
+      CostTimer timer(measure_heap_);
+      rule_success_[task_index] =
+          AppendResults(task_index, rule_input, &provider);
+      RuleTiming* timing = rule_results_[task_index]->mutable_timing();
+      timer.Stop(timing);
+      timing->set_name(rule->name());
+      timing->set_num_results(provider.num_new_results());
+      // Charge the rule for the time its DOM visitor spent in
+      // TraverseDom, which ran before it.
+      const RuleResults* dom_results = rule_input.GetDomVisitorResults(*rule);
+      if (dom_results != NULL && dom_results->has_timing()) {
+        timing->set_wall_time_millis(
+            timing->wall_time_millis() +
+            dom_results->timing().wall_time_millis());
+      }
+    } else {
+      rule_success_[task_index] =
+          AppendResults(task_index, rule_input, &provider);
+    }
+    num_new_results_[task_index] = provider.num_new_results();
+    // Only rules that saw their deadline expire may have stopped early.
+    // A rule that finished its work just after the deadline expired
+    // has complete results.
+    // The same goes for a DOM visitor stopped by TraverseDom.
+    rule_timed_out_[task_index] =
+        (deadline != NULL && deadline->WasExpiryObserved()) ||
+        rule_input.DomVisitorTimedOut(*rule);
+    rule_inputs_->Release(input_index);
+    FinishCompletedTasks(task_index);
+  }
+
+  bool rule_success(int task_index) const {
+    return rule_success_[task_index] != 0;
+  }
+  bool rule_timed_out(int task_index) const {
+    return rule_timed_out_[task_index] != 0;
+  }
+
+ private:
+  // Mark the given task as completed, then finish each task that has
+  // not yet been finished and whose predecessors have all completed,
+  // in task order, and notify the listener of them. Only one thread
+  // notifies the listener at a time, and it does so without holding
+  // lock_; tasks finished meanwhile by other threads are left for it to
+  // notify, so the listener still sees them in task order.
+  void FinishCompletedTasks(int task_index) {
+    base::AutoLock lock(lock_);
+    task_complete_[task_index] = 1;
+    while (next_task_to_finish_ < num_tasks() &&
+           task_complete_[next_task_to_finish_]) {
+      FinishTask(next_task_to_finish_);
+      ++next_task_to_finish_;
+    }
+    if (listener_ == NULL || notifying_) {
+      return;
+    }
+    notifying_ = true;
+    while (next_task_to_notify_ < next_task_to_finish_) {
+      const int begin = next_task_to_notify_;
+      const int end = next_task_to_finish_;
+      next_task_to_notify_ = end;
+      base::AutoUnlock unlock(lock_);
+      for (int i = begin; i < end; ++i) {
+        const int input_index = task_input_indices_[i];
+        listener_->OnRuleComplete(rules_[i],
+                                  input_results_[input_index]->input_info(),
+                                  rule_results_[i]);
+      }
+    }
+    notifying_ = false;
+  }
+
+  // Now that every earlier rule for the same input has completed,
+  // offset the result ids of the given task, so they match the ids
+  // that a serial run would produce.
+  void FinishTask(int task_index) {
+    const int input_index = task_input_indices_[task_index];
+    RuleResults* rule_results = rule_results_[task_index];
+    for (int result_idx = 0, end = rule_results->results_size();
+         result_idx < end; ++result_idx) {
+      Result* result = rule_results->mutable_results(result_idx);
+      result->set_id(result->id() + num_input_results_[input_index]);
+    }
+    num_input_results_[input_index] += num_new_results_[task_index];
+  }
+
+  bool AppendResults(int task_index,
+                     const RuleInput& rule_input,
+                     ResultProvider* provider) {
+    Rule* rule = rules_[task_index];
+    if (resource_result_cache_ != NULL && rule->IsResourceLocal()) {
+      return AppendResourceLocalResults(rule, rule_input,
+                                        resource_result_cache_,
+                                        rule_results_[task_index], provider);
+    }
+    return rule->AppendResults(rule_input, provider);
+  }
+
+  const std::vector<Rule*>& rules_;
+  const std::vector<int>& task_input_indices_;
+  LazyRuleInputs* const rule_inputs_;
+  const std::vector<RuleResults*>& rule_results_;
+  const std::vector<Results*>& input_results_;
+  const bool profile_rules_;
+  const bool measure_heap_;
+  const int rule_time_budget_millis_;
+  ResourceResultCache* const resource_result_cache_;
+  RuleCompletionListener* const listener_;
+  std::vector<int> num_new_results_;
+  // NOTE: we use vectors of chars rather than vector<bool>s, since
+  // the elements of a vector<bool> can not be written concurrently.
+  std::vector<char> rule_success_;
+  std::vector<char> rule_timed_out_;
+
+  // Guards the members below, which track the tasks that have been
+  // finished by FinishTask.
+  base::Lock lock_;
+  std::vector<char> task_complete_;
+  int next_task_to_finish_;
+  // The number of results generated by the finished tasks for each
+  // input.
+  std::vector<int> num_input_results_;
+  // The first finished task whose listener has not been notified, and
+  // whether some thread is currently notifying the listener.
+  int next_task_to_notify_;
+  bool notifying_;
+
+  DISALLOW_COPY_AND_ASSIGN(AppendResultsTask);
+};
+
 }  // namespace
 
 Engine::Engine(std::vector<Rule*>* rules)
-    : rules_(*rules), init_has_been_called_(false) {
+    : rules_(*rules),
+      init_has_been_called_(false),
+      num_threads_(1),
+      profile_rules_(false),
+      rule_time_budget_millis_(0),
+      estimate_compressed_sizes_(false),
+      resource_result_cache_(NULL),
+      artifact_computer_(NULL) {
   // Now that we've transferred the rule ownership to our local
   // vector, clear the passed in vector.
   rules->clear();
@@ -93,6 +591,13 @@ void Engine::PopulateNameToRuleMap() {
 
 bool Engine::ComputeResults(const PagespeedInput& pagespeed_input,
                             Results* results) const {
+  AlwaysAcceptResultFilter filter;
+  return ComputeResults(pagespeed_input, filter, results);
+}
+
+bool Engine::ComputeResults(const PagespeedInput& pagespeed_input,
+                            const ResultFilter& filter,
+                            Results* results) const {
   CHECK(init_has_been_called_);
 
   if (!pagespeed_input.is_frozen()) {
@@ -100,39 +605,150 @@ bool Engine::ComputeResults(const PagespeedInput& pagespeed_input,
     return false;
   }
 
-  results->mutable_input_info()->CopyFrom(*pagespeed_input.input_information());
-  GetPageSpeedVersion(results->mutable_version());
+  std::vector<const PagespeedInput*> inputs(1, &pagespeed_input);
+  std::vector<Results*> results_vector(1, results);
+  return ComputeResultsForInputs(inputs, filter, results_vector, NULL);
+}
+
+bool Engine::ComputeResultsBatch(
+    const std::vector<const PagespeedInput*>& inputs,
+    const std::vector<Results*>& results) const {
+  CHECK(init_has_been_called_);
 
-  RuleInput rule_input(pagespeed_input);
-  rule_input.Init();
-  int num_results_so_far = 0;
+  if (inputs.size() != results.size()) {
+    LOG(DFATAL) << "Got " << inputs.size() << " inputs but "
+                << results.size() << " results.";
+    return false;
+  }
 
   bool success = true;
+  std::vector<const PagespeedInput*> frozen_inputs;
+  std::vector<Results*> frozen_input_results;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    if (!inputs[i]->is_frozen()) {
+      LOG(DFATAL) << "Attempting to ComputeResultsBatch with non-frozen "
+                  << "input at index " << i << ".";
+      success = false;
+      continue;
+    }
+    frozen_inputs.push_back(inputs[i]);
+    frozen_input_results.push_back(results[i]);
+  }
+
+  AlwaysAcceptResultFilter filter;
+  if (!ComputeResultsForInputs(frozen_inputs, filter, frozen_input_results,
+                               NULL)) {
+    success = false;
+  }
+  return success;
+}
+
+bool Engine::ComputeResultsForInputs(
+    const std::vector<const PagespeedInput*>& inputs,
+    const ResultFilter& filter,
+    const std::vector<Results*>& results,
+    RuleCompletionListener* listener) const {
+  DCHECK(inputs.size() == results.size());
+  if (inputs.empty()) {
+    return true;
+  }
+
+  // Rules whose results the filter would discard are not run at all.
+  std::vector<Rule*> accepted_rules;
   for (std::vector<Rule*>::const_iterator iter = rules_.begin(),
            end = rules_.end();
        iter != end;
        ++iter) {
-    Rule* rule = *iter;
-    RuleResults* rule_results = results->add_rule_results();
-    rule_results->set_rule_name(rule->name());
-
-    ResultProvider provider(*rule, rule_results, num_results_so_far);
-    const bool rule_success = rule->AppendResults(rule_input, &provider);
-    num_results_so_far += provider.num_new_results();
-    if (!rule_success) {
-      // Record that the rule encountered an error.
-      results->add_error_rules(rule->name());
-      success = false;
+    if (filter.IsRuleAccepted(**iter)) {
+      accepted_rules.push_back(*iter);
     }
   }
 
-  if (!ComputeScoreAndImpact(results)) {
-    success = false;
+  // Add the RuleResults for every (input, rule) pair to run up front,
+  // so each rule writes into its own entry no matter which thread runs
+  // it, and the output is in rule order. Rules whose capability
+  // requirements are not satisfied by an input are not run against it,
+  // since they can not produce meaningful results. The tasks for input
+  // i are those in [input_task_begin[i], input_task_begin[i + 1]).
+  std::vector<Rule*> task_rules;
+  std::vector<int> task_input_indices;
+  std::vector<RuleResults*> rule_results;
+  std::vector<int> input_task_begin;
+  std::vector<std::vector<const Rule*> > input_rules(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    input_task_begin.push_back(rule_results.size());
+    Results* input_results = results[i];
+    input_results->mutable_input_info()->CopyFrom(
+        *inputs[i]->input_information());
+    GetPageSpeedVersion(input_results->mutable_version());
+    const InputCapabilities capabilities = inputs[i]->EstimateCapabilities();
+    for (std::vector<Rule*>::const_iterator iter = accepted_rules.begin(),
+             end = accepted_rules.end();
+         iter != end;
+         ++iter) {
+      Rule* rule = *iter;
+      if (!capabilities.satisfies(rule->capability_requirements())) {
+        continue;
+      }
+      RuleResults* new_rule_results = input_results->add_rule_results();
+      new_rule_results->set_rule_name(rule->name());
+      task_rules.push_back(rule);
+      input_rules[i].push_back(rule);
+      task_input_indices.push_back(i);
+      rule_results.push_back(new_rule_results);
+    }
   }
+  input_task_begin.push_back(rule_results.size());
+
+  // When there is a single input, RuleInput::Init() may use all of our
+  // threads to precompute per-resource data. When there are several,
+  // each RuleInput is initialized on a single thread, while the rules
+  // for other inputs run. Heap statistics are process wide, so we can
+  // only attribute allocations to a rule when rules run one at a time.
+  RuleInputOptions rule_input_options;
+  rule_input_options.num_threads = inputs.size() == 1 ? num_threads_ : 1;
+  rule_input_options.estimate_compressed_sizes = estimate_compressed_sizes_;
+  rule_input_options.dom_visitor_time_budget_millis = rule_time_budget_millis_;
+  rule_input_options.profile = profile_rules_;
+  rule_input_options.measure_heap = profile_rules_ && num_threads_ <= 1;
+  rule_input_options.artifact_computer = artifact_computer_;
+  LazyRuleInputs rule_inputs(inputs, input_rules, results,
+                             rule_input_options);
+
+  AppendResultsTask task(task_rules, task_input_indices, &rule_inputs,
+                         rule_results, results, profile_rules_,
+                         rule_input_options.measure_heap,
+                         rule_time_budget_millis_, resource_result_cache_,
+                         listener);
+  ThreadPool thread_pool(num_threads_);
+  thread_pool.Run(&task, task.num_tasks());
 
-  if (!results->IsInitialized()) {
-    LOG(DFATAL) << "Failed to fully initialize results object.";
-    return false;
+  bool success = true;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    Results* input_results = results[i];
+    for (int task_index = input_task_begin[i];
+         task_index < input_task_begin[i + 1]; ++task_index) {
+      const char* rule_name = task_rules[task_index]->name();
+      if (task.rule_timed_out(task_index)) {
+        // The rule ran out of time, so its results may be incomplete.
+        input_results->add_error_rules(rule_name);
+        input_results->add_timed_out_rules(rule_name);
+        success = false;
+      } else if (!task.rule_success(task_index)) {
+        // Record that the rule encountered an error.
+        input_results->add_error_rules(rule_name);
+        success = false;
+      }
+    }
+
+    if (!ComputeScoreAndImpact(input_results)) {
+      success = false;
+    }
+
+    if (!input_results->IsInitialized()) {
+      LOG(DFATAL) << "Failed to fully initialize results object.";
+      success = false;
+    }
   }
 
   return success;
@@ -185,11 +801,37 @@ bool Engine::ComputeAndFormatResults(const PagespeedInput& input,
   CHECK(init_has_been_called_);
 
   Results results;
-  bool success = ComputeResults(input, &results);
+  bool success = ComputeResults(input, filter, &results);
   success = FormatResults(results, filter, formatter) && success;
   return success;
 }
 
+bool Engine::ComputeAndFormatResultsStreaming(const PagespeedInput& input,
+                                              const ResultFilter& filter,
+                                              Formatter* formatter,
+                                              Results* results) const {
+  CHECK(init_has_been_called_);
+
+  if (!input.is_frozen()) {
+    LOG(DFATAL) << "Attempting to ComputeAndFormatResultsStreaming with "
+                << "non-frozen input.";
+    return false;
+  }
+
+  FormattingRuleCompletionListener listener(filter, formatter);
+  std::vector<const PagespeedInput*> inputs(1, &input);
+  std::vector<Results*> results_vector(1, results);
+  const bool success =
+      ComputeResultsForInputs(inputs, filter, results_vector, &listener);
+
+  if (results->has_score()) {
+    formatter->SetOverallScore(results->score());
+  }
+  formatter->Finalize();
+
+  return success;
+}
+
 bool Engine::ComputeScoreAndImpact(Results* results) const {
   CHECK(init_has_been_called_);
 
@@ -214,15 +856,8 @@ bool Engine::ComputeScoreAndImpact(Results* results) const {
 
     Rule* rule = rule_iter->second;
 
-    double impact = 0.0;
-    if (rule_results->results_size() > 0) {
-      impact = rule->ComputeRuleImpact(results->input_info(), *rule_results);
-      if (impact < 0.0) {
-        LOG(ERROR) << "Impact for " << rule->name() << " out of bounds: "
-                   << impact;
-        impact = 0.0;
-      }
-    }
+    const double impact =
+        ComputeRuleImpact(rule, results->input_info(), *rule_results);
     rule_results->set_rule_impact(impact);
     if (!rule->IsExperimental()) {
       total_impact += impact;
@@ -261,52 +896,104 @@ void Engine::FilterResults(const Results& results,
                            Results* filtered_results_out) const {
   CHECK(init_has_been_called_);
 
-  // We want to copy all fields but the rule_results
-  // field. Unfortunately there's no way to do this other than to copy
-  // all fields, then clear the rule_results field. This is somewhat
-  // inefficient but safer than copying the fields we want by hand, as
-  // we do also want to automatically copy any new fields added to
-  // Results in the future.
-  filtered_results_out->CopyFrom(results);
-  filtered_results_out->clear_rule_results();
-
-  for (int rule_idx = 0;
-       rule_idx < results.rule_results_size(); ++rule_idx) {
-    const RuleResults& rule_results = results.rule_results(rule_idx);
-    if (!filter.IsRuleResultsAccepted(rule_results)) {
-      continue;
-    }
-
-    RuleResults* new_rule_results =
+  std::vector<AcceptedRuleResults> accepted;
+  filter.GetAcceptedResults(results, &accepted);
+
+  // Copy every field other than the rule results, then only the
+  // accepted RuleResults and Results, so rejected results (which may
+  // hold large fields such as optimized_content) are never copied.
+  // Fields added to Results or RuleResults must be copied here too.
+  filtered_results_out->Clear();
+  filtered_results_out->mutable_input_info()->CopyFrom(results.input_info());
+  filtered_results_out->mutable_error_rules()->CopyFrom(results.error_rules());
+  filtered_results_out->mutable_version()->CopyFrom(results.version());
+  if (results.has_score()) {
+    filtered_results_out->set_score(results.score());
+  }
+  filtered_results_out->mutable_stage_timings()->CopyFrom(
+      results.stage_timings());
+  filtered_results_out->mutable_timed_out_rules()->CopyFrom(
+      results.timed_out_rules());
+  for (std::vector<AcceptedRuleResults>::const_iterator it = accepted.begin(),
+           end = accepted.end();
+       it != end;
+       ++it) {
+    const RuleResults& rule_results =
+        results.rule_results(it->rule_results_index);
+    RuleResults* filtered_rule_results =
         filtered_results_out->add_rule_results();
-
-    // We want to copy all fields but the results field. Unfortunately
-    // there's no way to do this other than to copy all fields, then
-    // clear the results field. This is somewhat inefficient but safer
-    // than copying the fields we want by hand, as we do also want to
-    // automatically copy any new fields added to RuleResults in the
-    // future.
-    new_rule_results->MergeFrom(rule_results);
-    new_rule_results->clear_results();
-
-    // Copy any non-filtered results into new_rule_results;
-    for (int result_idx = 0;
-         result_idx < rule_results.results_size();
-         ++result_idx) {
-      const Result& result = rule_results.results(result_idx);
-
-      if (filter.IsResultAccepted(result)) {
-        new_rule_results->add_results()->CopyFrom(result);
-      }
+    filtered_rule_results->set_rule_name(rule_results.rule_name());
+    if (rule_results.has_rule_impact()) {
+      filtered_rule_results->set_rule_impact(rule_results.rule_impact());
+    }
+    if (rule_results.has_timing()) {
+      filtered_rule_results->mutable_timing()->CopyFrom(rule_results.timing());
+    }
+    for (std::vector<int>::const_iterator result_index =
+             it->result_indices.begin(),
+             result_end = it->result_indices.end();
+         result_index != result_end;
+         ++result_index) {
+      filtered_rule_results->add_results()->CopyFrom(
+          rule_results.results(*result_index));
     }
   }
 
   ComputeScoreAndImpact(filtered_results_out);
 }
 
+void Engine::FilterResultsInPlace(const ResultFilter& filter,
+                                  Results* results) const {
+  CHECK(init_has_been_called_);
+
+  std::vector<AcceptedRuleResults> accepted;
+  filter.GetAcceptedResults(*results, &accepted);
+
+  google::protobuf::RepeatedPtrField<RuleResults>* all_rule_results =
+      results->mutable_rule_results();
+  std::vector<int> rule_results_indices;
+  rule_results_indices.reserve(accepted.size());
+  for (size_t i = 0; i < accepted.size(); ++i) {
+    RetainElements(
+        accepted[i].result_indices,
+        all_rule_results->Mutable(accepted[i].rule_results_index)->
+            mutable_results());
+    rule_results_indices.push_back(accepted[i].rule_results_index);
+  }
+  RetainElements(rule_results_indices, all_rule_results);
+
+  ComputeScoreAndImpact(results);
+}
+
 ResultFilter::ResultFilter() {}
 ResultFilter::~ResultFilter() {}
 
+bool ResultFilter::IsRuleAccepted(const Rule&) const {
+  return true;
+}
+
+void ResultFilter::GetAcceptedResults(
+    const Results& results,
+    std::vector<AcceptedRuleResults>* accepted) const {
+  accepted->clear();
+  for (int rule_idx = 0, rule_end = results.rule_results_size();
+       rule_idx < rule_end; ++rule_idx) {
+    const RuleResults& rule_results = results.rule_results(rule_idx);
+    if (!IsRuleResultsAccepted(rule_results)) {
+      continue;
+    }
+    accepted->push_back(AcceptedRuleResults());
+    AcceptedRuleResults* accepted_rule_results = &accepted->back();
+    accepted_rule_results->rule_results_index = rule_idx;
+    for (int result_idx = 0, result_end = rule_results.results_size();
+         result_idx < result_end; ++result_idx) {
+      if (IsResultAccepted(rule_results.results(result_idx))) {
+        accepted_rule_results->result_indices.push_back(result_idx);
+      }
+    }
+  }
+}
+
 AlwaysAcceptResultFilter::AlwaysAcceptResultFilter() {}
 AlwaysAcceptResultFilter::~AlwaysAcceptResultFilter() {}
 
@@ -328,4 +1015,8 @@ bool AndResultFilter::IsRuleResultsAccepted(const RuleResults& results) const {
       filter2_->IsRuleResultsAccepted(results);
 }
 
+bool AndResultFilter::IsRuleAccepted(const Rule& rule) const {
+  return filter1_->IsRuleAccepted(rule) && filter2_->IsRuleAccepted(rule);
+}
+
 }  // namespace pagespeed
@@ -29,15 +29,28 @@
 
 namespace pagespeed {
 
+class ArtifactComputer;
 class Formatter;
 class InputInformation;
 class PagespeedInput;
+class ResourceResultCache;
 class ResultText;
 class Results;
 class Result;
 class Rule;
+class RuleCompletionListener;
 class RuleResults;
 
+// The index of a RuleResults accepted by a ResultFilter, along with the
+// indices of the Results within it that the filter accepted. See
+// ResultFilter::GetAcceptedResults.
+struct AcceptedRuleResults {
+  AcceptedRuleResults() : rule_results_index(-1) {}
+
+  int rule_results_index;
+  std::vector<int> result_indices;
+};
+
 // ResultFilter is used to filter the results passed to the
 // formatter. A ResultFilter might want to remove Results that have an
 // impact under a certain threshold (e.g. saves less than 100 bytes).
@@ -55,6 +68,19 @@ class ResultFilter {
   // IsResultAccepted(Result) to determine if they should be retained.
   virtual bool IsRuleResultsAccepted(const RuleResults& results) const = 0;
 
+  // Whether the given Rule's results could be accepted. If false, the
+  // Engine will not run the rule at all, so filters must only return
+  // false for rules whose RuleResults IsRuleResultsAccepted would
+  // always discard. The default implementation returns true.
+  virtual bool IsRuleAccepted(const Rule& rule) const;
+
+  // Find the RuleResults in the given results that this filter accepts,
+  // and the accepted Results within each, in order, without copying
+  // any of them. The indices refer to the given results, so they are
+  // only valid until the results are modified.
+  void GetAcceptedResults(const Results& results,
+                          std::vector<AcceptedRuleResults>* accepted) const;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(ResultFilter);
 };
@@ -82,6 +108,7 @@ class AndResultFilter : public ResultFilter {
 
   virtual bool IsResultAccepted(const Result& result) const;
   virtual bool IsRuleResultsAccepted(const RuleResults& results) const;
+  virtual bool IsRuleAccepted(const Rule& rule) const;
 
  private:
   scoped_ptr<ResultFilter> filter1_;
@@ -101,11 +128,102 @@ class Engine {
   // instantiating the engine.
   void Init();
 
+  // Set the number of threads used to run rules in ComputeResults. By
+  // default, rules run serially on the calling thread. When more than
+  // one thread is used, Rule::AppendResults may be invoked concurrently
+  // for different rules; the generated Results (including result ids)
+  // are identical to those generated by a serial run.
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+  int num_threads() const { return num_threads_; }
+
+  // Set whether to measure the cost of running each rule. When enabled,
+  // ComputeResults records the time taken by each rule in
+  // RuleResults.timing, and the time taken by the engine's own stages
+  // in Results.stage_timings. A rule's wall time includes the time its
+  // DOM visitor (see Rule::NewDomVisitor) spent in the shared DOM
+  // traversal; its CPU time and heap usage do not.
+  void set_profile_rules(bool profile_rules) {
+    profile_rules_ = profile_rules;
+  }
+  bool profile_rules() const { return profile_rules_; }
+
+  // Set the maximum time, in milliseconds, that each rule may spend
+  // computing results for a single input, or 0 (the default) for no
+  // limit. Rules and the per-resource computations they depend on poll
+  // their deadline via RuleInput::deadline(), and stop early once it
+  // expires. A rule's DOM visitor (see Rule::NewDomVisitor) gets a
+  // budget of the same size for the time it spends in the shared DOM
+  // traversal. A rule that exceeds its budget keeps the results it
+  // generated so far, and is listed in both error_rules and
+  // timed_out_rules.
+  void set_rule_time_budget_millis(int rule_time_budget_millis) {
+    rule_time_budget_millis_ = rule_time_budget_millis;
+  }
+  int rule_time_budget_millis() const { return rule_time_budget_millis_; }
+
+  // Set whether to estimate the compressed sizes of resources, rather
+  // than compute them exactly (see RuleInput::set_estimate_compressed_sizes).
+  // Estimating is faster on inputs with a lot of text, but the savings
+  // reported by rules that compare compressed sizes become approximate.
+  void set_estimate_compressed_sizes(bool estimate) {
+    estimate_compressed_sizes_ = estimate;
+  }
+  bool estimate_compressed_sizes() const {
+    return estimate_compressed_sizes_;
+  }
+
+  // Set the cache used to reuse the results of resource-local rules
+  // (see Rule::IsResourceLocal), or NULL (the default) for no cache.
+  // When set, resource-local rules only run on resources whose results
+  // are not already in the cache, and their results for those
+  // resources are added to the cache. Results for resources that did
+  // not complete without errors are not cached. Other rules always
+  // run on the whole input. Ownership of the cache is not transferred
+  // to the Engine, and it must outlive any ComputeResults calls.
+  void set_resource_result_cache(ResourceResultCache* cache) {
+    resource_result_cache_ = cache;
+  }
+  ResourceResultCache* resource_result_cache() const {
+    return resource_result_cache_;
+  }
+
+  // Set the ArtifactComputer that rules use, through RuleInput, to
+  // compute minified content (see RuleInput::set_artifact_computer),
+  // or NULL (the default) if no rule needs it. Ownership of the
+  // computer is not transferred to the Engine, and it must outlive any
+  // ComputeResults calls.
+  void set_artifact_computer(const ArtifactComputer* computer) {
+    artifact_computer_ = computer;
+  }
+  const ArtifactComputer* artifact_computer() const {
+    return artifact_computer_;
+  }
+
   // Compute and add results to the result set by querying rule
-  // objects about results they produce.
+  // objects about results they produce. Rules whose capability
+  // requirements are not satisfied by the input's estimated
+  // capabilities (see PagespeedInput::EstimateCapabilities) are not
+  // run, and have no RuleResults in the output.
   // @return true iff the computation was completed without errors.
   bool ComputeResults(const PagespeedInput& input, Results* results) const;
 
+  // Same as above, but also skip rules rejected by the given filter's
+  // IsRuleAccepted, since their results would be discarded anyway.
+  bool ComputeResults(const PagespeedInput& input,
+                      const ResultFilter& filter,
+                      Results* results) const;
+
+  // Compute results for each of the given inputs, writing them into the
+  // Results at the same index. Rules for all inputs are run on the
+  // threads configured by set_num_threads, so that a single Engine can
+  // analyze many inputs with throughput that scales with the number of
+  // threads. The results for each input are identical to those
+  // generated by ComputeResults.
+  // @return true iff the computation was completed without errors for
+  // every input.
+  bool ComputeResultsBatch(const std::vector<const PagespeedInput*>& inputs,
+                           const std::vector<Results*>& results) const;
+
   // Generate a formatted representation of the results, such as
   // human-readable markup that will be displayed to a user.
   // @return true iff the formatting was completed without errors.
@@ -123,6 +241,21 @@ class Engine {
                                const ResultFilter& filter,
                                Formatter* formatter) const;
 
+  // Same as ComputeAndFormatResults, but format the results of each
+  // rule as soon as they are available, rather than once every rule has
+  // completed, so that streaming formatters (see Formatter::FinishRule)
+  // can emit them early. Rules are formatted in rule order, each as
+  // soon as it and all the rules before it have completed; with a
+  // single thread, that is as soon as the rule itself completes.
+  // SetOverallScore and Finalize are called once all rules are done.
+  // The formatter is never invoked from more than one thread at a time.
+  // The computed results are written to results.
+  // @return true iff the computation was completed without errors.
+  bool ComputeAndFormatResultsStreaming(const PagespeedInput& input,
+                                        const ResultFilter& filter,
+                                        Formatter* formatter,
+                                        Results* results) const;
+
   bool FormatResults(const Results& results,
                      Formatter* formatter) const {
     AlwaysAcceptResultFilter filter;
@@ -136,11 +269,20 @@ class Engine {
   }
 
   // Filters the results with the given filter into a second results proto,
-  // and recomputing the impact for the filtered results.
+  // and recomputing the impact for the filtered results. Only the
+  // accepted results are copied, but callers that no longer need the
+  // unfiltered results should use FilterResultsInPlace instead.
   void FilterResults(const Results& results,
                      const ResultFilter& filter,
                      Results* filtered_results_out) const;
 
+  // Same as FilterResults, but filters the given results in place. The
+  // accepted results are moved rather than copied, and the rejected
+  // ones are deleted, so large fields such as optimized_content are
+  // never copied.
+  void FilterResultsInPlace(const ResultFilter& filter,
+                            Results* results) const;
+
  private:
   // Computes the impact for each rule, as well as the overall score.
   // The given results should be as generated by ComputeResults
@@ -148,6 +290,17 @@ class Engine {
   // @return true iff the computation was completed without errors.
   bool ComputeScoreAndImpact(Results* results) const;
 
+  // Computes results for each of the given frozen inputs, running only
+  // the rules accepted by the given filter. Shared by ComputeResults,
+  // ComputeResultsBatch and ComputeAndFormatResultsStreaming. If
+  // listener is non-NULL, it is notified as the results of each rule
+  // become final.
+  bool ComputeResultsForInputs(
+      const std::vector<const PagespeedInput*>& inputs,
+      const ResultFilter& filter,
+      const std::vector<Results*>& results,
+      RuleCompletionListener* listener) const;
+
   void PopulateNameToRuleMap();
 
   typedef std::map<std::string, Rule*> NameToRuleMap;
@@ -155,6 +308,12 @@ class Engine {
   std::vector<Rule*> rules_;
   NameToRuleMap name_to_rule_map_;
   bool init_has_been_called_;
+  int num_threads_;
+  bool profile_rules_;
+  int rule_time_budget_millis_;
+  bool estimate_compressed_sizes_;
+  ResourceResultCache* resource_result_cache_;
+  const ArtifactComputer* artifact_computer_;
 
   DISALLOW_COPY_AND_ASSIGN(Engine);
 };
@@ -15,19 +15,37 @@
 #include <string>
 #include <vector>
 
+#include "base/memory/scoped_ptr.h"
+#include "base/stl_util.h"
+#include "base/synchronization/lock.h"
+#include "base/time.h"
+#include "pagespeed/core/artifact_computer.h"
+#include "pagespeed/core/dom.h"
 #include "pagespeed/core/engine.h"
+#include "pagespeed/core/image_attributes.h"
 #include "pagespeed/core/pagespeed_input.h"
+#include "pagespeed/core/resource.h"
+#include "pagespeed/core/resource_result_cache.h"
 #include "pagespeed/core/result_provider.h"
 #include "pagespeed/core/rule.h"
 #include "pagespeed/core/rule_input.h"
+#include "pagespeed/core/string_util.h"
 #include "pagespeed/formatters/proto_formatter.h"
 #include "pagespeed/l10n/l10n.h"
 #include "pagespeed/l10n/localizer.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
 #include "pagespeed/proto/pagespeed_proto_formatter.pb.h"
+#include "pagespeed/testing/fake_dom.h"
 #include "pagespeed/testing/pagespeed_test.h"
+#include "pagespeed/util/deadline.h"
 
 using pagespeed::AlwaysAcceptResultFilter;
+using pagespeed::ArtifactComputer;
+using pagespeed::ConcreteImageAttributes;
+using pagespeed::Deadline;
+using pagespeed::DomDocument;
+using pagespeed::DomElement;
+using pagespeed::DomTraversalVisitor;
 using pagespeed::Engine;
 using pagespeed::FormatArgument;
 using pagespeed::Formatter;
@@ -35,7 +53,12 @@ using pagespeed::InputInformation;
 using pagespeed::UserFacingString;
 using pagespeed::FormattedResults;
 using pagespeed::FormattedRuleResults;
+using pagespeed::ImageAttributes;
+using pagespeed::ImageAttributesFactory;
+using pagespeed::InputCapabilities;
 using pagespeed::PagespeedInput;
+using pagespeed::Resource;
+using pagespeed::ResourceResultCache;
 using pagespeed::Result;
 using pagespeed::ResultProvider;
 using pagespeed::Results;
@@ -43,8 +66,12 @@ using pagespeed::Rule;
 using pagespeed::RuleFormatter;
 using pagespeed::RuleInput;
 using pagespeed::RuleResults;
+using pagespeed::formatters::FormattedResultsListener;
+using pagespeed::string_util::IntToString;
 using pagespeed::formatters::ProtoFormatter;
 using pagespeed::l10n::NullLocalizer;
+using pagespeed_testing::FakeDomDocument;
+using pagespeed_testing::FakeDomElement;
 
 namespace {
 
@@ -57,8 +84,10 @@ const char* kBody2 = "Another format string";
 
 class TestRule : public Rule {
  public:
-  explicit TestRule(const char* name = kRuleName)
-      : pagespeed::Rule(pagespeed::InputCapabilities()),
+  explicit TestRule(const char* name = kRuleName,
+                    const InputCapabilities& capability_requirements =
+                        InputCapabilities())
+      : pagespeed::Rule(capability_requirements),
         name_(name),
         append_results_return_value_(true),
         append_results_(true),
@@ -113,6 +142,328 @@ class TestRule : public Rule {
   DISALLOW_COPY_AND_ASSIGN(TestRule);
 };
 
+// Rule that generates a configurable number of results, each tagged
+// with the name of the rule that generated it.
+class MultiResultRule : public TestRule {
+ public:
+  MultiResultRule(const char* name, int num_results)
+      : TestRule(name), num_results_(num_results) {}
+
+  virtual bool AppendResults(const RuleInput& input,
+                             ResultProvider* provider) {
+    for (int i = 0; i < num_results_; ++i) {
+      provider->NewResult()->add_resource_urls(name());
+    }
+    return true;
+  }
+
+ private:
+  const int num_results_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiResultRule);
+};
+
+// Rule that generates one result per resource in the input, tagged
+// with the URL of that resource.
+class PerResourceRule : public TestRule {
+ public:
+  explicit PerResourceRule(const char* name) : TestRule(name) {}
+
+  virtual bool AppendResults(const RuleInput& input,
+                             ResultProvider* provider) {
+    const PagespeedInput& pagespeed_input = input.pagespeed_input();
+    for (int i = 0; i < pagespeed_input.num_resources(); ++i) {
+      provider->NewResult()->add_resource_urls(
+          pagespeed_input.GetResource(i).GetRequestUrl());
+    }
+    return true;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(PerResourceRule);
+};
+
+// Resource-local rule that generates one result per resource in the
+// input, tagged with the URL of that resource, and counts the number of
+// resources it processed.
+class ResourceLocalRule : public PerResourceRule {
+ public:
+  explicit ResourceLocalRule(const char* name)
+      : PerResourceRule(name), num_resources_processed_(0) {}
+
+  virtual bool AppendResults(const RuleInput& input,
+                             ResultProvider* provider) {
+    bool success = true;
+    const PagespeedInput& pagespeed_input = input.pagespeed_input();
+    for (int i = 0; i < pagespeed_input.num_resources(); ++i) {
+      if (!AppendResultsForResource(input, pagespeed_input.GetResource(i),
+                                    provider)) {
+        success = false;
+      }
+    }
+    return success;
+  }
+
+  virtual bool IsResourceLocal() const { return true; }
+
+  virtual bool AppendResultsForResource(const RuleInput& input,
+                                        const Resource& resource,
+                                        ResultProvider* provider) {
+    ++num_resources_processed_;
+    provider->NewResult()->add_resource_urls(resource.GetRequestUrl());
+    return resource.GetResponseBody() != "error";
+  }
+
+  int num_resources_processed() const { return num_resources_processed_; }
+
+ private:
+  int num_resources_processed_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResourceLocalRule);
+};
+
+// Rule that generates a single result, then runs until its deadline
+// expires.
+class UntilDeadlineRule : public TestRule {
+ public:
+  explicit UntilDeadlineRule(const char* name) : TestRule(name) {}
+
+  virtual bool AppendResults(const RuleInput& input,
+                             ResultProvider* provider) {
+    if (input.deadline() == NULL) {
+      return false;
+    }
+    provider->NewResult()->add_resource_urls(name());
+    while (!Deadline::IsExpired(input.deadline())) {
+    }
+    return true;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(UntilDeadlineRule);
+};
+
+// Rule that runs past the engine's time budget without checking its
+// deadline, and so completes all of its work.
+class OverBudgetRule : public TestRule {
+ public:
+  OverBudgetRule(const char* name, int64 run_time_millis)
+      : TestRule(name), run_time_millis_(run_time_millis) {}
+
+  virtual bool AppendResults(const RuleInput& input,
+                             ResultProvider* provider) {
+    Deadline done(base::TimeDelta::FromMilliseconds(run_time_millis_));
+    while (!done.IsExpired()) {
+    }
+    provider->NewResult()->add_resource_urls(name());
+    return true;
+  }
+
+ private:
+  const int64 run_time_millis_;
+
+  DISALLOW_COPY_AND_ASSIGN(OverBudgetRule);
+};
+
+// DOM visitor that generates one result per element, tagged with the
+// element's tag name, taking at least the given time for each element.
+class TagVisitor : public DomTraversalVisitor {
+ public:
+  TagVisitor(ResultProvider* provider, int64 visit_millis)
+      : provider_(provider), visit_millis_(visit_millis) {}
+
+  virtual void Visit(const DomElement& node) {
+    Deadline done(base::TimeDelta::FromMilliseconds(visit_millis_));
+    while (!done.IsExpired()) {
+    }
+    provider_->NewResult()->add_resource_urls(node.GetTagName());
+  }
+
+ private:
+  ResultProvider* provider_;
+  const int64 visit_millis_;
+
+  DISALLOW_COPY_AND_ASSIGN(TagVisitor);
+};
+
+// Rule that generates its results with a TagVisitor, and counts the
+// number of visitors it created.
+class DomRule : public TestRule {
+ public:
+  explicit DomRule(const char* name, int64 visit_millis = 0)
+      : TestRule(name, InputCapabilities(InputCapabilities::DOM)),
+        visit_millis_(visit_millis),
+        num_visitors_created_(0) {}
+
+  virtual DomTraversalVisitor* NewDomVisitor(
+      const RuleInput& input, ResultProvider* provider) const {
+    ++num_visitors_created_;
+    return new TagVisitor(provider, visit_millis_);
+  }
+
+  virtual bool AppendResults(const RuleInput& input,
+                             ResultProvider* provider) {
+    AppendDomVisitorResults(input, provider);
+    return true;
+  }
+
+  int num_visitors_created() const { return num_visitors_created_; }
+
+ private:
+  const int64 visit_millis_;
+  mutable int num_visitors_created_;
+
+  DISALLOW_COPY_AND_ASSIGN(DomRule);
+};
+
+// ImageAttributesFactory that takes at least the given time for each
+// image, as decoding it would, and counts the images it was asked for.
+// Each image's width is the size of its body.
+class SlowImageAttributesFactory : public ImageAttributesFactory {
+ public:
+  SlowImageAttributesFactory(int64 decode_millis, int* num_decoded)
+      : decode_millis_(decode_millis), num_decoded_(num_decoded) {}
+
+  virtual ImageAttributes* NewImageAttributes(const Resource* resource) const {
+    Deadline done(base::TimeDelta::FromMilliseconds(decode_millis_));
+    while (!done.IsExpired()) {
+    }
+    {
+      base::AutoLock lock(lock_);
+      ++*num_decoded_;
+    }
+    return new ConcreteImageAttributes(
+        resource->GetResponseBodyPiece().size(), 1);
+  }
+
+ private:
+  const int64 decode_millis_;
+  mutable base::Lock lock_;
+  int* const num_decoded_;
+
+  DISALLOW_COPY_AND_ASSIGN(SlowImageAttributesFactory);
+};
+
+// DOM visitor that generates one result per image element, holding the
+// width of its image.
+class ImageWidthVisitor : public DomTraversalVisitor {
+ public:
+  ImageWidthVisitor(const RuleInput& input, ResultProvider* provider)
+      : input_(input), provider_(provider) {}
+
+  virtual void Visit(const DomElement& node) {
+    std::string src;
+    if (node.GetTagName() != "IMG" || !node.GetAttributeByName("src", &src)) {
+      return;
+    }
+    const Resource* resource =
+        input_.pagespeed_input().GetResourceWithUrlOrNull(src);
+    int width = 0;
+    int height = 0;
+    if (resource != NULL &&
+        input_.GetImageDimensions(*resource, &width, &height)) {
+      Result* result = provider_->NewResult();
+      result->add_resource_urls(src);
+      result->mutable_savings()->set_response_bytes_saved(width);
+    }
+  }
+
+ private:
+  const RuleInput& input_;
+  ResultProvider* provider_;
+
+  DISALLOW_COPY_AND_ASSIGN(ImageWidthVisitor);
+};
+
+// Rule that generates its results with an ImageWidthVisitor.
+class ImageWidthRule : public TestRule {
+ public:
+  ImageWidthRule()
+      : TestRule("ImageWidthRule", InputCapabilities(InputCapabilities::DOM)) {}
+
+  virtual DomTraversalVisitor* NewDomVisitor(
+      const RuleInput& input, ResultProvider* provider) const {
+    return new ImageWidthVisitor(input, provider);
+  }
+
+  virtual bool DomVisitorUsesImageDimensions() const {
+    return true;
+  }
+
+  virtual bool AppendResults(const RuleInput& input,
+                             ResultProvider* provider) {
+    AppendDomVisitorResults(input, provider);
+    return true;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ImageWidthRule);
+};
+
+// ArtifactComputer that fails to compute anything.
+class FailingArtifactComputer : public ArtifactComputer {
+ public:
+  FailingArtifactComputer() {}
+
+  virtual bool MinifyJavaScript(const Resource& resource,
+                                const Deadline* deadline,
+                                std::string* output) const {
+    return false;
+  }
+  virtual bool GetMinifiedJavaScriptSize(const Resource& resource,
+                                         const Deadline* deadline,
+                                         int* output) const {
+    return false;
+  }
+  virtual bool GetStringCollapsedMinifiedJavaScriptSize(
+      const Resource& resource,
+      const Deadline* deadline,
+      int* output) const {
+    return false;
+  }
+  virtual bool MinifyCss(const Resource& resource,
+                         const Deadline* deadline,
+                         std::string* output) const {
+    return false;
+  }
+  virtual bool GetMinifiedCssSize(const Resource& resource,
+                                  const Deadline* deadline,
+                                  int* output) const {
+    return false;
+  }
+  virtual bool MinifyHtml(const Resource& resource,
+                          const Deadline* deadline,
+                          std::string* output) const {
+    return false;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(FailingArtifactComputer);
+};
+
+// Rule that records the ArtifactComputer of the RuleInput it ran
+// against.
+class ArtifactComputerRule : public TestRule {
+ public:
+  explicit ArtifactComputerRule(const char* name)
+      : TestRule(name), artifact_computer_(NULL) {}
+
+  virtual bool AppendResults(const RuleInput& input,
+                             ResultProvider* provider) {
+    artifact_computer_ = input.artifact_computer();
+    return true;
+  }
+
+  const ArtifactComputer* artifact_computer() const {
+    return artifact_computer_;
+  }
+
+ private:
+  const ArtifactComputer* artifact_computer_;
+
+  DISALLOW_COPY_AND_ASSIGN(ArtifactComputerRule);
+};
+
 class TestExperimentalRule : public TestRule {
  public:
   explicit TestExperimentalRule(const char* name = kExperimentalRuleName)
@@ -123,6 +474,24 @@ class TestExperimentalRule : public TestRule {
   DISALLOW_COPY_AND_ASSIGN(TestExperimentalRule);
 };
 
+// Create a frozen input with one resource for each of the given
+// response bodies.
+PagespeedInput* NewInputWithResponseBodies(const char* const* bodies,
+                                           int num_bodies) {
+  PagespeedInput* input = new PagespeedInput();
+  for (int i = 0; i < num_bodies; ++i) {
+    Resource* resource = new Resource();
+    resource->SetRequestUrl(
+        "http://www.example.com/" + std::string(1, 'a' + i));
+    resource->SetRequestMethod("GET");
+    resource->SetResponseStatusCode(200);
+    resource->SetResponseBody(bodies[i]);
+    input->AddResource(resource);
+  }
+  input->Freeze();
+  return input;
+}
+
 TEST(EngineTest, ComputeResults) {
   PagespeedInput input;
   input.Freeze();
@@ -248,6 +617,76 @@ class NeverAcceptRuleResultsFilter : public pagespeed::ResultFilter {
   DISALLOW_COPY_AND_ASSIGN(NeverAcceptRuleResultsFilter);
 };
 
+// Filter that only accepts the results of the rule with the given name.
+class SingleRuleFilter : public pagespeed::ResultFilter {
+ public:
+  explicit SingleRuleFilter(const std::string& rule_name)
+      : rule_name_(rule_name) {}
+  virtual ~SingleRuleFilter() {}
+
+  virtual bool IsResultAccepted(const Result&) const { return true; }
+  virtual bool IsRuleResultsAccepted(const RuleResults& rule_results) const {
+    return rule_results.rule_name() == rule_name_;
+  }
+  virtual bool IsRuleAccepted(const Rule& rule) const {
+    return rule.name() == rule_name_;
+  }
+
+ private:
+  const std::string rule_name_;
+
+  DISALLOW_COPY_AND_ASSIGN(SingleRuleFilter);
+};
+
+TEST(EngineTest, ComputeResultsSkipsRulesWithUnsatisfiedCapabilities) {
+  PagespeedInput input;
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new TestRule("rule0"));
+  rules.push_back(
+      new TestRule("rule1", InputCapabilities(InputCapabilities::DOM)));
+  rules.push_back(new TestRule("rule2"));
+
+  Engine engine(&rules);
+  engine.Init();
+  Results results;
+  ASSERT_TRUE(engine.ComputeResults(input, &results));
+  ASSERT_EQ(2, results.rule_results_size());
+  EXPECT_EQ("rule0", results.rule_results(0).rule_name());
+  EXPECT_EQ("rule2", results.rule_results(1).rule_name());
+  EXPECT_EQ(0, results.rule_results(0).results(0).id());
+  EXPECT_EQ(1, results.rule_results(1).results(0).id());
+}
+
+TEST(EngineTest, ComputeResultsSkipsRulesRejectedByFilter) {
+  PagespeedInput input;
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new TestRule("rule0"));
+  TestRule* rejected_rule = new TestRule("rule1");
+  // The rejected rule would fail if it ran.
+  rejected_rule->set_append_results_return_value(false);
+  rules.push_back(rejected_rule);
+
+  Engine engine(&rules);
+  engine.Init();
+  SingleRuleFilter filter("rule0");
+  Results results;
+  ASSERT_TRUE(engine.ComputeResults(input, filter, &results));
+  ASSERT_EQ(1, results.rule_results_size());
+  EXPECT_EQ("rule0", results.rule_results(0).rule_name());
+  EXPECT_EQ(0, results.error_rules_size());
+
+  FormattedResults formatted_results;
+  NullLocalizer localizer;
+  ProtoFormatter formatter(&localizer, &formatted_results);
+  ASSERT_TRUE(engine.ComputeAndFormatResults(input, filter, &formatter));
+  ASSERT_EQ(1, formatted_results.rule_results_size());
+  EXPECT_EQ("rule0", formatted_results.rule_results(0).rule_name());
+}
+
 TEST(EngineTest, FormatResultsFilter) {
   PagespeedInput input;
   input.Freeze();
@@ -422,6 +861,585 @@ TEST(EngineTest, ResultIdAssignment) {
   EXPECT_EQ(2, results.rule_results(2).results(0).id());
 }
 
+TEST(EngineTest, ComputeResultsParallel) {
+  PagespeedInput input;
+  input.Freeze();
+
+  const char* kRuleNames[] = {
+    "rule0", "rule1", "rule2", "rule3", "rule4", "rule5", "rule6", "rule7",
+  };
+
+  Results serial_results;
+  Results parallel_results;
+  for (int num_threads = 1; num_threads <= 4; num_threads += 3) {
+    std::vector<Rule*> rules;
+    for (size_t i = 0; i < arraysize(kRuleNames); ++i) {
+      rules.push_back(new MultiResultRule(kRuleNames[i], i % 3));
+    }
+    TestRule* failing_rule = new TestRule("failing_rule");
+    failing_rule->set_append_results_return_value(false);
+    rules.push_back(failing_rule);
+
+    Engine engine(&rules);
+    engine.set_num_threads(num_threads);
+    engine.Init();
+    ASSERT_FALSE(engine.ComputeResults(
+        input, num_threads == 1 ? &serial_results : &parallel_results));
+  }
+
+  // The parallel results must be identical to the serial results,
+  // including rule order and result ids.
+  ASSERT_EQ(serial_results.SerializeAsString(),
+            parallel_results.SerializeAsString());
+
+  ASSERT_EQ(9, parallel_results.rule_results_size());
+  int expected_id = 0;
+  for (int i = 0; i < 8; ++i) {
+    const RuleResults& rule_results = parallel_results.rule_results(i);
+    ASSERT_EQ(kRuleNames[i], rule_results.rule_name());
+    ASSERT_EQ(i % 3, rule_results.results_size());
+    for (int j = 0; j < rule_results.results_size(); ++j) {
+      EXPECT_EQ(expected_id++, rule_results.results(j).id());
+      EXPECT_EQ(kRuleNames[i], rule_results.results(j).resource_urls(0));
+    }
+  }
+  EXPECT_EQ(expected_id, parallel_results.rule_results(8).results(0).id());
+  ASSERT_EQ(1, parallel_results.error_rules_size());
+  EXPECT_EQ("failing_rule", parallel_results.error_rules(0));
+}
+
+// Records the names of the rules passed to the listener, and the
+// number of rules that had been formatted when the results were
+// finalized.
+class RecordingFormattedResultsListener : public FormattedResultsListener {
+ public:
+  RecordingFormattedResultsListener() : num_rules_at_finalize_(-1) {}
+
+  virtual void OnRuleResults(const FormattedRuleResults& rule_results) {
+    EXPECT_EQ(-1, num_rules_at_finalize_);
+    rule_names_.push_back(rule_results.rule_name());
+  }
+
+  virtual void OnFinalize(const FormattedResults& results) {
+    num_rules_at_finalize_ = results.rule_results_size();
+  }
+
+  const std::vector<std::string>& rule_names() const { return rule_names_; }
+  int num_rules_at_finalize() const { return num_rules_at_finalize_; }
+
+ private:
+  std::vector<std::string> rule_names_;
+  int num_rules_at_finalize_;
+
+  DISALLOW_COPY_AND_ASSIGN(RecordingFormattedResultsListener);
+};
+
+TEST(EngineTest, ComputeAndFormatResultsStreaming) {
+  PagespeedInput input;
+  input.Freeze();
+
+  const char* kRuleNames[] = {
+    "rule0", "rule1", "rule2", "rule3", "rule4", "rule5", "rule6", "rule7",
+  };
+
+  for (int num_threads = 1; num_threads <= 4; num_threads += 3) {
+    std::vector<Rule*> rules;
+    for (size_t i = 0; i < arraysize(kRuleNames); ++i) {
+      rules.push_back(new MultiResultRule(kRuleNames[i], i % 3));
+    }
+    Engine engine(&rules);
+    engine.set_num_threads(num_threads);
+    engine.Init();
+
+    AlwaysAcceptResultFilter filter;
+    NullLocalizer localizer;
+    FormattedResults expected;
+    expected.set_locale("en_US");
+    ProtoFormatter expected_formatter(&localizer, &expected);
+    ASSERT_TRUE(engine.ComputeAndFormatResults(input, &expected_formatter));
+
+    Results results;
+    FormattedResults formatted_results;
+    formatted_results.set_locale("en_US");
+    ProtoFormatter formatter(&localizer, &formatted_results);
+    RecordingFormattedResultsListener listener;
+    formatter.set_listener(&listener);
+    ASSERT_TRUE(engine.ComputeAndFormatResultsStreaming(
+        input, filter, &formatter, &results));
+
+    // Streaming must not change the formatted results, and rules must
+    // be streamed in order, before the results are finalized.
+    ASSERT_EQ(expected.SerializeAsString(),
+              formatted_results.SerializeAsString());
+    ASSERT_EQ(arraysize(kRuleNames), listener.rule_names().size());
+    for (size_t i = 0; i < arraysize(kRuleNames); ++i) {
+      EXPECT_EQ(kRuleNames[i], listener.rule_names()[i]);
+    }
+    EXPECT_EQ(static_cast<int>(arraysize(kRuleNames)),
+              listener.num_rules_at_finalize());
+
+    // The computed results are the same as those from ComputeResults.
+    Results expected_results;
+    ASSERT_TRUE(engine.ComputeResults(input, &expected_results));
+    ASSERT_EQ(expected_results.SerializeAsString(),
+              results.SerializeAsString());
+  }
+}
+
+TEST(EngineTest, ComputeAndFormatResultsStreamingFilter) {
+  PagespeedInput input;
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new TestRule());
+
+  Engine engine(&rules);
+  engine.Init();
+
+  NeverAcceptRuleResultsFilter filter;
+  Results results;
+  FormattedResults formatted_results;
+  NullLocalizer localizer;
+  ProtoFormatter formatter(&localizer, &formatted_results);
+  RecordingFormattedResultsListener listener;
+  formatter.set_listener(&listener);
+  ASSERT_TRUE(engine.ComputeAndFormatResultsStreaming(
+      input, filter, &formatter, &results));
+  ASSERT_EQ(1, results.rule_results_size());
+  ASSERT_EQ(0, formatted_results.rule_results_size());
+  ASSERT_TRUE(listener.rule_names().empty());
+  ASSERT_EQ(0, listener.num_rules_at_finalize());
+  ASSERT_EQ(100, formatted_results.score());
+}
+
+TEST(EngineTest, ComputeResultsBatch) {
+  const int kNumInputs = 5;
+  std::vector<PagespeedInput*> inputs;
+  for (int i = 0; i < kNumInputs; ++i) {
+    PagespeedInput* input = new PagespeedInput();
+    for (int j = 0; j < i; ++j) {
+      Resource* resource = new Resource();
+      resource->SetRequestUrl(
+          "http://www.example.com/" + std::string(1, 'a' + i) +
+          std::string(1, 'a' + j));
+      resource->SetRequestMethod("GET");
+      resource->SetResponseStatusCode(200);
+      ASSERT_TRUE(input->AddResource(resource));
+    }
+    input->Freeze();
+    inputs.push_back(input);
+  }
+
+  const char* kRuleNames[] = { "rule0", "rule1", "rule2" };
+  std::vector<Results*> expected_results;
+  std::vector<Results*> batch_results;
+  for (int num_threads = 1; num_threads <= 4; num_threads += 3) {
+    std::vector<Rule*> rules;
+    for (size_t i = 0; i < arraysize(kRuleNames); ++i) {
+      rules.push_back(new PerResourceRule(kRuleNames[i]));
+    }
+    TestRule* failing_rule = new TestRule("failing_rule");
+    failing_rule->set_append_results_return_value(false);
+    rules.push_back(failing_rule);
+
+    Engine engine(&rules);
+    engine.set_num_threads(num_threads);
+    engine.Init();
+    if (num_threads == 1) {
+      // Compute the expected results one input at a time.
+      for (int i = 0; i < kNumInputs; ++i) {
+        Results* results = new Results();
+        ASSERT_FALSE(engine.ComputeResults(*inputs[i], results));
+        expected_results.push_back(results);
+      }
+    } else {
+      std::vector<const PagespeedInput*> const_inputs(inputs.begin(),
+                                                      inputs.end());
+      for (int i = 0; i < kNumInputs; ++i) {
+        batch_results.push_back(new Results());
+      }
+      ASSERT_FALSE(engine.ComputeResultsBatch(const_inputs, batch_results));
+    }
+  }
+
+  for (int i = 0; i < kNumInputs; ++i) {
+    EXPECT_EQ(expected_results[i]->SerializeAsString(),
+              batch_results[i]->SerializeAsString());
+    ASSERT_EQ(4, batch_results[i]->rule_results_size());
+    EXPECT_EQ(i, batch_results[i]->rule_results(0).results_size());
+    EXPECT_EQ(i, batch_results[i]->input_info().number_resources());
+    ASSERT_EQ(1, batch_results[i]->error_rules_size());
+    EXPECT_EQ("failing_rule", batch_results[i]->error_rules(0));
+  }
+
+  STLDeleteElements(&inputs);
+  STLDeleteElements(&expected_results);
+  STLDeleteElements(&batch_results);
+}
+
+TEST(EngineTest, ComputeResultsBatchEmpty) {
+  std::vector<Rule*> rules;
+  rules.push_back(new TestRule());
+  Engine engine(&rules);
+  engine.Init();
+  std::vector<const PagespeedInput*> inputs;
+  std::vector<Results*> results;
+  ASSERT_TRUE(engine.ComputeResultsBatch(inputs, results));
+}
+
+TEST(EngineTest, ComputeResultsProfileRules) {
+  PagespeedInput input;
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new MultiResultRule("rule0", 2));
+  rules.push_back(new MultiResultRule("rule1", 0));
+
+  Engine engine(&rules);
+  engine.set_profile_rules(true);
+  engine.Init();
+  Results results;
+  ASSERT_TRUE(engine.ComputeResults(input, &results));
+
+  ASSERT_EQ(2, results.rule_results_size());
+  for (int i = 0; i < results.rule_results_size(); ++i) {
+    const RuleResults& rule_results = results.rule_results(i);
+    ASSERT_TRUE(rule_results.has_timing());
+    EXPECT_EQ(rule_results.rule_name(), rule_results.timing().name());
+    EXPECT_EQ(rule_results.results_size(),
+              rule_results.timing().num_results());
+    EXPECT_GE(rule_results.timing().wall_time_millis(), 0.0);
+  }
+  ASSERT_EQ(1, results.stage_timings_size());
+  EXPECT_EQ("RuleInput::Init", results.stage_timings(0).name());
+  EXPECT_FALSE(results.stage_timings(0).has_num_results());
+}
+
+TEST(EngineTest, ComputeResultsSharedDomTraversal) {
+  PagespeedInput input;
+  Resource* resource = new Resource();
+  resource->SetRequestUrl("http://example.com/");
+  resource->SetRequestMethod("GET");
+  resource->SetResponseStatusCode(200);
+  input.AddResource(resource);
+  FakeDomDocument* document = FakeDomDocument::NewRoot("http://example.com/");
+  FakeDomElement* html = FakeDomElement::NewRoot(document, "HTML");
+  FakeDomElement::New(html, "BODY");
+  input.AcquireDomDocument(document);
+  input.Freeze();
+
+  DomRule* rule0 = new DomRule("rule0");
+  DomRule* rule1 = new DomRule("rule1");
+  std::vector<Rule*> rules;
+  rules.push_back(rule0);
+  rules.push_back(rule1);
+
+  Engine engine(&rules);
+  engine.set_profile_rules(true);
+  engine.Init();
+  Results results;
+  ASSERT_TRUE(engine.ComputeResults(input, &results));
+
+  // Each rule's visitor ran once, in the shared traversal, and its
+  // results were appended in the order it generated them.
+  EXPECT_EQ(1, rule0->num_visitors_created());
+  EXPECT_EQ(1, rule1->num_visitors_created());
+  ASSERT_EQ(2, results.rule_results_size());
+  int expected_id = 0;
+  for (int i = 0; i < results.rule_results_size(); ++i) {
+    const RuleResults& rule_results = results.rule_results(i);
+    ASSERT_EQ(2, rule_results.results_size());
+    EXPECT_EQ("HTML", rule_results.results(0).resource_urls(0));
+    EXPECT_EQ("BODY", rule_results.results(1).resource_urls(0));
+    EXPECT_EQ(expected_id++, rule_results.results(0).id());
+    EXPECT_EQ(expected_id++, rule_results.results(1).id());
+  }
+  ASSERT_EQ(2, results.stage_timings_size());
+  EXPECT_EQ("RuleInput::Init", results.stage_timings(0).name());
+  EXPECT_EQ("RuleInput::TraverseDom", results.stage_timings(1).name());
+}
+
+TEST(EngineTest, ComputeResultsDomVisitorTimeBudget) {
+  PagespeedInput input;
+  Resource* resource = new Resource();
+  resource->SetRequestUrl("http://example.com/");
+  resource->SetRequestMethod("GET");
+  resource->SetResponseStatusCode(200);
+  input.AddResource(resource);
+  FakeDomDocument* document = FakeDomDocument::NewRoot("http://example.com/");
+  FakeDomElement* html = FakeDomElement::NewRoot(document, "HTML");
+  FakeDomElement::New(html, "HEAD");
+  FakeDomElement::New(html, "BODY");
+  input.AcquireDomDocument(document);
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new DomRule("rule0"));
+  rules.push_back(new DomRule("rule1", 10));
+
+  Engine engine(&rules);
+  engine.set_profile_rules(true);
+  engine.set_rule_time_budget_millis(5);
+  engine.Init();
+  Results results;
+  ASSERT_FALSE(engine.ComputeResults(input, &results));
+
+  // The slow visitor was stopped after its first element, and its rule
+  // was charged for the time it spent.
+  ASSERT_EQ(2, results.rule_results_size());
+  EXPECT_EQ(3, results.rule_results(0).results_size());
+  EXPECT_EQ(1, results.rule_results(1).results_size());
+  EXPECT_GE(results.rule_results(1).timing().wall_time_millis(), 10.0);
+  ASSERT_EQ(1, results.timed_out_rules_size());
+  EXPECT_EQ("rule1", results.timed_out_rules(0));
+}
+
+// Compute the results of an ImageWidthRule for the given input with the
+// given number of threads, returning the wall time it took.
+double ComputeImageWidthResults(const PagespeedInput& input,
+                                int num_threads,
+                                Results* results) {
+  std::vector<Rule*> rules;
+  rules.push_back(new ImageWidthRule());
+  Engine engine(&rules);
+  engine.set_num_threads(num_threads);
+  engine.Init();
+  const base::TimeTicks start = base::TimeTicks::Now();
+  EXPECT_TRUE(engine.ComputeResults(input, results));
+  return (base::TimeTicks::Now() - start).InMillisecondsF();
+}
+
+TEST(EngineTest, ComputeResultsPopulatesImageDimensionsInParallel) {
+  const int kNumImages = 8;
+  PagespeedInput input;
+  Resource* primary = new Resource();
+  primary->SetRequestUrl("http://example.com/");
+  primary->SetRequestMethod("GET");
+  primary->SetResponseStatusCode(200);
+  input.AddResource(primary);
+  FakeDomDocument* document = FakeDomDocument::NewRoot("http://example.com/");
+  FakeDomElement* html = FakeDomElement::NewRoot(document, "HTML");
+  FakeDomElement* body = FakeDomElement::New(html, "BODY");
+  for (int i = 0; i < kNumImages; ++i) {
+    const std::string url = "http://example.com/" + IntToString(i) + ".png";
+    Resource* image = new Resource();
+    image->SetRequestUrl(url);
+    image->SetRequestMethod("GET");
+    image->SetResponseStatusCode(200);
+    image->AddResponseHeader("Content-Type", "image/png");
+    image->SetResponseBody(std::string(i + 1, 'x'));
+    input.AddResource(image);
+    FakeDomElement::NewImg(body, url);
+  }
+  input.AcquireDomDocument(document);
+  int num_decoded = 0;
+  input.AcquireImageAttributesFactory(
+      new SlowImageAttributesFactory(20, &num_decoded));
+  input.Freeze();
+
+  Results serial_results;
+  const double serial_millis =
+      ComputeImageWidthResults(input, 1, &serial_results);
+  EXPECT_EQ(kNumImages, num_decoded);
+
+  num_decoded = 0;
+  Results parallel_results;
+  const double parallel_millis =
+      ComputeImageWidthResults(input, 4, &parallel_results);
+
+  // Each image was still decoded once, the results are unchanged, and
+  // decoding the images in parallel up front made the input faster.
+  EXPECT_EQ(kNumImages, num_decoded);
+  ASSERT_EQ(1, parallel_results.rule_results_size());
+  ASSERT_EQ(kNumImages, parallel_results.rule_results(0).results_size());
+  EXPECT_EQ(serial_results.SerializeAsString(),
+            parallel_results.SerializeAsString());
+  EXPECT_LT(parallel_millis, serial_millis);
+}
+
+TEST(EngineTest, ComputeResultsNoProfileByDefault) {
+  PagespeedInput input;
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new MultiResultRule("rule0", 1));
+
+  Engine engine(&rules);
+  engine.Init();
+  Results results;
+  ASSERT_TRUE(engine.ComputeResults(input, &results));
+  ASSERT_FALSE(results.rule_results(0).has_timing());
+  ASSERT_EQ(0, results.stage_timings_size());
+}
+
+TEST(EngineTest, ComputeResultsRuleTimeBudget) {
+  PagespeedInput input;
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new MultiResultRule("rule0", 1));
+  rules.push_back(new UntilDeadlineRule("rule1"));
+  rules.push_back(new MultiResultRule("rule2", 1));
+
+  Engine engine(&rules);
+  engine.set_rule_time_budget_millis(5);
+  engine.Init();
+  Results results;
+  ASSERT_FALSE(engine.ComputeResults(input, &results));
+
+  // The rule that ran out of time keeps its partial results, and is
+  // reported as both an error rule and a timed out rule.
+  ASSERT_EQ(3, results.rule_results_size());
+  EXPECT_EQ(1, results.rule_results(0).results_size());
+  EXPECT_EQ(1, results.rule_results(1).results_size());
+  EXPECT_EQ(1, results.rule_results(2).results_size());
+  ASSERT_EQ(1, results.error_rules_size());
+  EXPECT_EQ("rule1", results.error_rules(0));
+  ASSERT_EQ(1, results.timed_out_rules_size());
+  EXPECT_EQ("rule1", results.timed_out_rules(0));
+}
+
+TEST(EngineTest, ComputeResultsRuleOverBudgetNotTimedOut) {
+  PagespeedInput input;
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new OverBudgetRule("rule0", 20));
+
+  Engine engine(&rules);
+  engine.set_rule_time_budget_millis(5);
+  engine.Init();
+  Results results;
+  // The rule never saw its deadline expire, so its results are
+  // complete even though it ran over budget.
+  ASSERT_TRUE(engine.ComputeResults(input, &results));
+  ASSERT_EQ(1, results.rule_results(0).results_size());
+  EXPECT_EQ(0, results.error_rules_size());
+  EXPECT_EQ(0, results.timed_out_rules_size());
+}
+
+TEST(EngineTest, ComputeResultsNoRuleTimeBudgetByDefault) {
+  PagespeedInput input;
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new UntilDeadlineRule("rule0"));
+
+  Engine engine(&rules);
+  engine.Init();
+  Results results;
+  // Without a time budget the rule has no deadline, so it reports an
+  // error rather than running forever.
+  ASSERT_FALSE(engine.ComputeResults(input, &results));
+  ASSERT_EQ(1, results.error_rules_size());
+  EXPECT_EQ(0, results.timed_out_rules_size());
+}
+
+TEST(EngineTest, ComputeResultsResourceResultCache) {
+  ResourceLocalRule* local_rule = new ResourceLocalRule("local_rule");
+  std::vector<Rule*> rules;
+  rules.push_back(local_rule);
+  rules.push_back(new MultiResultRule("global_rule", 1));
+
+  ResourceResultCache cache;
+  Engine engine(&rules);
+  engine.set_resource_result_cache(&cache);
+  engine.Init();
+
+  const char* kBodies[] = { "a", "b", "c" };
+  scoped_ptr<PagespeedInput> input(
+      NewInputWithResponseBodies(kBodies, arraysize(kBodies)));
+  Results results;
+  ASSERT_TRUE(engine.ComputeResults(*input, &results));
+  EXPECT_EQ(3, local_rule->num_resources_processed());
+  EXPECT_EQ(3, cache.num_entries());
+
+  // Analyzing an identical input reuses the cached results for every
+  // resource, and generates identical results.
+  scoped_ptr<PagespeedInput> same_input(
+      NewInputWithResponseBodies(kBodies, arraysize(kBodies)));
+  Results same_results;
+  ASSERT_TRUE(engine.ComputeResults(*same_input, &same_results));
+  EXPECT_EQ(3, local_rule->num_resources_processed());
+  EXPECT_EQ(results.SerializeAsString(), same_results.SerializeAsString());
+
+  // Only the modified resource is processed again.
+  const char* kModifiedBodies[] = { "a", "modified", "c" };
+  scoped_ptr<PagespeedInput> modified_input(
+      NewInputWithResponseBodies(kModifiedBodies, arraysize(kModifiedBodies)));
+  Results modified_results;
+  ASSERT_TRUE(engine.ComputeResults(*modified_input, &modified_results));
+  EXPECT_EQ(4, local_rule->num_resources_processed());
+  EXPECT_EQ(4, cache.num_entries());
+
+  ASSERT_EQ(2, modified_results.rule_results_size());
+  const RuleResults& local_results = modified_results.rule_results(0);
+  ASSERT_EQ(3, local_results.results_size());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(i, local_results.results(i).id());
+    EXPECT_EQ(input->GetResource(i).GetRequestUrl(),
+              local_results.results(i).resource_urls(0));
+  }
+  const RuleResults& global_results = modified_results.rule_results(1);
+  ASSERT_EQ(1, global_results.results_size());
+  EXPECT_EQ(3, global_results.results(0).id());
+}
+
+TEST(EngineTest, ComputeResultsResourceResultCacheSkipsErrors) {
+  ResourceLocalRule* local_rule = new ResourceLocalRule("local_rule");
+  std::vector<Rule*> rules;
+  rules.push_back(local_rule);
+
+  ResourceResultCache cache;
+  Engine engine(&rules);
+  engine.set_resource_result_cache(&cache);
+  engine.Init();
+
+  const char* kBodies[] = { "a", "error" };
+  scoped_ptr<PagespeedInput> input(
+      NewInputWithResponseBodies(kBodies, arraysize(kBodies)));
+  Results results;
+  ASSERT_FALSE(engine.ComputeResults(*input, &results));
+  ASSERT_EQ(1, results.error_rules_size());
+  EXPECT_EQ(2, results.rule_results(0).results_size());
+  EXPECT_EQ(1, cache.num_entries());
+
+  // The resource that failed is processed again.
+  Results second_results;
+  ASSERT_FALSE(engine.ComputeResults(*input, &second_results));
+  EXPECT_EQ(3, local_rule->num_resources_processed());
+  EXPECT_EQ(results.SerializeAsString(), second_results.SerializeAsString());
+}
+
+TEST(EngineTest, ComputeResultsResourceResultCacheEstimatedSizes) {
+  ResourceLocalRule* local_rule = new ResourceLocalRule("local_rule");
+  std::vector<Rule*> rules;
+  rules.push_back(local_rule);
+
+  ResourceResultCache cache;
+  Engine engine(&rules);
+  engine.set_resource_result_cache(&cache);
+  engine.Init();
+
+  const char* kBodies[] = { "a", "b" };
+  scoped_ptr<PagespeedInput> input(
+      NewInputWithResponseBodies(kBodies, arraysize(kBodies)));
+  Results results;
+  ASSERT_TRUE(engine.ComputeResults(*input, &results));
+  EXPECT_EQ(2, local_rule->num_resources_processed());
+
+  // Results computed with exact compressed sizes are not reused when
+  // estimating them, and the estimated results are cached separately.
+  engine.set_estimate_compressed_sizes(true);
+  Results estimated_results;
+  ASSERT_TRUE(engine.ComputeResults(*input, &estimated_results));
+  EXPECT_EQ(4, local_rule->num_resources_processed());
+  EXPECT_EQ(4, cache.num_entries());
+
+  ASSERT_TRUE(engine.ComputeResults(*input, &estimated_results));
+  EXPECT_EQ(4, local_rule->num_resources_processed());
+}
+
 TEST(EngineTest, ComputeScoreOneExperimentalRule) {
   PagespeedInput input;
   input.Freeze();
@@ -508,6 +1526,97 @@ TEST(EngineTest, FilterResults) {
 // mobile blocking round trips (8 * 9) should yield a score of 60; and so on
 // logarithmically.  Also, anything >= an impact of 93 mobile blocking rounds
 // trips should just be a score of zero.
+// Accepts results with odd ids, from all rules except the given one.
+class OddResultIdFilter : public pagespeed::ResultFilter {
+ public:
+  explicit OddResultIdFilter(const char* rejected_rule_name)
+      : rejected_rule_name_(rejected_rule_name) {}
+  virtual ~OddResultIdFilter() {}
+
+  virtual bool IsResultAccepted(const Result& result) const {
+    return result.id() % 2 == 1;
+  }
+  virtual bool IsRuleResultsAccepted(const RuleResults& rule_results) const {
+    return rule_results.rule_name() != rejected_rule_name_;
+  }
+
+ private:
+  const std::string rejected_rule_name_;
+
+  DISALLOW_COPY_AND_ASSIGN(OddResultIdFilter);
+};
+
+TEST(EngineTest, GetAcceptedResults) {
+  PagespeedInput input;
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new MultiResultRule("rule0", 3));
+  rules.push_back(new MultiResultRule("rule1", 2));
+  rules.push_back(new MultiResultRule("rule2", 2));
+
+  Engine engine(&rules);
+  engine.Init();
+  Results results;
+  ASSERT_TRUE(engine.ComputeResults(input, &results));
+
+  // Result ids are 0-2 for rule0, 3-4 for rule1 and 5-6 for rule2.
+  OddResultIdFilter filter("rule1");
+  std::vector<pagespeed::AcceptedRuleResults> accepted;
+  filter.GetAcceptedResults(results, &accepted);
+  ASSERT_EQ(2U, accepted.size());
+  ASSERT_EQ(0, accepted[0].rule_results_index);
+  ASSERT_EQ(1U, accepted[0].result_indices.size());
+  ASSERT_EQ(1, accepted[0].result_indices[0]);
+  ASSERT_EQ(2, accepted[1].rule_results_index);
+  ASSERT_EQ(1U, accepted[1].result_indices.size());
+  ASSERT_EQ(0, accepted[1].result_indices[0]);
+}
+
+TEST(EngineTest, FilterResultsInPlace) {
+  PagespeedInput input;
+  input.Freeze();
+
+  std::vector<Rule*> rules;
+  rules.push_back(new MultiResultRule("rule0", 3));
+  rules.push_back(new MultiResultRule("rule1", 2));
+  rules.push_back(new MultiResultRule("rule2", 2));
+  rules.push_back(new MultiResultRule("rule3", 4));
+
+  Engine engine(&rules);
+  engine.Init();
+  Results results;
+  ASSERT_TRUE(engine.ComputeResults(input, &results));
+  // Set the optional fields, so that FilterResults must copy them too.
+  results.add_error_rules("rule3");
+  results.add_timed_out_rules("rule3");
+  results.add_stage_timings()->set_name("stage");
+  results.mutable_rule_results(3)->mutable_timing()->set_name("rule3");
+
+  OddResultIdFilter filter("rule1");
+  Results expected;
+  engine.FilterResults(results, filter, &expected);
+
+  const Result* result1 = &results.rule_results(0).results(1);
+  engine.FilterResultsInPlace(filter, &results);
+  ASSERT_EQ(expected.SerializeAsString(), results.SerializeAsString());
+
+  ASSERT_EQ(3, results.rule_results_size());
+  ASSERT_EQ("rule0", results.rule_results(0).rule_name());
+  ASSERT_EQ("rule2", results.rule_results(1).rule_name());
+  ASSERT_EQ("rule3", results.rule_results(2).rule_name());
+  ASSERT_EQ(1, results.rule_results(0).results_size());
+  ASSERT_EQ(1, results.rule_results(0).results(0).id());
+  ASSERT_EQ(1, results.rule_results(1).results_size());
+  ASSERT_EQ(5, results.rule_results(1).results(0).id());
+  ASSERT_EQ(2, results.rule_results(2).results_size());
+  ASSERT_EQ(7, results.rule_results(2).results(0).id());
+  ASSERT_EQ(9, results.rule_results(2).results(1).id());
+
+  // Accepted results are moved, not copied.
+  ASSERT_EQ(result1, &results.rule_results(0).results(0));
+}
+
 TEST(EngineTest, TestScoreRanges) {
   PagespeedInput input;
   input.Freeze();
@@ -528,4 +1637,21 @@ TEST(EngineTest, TestScoreRanges) {
   }
 }
 
+TEST(EngineTest, ComputeResultsArtifactComputer) {
+  PagespeedInput input;
+  input.Freeze();
+
+  ArtifactComputerRule* rule = new ArtifactComputerRule("rule0");
+  std::vector<Rule*> rules;
+  rules.push_back(rule);
+
+  FailingArtifactComputer computer;
+  Engine engine(&rules);
+  engine.set_artifact_computer(&computer);
+  engine.Init();
+  Results results;
+  ASSERT_TRUE(engine.ComputeResults(input, &results));
+  EXPECT_EQ(&computer, rule->artifact_computer());
+}
+
 }  // namespace
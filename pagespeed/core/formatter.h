@@ -259,6 +259,13 @@ class Formatter {
   // Set the overall score (from 0 to 100).
   virtual void SetOverallScore(int score) = 0;
 
+  // Called once the RuleFormatter most recently returned by AddRule,
+  // and its children, will not be modified any further. Streaming
+  // formatters may emit the rule's formatted results at this point,
+  // rather than waiting for Finalize. The default implementation does
+  // nothing.
+  virtual void FinishRule() {}
+
   // Finalize the formatted results.
   virtual void Finalize() = 0;
 
@@ -0,0 +1,206 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pagespeed/core/header_map.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "pagespeed/core/string_util.h"
+
+namespace {
+
+using pagespeed::HeaderMap;
+using pagespeed::string_util::StringCaseEqual;
+
+// Indexed by WellKnownHeader, and sorted without regard to case, so
+// that FindWellKnownHeader can binary search it.
+const char* const kWellKnownHeaderNames[] = {
+  "Accept-Encoding",
+  "Cache-Control",
+  "Connection",
+  "Content-Encoding",
+  "Content-Type",
+  "Cookie",
+  "Date",
+  "ETag",
+  "Expires",
+  "Host",
+  "Last-Modified",
+  "Location",
+  "Pragma",
+  "Referer",
+  "Set-Cookie",
+  "Vary",
+};
+
+COMPILE_ASSERT(arraysize(kWellKnownHeaderNames) ==
+               pagespeed::NUM_WELL_KNOWN_HEADERS,
+               well_known_header_names_must_match_enum);
+
+// The names of the well-known headers, as strings that every HeaderMap
+// can refer to. They never change once constructed, so they are read
+// without locking.
+class WellKnownHeaderNames {
+ public:
+  WellKnownHeaderNames() {
+    for (int i = 0; i < pagespeed::NUM_WELL_KNOWN_HEADERS; ++i) {
+      names_[i] = kWellKnownHeaderNames[i];
+    }
+  }
+
+  const std::string& Get(int well_known_header) const {
+    return names_[well_known_header];
+  }
+
+ private:
+  std::string names_[pagespeed::NUM_WELL_KNOWN_HEADERS];
+
+  DISALLOW_COPY_AND_ASSIGN(WellKnownHeaderNames);
+};
+
+base::LazyInstance<WellKnownHeaderNames>::Leaky g_well_known_header_names =
+    LAZY_INSTANCE_INITIALIZER;
+
+bool CaseInsensitiveCharLessThan(char a, char b) {
+  return pagespeed::string_util::ToLowerASCII(a) <
+      pagespeed::string_util::ToLowerASCII(b);
+}
+
+bool WellKnownHeaderNameLessThan(const char* well_known_name,
+                                 const base::StringPiece& name) {
+  return std::lexicographical_compare(
+      well_known_name, well_known_name + strlen(well_known_name),
+      name.begin(), name.end(), CaseInsensitiveCharLessThan);
+}
+
+// Get the WellKnownHeader with the given name, compared without regard
+// to case, or -1.
+int FindWellKnownHeader(const base::StringPiece& name) {
+  const char* const* end =
+      kWellKnownHeaderNames + pagespeed::NUM_WELL_KNOWN_HEADERS;
+  const char* const* it = std::lower_bound(
+      kWellKnownHeaderNames, end, name, WellKnownHeaderNameLessThan);
+  if (it != end && StringCaseEqual(*it, name)) {
+    return static_cast<int>(it - kWellKnownHeaderNames);
+  }
+  return -1;
+}
+
+const std::string& GetEmptyString() {
+  static const std::string kEmptyString = "";
+  return kEmptyString;
+}
+
+// Orders headers the way a CaseInsensitiveStringStringMap would.
+bool HeaderNameLessThan(const HeaderMap::Header& header,
+                        const std::string& name) {
+  return pagespeed::string_util::CaseInsensitiveStringComparator()(
+      header.name(), name);
+}
+
+}  // namespace
+
+namespace pagespeed {
+
+HeaderMap::Header::Header() : well_known_header_(-1) {
+}
+
+const std::string& HeaderMap::Header::name() const {
+  if (name_.empty() && well_known_header_ >= 0) {
+    return g_well_known_header_names.Get().Get(well_known_header_);
+  }
+  return name_;
+}
+
+HeaderMap::HeaderMap() {
+  UpdateWellKnownSlots();
+}
+
+HeaderMap::~HeaderMap() {
+}
+
+void HeaderMap::Add(const std::string& name, const std::string& value) {
+  const int well_known_header = FindWellKnownHeader(name);
+  const int index = well_known_header >= 0 ?
+      well_known_slots_[well_known_header] : Find(name);
+  if (index >= 0) {
+    // Merge duplicate headers, rather than keeping them in a multi-map.
+    std::string& existing_value = headers_[index].value_;
+    if (!existing_value.empty()) {
+      existing_value += ",";
+    }
+    existing_value += value;
+    return;
+  }
+  Header header;
+  header.well_known_header_ = well_known_header;
+  if (well_known_header < 0 ||
+      name != kWellKnownHeaderNames[well_known_header]) {
+    header.name_ = name;
+  }
+  header.value_ = value;
+  headers_.insert(std::lower_bound(headers_.begin(), headers_.end(), name,
+                                   HeaderNameLessThan),
+                  header);
+  UpdateWellKnownSlots();
+}
+
+void HeaderMap::Remove(const base::StringPiece& name) {
+  const int index = Find(name);
+  if (index >= 0) {
+    headers_.erase(headers_.begin() + index);
+    UpdateWellKnownSlots();
+  }
+}
+
+const std::string& HeaderMap::Get(const base::StringPiece& name) const {
+  const int index = Find(name);
+  return index >= 0 ? headers_[index].value() : GetEmptyString();
+}
+
+const std::string& HeaderMap::Get(WellKnownHeader header) const {
+  DCHECK(header >= 0 && header < NUM_WELL_KNOWN_HEADERS);
+  const int index = well_known_slots_[header];
+  return index >= 0 ? headers_[index].value() : GetEmptyString();
+}
+
+int HeaderMap::Find(const base::StringPiece& name) const {
+  // Resources have few headers, and names of different lengths are
+  // rejected without comparing their characters, so a linear scan is
+  // faster than a binary search here.
+  for (size_t i = 0, size = headers_.size(); i < size; ++i) {
+    if (StringCaseEqual(headers_[i].name(), name)) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void HeaderMap::UpdateWellKnownSlots() {
+  std::fill(well_known_slots_, well_known_slots_ + NUM_WELL_KNOWN_HEADERS, -1);
+  for (size_t i = 0, size = headers_.size(); i < size; ++i) {
+    const int well_known_header = headers_[i].well_known_header_;
+    if (well_known_header >= 0) {
+      well_known_slots_[well_known_header] = static_cast<int>(i);
+    }
+  }
+}
+
+}  // namespace pagespeed
@@ -0,0 +1,113 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PAGESPEED_CORE_HEADER_MAP_H_
+#define PAGESPEED_CORE_HEADER_MAP_H_
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/string_piece.h"
+
+namespace pagespeed {
+
+// The HTTP headers that rules look up most often. A HeaderMap keeps
+// the location of each of these in a fixed slot, so looking one up by
+// its WellKnownHeader does not compare any header names.
+enum WellKnownHeader {
+  HEADER_ACCEPT_ENCODING,
+  HEADER_CACHE_CONTROL,
+  HEADER_CONNECTION,
+  HEADER_CONTENT_ENCODING,
+  HEADER_CONTENT_TYPE,
+  HEADER_COOKIE,
+  HEADER_DATE,
+  HEADER_ETAG,
+  HEADER_EXPIRES,
+  HEADER_HOST,
+  HEADER_LAST_MODIFIED,
+  HEADER_LOCATION,
+  HEADER_PRAGMA,
+  HEADER_REFERER,
+  HEADER_SET_COOKIE,
+  HEADER_VARY,
+  NUM_WELL_KNOWN_HEADERS,
+};
+
+// The HTTP headers of a request or response, keyed by case-insensitive
+// name. Headers are kept in a single vector, sorted by name. Well-known
+// header names spelled the usual way (e.g. "Content-Type") are shared
+// by every HeaderMap, so that a resource usually only allocates the
+// values of its headers.
+class HeaderMap {
+ public:
+  class Header {
+   public:
+    Header();
+
+    // The name as it was first added.
+    const std::string& name() const;
+    const std::string& value() const { return value_; }
+
+   private:
+    friend class HeaderMap;
+
+    // The WellKnownHeader with this name, or -1.
+    int well_known_header_;
+    // The name, or the empty string if it is the usual spelling of
+    // the well-known header.
+    std::string name_;
+    std::string value_;
+  };
+
+  typedef std::vector<Header>::const_iterator const_iterator;
+
+  HeaderMap();
+  ~HeaderMap();
+
+  // Add a header. If a header with the same name is already present,
+  // the value is appended to its value, separated by a comma. This
+  // transformation is allowed by the HTTP/1.1 RFC:
+  // http://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html#sec4.2
+  void Add(const std::string& name, const std::string& value);
+
+  // Remove the header with the given name, if present.
+  void Remove(const base::StringPiece& name);
+
+  // Get the value of the header with the given name, or the empty
+  // string if it is not present.
+  const std::string& Get(const base::StringPiece& name) const;
+  const std::string& Get(WellKnownHeader header) const;
+
+  bool empty() const { return headers_.empty(); }
+  size_t size() const { return headers_.size(); }
+
+  // Iterates over the headers in case-insensitive order of their names.
+  const_iterator begin() const { return headers_.begin(); }
+  const_iterator end() const { return headers_.end(); }
+
+ private:
+  // Get the index of the header with the given name, or -1.
+  int Find(const base::StringPiece& name) const;
+  void UpdateWellKnownSlots();
+
+  std::vector<Header> headers_;
+  // The index within headers_ of each well-known header, or -1.
+  int well_known_slots_[NUM_WELL_KNOWN_HEADERS];
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_CORE_HEADER_MAP_H_
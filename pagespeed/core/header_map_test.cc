@@ -0,0 +1,114 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "pagespeed/core/header_map.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using pagespeed::HeaderMap;
+
+namespace {
+
+TEST(HeaderMapTest, Empty) {
+  HeaderMap headers;
+  EXPECT_TRUE(headers.empty());
+  EXPECT_EQ(0u, headers.size());
+  EXPECT_TRUE(headers.begin() == headers.end());
+  EXPECT_EQ("", headers.Get("Content-Type"));
+  EXPECT_EQ("", headers.Get(pagespeed::HEADER_CONTENT_TYPE));
+}
+
+TEST(HeaderMapTest, GetIsCaseInsensitive) {
+  HeaderMap headers;
+  headers.Add("content-TYPE", "text/html");
+  headers.Add("X-Custom", "foo");
+  EXPECT_EQ(2u, headers.size());
+  EXPECT_EQ("text/html", headers.Get("Content-Type"));
+  EXPECT_EQ("text/html", headers.Get("content-type"));
+  EXPECT_EQ("text/html", headers.Get(pagespeed::HEADER_CONTENT_TYPE));
+  EXPECT_EQ("foo", headers.Get("x-custom"));
+  EXPECT_EQ("", headers.Get("X-Custo"));
+  EXPECT_EQ("", headers.Get(pagespeed::HEADER_CACHE_CONTROL));
+}
+
+TEST(HeaderMapTest, DuplicatesAreMerged) {
+  HeaderMap headers;
+  headers.Add("Cache-Control", "private");
+  headers.Add("cache-control", "max-age=0");
+  headers.Add("Vary", "");
+  headers.Add("Vary", "Accept-Encoding");
+  ASSERT_EQ(2u, headers.size());
+  EXPECT_EQ("private,max-age=0",
+            headers.Get(pagespeed::HEADER_CACHE_CONTROL));
+  EXPECT_EQ("Accept-Encoding", headers.Get(pagespeed::HEADER_VARY));
+  // The name is kept as it was first added.
+  EXPECT_EQ("Cache-Control", headers.begin()->name());
+}
+
+TEST(HeaderMapTest, IteratesInCaseInsensitiveOrder) {
+  HeaderMap headers;
+  headers.Add("vary", "Accept-Encoding");
+  headers.Add("Date", "Tue, 15 Nov 1994 08:12:31 GMT");
+  headers.Add("ETag", "\"abc\"");
+  headers.Add("cache-control", "public");
+  HeaderMap::const_iterator it = headers.begin();
+  ASSERT_TRUE(it != headers.end());
+  EXPECT_EQ("cache-control", it->name());
+  EXPECT_EQ("public", it->value());
+  ++it;
+  ASSERT_TRUE(it != headers.end());
+  EXPECT_EQ("Date", it->name());
+  ++it;
+  ASSERT_TRUE(it != headers.end());
+  EXPECT_EQ("ETag", it->name());
+  ++it;
+  ASSERT_TRUE(it != headers.end());
+  EXPECT_EQ("vary", it->name());
+  ++it;
+  EXPECT_TRUE(it == headers.end());
+
+  // The well-known slots follow the headers as they move.
+  EXPECT_EQ("public", headers.Get(pagespeed::HEADER_CACHE_CONTROL));
+  EXPECT_EQ("\"abc\"", headers.Get(pagespeed::HEADER_ETAG));
+  EXPECT_EQ("Accept-Encoding", headers.Get(pagespeed::HEADER_VARY));
+}
+
+TEST(HeaderMapTest, NamesAreKeptPerMap) {
+  HeaderMap usual;
+  usual.Add("ETag", "\"abc\"");
+  HeaderMap unusual;
+  unusual.Add("ETAG", "\"def\"");
+  unusual.Add("X-Unknown", "foo");
+  EXPECT_EQ("ETag", usual.begin()->name());
+  EXPECT_EQ("ETAG", unusual.begin()->name());
+  EXPECT_EQ("\"def\"", unusual.Get(pagespeed::HEADER_ETAG));
+  EXPECT_EQ("X-Unknown", (++unusual.begin())->name());
+}
+
+TEST(HeaderMapTest, Remove) {
+  HeaderMap headers;
+  headers.Add("Content-Type", "text/css");
+  headers.Add("Expires", "0");
+  headers.Add("Age", "10");
+  headers.Remove("EXPIRES");
+  headers.Remove("Not-Present");
+  EXPECT_EQ(2u, headers.size());
+  EXPECT_EQ("", headers.Get(pagespeed::HEADER_EXPIRES));
+  EXPECT_EQ("", headers.Get("Expires"));
+  EXPECT_EQ("text/css", headers.Get(pagespeed::HEADER_CONTENT_TYPE));
+  EXPECT_EQ("10", headers.Get("age"));
+}
+
+}  // namespace
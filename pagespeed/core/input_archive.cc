@@ -0,0 +1,633 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pagespeed/core/input_archive.h"
+
+#include <utility>
+
+#include "base/logging.h"
+#include "base/md5.h"
+#include "base/memory/scoped_ptr.h"
+#include "pagespeed/core/pagespeed_input.h"
+#include "pagespeed/core/resource.h"
+#include "pagespeed/core/shared_buffer.h"
+#ifdef USE_SYSTEM_ZLIB
+#include "zlib.h"
+#else
+#include "third_party/zlib/zlib.h"
+#endif
+
+namespace pagespeed {
+
+namespace {
+
+const char kMagic[] = { 'P', 'S', 'I', 'A' };
+
+// Sizes of the fixed-size parts of the archive, in bytes.
+const size_t kStringRefSize = 8;
+const size_t kFileHeaderSize = 40;
+const size_t kPageRecordSize = 28;
+const size_t kResourceRecordSize = 68;
+const size_t kHeaderRecordSize = 16;
+const size_t kBlobRecordSize = 16;
+
+// Offsets of the fields of the file header.
+const size_t kVersionField = 4;
+const size_t kPageTableField = 8;
+const size_t kResourceTableField = 16;
+const size_t kHeaderTableField = 24;
+const size_t kBlobTableField = 32;
+
+// Offsets of the fields of a page record.
+const size_t kPagePrimaryUrlField = 0;
+const size_t kPageOnloadField = 8;
+const size_t kPageFirstResourceField = 12;
+const size_t kPageNumResourcesField = 16;
+const size_t kPageDomField = 20;
+const size_t kPageTimelineField = 24;
+
+// Offsets of the fields of a resource record.
+const size_t kResourceUrlField = 0;
+const size_t kResourceMethodField = 8;
+const size_t kResourceRequestBodyField = 16;
+const size_t kResourceProtocolField = 24;
+const size_t kResourceStatusCodeField = 32;
+const size_t kResourceRequestStartField = 36;
+const size_t kResourceFirstByteField = 40;
+const size_t kResourceFlagsField = 44;
+const size_t kResourceRequestHeadersField = 48;
+const size_t kResourceResponseHeadersField = 56;
+const size_t kResourceBodyField = 64;
+
+// Offsets of the fields of a blob record.
+const size_t kBlobOffsetField = 0;
+const size_t kBlobStoredLengthField = 4;
+const size_t kBlobLengthField = 8;
+const size_t kBlobFlagsField = 12;
+
+// Values of the onload field of a page record, other than an onload
+// time.
+const int32 kOnloadUnknown = -1;
+const int32 kOnloadNotYetFired = -2;
+
+// Bits of the flags field of a resource record.
+const uint32 kResourceBodyModified = 1 << 0;
+
+void AppendUint32(uint32 value, std::string* out) {
+  const char bytes[] = {
+    static_cast<char>(value & 0xff),
+    static_cast<char>((value >> 8) & 0xff),
+    static_cast<char>((value >> 16) & 0xff),
+    static_cast<char>((value >> 24) & 0xff),
+  };
+  out->append(bytes, sizeof(bytes));
+}
+
+void AppendInt32(int32 value, std::string* out) {
+  AppendUint32(static_cast<uint32>(value), out);
+}
+
+void AppendStringRef(uint64 offset, uint64 length, std::string* out) {
+  AppendUint32(offset, out);
+  AppendUint32(length, out);
+}
+
+uint32 ReadUint32(const base::StringPiece& data, size_t offset) {
+  DCHECK_LE(offset + 4, data.size());
+  const unsigned char* bytes =
+      reinterpret_cast<const unsigned char*>(data.data() + offset);
+  return static_cast<uint32>(bytes[0]) |
+      (static_cast<uint32>(bytes[1]) << 8) |
+      (static_cast<uint32>(bytes[2]) << 16) |
+      (static_cast<uint32>(bytes[3]) << 24);
+}
+
+int32 ReadInt32(const base::StringPiece& data, size_t offset) {
+  return static_cast<int32>(ReadUint32(data, offset));
+}
+
+// Whether the range [offset, offset + length) lies within a buffer of
+// the given size, computed without overflow.
+bool IsInBounds(uint64 offset, uint64 length, size_t size) {
+  return offset <= size && length <= size - offset;
+}
+
+// Compress the given data in the zlib format. Returns false if zlib
+// fails or does not make the data smaller.
+bool Compress(const base::StringPiece& data, std::string* out) {
+  uLongf compressed_size = compressBound(data.size());
+  out->resize(compressed_size);
+  if (compress2(reinterpret_cast<Bytef*>(&(*out)[0]), &compressed_size,
+                reinterpret_cast<const Bytef*>(data.data()), data.size(),
+                Z_BEST_COMPRESSION) != Z_OK ||
+      compressed_size >= data.size()) {
+    return false;
+  }
+  out->resize(compressed_size);
+  return true;
+}
+
+// Inflate zlib data that is known to inflate to exactly length bytes.
+bool Uncompress(const base::StringPiece& data, size_t length,
+                std::string* out) {
+  out->resize(length);
+  uLongf uncompressed_size = length;
+  return uncompress(reinterpret_cast<Bytef*>(length > 0 ? &(*out)[0] : NULL),
+                    &uncompressed_size,
+                    reinterpret_cast<const Bytef*>(data.data()),
+                    data.size()) == Z_OK &&
+      uncompressed_size == length;
+}
+
+}  // namespace
+
+const uint32 InputArchiveReader::kVersion = 1;
+const uint32 InputArchiveReader::kNoBlob = 0xffffffff;
+const uint32 InputArchiveReader::kBlobZlib = 1 << 0;
+
+InputArchiveWriter::InputArchiveWriter() : compress_blobs_(false) {}
+
+InputArchiveWriter::~InputArchiveWriter() {}
+
+InputArchiveWriter::DataRef InputArchiveWriter::AddData(
+    const base::StringPiece& data) {
+  DataRef ref;
+  ref.offset = data_.size();
+  ref.length = data.size();
+  data_.append(data.data(), data.size());
+  return ref;
+}
+
+InputArchiveWriter::BlobEntry InputArchiveWriter::StoreBlob(
+    const base::StringPiece& data) {
+  BlobEntry blob;
+  blob.length = data.size();
+  blob.flags = 0;
+  std::string compressed;
+  if (compress_blobs_ && Compress(data, &compressed)) {
+    blob.stored = AddData(compressed);
+    blob.flags = InputArchiveReader::kBlobZlib;
+  } else {
+    blob.stored = AddData(data);
+  }
+  return blob;
+}
+
+uint32 InputArchiveWriter::AddBlob(const base::StringPiece& data) {
+  base::MD5Digest digest;
+  base::MD5Sum(data.data(), data.size(), &digest);
+  const std::string key(reinterpret_cast<const char*>(digest.a),
+                        sizeof(digest.a));
+
+  // Compare the contents of blobs with the same digest, so that a digest
+  // collision cannot make two different blobs share data.
+  for (BlobIndexMap::const_iterator it = blob_indices_.lower_bound(key),
+           end = blob_indices_.upper_bound(key); it != end; ++it) {
+    const BlobEntry& blob = blobs_[it->second];
+    if (blob.length != data.size()) {
+      continue;
+    }
+    const base::StringPiece stored =
+        base::StringPiece(data_).substr(blob.stored.offset,
+                                        blob.stored.length);
+    std::string uncompressed;
+    if (blob.flags == InputArchiveReader::kBlobZlib) {
+      if (!Uncompress(stored, blob.length, &uncompressed)) {
+        LOG(DFATAL) << "Failed to inflate blob " << it->second;
+        continue;
+      }
+      if (uncompressed == data) {
+        return it->second;
+      }
+    } else if (stored == data) {
+      return it->second;
+    }
+  }
+
+  blobs_.push_back(StoreBlob(data));
+  const uint32 blob_index = static_cast<uint32>(blobs_.size() - 1);
+  blob_indices_.insert(std::make_pair(key, blob_index));
+  return blob_index;
+}
+
+void InputArchiveWriter::AddPage(const PagespeedInput& input,
+                                 const base::StringPiece& dom_json,
+                                 const base::StringPiece& timeline_json) {
+  PageEntry page;
+  page.primary_resource_url = AddData(input.primary_resource_url());
+  switch (input.onload_state()) {
+    case PagespeedInput::ONLOAD_FIRED:
+      page.onload_millis = input.onload_millis();
+      break;
+    case PagespeedInput::ONLOAD_NOT_YET_FIRED:
+      page.onload_millis = kOnloadNotYetFired;
+      break;
+    default:
+      page.onload_millis = kOnloadUnknown;
+      break;
+  }
+  page.first_resource = resources_.size();
+  page.num_resources = input.num_resources();
+  page.dom_blob = dom_json.empty() ?
+      InputArchiveReader::kNoBlob : AddBlob(dom_json);
+  page.timeline_blob = timeline_json.empty() ?
+      InputArchiveReader::kNoBlob : AddBlob(timeline_json);
+  pages_.push_back(page);
+
+  for (int i = 0, num = input.num_resources(); i < num; ++i) {
+    const Resource& resource = input.GetResource(i);
+    ResourceEntry entry;
+    entry.request_url = AddData(resource.GetRequestUrl());
+    entry.request_method = AddData(resource.GetRequestMethod());
+    entry.request_body = AddData(resource.GetRequestBody());
+    entry.response_protocol = AddData(
+        resource.GetResponseProtocol() == UNKNOWN_PROTOCOL ?
+        "" : resource.GetResponseProtocolString());
+    entry.status_code = resource.GetResponseStatusCode();
+    entry.request_start_millis =
+        resource.GetRequestStartTimeMillisForSerialization();
+    entry.first_byte_millis = resource.GetFirstByteMillis();
+    entry.flags = resource.IsResponseBodyModified() ?
+        kResourceBodyModified : 0;
+
+    const Resource::HeaderMap* header_maps[] = {
+      resource.GetRequestHeaders(),
+      resource.GetResponseHeaders(),
+    };
+    uint32* first_header_fields[] = {
+      &entry.first_request_header,
+      &entry.first_response_header,
+    };
+    uint32* num_headers_fields[] = {
+      &entry.num_request_headers,
+      &entry.num_response_headers,
+    };
+    for (size_t map = 0; map < arraysize(header_maps); ++map) {
+      *first_header_fields[map] = headers_.size();
+      *num_headers_fields[map] = header_maps[map]->size();
+      for (Resource::HeaderMap::const_iterator
+               it = header_maps[map]->begin(), end = header_maps[map]->end();
+           it != end; ++it) {
+        HeaderEntry header;
+        header.name = AddData(it->name());
+        header.value = AddData(it->value());
+        headers_.push_back(header);
+      }
+    }
+
+    entry.body_blob = AddBlob(resource.GetResponseBodyPiece());
+    resources_.push_back(entry);
+  }
+}
+
+bool InputArchiveWriter::Finish(std::string* out) const {
+  const uint64 page_table_offset = kFileHeaderSize;
+  const uint64 resource_table_offset =
+      page_table_offset + pages_.size() * kPageRecordSize;
+  const uint64 header_table_offset =
+      resource_table_offset + resources_.size() * kResourceRecordSize;
+  const uint64 blob_table_offset =
+      header_table_offset + headers_.size() * kHeaderRecordSize;
+  const uint64 data_offset =
+      blob_table_offset + blobs_.size() * kBlobRecordSize;
+  if (data_offset + data_.size() > kuint32max) {
+    LOG(ERROR) << "Input archive too large: " << data_offset + data_.size();
+    return false;
+  }
+
+  std::string archive;
+  archive.reserve(data_offset + data_.size());
+  archive.append(kMagic, sizeof(kMagic));
+  AppendUint32(InputArchiveReader::kVersion, &archive);
+  AppendUint32(pages_.size(), &archive);
+  AppendUint32(page_table_offset, &archive);
+  AppendUint32(resources_.size(), &archive);
+  AppendUint32(resource_table_offset, &archive);
+  AppendUint32(headers_.size(), &archive);
+  AppendUint32(header_table_offset, &archive);
+  AppendUint32(blobs_.size(), &archive);
+  AppendUint32(blob_table_offset, &archive);
+  DCHECK_EQ(kFileHeaderSize, archive.size());
+
+  for (std::vector<PageEntry>::const_iterator it = pages_.begin(),
+           end = pages_.end(); it != end; ++it) {
+    AppendStringRef(data_offset + it->primary_resource_url.offset,
+                    it->primary_resource_url.length, &archive);
+    AppendInt32(it->onload_millis, &archive);
+    AppendUint32(it->first_resource, &archive);
+    AppendUint32(it->num_resources, &archive);
+    AppendUint32(it->dom_blob, &archive);
+    AppendUint32(it->timeline_blob, &archive);
+  }
+  DCHECK_EQ(resource_table_offset, archive.size());
+
+  for (std::vector<ResourceEntry>::const_iterator it = resources_.begin(),
+           end = resources_.end(); it != end; ++it) {
+    AppendStringRef(data_offset + it->request_url.offset,
+                    it->request_url.length, &archive);
+    AppendStringRef(data_offset + it->request_method.offset,
+                    it->request_method.length, &archive);
+    AppendStringRef(data_offset + it->request_body.offset,
+                    it->request_body.length, &archive);
+    AppendStringRef(data_offset + it->response_protocol.offset,
+                    it->response_protocol.length, &archive);
+    AppendInt32(it->status_code, &archive);
+    AppendInt32(it->request_start_millis, &archive);
+    AppendInt32(it->first_byte_millis, &archive);
+    AppendUint32(it->flags, &archive);
+    AppendUint32(it->first_request_header, &archive);
+    AppendUint32(it->num_request_headers, &archive);
+    AppendUint32(it->first_response_header, &archive);
+    AppendUint32(it->num_response_headers, &archive);
+    AppendUint32(it->body_blob, &archive);
+  }
+  DCHECK_EQ(header_table_offset, archive.size());
+
+  for (std::vector<HeaderEntry>::const_iterator it = headers_.begin(),
+           end = headers_.end(); it != end; ++it) {
+    AppendStringRef(data_offset + it->name.offset,
+                    it->name.length, &archive);
+    AppendStringRef(data_offset + it->value.offset,
+                    it->value.length, &archive);
+  }
+  DCHECK_EQ(blob_table_offset, archive.size());
+
+  for (std::vector<BlobEntry>::const_iterator it = blobs_.begin(),
+           end = blobs_.end(); it != end; ++it) {
+    AppendUint32(data_offset + it->stored.offset, &archive);
+    AppendUint32(it->stored.length, &archive);
+    AppendUint32(it->length, &archive);
+    AppendUint32(it->flags, &archive);
+  }
+  DCHECK_EQ(data_offset, archive.size());
+
+  archive.append(data_);
+  out->swap(archive);
+  return true;
+}
+
+InputArchiveReader::InputArchiveReader()
+    : num_pages_(0),
+      page_table_offset_(0),
+      num_resources_(0),
+      resource_table_offset_(0),
+      num_headers_(0),
+      header_table_offset_(0),
+      num_blobs_(0),
+      blob_table_offset_(0) {}
+
+InputArchiveReader::~InputArchiveReader() {}
+
+bool InputArchiveReader::Open(SharedBuffer* archive) {
+  scoped_refptr<SharedBuffer> buffer(archive);
+  const base::StringPiece& data = buffer->data();
+  if (data.size() < kFileHeaderSize ||
+      data.substr(0, sizeof(kMagic)) !=
+      base::StringPiece(kMagic, sizeof(kMagic))) {
+    LOG(ERROR) << "Not an input archive.";
+    return false;
+  }
+  const uint32 version = ReadUint32(data, kVersionField);
+  if (version != kVersion) {
+    LOG(ERROR) << "Unsupported input archive version " << version;
+    return false;
+  }
+
+  struct Table {
+    size_t field;
+    size_t record_size;
+    uint32* count;
+    uint32* offset;
+  } tables[] = {
+    { kPageTableField, kPageRecordSize, &num_pages_, &page_table_offset_ },
+    { kResourceTableField, kResourceRecordSize,
+      &num_resources_, &resource_table_offset_ },
+    { kHeaderTableField, kHeaderRecordSize,
+      &num_headers_, &header_table_offset_ },
+    { kBlobTableField, kBlobRecordSize, &num_blobs_, &blob_table_offset_ },
+  };
+  for (size_t i = 0; i < arraysize(tables); ++i) {
+    const uint32 count = ReadUint32(data, tables[i].field);
+    const uint32 offset = ReadUint32(data, tables[i].field + 4);
+    if (!IsInBounds(offset,
+                    static_cast<uint64>(count) * tables[i].record_size,
+                    data.size())) {
+      LOG(ERROR) << "Input archive table out of bounds.";
+      num_pages_ = 0;
+      return false;
+    }
+    *tables[i].count = count;
+    *tables[i].offset = offset;
+  }
+
+  archive_ = buffer;
+  base::AutoLock lock(inflated_blobs_lock_);
+  inflated_blobs_.clear();
+  return true;
+}
+
+bool InputArchiveReader::GetString(size_t record_offset,
+                                   base::StringPiece* out) const {
+  const base::StringPiece& data = archive_->data();
+  const uint32 offset = ReadUint32(data, record_offset);
+  const uint32 length = ReadUint32(data, record_offset + 4);
+  if (!IsInBounds(offset, length, data.size())) {
+    LOG(ERROR) << "Input archive string out of bounds.";
+    return false;
+  }
+  *out = archive_->Substr(offset, length);
+  return true;
+}
+
+bool InputArchiveReader::GetBlob(uint32 blob_index,
+                                 scoped_refptr<SharedBuffer>* buffer,
+                                 base::StringPiece* out) const {
+  if (blob_index == kNoBlob) {
+    *buffer = NULL;
+    *out = base::StringPiece();
+    return true;
+  }
+  if (blob_index >= num_blobs_) {
+    LOG(ERROR) << "Input archive blob index out of range: " << blob_index;
+    return false;
+  }
+  const base::StringPiece& data = archive_->data();
+  const size_t record = blob_table_offset_ + blob_index * kBlobRecordSize;
+  const uint32 offset = ReadUint32(data, record + kBlobOffsetField);
+  const uint32 stored_length =
+      ReadUint32(data, record + kBlobStoredLengthField);
+  const uint32 length = ReadUint32(data, record + kBlobLengthField);
+  const uint32 flags = ReadUint32(data, record + kBlobFlagsField);
+  if (!IsInBounds(offset, stored_length, data.size())) {
+    LOG(ERROR) << "Input archive blob out of bounds.";
+    return false;
+  }
+  if (flags == 0 && stored_length == length) {
+    *buffer = archive_;
+    *out = archive_->Substr(offset, length);
+    return true;
+  }
+  if (flags != kBlobZlib) {
+    LOG(ERROR) << "Unsupported input archive blob flags: " << flags;
+    return false;
+  }
+
+  base::AutoLock lock(inflated_blobs_lock_);
+  scoped_refptr<SharedBuffer>& inflated = inflated_blobs_[blob_index];
+  if (inflated == NULL) {
+    std::string uncompressed;
+    if (!Uncompress(archive_->Substr(offset, stored_length), length,
+                    &uncompressed)) {
+      LOG(ERROR) << "Failed to inflate input archive blob " << blob_index;
+      inflated_blobs_.erase(blob_index);
+      return false;
+    }
+    inflated = SharedBuffer::TakeString(&uncompressed);
+  }
+  *buffer = inflated;
+  *out = inflated->data();
+  return true;
+}
+
+bool InputArchiveReader::GetPageBlob(int page_index, size_t field_offset,
+                                     base::StringPiece* out) const {
+  if (page_index < 0 || static_cast<uint32>(page_index) >= num_pages_) {
+    LOG(DFATAL) << "Page index out of range: " << page_index;
+    return false;
+  }
+  const size_t record = page_table_offset_ + page_index * kPageRecordSize;
+  scoped_refptr<SharedBuffer> buffer;
+  return GetBlob(ReadUint32(archive_->data(), record + field_offset),
+                 &buffer, out);
+}
+
+bool InputArchiveReader::GetDomJson(int page_index,
+                                    base::StringPiece* out) const {
+  return GetPageBlob(page_index, kPageDomField, out);
+}
+
+bool InputArchiveReader::GetTimelineJson(int page_index,
+                                         base::StringPiece* out) const {
+  return GetPageBlob(page_index, kPageTimelineField, out);
+}
+
+bool InputArchiveReader::PopulatePagespeedInput(int page_index,
+                                                PagespeedInput* input) const {
+  if (page_index < 0 || static_cast<uint32>(page_index) >= num_pages_) {
+    LOG(DFATAL) << "Page index out of range: " << page_index;
+    return false;
+  }
+  const base::StringPiece& data = archive_->data();
+  const size_t page = page_table_offset_ + page_index * kPageRecordSize;
+  const uint32 first_resource =
+      ReadUint32(data, page + kPageFirstResourceField);
+  const uint32 num_resources = ReadUint32(data, page + kPageNumResourcesField);
+  if (!IsInBounds(first_resource, num_resources, num_resources_)) {
+    LOG(ERROR) << "Input archive resource range out of bounds.";
+    return false;
+  }
+
+  for (uint32 i = first_resource; i < first_resource + num_resources; ++i) {
+    const size_t record = resource_table_offset_ + i * kResourceRecordSize;
+    scoped_ptr<Resource> resource(new Resource);
+
+    base::StringPiece value;
+    if (!GetString(record + kResourceUrlField, &value)) {
+      return false;
+    }
+    resource->SetRequestUrl(value.as_string());
+    if (!GetString(record + kResourceMethodField, &value)) {
+      return false;
+    }
+    resource->SetRequestMethod(value.as_string());
+    if (!GetString(record + kResourceRequestBodyField, &value)) {
+      return false;
+    }
+    resource->SetRequestBody(value.as_string());
+    if (!GetString(record + kResourceProtocolField, &value)) {
+      return false;
+    }
+    if (!value.empty()) {
+      resource->SetResponseProtocol(value.as_string());
+    }
+    resource->SetResponseStatusCode(
+        ReadInt32(data, record + kResourceStatusCodeField));
+    const int32 request_start_millis =
+        ReadInt32(data, record + kResourceRequestStartField);
+    if (request_start_millis >= 0) {
+      resource->SetRequestStartTimeMillis(request_start_millis);
+    }
+    resource->SetFirstByteMillis(
+        ReadInt32(data, record + kResourceFirstByteField));
+    const uint32 flags = ReadUint32(data, record + kResourceFlagsField);
+    resource->SetResponseBodyModified((flags & kResourceBodyModified) != 0);
+
+    for (int headers = 0; headers < 2; ++headers) {
+      const size_t field = headers == 0 ?
+          kResourceRequestHeadersField : kResourceResponseHeadersField;
+      const uint32 first_header = ReadUint32(data, record + field);
+      const uint32 num_headers = ReadUint32(data, record + field + 4);
+      if (!IsInBounds(first_header, num_headers, num_headers_)) {
+        LOG(ERROR) << "Input archive header range out of bounds.";
+        return false;
+      }
+      for (uint32 h = first_header; h < first_header + num_headers; ++h) {
+        const size_t header = header_table_offset_ + h * kHeaderRecordSize;
+        base::StringPiece name;
+        if (!GetString(header, &name) ||
+            !GetString(header + kStringRefSize, &value)) {
+          return false;
+        }
+        if (headers == 0) {
+          resource->AddRequestHeader(name.as_string(), value.as_string());
+        } else {
+          resource->AddResponseHeader(name.as_string(), value.as_string());
+        }
+      }
+    }
+
+    const uint32 body_blob = ReadUint32(data, record + kResourceBodyField);
+    if (body_blob != kNoBlob) {
+      scoped_refptr<SharedBuffer> buffer;
+      if (!GetBlob(body_blob, &buffer, &value)) {
+        return false;
+      }
+      resource->SetResponseBody(buffer.get(),
+                                value.data() - buffer->data().data(),
+                                value.size());
+    }
+    input->AddResource(resource.release());
+  }
+
+  base::StringPiece primary_resource_url;
+  if (!GetString(page + kPagePrimaryUrlField, &primary_resource_url)) {
+    return false;
+  }
+  if (!primary_resource_url.empty()) {
+    input->SetPrimaryResourceUrl(primary_resource_url.as_string());
+  }
+
+  const int32 onload_millis = ReadInt32(data, page + kPageOnloadField);
+  if (onload_millis >= 0) {
+    input->SetOnloadTimeMillis(onload_millis);
+  } else if (onload_millis == kOnloadNotYetFired) {
+    input->SetOnloadState(PagespeedInput::ONLOAD_NOT_YET_FIRED);
+  } else if (onload_millis != kOnloadUnknown) {
+    LOG(ERROR) << "Invalid input archive onload time: " << onload_millis;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace pagespeed
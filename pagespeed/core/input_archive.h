@@ -0,0 +1,222 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PAGESPEED_CORE_INPUT_ARCHIVE_H_
+#define PAGESPEED_CORE_INPUT_ARCHIVE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/string_piece.h"
+#include "base/synchronization/lock.h"
+
+namespace pagespeed {
+
+class PagespeedInput;
+class SharedBuffer;
+
+// An input archive is a compact binary container for one or more
+// pages: the resources of each page, with their headers and response
+// bodies, and optionally the page's DOM and timeline as JSON. It is
+// meant to be memory-mapped (see SharedBuffer::MapFile). Everything in
+// it is located through offsets stored in fixed-size tables, so opening
+// an archive parses nothing, and response bodies are referenced
+// directly from the mapped bytes rather than copied.
+//
+// All integers are little-endian uint32s unless noted, and all offsets
+// are from the start of the archive. A string is stored as an
+// (offset, length) pair. The layout is:
+//
+//   FileHeader:     magic "PSIA", version, and the (count, offset) of
+//                   each of the four tables below.
+//   PageRecord:     primary resource URL (string), onload millis
+//                   (int32: -1 if unknown, -2 if onload had not fired),
+//                   first resource index, number of resources, DOM
+//                   blob index, timeline blob index.
+//   ResourceRecord: request URL, request method, request body and
+//                   response protocol (strings), status code,
+//                   request start millis and first byte millis
+//                   (int32s, -1 if unknown), flags, first request
+//                   header index, number of request headers, first
+//                   response header index, number of response headers,
+//                   response body blob index.
+//   HeaderRecord:   name, value (strings).
+//   BlobRecord:     offset, stored length, length, flags.
+//
+// Followed by the string and blob data. A blob index of kNoBlob means
+// there is no blob. Blobs are content-addressed: identical response
+// bodies, DOMs and timelines, within a page or across pages, share a
+// single blob. A blob whose flags are kBlobZlib holds its data
+// compressed in the zlib format, and its stored length is that of the
+// compressed data; otherwise its flags are zero and its stored length
+// equals its length.
+
+// Builds an input archive from PagespeedInputs.
+class InputArchiveWriter {
+ public:
+  InputArchiveWriter();
+  ~InputArchiveWriter();
+
+  // Add a page made of the resources of the given input, and the given
+  // DOM and timeline JSON, either of which may be empty if unavailable.
+  void AddPage(const PagespeedInput& input,
+               const base::StringPiece& dom_json,
+               const base::StringPiece& timeline_json);
+
+  // Whether to compress blobs that zlib makes smaller. Compressed blobs
+  // take less space, but must be inflated into memory when read, rather
+  // than being referenced in place. Defaults to false.
+  void set_compress_blobs(bool compress_blobs) {
+    compress_blobs_ = compress_blobs;
+  }
+
+  int num_pages() const { return static_cast<int>(pages_.size()); }
+  int num_blobs() const { return static_cast<int>(blobs_.size()); }
+
+  // Write the archive to the given string. Returns false if the archive
+  // would be too large to address with 32-bit offsets.
+  bool Finish(std::string* out) const;
+
+ private:
+  // A string or blob, located by its offset within data_.
+  struct DataRef {
+    DataRef() : offset(0), length(0) {}
+    uint64 offset;
+    uint64 length;
+  };
+
+  struct PageEntry {
+    DataRef primary_resource_url;
+    int32 onload_millis;
+    uint32 first_resource;
+    uint32 num_resources;
+    uint32 dom_blob;
+    uint32 timeline_blob;
+  };
+
+  struct ResourceEntry {
+    DataRef request_url;
+    DataRef request_method;
+    DataRef request_body;
+    DataRef response_protocol;
+    int32 status_code;
+    int32 request_start_millis;
+    int32 first_byte_millis;
+    uint32 flags;
+    uint32 first_request_header;
+    uint32 num_request_headers;
+    uint32 first_response_header;
+    uint32 num_response_headers;
+    uint32 body_blob;
+  };
+
+  struct HeaderEntry {
+    DataRef name;
+    DataRef value;
+  };
+
+  struct BlobEntry {
+    DataRef stored;
+    uint64 length;
+    uint32 flags;
+  };
+
+  // Blob indices by the MD5 digest of their uncompressed data.
+  typedef std::multimap<std::string, uint32> BlobIndexMap;
+
+  DataRef AddData(const base::StringPiece& data);
+  uint32 AddBlob(const base::StringPiece& data);
+
+  // Store the given data as a blob, compressing it if requested and
+  // worthwhile.
+  BlobEntry StoreBlob(const base::StringPiece& data);
+
+  bool compress_blobs_;
+  std::vector<PageEntry> pages_;
+  std::vector<ResourceEntry> resources_;
+  std::vector<HeaderEntry> headers_;
+  std::vector<BlobEntry> blobs_;
+  BlobIndexMap blob_indices_;
+  std::string data_;
+
+  DISALLOW_COPY_AND_ASSIGN(InputArchiveWriter);
+};
+
+// Reads the pages of an input archive written by InputArchiveWriter.
+class InputArchiveReader {
+ public:
+  InputArchiveReader();
+  ~InputArchiveReader();
+
+  // Open the archive held in the given buffer, keeping a reference to
+  // it. Returns false if the buffer does not hold a supported archive,
+  // or if its tables do not fit within the buffer. The contents of the
+  // tables are validated as each page is read.
+  bool Open(SharedBuffer* archive);
+
+  int num_pages() const { return static_cast<int>(num_pages_); }
+
+  // Add the resources of the given page to the input, and set its
+  // primary resource URL and onload time. The response bodies reference
+  // the archive's buffer, or the buffer into which a compressed body was
+  // inflated, which they keep alive. Returns false if the
+  // page's data is malformed, in which case the input may have been
+  // partially populated.
+  bool PopulatePagespeedInput(int page_index, PagespeedInput* input) const;
+
+  // Get the DOM or timeline JSON of the given page, or an empty piece if
+  // the page has none. The returned piece is valid as long as this
+  // reader is. Returns false if the page's data is malformed.
+  bool GetDomJson(int page_index, base::StringPiece* out) const;
+  bool GetTimelineJson(int page_index, base::StringPiece* out) const;
+
+  static const uint32 kVersion;
+  static const uint32 kNoBlob;
+  static const uint32 kBlobZlib;
+
+ private:
+  typedef std::map<uint32, scoped_refptr<SharedBuffer> > InflatedBlobMap;
+
+  bool GetPageBlob(int page_index, size_t field_offset,
+                   base::StringPiece* out) const;
+  bool GetString(size_t record_offset, base::StringPiece* out) const;
+
+  // Get the data of the given blob, and the buffer that holds it: either
+  // the archive's buffer or, for a compressed blob, the buffer it was
+  // inflated into. Each compressed blob is inflated at most once.
+  bool GetBlob(uint32 blob_index,
+               scoped_refptr<SharedBuffer>* buffer,
+               base::StringPiece* out) const;
+
+  scoped_refptr<SharedBuffer> archive_;
+  mutable base::Lock inflated_blobs_lock_;
+  mutable InflatedBlobMap inflated_blobs_;
+  uint32 num_pages_;
+  uint32 page_table_offset_;
+  uint32 num_resources_;
+  uint32 resource_table_offset_;
+  uint32 num_headers_;
+  uint32 header_table_offset_;
+  uint32 num_blobs_;
+  uint32 blob_table_offset_;
+
+  DISALLOW_COPY_AND_ASSIGN(InputArchiveReader);
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_CORE_INPUT_ARCHIVE_H_
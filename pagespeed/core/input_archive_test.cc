@@ -0,0 +1,400 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pagespeed/core/input_archive.h"
+
+#include <stdio.h>
+
+#include <string>
+
+#include "base/memory/ref_counted.h"
+#include "pagespeed/core/pagespeed_input.h"
+#include "pagespeed/core/resource.h"
+#include "pagespeed/core/shared_buffer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using pagespeed::InputArchiveReader;
+using pagespeed::InputArchiveWriter;
+using pagespeed::PagespeedInput;
+using pagespeed::Resource;
+using pagespeed::SharedBuffer;
+
+namespace {
+
+const char* kHtmlUrl = "http://www.example.com/";
+const char* kCssUrl = "http://www.example.com/style.css";
+const char* kHtmlBody = "<html><body>Hello, world</body></html>";
+const char* kCssBody = "body { color: red }";
+const char* kDomJson = "{\"documentUrl\":\"http://www.example.com/\"}";
+const char* kTimelineJson = "[{\"type\":\"Layout\"}]";
+
+Resource* NewResource(const std::string& url,
+                      const std::string& content_type,
+                      const std::string& body) {
+  Resource* resource = new Resource;
+  resource->SetRequestUrl(url);
+  resource->SetRequestMethod("GET");
+  resource->AddRequestHeader("Accept", "*/*");
+  resource->SetResponseStatusCode(200);
+  resource->SetResponseProtocol("HTTP/1.1");
+  resource->AddResponseHeader("Content-Type", content_type);
+  resource->AddResponseHeader("Cache-Control", "max-age=300");
+  resource->SetResponseBody(body);
+  return resource;
+}
+
+// Writes an archive of two pages: the first with an HTML and a CSS
+// resource, its DOM and timeline, and the second with a single POST
+// request and no DOM or timeline.
+std::string WriteTestArchive() {
+  InputArchiveWriter writer;
+
+  PagespeedInput first;
+  Resource* html = NewResource(kHtmlUrl, "text/html", kHtmlBody);
+  html->SetRequestStartTimeMillis(0);
+  html->SetFirstByteMillis(15);
+  first.AddResource(html);
+  Resource* css = NewResource(kCssUrl, "text/css", kCssBody);
+  css->SetRequestStartTimeMillis(20);
+  css->SetResponseBodyModified(true);
+  first.AddResource(css);
+  first.SetPrimaryResourceUrl(kHtmlUrl);
+  first.SetOnloadTimeMillis(100);
+  writer.AddPage(first, kDomJson, kTimelineJson);
+
+  PagespeedInput second;
+  Resource* post = new Resource;
+  post->SetRequestUrl("http://www.example.com/submit");
+  post->SetRequestMethod("POST");
+  post->SetRequestBody("name=value");
+  post->SetResponseStatusCode(204);
+  second.AddResource(post);
+  second.SetOnloadState(PagespeedInput::ONLOAD_NOT_YET_FIRED);
+  writer.AddPage(second, "", "");
+  EXPECT_EQ(2, writer.num_pages());
+
+  std::string archive;
+  EXPECT_TRUE(writer.Finish(&archive));
+  return archive;
+}
+
+// Returns whether the given piece lies within the given buffer.
+bool IsWithin(const base::StringPiece& piece, const SharedBuffer& buffer) {
+  return piece.data() >= buffer.data().data() &&
+      piece.data() + piece.size() <= buffer.data().data() + buffer.size();
+}
+
+uint32 GetUint32(const std::string& archive, size_t offset) {
+  uint32 value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32>(
+        static_cast<unsigned char>(archive[offset + i])) << (8 * i);
+  }
+  return value;
+}
+
+// Returns the offset of the record of the given blob.
+size_t GetBlobRecordOffset(const std::string& archive, int blob_index) {
+  return GetUint32(archive, 36) + blob_index * 16;
+}
+
+void SetUint32(size_t offset, uint32 value, std::string* archive) {
+  for (int i = 0; i < 4; ++i) {
+    (*archive)[offset + i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+}
+
+bool Open(std::string* archive, InputArchiveReader* reader) {
+  scoped_refptr<SharedBuffer> buffer(SharedBuffer::TakeString(archive));
+  return reader->Open(buffer.get());
+}
+
+TEST(InputArchiveTest, RoundTrip) {
+  std::string archive = WriteTestArchive();
+  scoped_refptr<SharedBuffer> buffer(SharedBuffer::TakeString(&archive));
+  InputArchiveReader reader;
+  ASSERT_TRUE(reader.Open(buffer.get()));
+  ASSERT_EQ(2, reader.num_pages());
+
+  PagespeedInput first;
+  ASSERT_TRUE(reader.PopulatePagespeedInput(0, &first));
+  ASSERT_TRUE(first.Freeze());
+  ASSERT_EQ(2, first.num_resources());
+  EXPECT_EQ(kHtmlUrl, first.primary_resource_url());
+  EXPECT_EQ(PagespeedInput::ONLOAD_FIRED, first.onload_state());
+  EXPECT_EQ(100, first.onload_millis());
+
+  const Resource* html = first.GetResourceWithUrlOrNull(kHtmlUrl);
+  ASSERT_TRUE(html != NULL);
+  EXPECT_EQ("GET", html->GetRequestMethod());
+  EXPECT_EQ("*/*", html->GetRequestHeader("Accept"));
+  EXPECT_EQ(200, html->GetResponseStatusCode());
+  EXPECT_EQ(pagespeed::HTTP_11, html->GetResponseProtocol());
+  EXPECT_EQ("text/html", html->GetResponseHeader("Content-Type"));
+  EXPECT_EQ("max-age=300", html->GetResponseHeader("Cache-Control"));
+  EXPECT_EQ(kHtmlBody, html->GetResponseBody());
+  EXPECT_EQ(15, html->GetFirstByteMillis());
+  EXPECT_FALSE(html->IsResponseBodyModified());
+  // Response bodies reference the archive rather than copies of it.
+  EXPECT_TRUE(IsWithin(html->GetResponseBodyPiece(), *buffer));
+
+  const Resource* css = first.GetResourceWithUrlOrNull(kCssUrl);
+  ASSERT_TRUE(css != NULL);
+  EXPECT_EQ(kCssBody, css->GetResponseBody());
+  EXPECT_TRUE(css->IsResponseBodyModified());
+  EXPECT_FALSE(css->IsRequestStartTimeLessThan(*html));
+  EXPECT_TRUE(html->IsRequestStartTimeLessThan(*css));
+  EXPECT_TRUE(IsWithin(css->GetResponseBodyPiece(), *buffer));
+
+  base::StringPiece json;
+  ASSERT_TRUE(reader.GetDomJson(0, &json));
+  EXPECT_EQ(kDomJson, json.as_string());
+  ASSERT_TRUE(reader.GetTimelineJson(0, &json));
+  EXPECT_EQ(kTimelineJson, json.as_string());
+
+  PagespeedInput second;
+  ASSERT_TRUE(reader.PopulatePagespeedInput(1, &second));
+  ASSERT_TRUE(second.Freeze());
+  ASSERT_EQ(1, second.num_resources());
+  EXPECT_EQ(PagespeedInput::ONLOAD_NOT_YET_FIRED, second.onload_state());
+  const Resource& post = second.GetResource(0);
+  EXPECT_EQ("http://www.example.com/submit", post.GetRequestUrl());
+  EXPECT_EQ("POST", post.GetRequestMethod());
+  EXPECT_EQ("name=value", post.GetRequestBody());
+  EXPECT_EQ(204, post.GetResponseStatusCode());
+  EXPECT_EQ(pagespeed::UNKNOWN_PROTOCOL, post.GetResponseProtocol());
+  EXPECT_EQ(-1, post.GetFirstByteMillis());
+  EXPECT_EQ("", post.GetResponseBody());
+
+  ASSERT_TRUE(reader.GetDomJson(1, &json));
+  EXPECT_TRUE(json.empty());
+  ASSERT_TRUE(reader.GetTimelineJson(1, &json));
+  EXPECT_TRUE(json.empty());
+}
+
+TEST(InputArchiveTest, ResourcesOutliveReader) {
+  std::string archive = WriteTestArchive();
+  PagespeedInput input;
+  {
+    InputArchiveReader reader;
+    ASSERT_TRUE(Open(&archive, &reader));
+    ASSERT_TRUE(reader.PopulatePagespeedInput(0, &input));
+  }
+  ASSERT_TRUE(input.Freeze());
+  EXPECT_EQ(kHtmlBody, input.GetResource(0).GetResponseBody());
+}
+
+TEST(InputArchiveTest, MapFile) {
+  const std::string archive = WriteTestArchive();
+  const std::string path = "input_archive_test.tmp";
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(file != NULL);
+  fwrite(archive.data(), 1, archive.size(), file);
+  fclose(file);
+
+  scoped_refptr<SharedBuffer> buffer(SharedBuffer::MapFile(path));
+  remove(path.c_str());
+  ASSERT_TRUE(buffer != NULL);
+  InputArchiveReader reader;
+  ASSERT_TRUE(reader.Open(buffer.get()));
+  PagespeedInput input;
+  ASSERT_TRUE(reader.PopulatePagespeedInput(0, &input));
+  ASSERT_TRUE(input.Freeze());
+  ASSERT_EQ(2, input.num_resources());
+  EXPECT_EQ(kHtmlBody, input.GetResource(0).GetResponseBody());
+  EXPECT_TRUE(IsWithin(input.GetResource(0).GetResponseBodyPiece(), *buffer));
+}
+
+TEST(InputArchiveTest, EmptyArchive) {
+  InputArchiveWriter writer;
+  std::string archive;
+  ASSERT_TRUE(writer.Finish(&archive));
+  InputArchiveReader reader;
+  ASSERT_TRUE(Open(&archive, &reader));
+  EXPECT_EQ(0, reader.num_pages());
+}
+
+TEST(InputArchiveTest, BadMagic) {
+  std::string archive = WriteTestArchive();
+  archive[0] = 'X';
+  InputArchiveReader reader;
+  EXPECT_FALSE(Open(&archive, &reader));
+  EXPECT_EQ(0, reader.num_pages());
+}
+
+TEST(InputArchiveTest, BadVersion) {
+  std::string archive = WriteTestArchive();
+  SetUint32(4, InputArchiveReader::kVersion + 1, &archive);
+  InputArchiveReader reader;
+  EXPECT_FALSE(Open(&archive, &reader));
+}
+
+TEST(InputArchiveTest, Truncated) {
+  const std::string archive = WriteTestArchive();
+  std::string header = archive.substr(0, 20);
+  InputArchiveReader reader;
+  EXPECT_FALSE(Open(&header, &reader));
+
+  // The tables no longer fit once the data that follows them is gone.
+  std::string tables = archive.substr(0, 60);
+  EXPECT_FALSE(Open(&tables, &reader));
+  EXPECT_EQ(0, reader.num_pages());
+}
+
+TEST(InputArchiveTest, StringOutOfBounds) {
+  std::string archive = WriteTestArchive();
+  // Point the first page's primary resource URL past the archive's end.
+  SetUint32(40, archive.size() - 2, &archive);
+  InputArchiveReader reader;
+  ASSERT_TRUE(Open(&archive, &reader));
+  PagespeedInput input;
+  EXPECT_FALSE(reader.PopulatePagespeedInput(0, &input));
+}
+
+TEST(InputArchiveTest, ResourceRangeOutOfBounds) {
+  std::string archive = WriteTestArchive();
+  // Give the second page more resources than the archive holds.
+  SetUint32(40 + 28 + 16, 3, &archive);
+  InputArchiveReader reader;
+  ASSERT_TRUE(Open(&archive, &reader));
+  PagespeedInput input;
+  EXPECT_FALSE(reader.PopulatePagespeedInput(1, &input));
+}
+
+TEST(InputArchiveTest, BlobIndexOutOfRange) {
+  std::string archive = WriteTestArchive();
+  // Point the first page's DOM at a blob that does not exist.
+  SetUint32(40 + 20, 1000, &archive);
+  InputArchiveReader reader;
+  ASSERT_TRUE(Open(&archive, &reader));
+  base::StringPiece json;
+  EXPECT_FALSE(reader.GetDomJson(0, &json));
+  EXPECT_TRUE(reader.GetTimelineJson(0, &json));
+}
+
+// Builds a page whose resources all have the given response body.
+void AddPageWithBody(const std::string& url_prefix,
+                     const std::string& body,
+                     InputArchiveWriter* writer) {
+  PagespeedInput input;
+  input.AddResource(NewResource(url_prefix + "a.js", "text/javascript", body));
+  input.AddResource(NewResource(url_prefix + "b.js", "text/javascript", body));
+  writer->AddPage(input, "", "");
+}
+
+std::string RepeatedBody() {
+  std::string body;
+  for (int i = 0; i < 100; ++i) {
+    body += "function f() { return 'a fairly compressible body'; }\n";
+  }
+  return body;
+}
+
+TEST(InputArchiveTest, IdenticalBodiesStoredOnce) {
+  const std::string body = RepeatedBody();
+  InputArchiveWriter writer;
+  AddPageWithBody("http://a.example.com/", body, &writer);
+  AddPageWithBody("http://b.example.com/", body, &writer);
+  AddPageWithBody("http://c.example.com/", "other", &writer);
+  EXPECT_EQ(2, writer.num_blobs());
+
+  std::string archive;
+  ASSERT_TRUE(writer.Finish(&archive));
+  EXPECT_GT(2 * body.size(), archive.size());
+
+  InputArchiveReader reader;
+  ASSERT_TRUE(Open(&archive, &reader));
+  PagespeedInput first;
+  PagespeedInput second;
+  ASSERT_TRUE(reader.PopulatePagespeedInput(0, &first));
+  ASSERT_TRUE(reader.PopulatePagespeedInput(1, &second));
+  ASSERT_TRUE(first.Freeze());
+  ASSERT_TRUE(second.Freeze());
+  EXPECT_EQ(body, first.GetResource(0).GetResponseBody());
+  EXPECT_EQ(body, second.GetResource(1).GetResponseBody());
+  EXPECT_EQ(first.GetResource(0).GetResponseBodyPiece().data(),
+            second.GetResource(1).GetResponseBodyPiece().data());
+}
+
+TEST(InputArchiveTest, CompressedBlobs) {
+  const std::string body = RepeatedBody();
+  InputArchiveWriter uncompressed_writer;
+  AddPageWithBody("http://a.example.com/", body, &uncompressed_writer);
+  std::string uncompressed_archive;
+  ASSERT_TRUE(uncompressed_writer.Finish(&uncompressed_archive));
+
+  InputArchiveWriter writer;
+  writer.set_compress_blobs(true);
+  AddPageWithBody("http://a.example.com/", body, &writer);
+  AddPageWithBody("http://b.example.com/", body, &writer);
+  // Too short for zlib to make it smaller, so stored uncompressed.
+  AddPageWithBody("http://c.example.com/", "x", &writer);
+  EXPECT_EQ(2, writer.num_blobs());
+  std::string archive;
+  ASSERT_TRUE(writer.Finish(&archive));
+  EXPECT_GT(uncompressed_archive.size() / 2, archive.size());
+
+  scoped_refptr<SharedBuffer> buffer(SharedBuffer::TakeString(&archive));
+  InputArchiveReader reader;
+  ASSERT_TRUE(reader.Open(buffer.get()));
+  PagespeedInput first;
+  PagespeedInput second;
+  PagespeedInput third;
+  ASSERT_TRUE(reader.PopulatePagespeedInput(0, &first));
+  ASSERT_TRUE(reader.PopulatePagespeedInput(1, &second));
+  ASSERT_TRUE(reader.PopulatePagespeedInput(2, &third));
+  ASSERT_TRUE(first.Freeze());
+  ASSERT_TRUE(second.Freeze());
+  ASSERT_TRUE(third.Freeze());
+  EXPECT_EQ(body, first.GetResource(0).GetResponseBody());
+  EXPECT_EQ(body, second.GetResource(0).GetResponseBody());
+  EXPECT_FALSE(IsWithin(first.GetResource(0).GetResponseBodyPiece(),
+                        *buffer));
+  // Each compressed blob is inflated once, and shared by its resources.
+  EXPECT_EQ(first.GetResource(0).GetResponseBodyPiece().data(),
+            second.GetResource(1).GetResponseBodyPiece().data());
+  EXPECT_EQ("x", third.GetResource(0).GetResponseBody());
+  EXPECT_TRUE(IsWithin(third.GetResource(0).GetResponseBodyPiece(),
+                       *buffer));
+}
+
+TEST(InputArchiveTest, CorruptCompressedBlob) {
+  InputArchiveWriter writer;
+  writer.set_compress_blobs(true);
+  AddPageWithBody("http://a.example.com/", RepeatedBody(), &writer);
+  std::string archive;
+  ASSERT_TRUE(writer.Finish(&archive));
+  // Damage the end of the compressed body, which holds its checksum.
+  const size_t record = GetBlobRecordOffset(archive, 0);
+  ASSERT_EQ(InputArchiveReader::kBlobZlib, GetUint32(archive, record + 12));
+  const size_t end =
+      GetUint32(archive, record) + GetUint32(archive, record + 4);
+  archive[end - 1] ^= 0xff;
+  InputArchiveReader reader;
+  ASSERT_TRUE(Open(&archive, &reader));
+  PagespeedInput input;
+  EXPECT_FALSE(reader.PopulatePagespeedInput(0, &input));
+}
+
+TEST(InputArchiveTest, UnknownBlobFlags) {
+  std::string archive = WriteTestArchive();
+  // Set an unknown flag on the first blob: the first page's DOM.
+  SetUint32(GetBlobRecordOffset(archive, 0) + 12, 1 << 4, &archive);
+  InputArchiveReader reader;
+  ASSERT_TRUE(Open(&archive, &reader));
+  base::StringPiece json;
+  EXPECT_FALSE(reader.GetDomJson(0, &json));
+}
+
+}  // namespace
@@ -0,0 +1,584 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pagespeed/core/json_stream_parser.h"
+
+#include <string.h>  // for memcmp
+
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/string_number_conversions.h"
+#include "base/stringprintf.h"
+#include "base/values.h"
+
+namespace {
+
+// Same as the limit used by base::JSONReader.
+const int kMaxDepth = 100;
+
+const char kUtf8Bom[] = "\xEF\xBB\xBF";
+
+const char kSyntaxError[] = "Syntax error.";
+const char kUnexpectedEnd[] = "Unexpected end of input.";
+
+bool IsDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Whether the given code point may appear in a string. This rejects the
+// same code points as base::JSONReader: surrogates, noncharacters, and
+// values beyond the Unicode range.
+bool IsValidCharacter(uint32 code_point) {
+  return code_point < 0xD800u ||
+      (code_point >= 0xE000u && code_point < 0xFDD0u) ||
+      (code_point > 0xFDEFu && code_point <= 0x10FFFFu &&
+       (code_point & 0xFFFEu) != 0xFFFEu);
+}
+
+// Returns the number of bytes in the UTF-8 encoded character at the
+// start of [begin, end), which must not be empty, or 0 if it is not a
+// valid character.
+int GetUtf8CharLength(const char* begin, const char* end) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(begin);
+  const unsigned char lead = bytes[0];
+  if (lead < 0x80) {
+    return 1;
+  }
+  int length;
+  uint32 code_point;
+  uint32 min_code_point;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+    code_point = lead & 0x1F;
+    min_code_point = 0x80;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+    code_point = lead & 0x0F;
+    min_code_point = 0x800;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+    code_point = lead & 0x07;
+    min_code_point = 0x10000;
+  } else {
+    return 0;
+  }
+  if (end - begin < length) {
+    return 0;
+  }
+  for (int i = 1; i < length; ++i) {
+    if ((bytes[i] & 0xC0) != 0x80) {
+      return 0;
+    }
+    code_point = (code_point << 6) | (bytes[i] & 0x3F);
+  }
+  if (code_point < min_code_point || !IsValidCharacter(code_point)) {
+    return 0;
+  }
+  return length;
+}
+
+void AppendUtf8(uint32 code_point, std::string* out) {
+  if (code_point < 0x80) {
+    out->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+}  // namespace
+
+namespace pagespeed {
+
+JsonStreamParser::Delegate::Delegate() {}
+
+JsonStreamParser::Delegate::~Delegate() {}
+
+JsonStreamParser::JsonStreamParser(Delegate* delegate)
+    : delegate_(delegate), start_(NULL), pos_(NULL), end_(NULL), depth_(0) {
+}
+
+JsonStreamParser::~JsonStreamParser() {}
+
+base::Value* JsonStreamParser::Parse(const base::StringPiece& json,
+                                     std::string* error_msg_out) {
+  start_ = json.data();
+  pos_ = start_;
+  end_ = start_ + json.size();
+  depth_ = 0;
+  path_.clear();
+  error_.clear();
+
+  const size_t bom_size = sizeof(kUtf8Bom) - 1;
+  if (json.size() >= bom_size && memcmp(pos_, kUtf8Bom, bom_size) == 0) {
+    pos_ += bom_size;
+  }
+
+  scoped_ptr<base::Value> root(ParseValue(true));
+  if (root != NULL && (!SkipWhitespace() || pos_ != end_)) {
+    root.reset();
+    SetError("Unexpected data after root element.");
+  }
+  if (root == NULL && error_msg_out != NULL) {
+    *error_msg_out = error_;
+  }
+  return root.release();
+}
+
+base::Value* JsonStreamParser::ParseValue(bool streamable) {
+  if (!SkipWhitespace()) {
+    return SetError(kSyntaxError);
+  }
+  if (pos_ == end_) {
+    return SetError(kUnexpectedEnd);
+  }
+  switch (*pos_) {
+    case '{':
+      return ParseObject(streamable);
+    case '[':
+      return ParseArray(streamable);
+    case '"': {
+      std::string value;
+      if (!ParseString(&value)) {
+        return NULL;
+      }
+      return base::Value::CreateStringValue(value);
+    }
+    case 't':
+    case 'f':
+    case 'n':
+      return ParseLiteral();
+    default:
+      if (*pos_ == '-' || IsDigit(*pos_)) {
+        return ParseNumber();
+      }
+      return SetError(kSyntaxError);
+  }
+}
+
+base::Value* JsonStreamParser::ParseObject(bool streamable) {
+  DCHECK_EQ('{', *pos_);
+  ++pos_;
+  if (++depth_ > kMaxDepth) {
+    return SetError("Too much nesting.");
+  }
+
+  scoped_ptr<base::DictionaryValue> dict(new base::DictionaryValue());
+  while (true) {
+    if (!SkipWhitespace()) {
+      return SetError(kSyntaxError);
+    }
+    if (pos_ == end_) {
+      return SetError(kUnexpectedEnd);
+    }
+    if (*pos_ == '}') {
+      ++pos_;
+      break;
+    }
+    if (*pos_ != '"') {
+      return SetError("Dictionary keys must be quoted.");
+    }
+    std::string key;
+    if (!ParseString(&key)) {
+      return NULL;
+    }
+    if (!SkipWhitespace()) {
+      return SetError(kSyntaxError);
+    }
+    if (pos_ == end_ || *pos_ != ':') {
+      return SetError(kSyntaxError);
+    }
+    ++pos_;
+
+    if (streamable) {
+      path_.push_back(key);
+    }
+    base::Value* value = ParseValue(streamable);
+    if (streamable) {
+      path_.pop_back();
+    }
+    if (value == NULL) {
+      return NULL;
+    }
+    dict->SetWithoutPathExpansion(key, value);
+
+    // A trailing comma before the closing brace is permitted.
+    if (!SkipWhitespace()) {
+      return SetError(kSyntaxError);
+    }
+    if (pos_ == end_) {
+      return SetError(kUnexpectedEnd);
+    }
+    if (*pos_ == ',') {
+      ++pos_;
+    } else if (*pos_ != '}') {
+      return SetError(kSyntaxError);
+    }
+  }
+
+  --depth_;
+  return dict.release();
+}
+
+base::Value* JsonStreamParser::ParseArray(bool streamable) {
+  DCHECK_EQ('[', *pos_);
+  ++pos_;
+  if (++depth_ > kMaxDepth) {
+    return SetError("Too much nesting.");
+  }
+
+  const bool stream_elements = streamable && delegate_ != NULL &&
+      delegate_->ShouldStreamArrayElements(path_);
+  scoped_ptr<base::ListValue> list(new base::ListValue());
+  while (true) {
+    if (!SkipWhitespace()) {
+      return SetError(kSyntaxError);
+    }
+    if (pos_ == end_) {
+      return SetError(kUnexpectedEnd);
+    }
+    if (*pos_ == ']') {
+      ++pos_;
+      break;
+    }
+
+    base::Value* value = ParseValue(false);
+    if (value == NULL) {
+      return NULL;
+    }
+    if (stream_elements) {
+      if (!delegate_->OnArrayElement(path_, value)) {
+        return SetError("Parsing stopped by delegate.");
+      }
+    } else {
+      list->Append(value);
+    }
+
+    // A trailing comma before the closing bracket is permitted.
+    if (!SkipWhitespace()) {
+      return SetError(kSyntaxError);
+    }
+    if (pos_ == end_) {
+      return SetError(kUnexpectedEnd);
+    }
+    if (*pos_ == ',') {
+      ++pos_;
+    } else if (*pos_ != ']') {
+      return SetError(kSyntaxError);
+    }
+  }
+
+  --depth_;
+  return list.release();
+}
+
+base::Value* JsonStreamParser::ParseNumber() {
+  const char* number_start = pos_;
+  if (*pos_ == '-') {
+    ++pos_;
+  }
+  if (pos_ == end_ || !IsDigit(*pos_)) {
+    return SetError(kSyntaxError);
+  }
+  // Leading zeros are not permitted.
+  if (*pos_ == '0') {
+    ++pos_;
+    if (pos_ != end_ && IsDigit(*pos_)) {
+      return SetError(kSyntaxError);
+    }
+  } else {
+    while (pos_ != end_ && IsDigit(*pos_)) {
+      ++pos_;
+    }
+  }
+
+  bool is_integer = true;
+  if (pos_ != end_ && *pos_ == '.') {
+    is_integer = false;
+    ++pos_;
+    if (pos_ == end_ || !IsDigit(*pos_)) {
+      return SetError(kSyntaxError);
+    }
+    while (pos_ != end_ && IsDigit(*pos_)) {
+      ++pos_;
+    }
+  }
+  if (pos_ != end_ && (*pos_ == 'e' || *pos_ == 'E')) {
+    is_integer = false;
+    ++pos_;
+    if (pos_ != end_ && (*pos_ == '+' || *pos_ == '-')) {
+      ++pos_;
+    }
+    if (pos_ == end_ || !IsDigit(*pos_)) {
+      return SetError(kSyntaxError);
+    }
+    while (pos_ != end_ && IsDigit(*pos_)) {
+      ++pos_;
+    }
+  }
+
+  // As with base::JSONReader, numbers without a fraction or exponent
+  // that fit in an int are integers, and all others are doubles.
+  if (is_integer) {
+    const bool negative = (*number_start == '-');
+    int64 value = 0;
+    const char* digit = negative ? number_start + 1 : number_start;
+    for (; digit != pos_; ++digit) {
+      value = value * 10 + (*digit - '0');
+      if (value > static_cast<int64>(kint32max) + 1) {
+        break;
+      }
+    }
+    if (negative) {
+      value = -value;
+    }
+    if (digit == pos_ && value >= kint32min && value <= kint32max) {
+      return base::Value::CreateIntegerValue(static_cast<int>(value));
+    }
+  }
+
+  // base::StringToDouble, unlike strtod, does not depend on the current
+  // locale's decimal separator.
+  double value = 0;
+  if (!base::StringToDouble(std::string(number_start, pos_ - number_start),
+                            &value)) {
+    return SetError("Number out of range.");
+  }
+  return base::Value::CreateDoubleValue(value);
+}
+
+base::Value* JsonStreamParser::ParseLiteral() {
+  const size_t remaining = end_ - pos_;
+  if (remaining >= 4 && memcmp(pos_, "true", 4) == 0) {
+    pos_ += 4;
+    return base::Value::CreateBooleanValue(true);
+  }
+  if (remaining >= 5 && memcmp(pos_, "false", 5) == 0) {
+    pos_ += 5;
+    return base::Value::CreateBooleanValue(false);
+  }
+  if (remaining >= 4 && memcmp(pos_, "null", 4) == 0) {
+    pos_ += 4;
+    return base::Value::CreateNullValue();
+  }
+  return SetError(kSyntaxError);
+}
+
+bool JsonStreamParser::ParseString(std::string* out) {
+  DCHECK_EQ('"', *pos_);
+  ++pos_;
+  // Copy runs of unescaped characters at once, rather than one
+  // character at a time.
+  const char* run_start = pos_;
+  while (true) {
+    if (pos_ == end_) {
+      SetError(kUnexpectedEnd);
+      return false;
+    }
+    const char c = *pos_;
+    if (c == '"') {
+      out->append(run_start, pos_ - run_start);
+      ++pos_;
+      return true;
+    }
+    if (c == '\\') {
+      out->append(run_start, pos_ - run_start);
+      ++pos_;
+      if (!ParseEscapeSequence(out)) {
+        return false;
+      }
+      run_start = pos_;
+      continue;
+    }
+    const int length = GetUtf8CharLength(pos_, end_);
+    if (length == 0) {
+      SetError("Unsupported encoding. JSON must be UTF-8.");
+      return false;
+    }
+    pos_ += length;
+  }
+}
+
+bool JsonStreamParser::ParseEscapeSequence(std::string* out) {
+  if (pos_ == end_) {
+    SetError(kUnexpectedEnd);
+    return false;
+  }
+  const char c = *pos_;
+  ++pos_;
+  switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+      out->push_back(c);
+      return true;
+    case 'b':
+      out->push_back('\b');
+      return true;
+    case 'f':
+      out->push_back('\f');
+      return true;
+    case 'n':
+      out->push_back('\n');
+      return true;
+    case 'r':
+      out->push_back('\r');
+      return true;
+    case 't':
+      out->push_back('\t');
+      return true;
+    case 'v':
+      out->push_back('\v');
+      return true;
+    case 'x': {
+      // Like base::JSONReader, we accept \xXX as the code point U+00XX.
+      uint32 code_point;
+      if (!ParseHexDigits(2, &code_point)) {
+        return false;
+      }
+      AppendUtf8(code_point, out);
+      return true;
+    }
+    case 'u': {
+      uint32 code_point;
+      if (!ParseHexDigits(4, &code_point)) {
+        return false;
+      }
+      if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+        // A high surrogate must be followed by an escaped low surrogate.
+        uint32 low_surrogate;
+        if (end_ - pos_ < 2 || pos_[0] != '\\' || pos_[1] != 'u') {
+          SetError("Invalid escape sequence.");
+          return false;
+        }
+        pos_ += 2;
+        if (!ParseHexDigits(4, &low_surrogate)) {
+          return false;
+        }
+        if (low_surrogate < 0xDC00 || low_surrogate > 0xDFFF) {
+          SetError("Invalid escape sequence.");
+          return false;
+        }
+        code_point = 0x10000 + ((code_point - 0xD800) << 10) +
+            (low_surrogate - 0xDC00);
+      } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+        SetError("Invalid escape sequence.");
+        return false;
+      }
+      AppendUtf8(code_point, out);
+      return true;
+    }
+    default:
+      SetError("Invalid escape sequence.");
+      return false;
+  }
+}
+
+bool JsonStreamParser::ParseHexDigits(int num_digits, uint32* out) {
+  if (end_ - pos_ < num_digits) {
+    SetError(kUnexpectedEnd);
+    return false;
+  }
+  uint32 value = 0;
+  for (int i = 0; i < num_digits; ++i, ++pos_) {
+    const char c = *pos_;
+    value <<= 4;
+    if (c >= '0' && c <= '9') {
+      value |= c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      value |= c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      value |= c - 'A' + 10;
+    } else {
+      SetError("Invalid escape sequence.");
+      return false;
+    }
+  }
+  *out = value;
+  return true;
+}
+
+bool JsonStreamParser::SkipWhitespace() {
+  while (pos_ != end_) {
+    switch (*pos_) {
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n':
+        ++pos_;
+        break;
+      case '/':
+        if (end_ - pos_ < 2) {
+          return false;
+        }
+        if (pos_[1] == '/') {
+          // Skip to the end of the line.
+          pos_ += 2;
+          while (pos_ != end_ && *pos_ != '\n' && *pos_ != '\r') {
+            ++pos_;
+          }
+        } else if (pos_[1] == '*') {
+          // Skip to the end of the comment.
+          const char* comment_end = pos_ + 2;
+          while (true) {
+            if (end_ - comment_end < 2) {
+              return false;
+            }
+            if (comment_end[0] == '*' && comment_end[1] == '/') {
+              break;
+            }
+            ++comment_end;
+          }
+          pos_ = comment_end + 2;
+        } else {
+          return false;
+        }
+        break;
+      default:
+        return true;
+    }
+  }
+  return true;
+}
+
+base::Value* JsonStreamParser::SetError(const char* description) {
+  // Keep the first error, which is the most specific.
+  if (!error_.empty()) {
+    return NULL;
+  }
+  int line = 1;
+  int column = 1;
+  for (const char* p = start_; p < pos_; ++p) {
+    if (*p == '\n') {
+      ++line;
+      column = 1;
+    } else {
+      ++column;
+    }
+  }
+  error_ = base::StringPrintf("Line: %d, column: %d, %s",
+                              line, column, description);
+  return NULL;
+}
+
+}  // namespace pagespeed
@@ -0,0 +1,114 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PAGESPEED_CORE_JSON_STREAM_PARSER_H_
+#define PAGESPEED_CORE_JSON_STREAM_PARSER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/string_piece.h"
+
+namespace base {
+class Value;
+}  // namespace base
+
+namespace pagespeed {
+
+// Parses a JSON document in a single pass, handing the elements of
+// selected arrays to a delegate as soon as each element has been
+// parsed, rather than adding them to the document. This allows large
+// documents that consist mostly of one array (such as the entries of a
+// HAR, or the records of a timeline) to be processed one element at a
+// time, with peak memory use bounded by the size of the largest
+// element rather than the size of the whole document.
+//
+// The accepted syntax is the same as that accepted by base::JSONReader
+// with trailing commas allowed: comments and trailing commas are
+// permitted, and strings must be valid UTF-8.
+class JsonStreamParser {
+ public:
+  // The object keys leading from the root of the document to an array.
+  typedef std::vector<std::string> Path;
+
+  class Delegate {
+   public:
+    Delegate();
+    virtual ~Delegate();
+
+    // Whether the elements of the array at the given path should be
+    // passed to OnArrayElement rather than added to the document. Only
+    // called for arrays that are reached from the root through objects
+    // alone.
+    virtual bool ShouldStreamArrayElements(const Path& path) = 0;
+
+    // Called with each element of an array for which
+    // ShouldStreamArrayElements returned true, in order. Ownership of
+    // the element is transferred to the delegate. Return false to stop
+    // parsing, in which case Parse fails.
+    virtual bool OnArrayElement(const Path& path, base::Value* element) = 0;
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(Delegate);
+  };
+
+  // Does not take ownership of the delegate.
+  explicit JsonStreamParser(Delegate* delegate);
+  ~JsonStreamParser();
+
+  // Parse the given JSON document. Returns the document, without the
+  // elements that were passed to the delegate (so streamed arrays are
+  // left empty), or NULL if the document is malformed, in which case
+  // error_msg_out (if non-NULL) is set to a description of the error.
+  // Ownership of the returned value is transferred to the caller.
+  base::Value* Parse(const base::StringPiece& json,
+                     std::string* error_msg_out);
+
+ private:
+  // Each Parse* method parses a value that starts at pos_, leaving pos_
+  // just past it, or returns NULL (or false) and sets error_.
+  // Streamable is true iff every container enclosing the value is an
+  // object, so that path_ describes its location.
+  base::Value* ParseValue(bool streamable);
+  base::Value* ParseObject(bool streamable);
+  base::Value* ParseArray(bool streamable);
+  base::Value* ParseNumber();
+  base::Value* ParseLiteral();
+  bool ParseString(std::string* out);
+  bool ParseEscapeSequence(std::string* out);
+  bool ParseHexDigits(int num_digits, uint32* out);
+
+  // Advance pos_ past any whitespace and comments. Returns false if a
+  // comment is not terminated.
+  bool SkipWhitespace();
+
+  // Record an error at the current position. Returns NULL so that
+  // parse methods can return its result.
+  base::Value* SetError(const char* description);
+
+  Delegate* const delegate_;
+  const char* start_;
+  const char* pos_;
+  const char* end_;
+  int depth_;
+  Path path_;
+  std::string error_;
+
+  DISALLOW_COPY_AND_ASSIGN(JsonStreamParser);
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_CORE_JSON_STREAM_PARSER_H_
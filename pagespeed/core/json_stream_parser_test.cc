@@ -0,0 +1,314 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pagespeed/core/json_stream_parser.h"
+
+#include <string>
+#include <vector>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/stl_util.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using pagespeed::JsonStreamParser;
+
+namespace {
+
+// Does not stream any arrays.
+class NonStreamingDelegate : public JsonStreamParser::Delegate {
+ public:
+  NonStreamingDelegate() {}
+
+  virtual bool ShouldStreamArrayElements(const JsonStreamParser::Path& path) {
+    return false;
+  }
+
+  virtual bool OnArrayElement(const JsonStreamParser::Path& path,
+                              base::Value* element) {
+    ADD_FAILURE() << "Unexpected array element.";
+    delete element;
+    return false;
+  }
+};
+
+// Streams the elements of the arrays at the given path, and records
+// them. The path is given as dot-separated keys; an empty path streams
+// the elements of a root array.
+class RecordingDelegate : public JsonStreamParser::Delegate {
+ public:
+  explicit RecordingDelegate(const std::string& path_spec)
+      : max_elements_(-1) {
+    if (!path_spec.empty()) {
+      std::string::size_type start = 0;
+      std::string::size_type dot;
+      while ((dot = path_spec.find('.', start)) != std::string::npos) {
+        path_.push_back(path_spec.substr(start, dot - start));
+        start = dot + 1;
+      }
+      path_.push_back(path_spec.substr(start));
+    }
+  }
+  virtual ~RecordingDelegate() {
+    STLDeleteElements(&elements_);
+  }
+
+  virtual bool ShouldStreamArrayElements(const JsonStreamParser::Path& path) {
+    return path == path_;
+  }
+
+  virtual bool OnArrayElement(const JsonStreamParser::Path& path,
+                              base::Value* element) {
+    EXPECT_TRUE(path == path_);
+    elements_.push_back(element);
+    return max_elements_ < 0 ||
+        static_cast<int>(elements_.size()) < max_elements_;
+  }
+
+  void set_max_elements(int max_elements) { max_elements_ = max_elements; }
+  const std::vector<base::Value*>& elements() const { return elements_; }
+
+ private:
+  JsonStreamParser::Path path_;
+  std::vector<base::Value*> elements_;
+  int max_elements_;
+};
+
+// Parses the given JSON without streaming, returning NULL and setting
+// error_msg on failure.
+base::Value* ParseWithoutStreaming(const std::string& json,
+                                   std::string* error_msg) {
+  NonStreamingDelegate delegate;
+  JsonStreamParser parser(&delegate);
+  return parser.Parse(json, error_msg);
+}
+
+void ExpectParseFails(const std::string& json) {
+  std::string error_msg;
+  scoped_ptr<base::Value> value(ParseWithoutStreaming(json, &error_msg));
+  EXPECT_TRUE(value == NULL) << json;
+  EXPECT_FALSE(error_msg.empty()) << json;
+}
+
+TEST(JsonStreamParserTest, Scalars) {
+  std::string error_msg;
+  scoped_ptr<base::Value> value;
+
+  value.reset(ParseWithoutStreaming("true", &error_msg));
+  bool bool_value = false;
+  ASSERT_TRUE(value != NULL);
+  ASSERT_TRUE(value->GetAsBoolean(&bool_value));
+  EXPECT_TRUE(bool_value);
+
+  value.reset(ParseWithoutStreaming(" null ", &error_msg));
+  ASSERT_TRUE(value != NULL);
+  EXPECT_TRUE(value->IsType(base::Value::TYPE_NULL));
+
+  int int_value = 0;
+  value.reset(ParseWithoutStreaming("-42", &error_msg));
+  ASSERT_TRUE(value != NULL);
+  ASSERT_TRUE(value->GetAsInteger(&int_value));
+  EXPECT_EQ(-42, int_value);
+
+  value.reset(ParseWithoutStreaming("-2147483648", &error_msg));
+  ASSERT_TRUE(value != NULL);
+  ASSERT_TRUE(value->GetAsInteger(&int_value));
+  EXPECT_EQ(kint32min, int_value);
+
+  // Integers that do not fit in an int are doubles.
+  double double_value = 0.0;
+  value.reset(ParseWithoutStreaming("2147483648", &error_msg));
+  ASSERT_TRUE(value != NULL);
+  EXPECT_TRUE(value->IsType(base::Value::TYPE_DOUBLE));
+  ASSERT_TRUE(value->GetAsDouble(&double_value));
+  EXPECT_DOUBLE_EQ(2147483648.0, double_value);
+
+  value.reset(ParseWithoutStreaming("1.5e2", &error_msg));
+  ASSERT_TRUE(value != NULL);
+  EXPECT_TRUE(value->IsType(base::Value::TYPE_DOUBLE));
+  ASSERT_TRUE(value->GetAsDouble(&double_value));
+  EXPECT_DOUBLE_EQ(150.0, double_value);
+
+  std::string string_value;
+  value.reset(ParseWithoutStreaming("\"a\\\"b\\\\c\\/d\\n\"", &error_msg));
+  ASSERT_TRUE(value != NULL);
+  ASSERT_TRUE(value->GetAsString(&string_value));
+  EXPECT_EQ("a\"b\\c/d\n", string_value);
+}
+
+TEST(JsonStreamParserTest, UnicodeEscapes) {
+  std::string error_msg;
+  std::string string_value;
+
+  scoped_ptr<base::Value> value(
+      ParseWithoutStreaming("\"\\u00e9\\u20ac\\ud834\\udd1e\"", &error_msg));
+  ASSERT_TRUE(value != NULL) << error_msg;
+  ASSERT_TRUE(value->GetAsString(&string_value));
+  EXPECT_EQ("\xc3\xa9\xe2\x82\xac\xf0\x9d\x84\x9e", string_value);
+
+  // UTF-8 is passed through unchanged.
+  value.reset(ParseWithoutStreaming("\"\xc3\xa9\"", &error_msg));
+  ASSERT_TRUE(value != NULL) << error_msg;
+  ASSERT_TRUE(value->GetAsString(&string_value));
+  EXPECT_EQ("\xc3\xa9", string_value);
+}
+
+TEST(JsonStreamParserTest, Containers) {
+  std::string error_msg;
+  scoped_ptr<base::Value> value(ParseWithoutStreaming(
+      "\xef\xbb\xbf"  // UTF-8 byte order mark.
+      "{\n"
+      "  // A comment.\n"
+      "  \"a\": [1, 2, /* another comment */ 3,],\n"
+      "  \"b\": {\"c\": \"d\",},\n"
+      "}",
+      &error_msg));
+  ASSERT_TRUE(value != NULL) << error_msg;
+  ASSERT_TRUE(value->IsType(base::Value::TYPE_DICTIONARY));
+  const base::DictionaryValue* dict =
+      static_cast<const base::DictionaryValue*>(value.get());
+
+  const base::ListValue* list = NULL;
+  ASSERT_TRUE(dict->GetList("a", &list));
+  ASSERT_EQ(3U, list->GetSize());
+  int int_value = 0;
+  ASSERT_TRUE(list->GetInteger(2, &int_value));
+  EXPECT_EQ(3, int_value);
+
+  std::string string_value;
+  ASSERT_TRUE(dict->GetString("b.c", &string_value));
+  EXPECT_EQ("d", string_value);
+}
+
+TEST(JsonStreamParserTest, InvalidInput) {
+  ExpectParseFails("");
+  ExpectParseFails("{");
+  ExpectParseFails("[1 2]");
+  ExpectParseFails("{\"a\" 1}");
+  ExpectParseFails("{a: 1}");
+  ExpectParseFails("[,]");
+  ExpectParseFails("[1,,]");
+  ExpectParseFails("01");
+  ExpectParseFails("1.");
+  ExpectParseFails("-");
+  ExpectParseFails("1e999");
+  ExpectParseFails("tru");
+  ExpectParseFails("\"abc");
+  ExpectParseFails("\"\\q\"");
+  ExpectParseFails("\"\\u12\"");
+  ExpectParseFails("\"\xc3\"");
+  ExpectParseFails("/* unterminated");
+  ExpectParseFails("[] []");
+}
+
+TEST(JsonStreamParserTest, ErrorMessage) {
+  std::string error_msg;
+  scoped_ptr<base::Value> value(
+      ParseWithoutStreaming("{\n  \"a\": 1,\n  b: 2\n}", &error_msg));
+  EXPECT_TRUE(value == NULL);
+  EXPECT_EQ("Line: 3, column: 3, Dictionary keys must be quoted.", error_msg);
+}
+
+TEST(JsonStreamParserTest, TooMuchNesting) {
+  std::string json;
+  for (int i = 0; i < 100; ++i) {
+    json += "[";
+  }
+  json += std::string(100, ']');
+  std::string error_msg;
+  scoped_ptr<base::Value> value(ParseWithoutStreaming(json, &error_msg));
+  EXPECT_TRUE(value != NULL) << error_msg;
+
+  json = "[" + json + "]";
+  value.reset(ParseWithoutStreaming(json, &error_msg));
+  EXPECT_TRUE(value == NULL);
+}
+
+TEST(JsonStreamParserTest, StreamArrayElements) {
+  RecordingDelegate delegate("log.entries");
+  JsonStreamParser parser(&delegate);
+  std::string error_msg;
+  scoped_ptr<base::Value> value(parser.Parse(
+      "{\"log\": {\"version\": \"1.2\","
+      "          \"entries\": [{\"a\": 1}, {\"b\": [2, 3]}, 4,],"
+      "          \"pages\": [{\"entries\": [5]}]},"
+      " \"entries\": [6]}",
+      &error_msg));
+  ASSERT_TRUE(value != NULL) << error_msg;
+
+  // The elements of log.entries were streamed, in order.
+  ASSERT_EQ(3U, delegate.elements().size());
+  EXPECT_TRUE(delegate.elements()[0]->IsType(base::Value::TYPE_DICTIONARY));
+  EXPECT_TRUE(delegate.elements()[1]->IsType(base::Value::TYPE_DICTIONARY));
+  int int_value = 0;
+  ASSERT_TRUE(delegate.elements()[2]->GetAsInteger(&int_value));
+  EXPECT_EQ(4, int_value);
+
+  // They are not part of the returned document, but the rest of the
+  // document is, including arrays at other paths.
+  const base::DictionaryValue* dict =
+      static_cast<const base::DictionaryValue*>(value.get());
+  const base::ListValue* list = NULL;
+  ASSERT_TRUE(dict->GetList("log.entries", &list));
+  EXPECT_TRUE(list->empty());
+  std::string string_value;
+  ASSERT_TRUE(dict->GetString("log.version", &string_value));
+  EXPECT_EQ("1.2", string_value);
+  const base::ListValue* pages = NULL;
+  ASSERT_TRUE(dict->GetList("log.pages", &pages));
+  const base::DictionaryValue* page = NULL;
+  ASSERT_TRUE(pages->GetDictionary(0, &page));
+  ASSERT_TRUE(page->GetList("entries", &list));
+  EXPECT_EQ(1U, list->GetSize());
+  ASSERT_TRUE(dict->GetList("entries", &list));
+  EXPECT_EQ(1U, list->GetSize());
+}
+
+TEST(JsonStreamParserTest, StreamRootArray) {
+  RecordingDelegate delegate("");
+  JsonStreamParser parser(&delegate);
+  std::string error_msg;
+  scoped_ptr<base::Value> value(parser.Parse("[1, [2], 3]", &error_msg));
+  ASSERT_TRUE(value != NULL) << error_msg;
+  EXPECT_EQ(3U, delegate.elements().size());
+  const base::ListValue* list = NULL;
+  ASSERT_TRUE(value->GetAsList(&list));
+  EXPECT_TRUE(list->empty());
+}
+
+TEST(JsonStreamParserTest, DelegateStopsParsing) {
+  RecordingDelegate delegate("entries");
+  delegate.set_max_elements(2);
+  JsonStreamParser parser(&delegate);
+  std::string error_msg;
+  scoped_ptr<base::Value> value(
+      parser.Parse("{\"entries\": [1, 2, 3, 4]}", &error_msg));
+  EXPECT_TRUE(value == NULL);
+  EXPECT_EQ(2U, delegate.elements().size());
+  EXPECT_FALSE(error_msg.empty());
+}
+
+TEST(JsonStreamParserTest, ErrorAfterStreamedElements) {
+  RecordingDelegate delegate("entries");
+  JsonStreamParser parser(&delegate);
+  std::string error_msg;
+  scoped_ptr<base::Value> value(
+      parser.Parse("{\"entries\": [1, 2], \"x\": }", &error_msg));
+  EXPECT_TRUE(value == NULL);
+  EXPECT_EQ(2U, delegate.elements().size());
+  EXPECT_FALSE(error_msg.empty());
+}
+
+}  // namespace
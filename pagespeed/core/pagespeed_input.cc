@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <map>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/stl_util.h"
@@ -272,22 +273,30 @@ void PagespeedInput::PopulateInputInformation() {
   }
 }
 
-// DomElementVisitor that walks the DOM looking for nodes that
+// DomTraversalVisitor that walks the DOM looking for nodes that
 // reference external resources (e.g. <img src="foo.gif">).
-class ExternalResourceNodeVisitor : public pagespeed::DomElementVisitor {
+class ExternalResourceNodeVisitor : public pagespeed::DomTraversalVisitor {
  public:
   ExternalResourceNodeVisitor(
       const pagespeed::PagespeedInput* pagespeed_input,
-      const pagespeed::DomDocument* document,
       std::map<const Resource*, ResourceType>* resource_type_map)
       : pagespeed_input_(pagespeed_input),
-        document_(document),
         resource_type_map_(resource_type_map) {
     SetUp();
   }
 
+  virtual bool EnterDocument(const pagespeed::DomDocument& document,
+                             const pagespeed::DomElement* frame) {
+    documents_.push_back(&document);
+    return true;
+  }
+
   virtual void Visit(const pagespeed::DomElement& node);
 
+  virtual void LeaveDocument(const pagespeed::DomDocument& document) {
+    documents_.pop_back();
+  }
+
  private:
   void SetUp();
 
@@ -295,7 +304,8 @@ class ExternalResourceNodeVisitor : public pagespeed::DomElementVisitor {
                   ResourceType type);
 
   const pagespeed::PagespeedInput* pagespeed_input_;
-  const pagespeed::DomDocument* document_;
+  // The documents being visited, innermost last.
+  std::vector<const pagespeed::DomDocument*> documents_;
   std::map<const Resource*, ResourceType>* resource_type_map_;
   ResourceSet visited_resources_;
 
@@ -311,7 +321,7 @@ void ExternalResourceNodeVisitor::ProcessUri(const std::string& relative_uri,
     // URIs.
     return;
   }
-  std::string uri = document_->ResolveUri(relative_uri);
+  std::string uri = documents_.back()->ResolveUri(relative_uri);
   if (!uri_util::IsExternalResourceUrl(uri)) {
     // If this is a URL for a non-external resource (e.g. a data URI)
     // then we should not attempt to process it.
@@ -385,26 +395,13 @@ void ExternalResourceNodeVisitor::Visit(const pagespeed::DomElement& node) {
       }
     }
   }
-
-  if (node.GetTagName() == "IFRAME") {
-    // Do a recursive document traversal.
-    scoped_ptr<pagespeed::DomDocument> child_doc(node.GetContentDocument());
-    if (child_doc.get()) {
-      ExternalResourceNodeVisitor visitor(pagespeed_input_,
-                                          child_doc.get(),
-                                          resource_type_map_);
-      child_doc->Traverse(&visitor);
-    }
-  }
 }
 
 void PagespeedInput::PopulateResourceInformationFromDom(
     std::map<const Resource*, ResourceType>* resource_type_map) {
   if (dom_document() != NULL) {
-    ExternalResourceNodeVisitor visitor(this,
-                                        dom_document(),
-                                        resource_type_map);
-    dom_document()->Traverse(&visitor);
+    ExternalResourceNodeVisitor visitor(this, resource_type_map);
+    DomTraversal::TraverseWithVisitor(*dom_document(), &visitor);
   }
 }
 
@@ -552,12 +549,12 @@ InputCapabilities PagespeedInput::EstimateCapabilities() const {
   }
   for (int i = 0, num = num_resources(); i < num; ++i) {
     const Resource& resource = GetResource(i);
-    if (!resource.GetResponseBody().empty()) {
+    if (!resource.GetResponseBodyPiece().empty()) {
       capabilities.add(InputCapabilities::RESPONSE_BODY);
     }
-    if (!resource.GetRequestHeader("referer").empty() &&
-        !resource.GetRequestHeader("host").empty() &&
-        !resource.GetRequestHeader("accept-encoding").empty()) {
+    if (!resource.GetRequestHeader(HEADER_REFERER).empty() &&
+        !resource.GetRequestHeader(HEADER_HOST).empty() &&
+        !resource.GetRequestHeader(HEADER_ACCEPT_ENCODING).empty()) {
       // If at least one resource has a Host, Referer, and
       // Accept-Encoding header, we assume that a full set of request
       // headers were provided.
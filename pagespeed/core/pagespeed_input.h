@@ -182,6 +182,11 @@ class PagespeedInput {
   int viewport_width() const { return viewport_width_; }
   int viewport_height() const { return viewport_height_; }
 
+  // For serialization purposes only. Rules should use
+  // IsResourceLoadedAfterOnload instead.
+  OnloadState onload_state() const { return onload_state_; }
+  int onload_millis() const { return onload_millis_; }
+
   bool SetViewportWidthAndHeight(int width, int height);
 
   // Returns true if the initial resource url should be treated as canonical
@@ -22,6 +22,8 @@
 #include "base/logging.h"
 #include "base/stl_util.h"
 #include "googleurl/src/gurl.h"
+#include "pagespeed/core/resource_util.h"
+#include "pagespeed/core/shared_buffer.h"
 #include "pagespeed/core/uri_util.h"
 
 namespace {
@@ -51,6 +53,25 @@ bool IsBodyStatusCode(int status_code) {
       status_code == 304;
 }
 
+std::string GetMimeTypeFromContentType(const std::string& content_type) {
+  std::string mime_type = content_type.substr(0, content_type.find(';'));
+  pagespeed::string_util::TrimWhitespaceASCII(
+      mime_type, pagespeed::string_util::TRIM_ALL, &mime_type);
+  pagespeed::string_util::StringToLowerASCII(&mime_type);
+  return mime_type;
+}
+
+std::string GetCharsetFromContentType(const std::string& content_type) {
+  pagespeed::resource_util::DirectiveMap directives;
+  if (!pagespeed::resource_util::GetHeaderDirectives(content_type,
+                                                     &directives)) {
+    return "";
+  }
+  pagespeed::resource_util::DirectiveMap::const_iterator it =
+      directives.find("charset");
+  return it == directives.end() ? "" : it->second;
+}
+
 }  // namespace
 
 namespace pagespeed {
@@ -66,7 +87,15 @@ Resource::Resource()
       response_protocol_(UNKNOWN_PROTOCOL),
       type_(OTHER),
       request_start_time_millis_(-1),
-      first_byte_millis_(-1) {
+      first_byte_millis_(-1),
+      resource_index_(-1),
+      frozen_(false) {
+}
+
+Resource::Classification::Classification()
+    : type(OTHER),
+      image_type(UNKNOWN_IMAGE_TYPE),
+      url_valid(false) {
 }
 
 Resource::~Resource() {
@@ -94,6 +123,7 @@ void Resource::SetRequestUrl(const std::string& value) {
   }
 
   request_url_ = url_no_fragment;
+  Unfreeze();
 }
 
 void Resource::SetRequestMethod(const std::string& value) {
@@ -102,17 +132,8 @@ void Resource::SetRequestMethod(const std::string& value) {
 
 void Resource::AddRequestHeader(const std::string& name,
                                 const std::string& value) {
-  std::string& header = request_headers_[name];
-  if (!header.empty()) {
-    // In order to avoid keeping headers in a multi-map, we merge
-    // duplicate headers are merged using commas.  This transformation is
-    // allowed by the http 1.1 RFC.
-    //
-    // http://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html#sec4.2
-    // TODO(bmcquade): change to preserve header structure if we need to.
-    header += ",";
-  }
-  header += value;
+  // TODO(bmcquade): change to preserve header structure if we need to.
+  request_headers_.Add(name, value);
 }
 
 void Resource::SetRequestBody(const std::string& value) {
@@ -151,29 +172,37 @@ const char* Resource::GetResponseProtocolString() const {
 
 void Resource::SetResponseStatusCode(int code) {
   status_code_ = code;
+  Unfreeze();
 }
 
 void Resource::AddResponseHeader(const std::string& name,
                                  const std::string& value) {
-  std::string& header = response_headers_[name];
-  if (!header.empty()) {
-    // In order to avoid keeping headers in a multi-map, we merge
-    // duplicate headers are merged using commas.  This transformation is
-    // allowed by the http 1.1 RFC.
-    //
-    // http://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html#sec4.2
-    // TODO(bmcquade): change to preserve header structure if we need to.
-    header += ",";
-  }
-  header += value;
+  response_headers_.Add(name, value);
+  Unfreeze();
 }
 
 void Resource::RemoveResponseHeader(const std::string& name) {
-  response_headers_.erase(name);
+  response_headers_.Remove(name);
+  Unfreeze();
 }
 
 void Resource::SetResponseBody(const std::string& value) {
   response_body_ = value;
+  response_body_buffer_ = NULL;
+  shared_response_body_.clear();
+  copied_response_body_.Reset();
+}
+
+void Resource::SetResponseBody(SharedBuffer* buffer,
+                               size_t offset,
+                               size_t length) {
+  // Take the reference before releasing any previous buffer, in case
+  // they are the same.
+  scoped_refptr<SharedBuffer> new_buffer(buffer);
+  response_body_.clear();
+  response_body_buffer_.swap(new_buffer);
+  shared_response_body_ = buffer->Substr(offset, length);
+  copied_response_body_.Reset();
 }
 
 void Resource::SetCookies(const std::string& cookies) {
@@ -206,6 +235,7 @@ void Resource::SetResourceType(ResourceType type) {
     return;
   }
   type_ = type;
+  Unfreeze();
 }
 
 const std::string& Resource::GetRequestUrl() const {
@@ -218,12 +248,11 @@ const std::string& Resource::GetRequestMethod() const {
 
 const std::string& Resource::GetRequestHeader(
     const std::string& name) const {
-  HeaderMap::const_iterator it = request_headers_.find(name);
-  if (it != request_headers_.end()) {
-    return it->second;
-  } else {
-    return GetEmptyString();
-  }
+  return request_headers_.Get(name);
+}
+
+const std::string& Resource::GetRequestHeader(WellKnownHeader header) const {
+  return request_headers_.Get(header);
 }
 
 const std::string& Resource::GetRequestBody() const {
@@ -239,7 +268,26 @@ const Resource::HeaderMap* Resource::GetResponseHeaders() const {
 }
 
 const std::string& Resource::GetResponseBody() const {
-  return response_body_;
+  if (response_body_buffer_ == NULL) {
+    return response_body_;
+  }
+  const std::string* copied_body = copied_response_body_.Get();
+  if (copied_body == NULL) {
+    if (copied_response_body_.TryBeginCompute()) {
+      shared_response_body_.CopyToString(
+          copied_response_body_.mutable_value());
+      copied_response_body_.Publish();
+    }
+    copied_body = copied_response_body_.Get();
+  }
+  return *copied_body;
+}
+
+base::StringPiece Resource::GetResponseBodyPiece() const {
+  if (response_body_buffer_ == NULL) {
+    return response_body_;
+  }
+  return shared_response_body_;
 }
 
 const std::string& Resource::GetCookies() const {
@@ -250,12 +298,12 @@ const std::string& Resource::GetCookies() const {
 
   // NOTE: we could try to merge the Cookie and Set-Cookie headers like
   // a browser, but this is a non-trivial operation.
-  const std::string& cookie_header = GetRequestHeader("Cookie");
+  const std::string& cookie_header = GetRequestHeader(HEADER_COOKIE);
   if (!cookie_header.empty()) {
     return cookie_header;
   }
 
-  const std::string& set_cookie_header = GetResponseHeader("Set-Cookie");
+  const std::string& set_cookie_header = GetResponseHeader(HEADER_SET_COOKIE);
   if (!set_cookie_header.empty()) {
     return set_cookie_header;
   }
@@ -269,15 +317,21 @@ const Resource::HeaderMap* Resource::GetRequestHeaders() const {
 
 const std::string& Resource::GetResponseHeader(
     const std::string& name) const {
-  HeaderMap::const_iterator it = response_headers_.find(name);
-  if (it != response_headers_.end()) {
-    return it->second;
-  } else {
-    return GetEmptyString();
-  }
+  return response_headers_.Get(name);
+}
+
+const std::string& Resource::GetResponseHeader(WellKnownHeader header) const {
+  return response_headers_.Get(header);
 }
 
 std::string Resource::GetHost() const {
+  if (frozen_) {
+    if (!classification_.url_valid) {
+      LOG(DFATAL) << "Url parsing failed while processing "
+                  << GetRequestUrl();
+    }
+    return classification_.host;
+  }
   GURL url(GetRequestUrl());
   if (!url.is_valid()) {
     LOG(DFATAL) << "Url parsing failed while processing "
@@ -289,6 +343,13 @@ std::string Resource::GetHost() const {
 }
 
 std::string Resource::GetProtocol() const {
+  if (frozen_) {
+    if (!classification_.url_valid) {
+      LOG(DFATAL) << "Url parsing failed while processing "
+                  << GetRequestUrl();
+    }
+    return classification_.protocol;
+  }
   GURL url(GetRequestUrl());
   if (!url.is_valid()) {
     LOG(DFATAL) << "Url parsing failed while processing "
@@ -299,7 +360,21 @@ std::string Resource::GetProtocol() const {
   }
 }
 
+std::string Resource::GetPath() const {
+  if (frozen_) {
+    return classification_.path;
+  }
+  return GURL(GetRequestUrl()).path();
+}
+
 ResourceType Resource::GetResourceType() const {
+  if (frozen_) {
+    return classification_.type;
+  }
+  return ComputeResourceType();
+}
+
+ResourceType Resource::ComputeResourceType() const {
   // Prefer the status code to an explicitly specified type and the
   // contents of the Content-Type header.
   const int status_code = GetResponseStatusCode();
@@ -317,7 +392,7 @@ ResourceType Resource::GetResourceType() const {
   }
 
   // Finally, fall back to the Content-Type header.
-  std::string type = GetResponseHeader("Content-Type");
+  std::string type = GetResponseHeader(HEADER_CONTENT_TYPE);
 
   size_t separator_idx = type.find(";");
   if (separator_idx != std::string::npos) {
@@ -389,12 +464,19 @@ ImageType Resource::GetImageType() const {
     DCHECK(false) << "Non-image type: " << GetResourceType();
     return UNKNOWN_IMAGE_TYPE;
   }
-  std::string type = GetResponseHeader("Content-Type");
+  if (frozen_) {
+    return classification_.image_type;
+  }
+  return ComputeImageType();
+}
+
+ImageType Resource::ComputeImageType() const {
+  std::string type = GetResponseHeader(HEADER_CONTENT_TYPE);
 
   if (type.empty()) {
     // If there is no Content-Type header, then guess the type based on the
     // extension.
-    const std::string path = GURL(GetRequestUrl()).path();
+    const std::string path = GetPath();
     if (StringCaseEndsWith(path, ".png")) {
       return PNG;
     } else if (StringCaseEndsWith(path, ".gif")) {
@@ -430,6 +512,54 @@ ImageType Resource::GetImageType() const {
   return UNKNOWN_IMAGE_TYPE;
 }
 
+std::string Resource::GetMimeType() const {
+  if (frozen_) {
+    return classification_.mime_type;
+  }
+  return GetMimeTypeFromContentType(GetResponseHeader(HEADER_CONTENT_TYPE));
+}
+
+std::string Resource::GetCharset() const {
+  if (frozen_) {
+    return classification_.charset;
+  }
+  return GetCharsetFromContentType(GetResponseHeader(HEADER_CONTENT_TYPE));
+}
+
+CachePolicy Resource::GetCachePolicy() const {
+  if (frozen_) {
+    return classification_.cache_policy;
+  }
+  CachePolicy policy;
+  CachePolicy::Compute(GetRequestUrl(), response_headers_, &policy);
+  return policy;
+}
+
+void Resource::Freeze() {
+  // Compute everything before setting frozen_, since the Compute*
+  // methods use the getters.
+  frozen_ = false;
+  Classification classification;
+  classification.type = ComputeResourceType();
+  if (classification.type == IMAGE) {
+    classification.image_type = ComputeImageType();
+  }
+  const std::string& content_type = GetResponseHeader(HEADER_CONTENT_TYPE);
+  classification.mime_type = GetMimeTypeFromContentType(content_type);
+  classification.charset = GetCharsetFromContentType(content_type);
+  GURL url(GetRequestUrl());
+  classification.url_valid = url.is_valid();
+  if (classification.url_valid) {
+    classification.host = url.host();
+    classification.protocol = url.scheme();
+  }
+  classification.path = url.path();
+  CachePolicy::Compute(GetRequestUrl(), response_headers_,
+                       &classification.cache_policy);
+  classification_ = classification;
+  frozen_ = true;
+}
+
 bool Resource::IsRequestStartTimeLessThan(const Resource& other) const {
   if (!has_request_start_time_millis() ||
       !other.has_request_start_time_millis()) {
@@ -446,8 +576,8 @@ bool Resource::SerializeData(ResourceData* data) const {
   for (HeaderMap::const_iterator it = request_headers_.begin();
       it != request_headers_.end(); ++it) {
     HeaderData* header = data->add_request_headers();
-    header->set_name(it->first);
-    header->set_value(it->second);
+    header->set_name(it->name());
+    header->set_value(it->value());
   }
 
   if (!GetRequestBody().empty()) {
@@ -458,13 +588,13 @@ bool Resource::SerializeData(ResourceData* data) const {
   for (HeaderMap::const_iterator it = response_headers_.begin();
       it != response_headers_.end(); ++it) {
     HeaderData* header = data->add_response_headers();
-    header->set_name(it->first);
-    header->set_value(it->second);
+    header->set_name(it->name());
+    header->set_value(it->value());
   }
-  data->set_response_body_size(GetResponseBody().size());
+  data->set_response_body_size(GetResponseBodyPiece().size());
 
   data->set_resource_type(GetResourceType());
-  std::string mime_type = GetResponseHeader("Content-Type");
+  std::string mime_type = GetResponseHeader(HEADER_CONTENT_TYPE);
   if (!mime_type.empty()) {
     data->set_mime_type(mime_type);
   }
@@ -18,19 +18,25 @@
 #include <string>
 
 #include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/string_piece.h"
+#include "pagespeed/core/cache_policy.h"
+#include "pagespeed/core/concurrent_memo.h"
+#include "pagespeed/core/header_map.h"
 #include "pagespeed/core/string_util.h"
 #include "pagespeed/proto/resource.pb.h"
 
 namespace pagespeed {
 
 class Resource;
+class SharedBuffer;
 
 /**
  * Represents an individual input resource.
  */
 class Resource {
  public:
-  typedef pagespeed::string_util::CaseInsensitiveStringStringMap HeaderMap;
+  typedef pagespeed::HeaderMap HeaderMap;
 
   Resource();
   virtual ~Resource();
@@ -44,6 +50,11 @@ class Resource {
   void AddResponseHeader(const std::string& name, const std::string& value);
   void RemoveResponseHeader(const std::string& name);
   void SetResponseBody(const std::string& value);
+  // Set the response body to the given range of a shared buffer, which
+  // the resource keeps a reference to, so that the body is not copied.
+  // This allows many bodies to be stored in one buffer, such as a
+  // memory-mapped input file.
+  void SetResponseBody(SharedBuffer* buffer, size_t offset, size_t length);
   void SetResponseBodyModified(bool modified) {
     response_body_modified_ = modified;
   }
@@ -93,6 +104,9 @@ class Resource {
   // case-insensitive. If the header is not present, the empty string
   // is returned.
   const std::string& GetRequestHeader(const std::string& name) const;
+  // Get a well-known HTTP request header, without comparing any header
+  // names.
+  const std::string& GetRequestHeader(WellKnownHeader header) const;
 
   // Get the body sent with the request. This only makes sense for
   // POST requests.
@@ -105,12 +119,22 @@ class Resource {
   // case-insensitive. If the header is not present, the empty string
   // is returned.
   const std::string& GetResponseHeader(const std::string& name) const;
+  // Get a well-known HTTP response header, without comparing any header
+  // names.
+  const std::string& GetResponseHeader(WellKnownHeader header) const;
 
   // Get the body sent with the response (e.g. the HTML, CSS,
   // JavaScript, etc content). This is the body after applying any
-  // content decodings (e.g. post ungzipping the response).
+  // content decodings (e.g. post ungzipping the response). If the body
+  // was set from a SharedBuffer, the first call copies it into a string
+  // held by the resource, so callers that do not need a std::string
+  // should use GetResponseBodyPiece instead.
   const std::string& GetResponseBody() const;
 
+  // Get the body sent with the response, without copying it. The
+  // returned piece is valid until the body is next set.
+  base::StringPiece GetResponseBodyPiece() const;
+
   // Check if the response body modified for the purpose of analysis. We should
   // not save optimized content if the response body is modified. Note: the
   // response body may be modified to fix invalid Unicode code points.
@@ -150,8 +174,15 @@ class Resource {
   // Use GetRequestHeader/GetResponseHeader methods above for key lookup.
   const HeaderMap* GetRequestHeaders() const;
   const HeaderMap* GetResponseHeaders() const;
+  // Returns -1 if no request start time was set. Rules should use
+  // IsRequestStartTimeLessThan instead, for the reasons given above.
+  int GetRequestStartTimeMillisForSerialization() const {
+    return request_start_time_millis_;
+  }
 
-  // Helper methods
+  // Helper methods. Once the resource has been frozen (see Freeze),
+  // these return values computed when it was frozen, rather than
+  // parsing the request URL and headers again on each call.
 
   // extract the host std::string from the request url
   std::string GetHost() const;
@@ -159,6 +190,9 @@ class Resource {
   // extract the protocol std::string from the request url
   std::string GetProtocol() const;
 
+  // extract the path std::string from the request url
+  std::string GetPath() const;
+
   // Get the protocol string from response, e.g., HTTP/1.1.
   const char* GetResponseProtocolString() const;
 
@@ -167,10 +201,31 @@ class Resource {
     return response_protocol_;
   }
 
+  // Get the position of this resource within the ResourceCollection
+  // (and thus the PagespeedInput) that owns it, or -1 if the resource
+  // has not been added to one. This can be used to index per-resource
+  // data without a map lookup.
+  int GetResourceIndex() const {
+    return resource_index_;
+  }
+
   // Extract resource type from the Content-Type header.
   ResourceType GetResourceType() const;
   ImageType GetImageType() const;
 
+  // Get the MIME type from the Content-Type header, lower-cased and
+  // without parameters (e.g. "text/html"), or the empty string if there
+  // is no Content-Type header.
+  std::string GetMimeType() const;
+
+  // Get the charset parameter of the Content-Type header, or the empty
+  // string if it has none.
+  std::string GetCharset() const;
+
+  // Get the caching information in the response headers. Most callers
+  // should use ResourceCacheComputer, which interprets it.
+  CachePolicy GetCachePolicy() const;
+
   bool SerializeData(ResourceData* data) const;
 
  private:
@@ -181,6 +236,36 @@ class Resource {
   // lead to nondeterminism in results.
   friend class PagespeedInput;
 
+  // ResourceCollection assigns resource_index_ when the resource is
+  // added to it, and freezes the resource when it is frozen.
+  friend class ResourceCollection;
+
+  // The values derived from the request URL, status code, headers and
+  // explicit resource type that the helper methods above return.
+  struct Classification {
+    Classification();
+
+    ResourceType type;
+    ImageType image_type;
+    std::string mime_type;
+    std::string charset;
+    bool url_valid;
+    std::string host;
+    std::string protocol;
+    std::string path;
+    CachePolicy cache_policy;
+  };
+
+  // Compute the classification once, so that the helper methods
+  // become plain reads. Rules read resources from many threads, so
+  // this is done while the input is frozen, before any rule runs.
+  // Modifying the resource afterwards discards the classification.
+  void Freeze();
+  void Unfreeze() { frozen_ = false; }
+
+  ResourceType ComputeResourceType() const;
+  ImageType ComputeImageType() const;
+
   std::string request_url_;
   std::string request_method_;
   HeaderMap request_headers_;
@@ -190,10 +275,19 @@ class Resource {
   Protocol response_protocol_;
   HeaderMap response_headers_;
   std::string response_body_;
+  // If the response body was set from a shared buffer, the buffer and
+  // the body's location within it. The body is copied into
+  // copied_response_body_ on demand by GetResponseBody.
+  scoped_refptr<SharedBuffer> response_body_buffer_;
+  base::StringPiece shared_response_body_;
+  mutable ConcurrentMemo<std::string> copied_response_body_;
   std::string cookies_;
   ResourceType type_;
   int request_start_time_millis_;
   int first_byte_millis_;
+  int resource_index_;
+  bool frozen_;
+  Classification classification_;
 
   DISALLOW_COPY_AND_ASSIGN(Resource);
 };
@@ -19,7 +19,7 @@
 #define PAGESPEED_CORE_RESOURCE_CACHE_COMPUTER_H_
 
 #include "base/basictypes.h"
-#include "base/logging.h"
+#include "pagespeed/core/cache_policy.h"
 
 namespace pagespeed {
 
@@ -27,8 +27,9 @@ class Resource;
 
 // Class to embody computing caching info for Resources.
 // This class has two advantages over static functions in resource_util:
-//  1) It allows computation to be run once, lazily and saved rather than
-//     multiple times and thrown away.
+//  1) It answers from the resource's CachePolicy, which is parsed once
+//     when the resource is frozen, rather than parsing the caching
+//     headers again for each question.
 //  2) It supplies virtual methods for details of caching policy so that users
 //     (including Page Speed Automatic) can tweak parts of the policy by
 //     subclassing and overriding these methods.
@@ -36,8 +37,7 @@ class ResourceCacheComputer {
  public:
   // resource must outlive ResourceCacheComputer.
   // Does not take ownership of resource.
-  explicit ResourceCacheComputer(const Resource* resource)
-      : resource_(resource) {}
+  explicit ResourceCacheComputer(const Resource* resource);
   // Note: Do not remove virtual for this destructor, as code in other
   // projects does subclass this class.
   virtual ~ResourceCacheComputer();
@@ -88,50 +88,8 @@ class ResourceCacheComputer {
   // cache headers have been set for resource!
   bool IsHeuristicallyCacheable();
 
-  // Compute values w/o memory. Helper functions to the ones above which lazily
-  // compute the result and memoize the result.
-  bool ComputeIsCacheable();
-  bool ComputeIsProxyCacheable();
-  bool ComputeIsHeuristicallyCacheable();
-  bool ComputeFreshnessLifetimeMillis(int64* out_freshness_lifetime_millis);
-  bool ComputeHasExplicitNoCacheDirective();
-
-  // A variable with added bool for whether or not it's been set.
-  template<class T> class Optional {
-   public:
-    Optional() : has_value_(false) {}
-    ~Optional();
-
-    bool has_value() const { return has_value_; }
-
-    T value() const {
-      // Not meaningful unless has_value() == true.
-      DCHECK(has_value());
-      return value_;
-    }
-
-    void set_value(T value) {
-      // Do not set a value twice.
-      DCHECK(!has_value());
-      value_ = value;
-      has_value_ = true;
-    }
-
-   private:
-    T value_;
-    bool has_value_;
-
-    DISALLOW_COPY_AND_ASSIGN(Optional);
-  };
-
   const Resource* resource_;
-
-  Optional<int64> freshness_lifetime_millis_;
-  Optional<bool> is_cacheable_;
-  Optional<bool> is_proxy_cacheable_;
-  Optional<bool> is_explicitly_cacheable_;
-  Optional<bool> is_heuristically_cacheable_;
-  Optional<bool> has_explicit_no_cache_directive_;
+  const CachePolicy policy_;
 
   DISALLOW_COPY_AND_ASSIGN(ResourceCacheComputer);
 };
@@ -221,6 +221,7 @@ bool ResourceCollection::AddResource(Resource* resource) {
   }
   const std::string& url = resource->GetRequestUrl();
 
+  resource->resource_index_ = resources_.size();
   resources_.push_back(resource);
   url_resource_map_[url] = resource;
   host_resource_map_[resource->GetHost()].insert(resource);
@@ -228,6 +229,10 @@ bool ResourceCollection::AddResource(Resource* resource) {
 }
 
 bool ResourceCollection::Freeze() {
+  for (std::vector<Resource*>::const_iterator it = resources_.begin(),
+           end = resources_.end(); it != end; ++it) {
+    (*it)->Freeze();
+  }
   bool have_start_times_for_all_resources = true;
   for (int idx = 0, num = num_resources(); idx < num; ++idx) {
     const Resource& resource = GetResource(idx);
@@ -223,6 +223,20 @@ TEST(ResourceCollectionTest, DisallowDuplicates) {
   EXPECT_EQ(coll.GetResource(1).GetRequestUrl(), kURL2);
 }
 
+TEST(ResourceCollectionTest, ResourceIndex) {
+  ResourceCollection coll;
+
+  Resource* resource1 = NewResource(kURL1, 200);
+  Resource* resource2 = NewResource(kURL2, 200);
+  EXPECT_EQ(-1, resource1->GetResourceIndex());
+  EXPECT_TRUE(coll.AddResource(resource1));
+  EXPECT_FALSE(coll.AddResource(NewResource(kURL1, 200)));
+  EXPECT_TRUE(coll.AddResource(resource2));
+  ASSERT_TRUE(coll.Freeze());
+  EXPECT_EQ(0, coll.GetResource(0).GetResourceIndex());
+  EXPECT_EQ(1, coll.GetResource(1).GetResourceIndex());
+}
+
 TEST(ResourceCollectionTest, GetMutableResource) {
   ResourceCollection coll;
 
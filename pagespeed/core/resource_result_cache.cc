@@ -0,0 +1,144 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pagespeed/core/resource_result_cache.h"
+
+#include "base/logging.h"
+#include "base/stl_util.h"
+#include "pagespeed/core/pagespeed_version.h"
+#include "pagespeed/proto/pagespeed_output.pb.h"
+
+namespace pagespeed {
+
+struct ResourceResultCache::Entry {
+  Entry() : used(false) {}
+
+  RuleResults results;
+
+  // Whether this entry was looked up or inserted since the cache was
+  // created or parsed.
+  bool used;
+};
+
+ResourceResultCache::ResourceResultCache() {}
+
+ResourceResultCache::~ResourceResultCache() {
+  STLDeleteValues(&entries_);
+}
+
+// static
+std::string ResourceResultCache::GetKey(
+    const std::string& rule_name,
+    const std::string& configuration_fingerprint,
+    const std::string& content_hash,
+    bool estimated_compressed_sizes) {
+  // Neither rule names nor content hashes contain slashes, and the
+  // fingerprint, which may, comes last, so distinct keys never collide.
+  return rule_name + "/" + content_hash +
+      (estimated_compressed_sizes ? "/estimated/" : "/exact/") +
+      configuration_fingerprint;
+}
+
+bool ResourceResultCache::Lookup(const std::string& key, RuleResults* out) {
+  base::AutoLock lock(lock_);
+  EntryMap::iterator it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  it->second->used = true;
+  out->CopyFrom(it->second->results);
+  return true;
+}
+
+void ResourceResultCache::Insert(const std::string& key,
+                                 const RuleResults& results) {
+  base::AutoLock lock(lock_);
+  Entry* entry = GetOrCreateEntry(key);
+  entry->used = true;
+  entry->results.CopyFrom(results);
+}
+
+int ResourceResultCache::num_entries() const {
+  base::AutoLock lock(lock_);
+  return entries_.size();
+}
+
+int ResourceResultCache::EvictUnusedEntries() {
+  base::AutoLock lock(lock_);
+  int num_evicted = 0;
+  for (EntryMap::iterator it = entries_.begin(); it != entries_.end();) {
+    if (it->second->used) {
+      ++it;
+      continue;
+    }
+    delete it->second;
+    entries_.erase(it++);
+    ++num_evicted;
+  }
+  return num_evicted;
+}
+
+bool ResourceResultCache::SerializeToString(std::string* out) const {
+  ResourceResultCacheData data;
+  GetPageSpeedVersion(data.mutable_version());
+  {
+    base::AutoLock lock(lock_);
+    for (EntryMap::const_iterator it = entries_.begin(), end = entries_.end();
+         it != end;
+         ++it) {
+      ResourceResultCacheData::Entry* entry = data.add_entries();
+      entry->set_key(it->first);
+      entry->mutable_rule_results()->CopyFrom(it->second->results);
+    }
+  }
+  return data.SerializeToString(out);
+}
+
+bool ResourceResultCache::ParseFromString(const std::string& data_string) {
+  base::AutoLock lock(lock_);
+  STLDeleteValues(&entries_);
+
+  ResourceResultCacheData data;
+  if (!data.ParseFromString(data_string)) {
+    LOG(INFO) << "Unable to parse resource result cache.";
+    return false;
+  }
+
+  Version version;
+  GetPageSpeedVersion(&version);
+  if (data.version().SerializeAsString() != version.SerializeAsString()) {
+    LOG(INFO) << "Ignoring resource result cache from a different version.";
+    return false;
+  }
+
+  for (int i = 0, num = data.entries_size(); i < num; ++i) {
+    const ResourceResultCacheData::Entry& data_entry = data.entries(i);
+    GetOrCreateEntry(data_entry.key())->results.CopyFrom(
+        data_entry.rule_results());
+  }
+  return true;
+}
+
+ResourceResultCache::Entry* ResourceResultCache::GetOrCreateEntry(
+    const std::string& key) {
+  lock_.AssertAcquired();
+  Entry*& entry = entries_[key];
+  if (entry == NULL) {
+    entry = new Entry();
+  }
+  return entry;
+}
+
+}  // namespace pagespeed
@@ -0,0 +1,99 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PAGESPEED_CORE_RESOURCE_RESULT_CACHE_H_
+#define PAGESPEED_CORE_RESOURCE_RESULT_CACHE_H_
+
+#include <map>
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/synchronization/lock.h"
+
+namespace pagespeed {
+
+class RuleResults;
+
+// Holds the results that resource-local rules (see
+// Rule::IsResourceLocal) generated for individual resources, keyed by
+// the rule name, the rule's configuration (see
+// Rule::GetConfigurationFingerprint) and the resource's content hash
+// (see RuleInput::GetResourceContentHash). An Engine configured with a
+// ResourceResultCache reuses these results for resources that have
+// not changed, and only runs resource-local rules on new or modified
+// resources. The cache can be serialized, so that it can be persisted
+// between runs.
+//
+// Results computed with estimated compressed sizes (see
+// RuleInput::set_estimate_compressed_sizes) are stored under keys of
+// their own, so they are never reused by an exact run, nor the reverse.
+// All methods are safe to call from multiple threads.
+class ResourceResultCache {
+ public:
+  ResourceResultCache();
+  ~ResourceResultCache();
+
+  // Build the key under which results for the given rule, configured
+  // as the given fingerprint describes, and resource content hash are
+  // stored, when computed with exact or estimated compressed sizes.
+  static std::string GetKey(const std::string& rule_name,
+                            const std::string& configuration_fingerprint,
+                            const std::string& content_hash,
+                            bool estimated_compressed_sizes);
+
+  // Look up the results stored under the given key. Return true and
+  // copy them into out if found.
+  bool Lookup(const std::string& key, RuleResults* out);
+
+  // Store the given results under the given key, replacing any
+  // results previously stored there.
+  void Insert(const std::string& key, const RuleResults& results);
+
+  int num_entries() const;
+
+  // Remove the entries that were neither looked up nor inserted since
+  // this cache was created or parsed, and return how many were removed.
+  // Unused entries may belong to rules or pages that were not analyzed
+  // this time, so only callers that know every entry worth keeping was
+  // used should evict them, to keep a persisted cache from growing
+  // without bound as resources change.
+  int EvictUnusedEntries();
+
+  // Serialize every entry in this cache, including those parsed but not
+  // used since (see EvictUnusedEntries).
+  bool SerializeToString(std::string* out) const;
+
+  // Replace the contents of this cache with the given serialized
+  // cache. Return false, leaving this cache empty, if the data can not
+  // be parsed or was generated by a different version of the library.
+  bool ParseFromString(const std::string& data);
+
+ private:
+  struct Entry;
+  typedef std::map<std::string, Entry*> EntryMap;
+
+  // Get the entry for the given key, creating it if needed. Must be
+  // called with lock_ held.
+  Entry* GetOrCreateEntry(const std::string& key);
+
+  mutable base::Lock lock_;
+  EntryMap entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResourceResultCache);
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_CORE_RESOURCE_RESULT_CACHE_H_
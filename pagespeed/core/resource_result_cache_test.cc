@@ -0,0 +1,144 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <string>
+
+#include "pagespeed/core/resource_result_cache.h"
+#include "pagespeed/proto/pagespeed_output.pb.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using pagespeed::ResourceResultCache;
+using pagespeed::RuleResults;
+
+namespace {
+
+RuleResults NewRuleResults(const std::string& url) {
+  RuleResults results;
+  results.set_rule_name("rule");
+  results.add_results()->add_resource_urls(url);
+  return results;
+}
+
+TEST(ResourceResultCacheTest, LookupAndInsert) {
+  ResourceResultCache cache;
+  const std::string key =
+      ResourceResultCache::GetKey("rule", "", "hash", false);
+  RuleResults results;
+  ASSERT_FALSE(cache.Lookup(key, &results));
+
+  cache.Insert(key, NewRuleResults("http://www.example.com/"));
+  ASSERT_EQ(1, cache.num_entries());
+  ASSERT_TRUE(cache.Lookup(key, &results));
+  ASSERT_EQ(1, results.results_size());
+  EXPECT_EQ("http://www.example.com/", results.results(0).resource_urls(0));
+
+  // Keys for other rules or other content do not match.
+  ASSERT_FALSE(cache.Lookup(
+      ResourceResultCache::GetKey("other", "", "hash", false), &results));
+  ASSERT_FALSE(cache.Lookup(
+      ResourceResultCache::GetKey("rule", "", "other", false), &results));
+  // Nor do results of differently configured rules.
+  ASSERT_FALSE(cache.Lookup(
+      ResourceResultCache::GetKey("rule", "option", "hash", false),
+      &results));
+  // Nor do results computed with estimated compressed sizes.
+  ASSERT_FALSE(cache.Lookup(
+      ResourceResultCache::GetKey("rule", "", "hash", true), &results));
+}
+
+TEST(ResourceResultCacheTest, SerializeRoundTrip) {
+  ResourceResultCache cache;
+  cache.Insert("a", NewRuleResults("http://www.example.com/a"));
+  cache.Insert("b", NewRuleResults("http://www.example.com/b"));
+  std::string data;
+  ASSERT_TRUE(cache.SerializeToString(&data));
+
+  ResourceResultCache parsed_cache;
+  ASSERT_TRUE(parsed_cache.ParseFromString(data));
+  ASSERT_EQ(2, parsed_cache.num_entries());
+  RuleResults results;
+  ASSERT_TRUE(parsed_cache.Lookup("b", &results));
+  EXPECT_EQ("http://www.example.com/b", results.results(0).resource_urls(0));
+}
+
+TEST(ResourceResultCacheTest, SerializeKeepsUnusedEntries) {
+  ResourceResultCache cache;
+  cache.Insert("a", NewRuleResults("http://www.example.com/a"));
+  cache.Insert("b", NewRuleResults("http://www.example.com/b"));
+  std::string data;
+  ASSERT_TRUE(cache.SerializeToString(&data));
+
+  // Entries that were not used since parsing, e.g. those of rules that
+  // did not run, are still serialized.
+  ResourceResultCache parsed_cache;
+  ASSERT_TRUE(parsed_cache.ParseFromString(data));
+  RuleResults results;
+  ASSERT_TRUE(parsed_cache.Lookup("a", &results));
+  parsed_cache.Insert("c", NewRuleResults("http://www.example.com/c"));
+  std::string reserialized_data;
+  ASSERT_TRUE(parsed_cache.SerializeToString(&reserialized_data));
+
+  ResourceResultCache reparsed_cache;
+  ASSERT_TRUE(reparsed_cache.ParseFromString(reserialized_data));
+  ASSERT_EQ(3, reparsed_cache.num_entries());
+  ASSERT_TRUE(reparsed_cache.Lookup("a", &results));
+  ASSERT_TRUE(reparsed_cache.Lookup("b", &results));
+  ASSERT_TRUE(reparsed_cache.Lookup("c", &results));
+}
+
+TEST(ResourceResultCacheTest, EvictUnusedEntries) {
+  ResourceResultCache cache;
+  cache.Insert("a", NewRuleResults("http://www.example.com/a"));
+  cache.Insert("b", NewRuleResults("http://www.example.com/b"));
+  std::string data;
+  ASSERT_TRUE(cache.SerializeToString(&data));
+
+  // Only the entries used since parsing survive eviction.
+  ResourceResultCache parsed_cache;
+  ASSERT_TRUE(parsed_cache.ParseFromString(data));
+  RuleResults results;
+  ASSERT_TRUE(parsed_cache.Lookup("a", &results));
+  parsed_cache.Insert("c", NewRuleResults("http://www.example.com/c"));
+  ASSERT_EQ(1, parsed_cache.EvictUnusedEntries());
+  ASSERT_EQ(2, parsed_cache.num_entries());
+  ASSERT_TRUE(parsed_cache.Lookup("a", &results));
+  ASSERT_FALSE(parsed_cache.Lookup("b", &results));
+  ASSERT_TRUE(parsed_cache.Lookup("c", &results));
+}
+
+TEST(ResourceResultCacheTest, ParseInvalidData) {
+  ResourceResultCache cache;
+  cache.Insert("a", NewRuleResults("http://www.example.com/a"));
+  ASSERT_FALSE(cache.ParseFromString("not a cache"));
+  ASSERT_EQ(0, cache.num_entries());
+}
+
+TEST(ResourceResultCacheTest, ParseOtherVersion) {
+  ResourceResultCache cache;
+  cache.Insert("a", NewRuleResults("http://www.example.com/a"));
+  std::string data;
+  ASSERT_TRUE(cache.SerializeToString(&data));
+
+  pagespeed::ResourceResultCacheData cache_data;
+  ASSERT_TRUE(cache_data.ParseFromString(data));
+  cache_data.mutable_version()->set_minor(cache_data.version().minor() + 1);
+
+  ResourceResultCache other_version_cache;
+  ASSERT_FALSE(other_version_cache.ParseFromString(
+      cache_data.SerializeAsString()));
+  ASSERT_EQ(0, other_version_cache.num_entries());
+}
+
+}  // namespace
@@ -14,13 +14,16 @@
 
 #include <vector>
 
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
+#include "pagespeed/core/shared_buffer.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 using pagespeed::PagespeedInput;
 using pagespeed::Resource;
+using pagespeed::SharedBuffer;
 
 namespace {
 
@@ -40,6 +43,38 @@ TEST(ResourceTest, SetFields) {
   EXPECT_EQ(resource.GetResponseBody(), "response body");
 }
 
+TEST(ResourceTest, SharedResponseBody) {
+  std::string contents("first body, second body");
+  scoped_refptr<SharedBuffer> buffer(SharedBuffer::TakeString(&contents));
+  const char* buffer_data = buffer->data().data();
+
+  Resource first;
+  Resource second;
+  first.SetResponseBody(buffer, 0, 10);
+  second.SetResponseBody(buffer, 12, 11);
+  buffer = NULL;
+
+  // The bodies are views into the buffer, which the resources keep
+  // alive.
+  EXPECT_EQ("first body", first.GetResponseBodyPiece().as_string());
+  EXPECT_EQ(buffer_data, first.GetResponseBodyPiece().data());
+  EXPECT_EQ("second body", second.GetResponseBodyPiece().as_string());
+  EXPECT_EQ(buffer_data + 12, second.GetResponseBodyPiece().data());
+
+  // GetResponseBody copies the body, once.
+  const std::string& body = second.GetResponseBody();
+  EXPECT_EQ("second body", body);
+  EXPECT_EQ(&body, &second.GetResponseBody());
+
+  // Setting a string body replaces the shared one.
+  second.SetResponseBody("owned body");
+  EXPECT_EQ("owned body", second.GetResponseBody());
+  EXPECT_EQ("owned body", second.GetResponseBodyPiece().as_string());
+
+  first.SetResponseBody("");
+  EXPECT_TRUE(first.GetResponseBodyPiece().empty());
+}
+
 TEST(ResourceTest, IsRequestStartTimeLessThanDeathTest) {
   Resource r1, r2;
 #ifndef NDEBUG
@@ -267,6 +302,49 @@ TEST(ResourceTest, SetResourceType) {
   ASSERT_EQ(pagespeed::REDIRECT, r.GetResourceType());
 }
 
+TEST(ResourceTest, MimeTypeAndCharset) {
+  Resource r;
+  EXPECT_EQ("", r.GetMimeType());
+  EXPECT_EQ("", r.GetCharset());
+  r.AddResponseHeader("Content-Type", " Text/HTML ; charset=UTF-8");
+  EXPECT_EQ("text/html", r.GetMimeType());
+  EXPECT_EQ("UTF-8", r.GetCharset());
+  r.RemoveResponseHeader("Content-Type");
+  r.AddResponseHeader("Content-Type", "image/png");
+  EXPECT_EQ("image/png", r.GetMimeType());
+  EXPECT_EQ("", r.GetCharset());
+}
+
+TEST(ResourceTest, FrozenClassification) {
+  PagespeedInput input;
+  Resource* html = new Resource;
+  html->SetRequestUrl("http://www.example.com/dir/index.html");
+  html->SetResponseStatusCode(200);
+  html->AddResponseHeader("Content-Type", "text/html; charset=utf-8");
+  ASSERT_TRUE(input.AddResource(html));
+  Resource* image = new Resource;
+  image->SetRequestUrl("https://images.example.com/logo.gif");
+  image->SetResponseStatusCode(200);
+  image->SetResourceType(pagespeed::IMAGE);
+  ASSERT_TRUE(input.AddResource(image));
+  ASSERT_TRUE(input.Freeze());
+
+  EXPECT_EQ(pagespeed::HTML, html->GetResourceType());
+  EXPECT_EQ("text/html", html->GetMimeType());
+  EXPECT_EQ("utf-8", html->GetCharset());
+  EXPECT_EQ("www.example.com", html->GetHost());
+  EXPECT_EQ("http", html->GetProtocol());
+  EXPECT_EQ("/dir/index.html", html->GetPath());
+
+  // The image type is guessed from the path.
+  EXPECT_EQ(pagespeed::IMAGE, image->GetResourceType());
+  EXPECT_EQ(pagespeed::GIF, image->GetImageType());
+  EXPECT_EQ("", image->GetMimeType());
+  EXPECT_EQ("images.example.com", image->GetHost());
+  EXPECT_EQ("https", image->GetProtocol());
+  EXPECT_EQ("/logo.gif", image->GetPath());
+}
+
 TEST(ResourceTest, CanonicalizeUrl) {
   Resource r;
   r.SetRequestUrl("http://www.example.com");
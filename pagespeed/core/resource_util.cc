@@ -14,9 +14,13 @@
 
 #include "pagespeed/core/resource_util.h"
 
+#include <map>
 #include <set>
+#include <vector>
 
+#include "base/lazy_instance.h"
 #include "base/logging.h"
+#include "base/synchronization/lock.h"
 #include "base/third_party/nspr/prtime.h"
 #include "pagespeed/core/browsing_context.h"
 #include "pagespeed/core/directive_enumerator.h"
@@ -67,7 +71,7 @@ int EstimateHeadersBytes(const Resource::HeaderMap& headers) {
            iter = headers.begin(), end = headers.end();
        iter != end;
        ++iter) {
-    total_size += EstimateHeaderBytes(iter->first, iter->second);
+    total_size += EstimateHeaderBytes(iter->name(), iter->value());
   }
 
   // Include size of trailing empty \r\n line.
@@ -89,9 +93,9 @@ int EstimateRequestBytes(const Resource& resource) {
   // explicit SetCookies() method. When computing estimated request
   // bytes, take the larger of the two values.
   const int cookie_header_size =
-      resource.GetRequestHeader(kCookieHeaderName).empty() ? 0 :
+      resource.GetRequestHeader(HEADER_COOKIE).empty() ? 0 :
       EstimateHeaderBytes(kCookieHeaderName,
-                          resource.GetRequestHeader(kCookieHeaderName));
+                          resource.GetRequestHeader(HEADER_COOKIE));
   const int cookies_size =
       resource.GetCookies().empty() ? 0 :
       EstimateHeaderBytes(kCookieHeaderName, resource.GetCookies());
@@ -102,7 +106,7 @@ int EstimateRequestBytes(const Resource& resource) {
     request_bytes += cookies_size - cookie_header_size;
   }
 
-  if (resource.GetRequestHeader(kHostHeaderName).empty()) {
+  if (resource.GetRequestHeader(HEADER_HOST).empty()) {
     // If the request headers were missing a host header, then it
     // likely indicates that we were given an incomplete set of
     // request headers. Thus we use the request URL to include the
@@ -124,7 +128,7 @@ int EstimateResponseBytes(const Resource& resource) {
   // should be using the post-gzip compression size for this resource,
   // but it's not clear that it's necessarily the right thing to use
   // the gzip-compressed size.
-  response_bytes += resource.GetResponseBody().size();
+  response_bytes += resource.GetResponseBodyPiece().size();
   response_bytes += 8;  // "HTTP/1.1"
   response_bytes += EstimateHeadersBytes(*resource.GetResponseHeaders());
   return response_bytes;
@@ -152,7 +156,8 @@ bool IsCompressibleResource(const Resource& resource) {
 }
 
 bool IsCompressedResource(const Resource& resource) {
-  const std::string& encoding = resource.GetResponseHeader("Content-Encoding");
+  const std::string& encoding =
+      resource.GetResponseHeader(HEADER_CONTENT_ENCODING);
 
   // HTTP allows Content-Encodings to be "stacked" in which case they
   // are comma-separated. Instead of splitting on commas and checking
@@ -166,55 +171,73 @@ bool IsCompressedResource(const Resource& resource) {
 
 namespace {
 
-bool GetGzippedSizeFromCStream(z_stream* c_stream, int* output) {
-  const int kBufferSize = 4096;  // compress 4K at a time
-  scoped_array<char> buffer(new char[kBufferSize]);
+// The level at which most servers compress responses, and so the level
+// at which GetGzippedSize compresses.
+const int kGzipLevel = 6;
+
+// The level at which EstimateGzippedSize compresses, and the ratio
+// between sizes at kGzipLevel and at this level, in percent. Level 1
+// is about 2.5 times faster than level 6. The ratio is the median over
+// a corpus of text resources, which ranged from about 64% to 91%.
+const int kEstimateGzipLevel = 1;
+const int kEstimateGzipSizePercent = 85;
+
+// Inputs smaller than this are cheap to compress exactly, so
+// EstimateGzippedSize does not estimate their size.
+const size_t kMinEstimatedInputSize = 8 * 1024;
+
+// Compresses inputs at a fixed level, counting the compressed bytes
+// and discarding them. Initializing a deflate stream allocates and
+// clears a few hundred kilobytes of state, so each SizeOnlyDeflater
+// reuses its stream, resetting it between inputs.
+class SizeOnlyDeflater {
+ public:
+  explicit SizeOnlyDeflater(int level) : level_(level), initialized_(false) {
+    c_stream_.zalloc = (alloc_func)0;
+    c_stream_.zfree = (free_func)0;
+    c_stream_.opaque = (voidpf)0;
+  }
+
+  ~SizeOnlyDeflater() {
+    if (initialized_) {
+      deflateEnd(&c_stream_);
+    }
+  }
 
-  int err = Z_OK;
-  bool finished = false;
-  int compressed_size = 0;
+  int level() const { return level_; }
 
-  while (!finished) {
-    c_stream->next_out = reinterpret_cast<Bytef*>(buffer.get());
-    c_stream->avail_out = kBufferSize;
-    err = deflate(c_stream, Z_FINISH);
+  // Determine the size of the input after being gzipped. In case of
+  // error, return false and make no change to *output.
+  bool GetCompressedSize(const base::StringPiece& input, int* output);
 
-    switch (err) {
-      case Z_OK:
-        break;
+ private:
+  bool Reset();
 
-      case Z_STREAM_END:
-        finished = true;
-        break;
+  // Compressed output is written here, and then discarded.
+  static const int kBufferSize = 16 * 1024;
 
-      default:
-        LOG(INFO) << "GetCompressedSize encountered error: " << err;
-        return false;
-    }
+  const int level_;
+  bool initialized_;
+  z_stream c_stream_;
+  char buffer_[kBufferSize];
 
-    compressed_size += (kBufferSize - c_stream->avail_out);
-  }
+  DISALLOW_COPY_AND_ASSIGN(SizeOnlyDeflater);
+};
 
-  if (err != Z_STREAM_END) {
-    LOG(INFO) << "GetCompressedSize expected Z_STREAM_END, got " << err;
-    return false;
+bool SizeOnlyDeflater::Reset() {
+  if (initialized_) {
+    int err = deflateReset(&c_stream_);
+    if (err == Z_OK) {
+      return true;
+    }
+    LOG(INFO) << "Failed to deflateReset: " << err;
+    deflateEnd(&c_stream_);
+    initialized_ = false;
   }
 
-  *output = compressed_size;
-  return true;
-}
-
-}  // namespace
-
-bool GetGzippedSize(const std::string& input, int* output) {
-  z_stream c_stream; /* compression stream */
-  c_stream.zalloc = (alloc_func)0;
-  c_stream.zfree = (free_func)0;
-  c_stream.opaque = (voidpf)0;
-
   int err = deflateInit2(
-      &c_stream,
-      Z_DEFAULT_COMPRESSION,
+      &c_stream_,
+      level_,
       Z_DEFLATED,
       31,  // window size of 15, plus 16 for gzip
       8,   // default mem level (no zlib constant exists for this value)
@@ -223,25 +246,99 @@ bool GetGzippedSize(const std::string& input, int* output) {
     LOG(INFO) << "Failed to deflateInit2: " << err;
     return false;
   }
+  initialized_ = true;
+  return true;
+}
+
+bool SizeOnlyDeflater::GetCompressedSize(const base::StringPiece& input,
+                                         int* output) {
+  if (!Reset()) {
+    return false;
+  }
 
-  c_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
-  c_stream.avail_in = input.size();
+  c_stream_.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+  c_stream_.avail_in = input.size();
 
+  int err = Z_OK;
   int compressed_size = 0;
-  bool ok = GetGzippedSizeFromCStream(&c_stream, &compressed_size);
+  while (err != Z_STREAM_END) {
+    c_stream_.next_out = reinterpret_cast<Bytef*>(buffer_);
+    c_stream_.avail_out = kBufferSize;
+    err = deflate(&c_stream_, Z_FINISH);
+    if (err != Z_OK && err != Z_STREAM_END) {
+      LOG(INFO) << "GetCompressedSize encountered error: " << err;
+      return false;
+    }
+    compressed_size += (kBufferSize - c_stream_.avail_out);
+  }
 
-  // clean up.
-  err = deflateEnd(&c_stream);
-  if (err != Z_OK) {
-    LOG(INFO) << "Failed to deflateEnd: " << err;
-    return false;
+  *output = compressed_size;
+  return true;
+}
+
+// The idle SizeOnlyDeflaters for each level. Rules compute compressed
+// sizes from several threads at once, so each computation takes a
+// deflater from the pool for its duration, and there are never more
+// deflaters than computations that ran concurrently.
+class DeflaterPool {
+ public:
+  DeflaterPool() {}
+
+  SizeOnlyDeflater* Acquire(int level) {
+    {
+      base::AutoLock lock(lock_);
+      std::vector<SizeOnlyDeflater*>& idle = idle_deflaters_[level];
+      if (!idle.empty()) {
+        SizeOnlyDeflater* deflater = idle.back();
+        idle.pop_back();
+        return deflater;
+      }
+    }
+    return new SizeOnlyDeflater(level);
   }
 
-  if (!ok) {
-    return false;
+  void Release(SizeOnlyDeflater* deflater) {
+    base::AutoLock lock(lock_);
+    idle_deflaters_[deflater->level()].push_back(deflater);
   }
 
-  *output = compressed_size;
+ private:
+  base::Lock lock_;
+  std::map<int, std::vector<SizeOnlyDeflater*> > idle_deflaters_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeflaterPool);
+};
+
+base::LazyInstance<DeflaterPool>::Leaky g_deflater_pool =
+    LAZY_INSTANCE_INITIALIZER;
+
+bool GetGzippedSizeAtLevel(const base::StringPiece& input,
+                           int level,
+                           int* output) {
+  DeflaterPool* pool = g_deflater_pool.Pointer();
+  SizeOnlyDeflater* deflater = pool->Acquire(level);
+  bool ok = deflater->GetCompressedSize(input, output);
+  pool->Release(deflater);
+  return ok;
+}
+
+}  // namespace
+
+bool GetGzippedSize(const base::StringPiece& input, int* output) {
+  return GetGzippedSizeAtLevel(input, kGzipLevel, output);
+}
+
+bool EstimateGzippedSize(const base::StringPiece& input, int* output) {
+  if (input.size() < kMinEstimatedInputSize) {
+    return GetGzippedSize(input, output);
+  }
+  int compressed_size = 0;
+  if (!GetGzippedSizeAtLevel(input, kEstimateGzipLevel, &compressed_size)) {
+    return false;
+  }
+  *output = static_cast<int>(
+      static_cast<int64>(compressed_size) * kEstimateGzipSizePercent / 100);
   return true;
 }
 
@@ -386,7 +483,7 @@ std::string GetRedirectedUrl(const Resource& resource) {
     return "";
   }
 
-  const std::string& location = resource.GetResponseHeader("Location");
+  const std::string& location = resource.GetResponseHeader(HEADER_LOCATION);
   if (location.empty()) {
     // No Location header, so unable to compute redirect.
     return "";
@@ -492,7 +589,7 @@ bool IsLikelyTrackingPixel(const PagespeedInput& input,
     return false;
   }
 
-  if (resource.GetResponseBody().length() == 0) {
+  if (resource.GetResponseBodyPiece().length() == 0) {
     // An image resource with no body is almost certainly being used
     // for tracking.
     return true;
@@ -19,6 +19,7 @@
 #include <string>
 
 #include "base/basictypes.h"
+#include "base/string_piece.h"
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/string_util.h"
 
@@ -48,7 +49,13 @@ bool IsCompressedResource(const Resource& resource);
 
 // Determine the size of a string after being gzipped.  In case of error,
 // return false and make no change to *output.
-bool GetGzippedSize(const std::string& input, int* output);
+bool GetGzippedSize(const base::StringPiece& input, int* output);
+
+// Like GetGzippedSize, but compress at a faster level and scale the
+// result to approximate the size at the level GetGzippedSize uses.
+// This is more than twice as fast for large inputs, but is only
+// accurate to within about 10% for typical text resources.
+bool EstimateGzippedSize(const base::StringPiece& input, int* output);
 
 // Parse directives from the given HTTP header.
 // For instance, if Cache-Control contains "private, max-age=0" we
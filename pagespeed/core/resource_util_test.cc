@@ -411,6 +411,44 @@ TEST_F(ResourceUtilTest, ErrorStatusCodes) {
   ASSERT_TRUE(resource_util::IsErrorResourceStatusCode(503));
 }
 
+TEST_F(ResourceUtilTest, GetGzippedSize) {
+  int size = 0;
+  ASSERT_TRUE(resource_util::GetGzippedSize(std::string(1000, 'a'), &size));
+  // NOTE: this size can change if we change the gzip compression
+  // implementation.
+  EXPECT_EQ(29, size);
+
+  // Compressing other inputs in between must not affect the result.
+  int other_size = 0;
+  ASSERT_TRUE(resource_util::GetGzippedSize("", &other_size));
+  EXPECT_EQ(20, other_size);
+  ASSERT_TRUE(resource_util::GetGzippedSize(std::string(100000, 'b'),
+                                            &other_size));
+  ASSERT_TRUE(resource_util::GetGzippedSize(std::string(1000, 'a'),
+                                            &other_size));
+  EXPECT_EQ(size, other_size);
+}
+
+TEST_F(ResourceUtilTest, EstimateGzippedSize) {
+  // Small inputs are not estimated.
+  int size = 0;
+  ASSERT_TRUE(resource_util::EstimateGzippedSize(std::string(1000, 'a'),
+                                                 &size));
+  EXPECT_EQ(29, size);
+
+  std::string script;
+  for (int i = 0; i < 2000; ++i) {
+    script += "var v" + IntToString(i) + " = f(" + IntToString(i * i % 997) +
+        ", 'x" + IntToString(i * 31 % 101) + "');\n";
+  }
+  int exact_size = 0;
+  ASSERT_TRUE(resource_util::GetGzippedSize(script, &exact_size));
+  int estimated_size = 0;
+  ASSERT_TRUE(resource_util::EstimateGzippedSize(script, &estimated_size));
+  EXPECT_GT(estimated_size, exact_size * 85 / 100);
+  EXPECT_LT(estimated_size, exact_size * 115 / 100);
+}
+
 TEST_F(ResourceUtilTest, EstimateRequestBytesHost) {
   const char* kExpectedRequestHeaders =
       "GET / HTTP/1.1\r\nHost:www.example.com\r\n\r\n";
@@ -17,7 +17,12 @@
 #include <algorithm>
 #include "base/basictypes.h"
 #include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "pagespeed/core/dom.h"
+#include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource_util.h"
+#include "pagespeed/core/result_provider.h"
+#include "pagespeed/core/rule_input.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
 
 namespace pagespeed {
@@ -158,8 +163,62 @@ void Rule::AppendRuleGroups(
   out->push_back(FormattedRuleResults::SPEED);
 }
 
+void Rule::AppendTimelineRecordTypes(
+    std::vector<InstrumentationData::RecordType>* out) const {
+}
+
 bool Rule::IsExperimental() const {
   return false;
 }
 
+bool Rule::IsResourceLocal() const {
+  return false;
+}
+
+std::string Rule::GetConfigurationFingerprint() const {
+  return "";
+}
+
+bool Rule::AppendResultsForResource(const RuleInput& input,
+                                    const Resource& resource,
+                                    ResultProvider* result_provider) {
+  LOG(DFATAL) << "AppendResultsForResource not implemented for " << name();
+  return false;
+}
+
+DomTraversalVisitor* Rule::NewDomVisitor(
+    const RuleInput& input, ResultProvider* result_provider) const {
+  return NULL;
+}
+
+bool Rule::DomVisitorUsesImageDimensions() const {
+  return false;
+}
+
+void Rule::AppendDomVisitorResults(const RuleInput& input,
+                                   ResultProvider* result_provider) const {
+  const RuleResults* dom_results = input.GetDomVisitorResults(*this);
+  if (dom_results != NULL) {
+    for (int i = 0, end = dom_results->results_size(); i < end; ++i) {
+      Result* result = result_provider->NewResult();
+      const int id = result->id();
+      result->CopyFrom(dom_results->results(i));
+      result->set_id(id);
+    }
+    return;
+  }
+
+  const DomDocument* document = input.pagespeed_input().dom_document();
+  if (document == NULL) {
+    return;
+  }
+  scoped_ptr<DomTraversalVisitor> visitor(
+      NewDomVisitor(input, result_provider));
+  if (visitor.get() == NULL) {
+    LOG(DFATAL) << "No DOM visitor for " << name();
+    return;
+  }
+  DomTraversal::TraverseWithVisitor(*document, visitor.get());
+}
+
 }  // namespace pagespeed
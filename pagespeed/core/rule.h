@@ -21,9 +21,11 @@
 #include "pagespeed/core/input_capabilities.h"
 #include "pagespeed/l10n/user_facing_string.h"
 #include "pagespeed/proto/pagespeed_proto_formatter.pb.h"
+#include "pagespeed/proto/timeline.pb.h"
 
 namespace pagespeed {
 
+class DomTraversalVisitor;
 class InputInformation;
 class Resource;
 class Result;
@@ -67,6 +69,54 @@ class Rule {
   virtual bool AppendResults(const RuleInput& input,
                              ResultProvider* result_provider) = 0;
 
+  // Whether the results this rule generates for each resource depend
+  // only on that resource (see RuleInput::GetResourceContentHash), and
+  // AppendResults generates exactly the results AppendResultsForResource
+  // generates for each resource, in resource order. This allows the
+  // Engine to reuse results for resources that have not changed since
+  // a previous run (see ResourceResultCache). Return false by default.
+  virtual bool IsResourceLocal() const;
+
+  // Get a string identifying the options this rule was constructed
+  // with that affect the results it generates (such as whether it saves
+  // optimized content), so that results cached for one configuration of
+  // a resource-local rule are never reused by another (see
+  // ResourceResultCache::GetKey). Rules must return different strings
+  // for configurations that may generate different results. Return the
+  // empty string by default.
+  virtual std::string GetConfigurationFingerprint() const;
+
+  // Compute results for a single resource and append them to the
+  // results set. Must be implemented by resource-local rules.
+  //
+  // @param input Input to process.
+  // @param resource The resource to process, which is part of input.
+  // @param result_provider
+  // @return true iff the computation was completed without errors.
+  virtual bool AppendResultsForResource(const RuleInput& input,
+                                        const Resource& resource,
+                                        ResultProvider* result_provider);
+
+  // Rules that generate their results from the DOM may return a new
+  // visitor that generates them, using the given provider, as it visits
+  // the input's DOM. The Engine runs the visitors of all such rules in
+  // a single DomTraversal (see RuleInput::TraverseDom), rather than
+  // having each rule walk the DOM separately, and their AppendResults
+  // then calls AppendDomVisitorResults. The visitor runs under a time
+  // budget of its own, and its wall time is included in the rule's
+  // profile (see Engine::set_rule_time_budget_millis and
+  // Engine::set_profile_rules). Return NULL by default.
+  virtual DomTraversalVisitor* NewDomVisitor(
+      const RuleInput& input, ResultProvider* result_provider) const;
+
+  // Whether this rule's DOM visitor asks the RuleInput for the
+  // dimensions of images (see RuleInput::GetImageDimensions). If any
+  // visitor run by TraverseDom does, the dimensions of the input's
+  // images are computed in parallel before the traversal, rather than
+  // decoded one at a time as the visitor reaches each image. Return
+  // false by default.
+  virtual bool DomVisitorUsesImageDimensions() const;
+
   // Interpret the results structure and produce a formatted representation.
   //
   // @param results Results to interpret
@@ -92,6 +142,14 @@ class Rule {
   virtual void AppendRuleGroups(
       std::vector<FormattedRuleResults::RuleGroup>* out) const;
 
+  // Add to the vector the types of the timeline records this rule
+  // inspects, if it uses TIMELINE_DATA. Timeline importers may then drop
+  // records of other types, other than those that contain records of
+  // these types (see timeline::CreateFilteredTimelineProtoFromJsonString).
+  // Adds nothing by default.
+  virtual void AppendTimelineRecordTypes(
+      std::vector<InstrumentationData::RecordType>* out) const;
+
   // Show if the rule is experimental. Return false by default. Any experimental
   // rule must override this method to return true. Experimental rules are new
   // rules that we are trying out, which do not impact the overall score, and
@@ -111,6 +169,13 @@ class Rule {
   virtual double ComputeResultImpact(const InputInformation& input_info,
                                      const Result& result);
 
+  // Append the results generated by this rule's DOM visitor (see
+  // NewDomVisitor): those of the visitor RuleInput::TraverseDom already
+  // ran, if any, or else those of a new visitor, run over the input's
+  // DOM now. Does nothing if the input has no DOM.
+  void AppendDomVisitorResults(const RuleInput& input,
+                               ResultProvider* result_provider) const;
+
  private:
   const InputCapabilities capability_requirements_;
 
@@ -14,55 +14,815 @@
 
 #include "pagespeed/core/rule_input.h"
 
+#include <algorithm>
+#include <vector>
+
+#include "base/lazy_instance.h"
 #include "base/logging.h"
+#include "base/md5.h"
+#include "base/stl_util.h"
+#include "base/threading/thread_local.h"
+#include "base/time.h"
+#include "pagespeed/core/artifact_computer.h"
+#include "pagespeed/core/concurrent_memo.h"
+#include "pagespeed/core/dom.h"
+#include "pagespeed/core/image_attributes.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/resource_util.h"
+#include "pagespeed/core/result_provider.h"
+#include "pagespeed/core/rule.h"
+#include "pagespeed/core/string_util.h"
+#include "pagespeed/core/thread_pool.h"
+#include "pagespeed/proto/pagespeed_output.pb.h"
+#include "pagespeed/util/deadline.h"
+
+namespace {
+
+using pagespeed::Deadline;
+using pagespeed::string_util::IntToString;
+
+// The deadline of the rule running on each thread. See
+// RuleInput::ScopedDeadline.
+base::LazyInstance<base::ThreadLocalPointer<const Deadline> >::Leaky
+    g_rule_deadline = LAZY_INSTANCE_INITIALIZER;
+
+// Runs a rule's DOM visitor for RuleInput::TraverseDom, measuring the
+// wall time spent in its callbacks. If the time budget is positive, the
+// visitor is stopped once it has spent that long.
+class MeteredDomVisitor : public pagespeed::DomTraversalVisitor {
+ public:
+  // Takes ownership of the visitor.
+  MeteredDomVisitor(pagespeed::DomTraversalVisitor* visitor,
+                    base::TimeDelta time_budget)
+      : visitor_(visitor), time_budget_(time_budget), timed_out_(false) {}
+
+  virtual bool EnterDocument(const pagespeed::DomDocument& document,
+                             const pagespeed::DomElement* frame) {
+    const base::TimeTicks start = base::TimeTicks::Now();
+    const bool enter = visitor_->EnterDocument(document, frame);
+    AddElapsedTime(start);
+    return enter;
+  }
+
+  virtual void LeaveDocument(const pagespeed::DomDocument& document) {
+    const base::TimeTicks start = base::TimeTicks::Now();
+    visitor_->LeaveDocument(document);
+    AddElapsedTime(start);
+  }
+
+  virtual void Visit(const pagespeed::DomElement& node) {
+    const base::TimeTicks start = base::TimeTicks::Now();
+    visitor_->Visit(node);
+    AddElapsedTime(start);
+  }
+
+  virtual bool IsDone() const {
+    return timed_out_ || visitor_->IsDone();
+  }
+
+  base::TimeDelta elapsed() const { return elapsed_; }
+  bool timed_out() const { return timed_out_; }
+
+ private:
+  void AddElapsedTime(base::TimeTicks start) {
+    elapsed_ += base::TimeTicks::Now() - start;
+    if (time_budget_ > base::TimeDelta() && elapsed_ >= time_budget_ &&
+        !visitor_->IsDone()) {
+      timed_out_ = true;
+    }
+  }
+
+  scoped_ptr<pagespeed::DomTraversalVisitor> visitor_;
+  const base::TimeDelta time_budget_;
+  base::TimeDelta elapsed_;
+  bool timed_out_;
+
+  DISALLOW_COPY_AND_ASSIGN(MeteredDomVisitor);
+};
+
+struct ArtifactSize {
+  ArtifactSize() : success(false), size(0) {}
+
+  bool success;
+  int size;
+};
+
+struct MinifiedContent {
+  MinifiedContent() : success(false) {}
+
+  bool success;
+  std::string content;
+};
+
+struct ContentHash {
+  ContentHash() : success(false) {}
+
+  bool success;
+  std::string hash;
+};
+
+struct ImageDimensions {
+  ImageDimensions() : success(false), width(0), height(0) {}
+
+  bool success;
+  int width;
+  int height;
+};
+
+bool ComputeGzippedSize(const base::StringPiece& content,
+                        bool estimate,
+                        int* output) {
+  return estimate ?
+      ::pagespeed::resource_util::EstimateGzippedSize(content, output) :
+      ::pagespeed::resource_util::GetGzippedSize(content, output);
+}
+
+bool NeedsCompression(const pagespeed::Resource& resource) {
+  return ::pagespeed::resource_util::IsCompressibleResource(resource) ||
+      ::pagespeed::resource_util::IsCompressedResource(resource);
+}
+
+bool ComputeCompressedResponseBodySize(const pagespeed::Resource& resource,
+                                       bool estimate,
+                                       int* output) {
+  // Compute the compressed size of the resource (or original size if the
+  // resource is not compressible).
+  if (NeedsCompression(resource)) {
+    return ComputeGzippedSize(resource.GetResponseBodyPiece(), estimate,
+                              output);
+  }
+  *output = resource.GetResponseBodyPiece().size();
+  return true;
+}
+
+void ComputeCompressedSize(const pagespeed::RuleInput& rule_input,
+                           const pagespeed::Resource& resource,
+                           const Deadline* deadline,
+                           ArtifactSize* output) {
+  output->success =
+      ComputeCompressedResponseBodySize(resource, false, &output->size);
+}
+
+void ComputeEstimatedCompressedSize(const pagespeed::RuleInput& rule_input,
+                                    const pagespeed::Resource& resource,
+                                    const Deadline* deadline,
+                                    ArtifactSize* output) {
+  output->success =
+      ComputeCompressedResponseBodySize(resource, true, &output->size);
+}
+
+// Get the ArtifactComputer of the given RuleInput, or NULL, logging
+// an error, if it was not given one.
+const pagespeed::ArtifactComputer* GetArtifactComputer(
+    const pagespeed::RuleInput& rule_input) {
+  const pagespeed::ArtifactComputer* computer =
+      rule_input.artifact_computer();
+  if (computer == NULL) {
+    LOG(DFATAL) << "No ArtifactComputer set on RuleInput.";
+  }
+  return computer;
+}
+
+void ComputeMinifiedJavaScript(const pagespeed::RuleInput& rule_input,
+                               const pagespeed::Resource& resource,
+                               const Deadline* deadline,
+                               MinifiedContent* output) {
+  const pagespeed::ArtifactComputer* computer =
+      GetArtifactComputer(rule_input);
+  output->success = computer != NULL &&
+      computer->MinifyJavaScript(resource, deadline, &output->content);
+  if (!output->success) {
+    output->content.clear();
+  }
+}
+
+void ComputeMinifiedJavaScriptSize(const pagespeed::RuleInput& rule_input,
+                                   const pagespeed::Resource& resource,
+                                   const Deadline* deadline,
+                                   ArtifactSize* output) {
+  const pagespeed::ArtifactComputer* computer =
+      GetArtifactComputer(rule_input);
+  output->success = computer != NULL &&
+      computer->GetMinifiedJavaScriptSize(resource, deadline, &output->size);
+}
+
+void ComputeStringCollapsedJavaScriptSize(
+    const pagespeed::RuleInput& rule_input,
+    const pagespeed::Resource& resource,
+    const Deadline* deadline,
+    ArtifactSize* output) {
+  const pagespeed::ArtifactComputer* computer =
+      GetArtifactComputer(rule_input);
+  output->success = computer != NULL &&
+      computer->GetStringCollapsedMinifiedJavaScriptSize(
+          resource, deadline, &output->size);
+}
+
+void ComputeMinifiedCss(const pagespeed::RuleInput& rule_input,
+                        const pagespeed::Resource& resource,
+                        const Deadline* deadline,
+                        MinifiedContent* output) {
+  const pagespeed::ArtifactComputer* computer =
+      GetArtifactComputer(rule_input);
+  output->success = computer != NULL &&
+      computer->MinifyCss(resource, deadline, &output->content);
+  if (!output->success) {
+    output->content.clear();
+  }
+}
+
+void ComputeMinifiedCssSize(const pagespeed::RuleInput& rule_input,
+                            const pagespeed::Resource& resource,
+                            const Deadline* deadline,
+                            ArtifactSize* output) {
+  const pagespeed::ArtifactComputer* computer =
+      GetArtifactComputer(rule_input);
+  output->success = computer != NULL &&
+      computer->GetMinifiedCssSize(resource, deadline, &output->size);
+}
+
+void ComputeMinifiedHtml(const pagespeed::RuleInput& rule_input,
+                         const pagespeed::Resource& resource,
+                         const Deadline* deadline,
+                         MinifiedContent* output) {
+  const pagespeed::ArtifactComputer* computer =
+      GetArtifactComputer(rule_input);
+  output->success = computer != NULL &&
+      computer->MinifyHtml(resource, deadline, &output->content);
+  if (!output->success) {
+    output->content.clear();
+  }
+}
+
+void ComputeImageDimensions(const pagespeed::RuleInput& rule_input,
+                            const pagespeed::Resource& resource,
+                            const Deadline* deadline,
+                            ImageDimensions* output) {
+  scoped_ptr<pagespeed::ImageAttributes> image_attributes(
+      rule_input.pagespeed_input().NewImageAttributes(&resource));
+  if (image_attributes == NULL) {
+    return;
+  }
+  output->success = true;
+  output->width = image_attributes->GetImageWidth();
+  output->height = image_attributes->GetImageHeight();
+}
+
+// Add the given field to the MD5 context, prefixed with its length, so
+// that distinct sequences of fields never hash the same input.
+void AddHashField(base::MD5Context* context, const base::StringPiece& field) {
+  const std::string length = IntToString(field.size());
+  base::MD5Update(context, length);
+  base::MD5Update(context, ":");
+  base::MD5Update(context, field);
+}
+
+void AddHashHeaders(base::MD5Context* context,
+                    const pagespeed::Resource::HeaderMap& headers) {
+  AddHashField(context, IntToString(headers.size()));
+  for (pagespeed::Resource::HeaderMap::const_iterator it = headers.begin(),
+           end = headers.end();
+       it != end;
+       ++it) {
+    AddHashField(context, it->name());
+    AddHashField(context, it->value());
+  }
+}
+
+void ComputeContentHash(const pagespeed::RuleInput& rule_input,
+                        const pagespeed::Resource& resource,
+                        const Deadline* deadline,
+                        ContentHash* output) {
+  base::MD5Context context;
+  base::MD5Init(&context);
+  AddHashField(&context, resource.GetRequestUrl());
+  AddHashField(&context, resource.GetRequestMethod());
+  AddHashHeaders(&context, *resource.GetRequestHeaders());
+  AddHashField(&context, resource.GetRequestBody());
+  AddHashField(&context, IntToString(resource.GetResponseStatusCode()));
+  AddHashHeaders(&context, *resource.GetResponseHeaders());
+  AddHashField(&context, resource.GetResponseBodyPiece());
+  AddHashField(&context, IntToString(resource.GetResourceType()));
+  AddHashField(&context, resource.IsResponseBodyModified() ? "1" : "0");
+  base::MD5Digest digest;
+  base::MD5Final(&digest, &context);
+  output->success = true;
+  output->hash = base::MD5DigestToBase16(digest);
+}
+
+// Get the value held by the given memo, computing it with the given
+// function first if needed. Sets *hit to whether the value had already
+// been computed (possibly by another thread). Returns NULL if the given
+// deadline expired, either during the computation or while waiting for
+// another thread to finish it; such failures are not memoized, since
+// another rule with more time to spare may succeed.
+template <typename T>
+const T* GetOrComputeArtifact(
+    pagespeed::ConcurrentMemo<T>* memo,
+    void (*compute)(const pagespeed::RuleInput&,
+                    const pagespeed::Resource&,
+                    const Deadline*,
+                    T*),
+    const pagespeed::RuleInput& rule_input,
+    const pagespeed::Resource& resource,
+    const Deadline* deadline,
+    bool* hit) {
+  const T* value = memo->Get();
+  if (value != NULL) {
+    *hit = true;
+    return value;
+  }
+  if (!memo->TryBeginCompute(deadline)) {
+    // Either another thread published the value, or the deadline
+    // expired while we waited for it to.
+    value = memo->Get();
+    *hit = value != NULL;
+    return value;
+  }
+  *hit = false;
+  T* mutable_value = memo->mutable_value();
+  compute(rule_input, resource, deadline, mutable_value);
+  if (!mutable_value->success && Deadline::IsExpired(deadline)) {
+    memo->AbandonCompute();
+    return NULL;
+  }
+  memo->Publish();
+  return memo->Get();
+}
+
+// Get the size of a resource's minified content: from the content
+// memo, if the content has already been computed, or else from the
+// size memo, computing just the size if needed. Sets *hit as
+// GetOrComputeArtifact does. Returns true on success.
+bool GetOrComputeMinifiedSize(
+    const pagespeed::ConcurrentMemo<MinifiedContent>& content_memo,
+    pagespeed::ConcurrentMemo<ArtifactSize>* size_memo,
+    void (*compute_size)(const pagespeed::RuleInput&,
+                         const pagespeed::Resource&,
+                         const Deadline*,
+                         ArtifactSize*),
+    const pagespeed::RuleInput& rule_input,
+    const pagespeed::Resource& resource,
+    bool* hit,
+    int* output) {
+  const MinifiedContent* content = content_memo.Get();
+  if (content != NULL) {
+    *hit = true;
+    if (!content->success) {
+      return false;
+    }
+    *output = content->content.size();
+    return true;
+  }
+  const ArtifactSize* size = GetOrComputeArtifact(
+      size_memo, compute_size, rule_input, resource, rule_input.deadline(),
+      hit);
+  if (size == NULL || !size->success) {
+    return false;
+  }
+  *output = size->size;
+  return true;
+}
+
+// Orders resources by how expensive their compressed sizes are to
+// compute: resources whose bodies must be compressed come first,
+// largest first, followed by the rest, whose size is just the size of
+// their body.
+struct CompressionCostGreaterThan {
+  bool operator() (const pagespeed::Resource* lhs,
+                   const pagespeed::Resource* rhs) const {
+    const bool lhs_needs_compression = NeedsCompression(*lhs);
+    const bool rhs_needs_compression = NeedsCompression(*rhs);
+    if (lhs_needs_compression != rhs_needs_compression) {
+      return lhs_needs_compression;
+    }
+    return lhs->GetResponseBodyPiece().size() >
+        rhs->GetResponseBodyPiece().size();
+  }
+};
+
+// ParallelTask that populates the compressed size memo for each of the
+// given resources. ThreadPool starts tasks in index order, and the
+// resources are sorted by CompressionCostGreaterThan, so that no thread
+// is left compressing a large body after the others have finished.
+class PopulateCompressedSizesTask : public pagespeed::ParallelTask {
+ public:
+  PopulateCompressedSizesTask(
+      const pagespeed::RuleInput& rule_input,
+      const std::vector<const pagespeed::Resource*>& resources)
+      : rule_input_(rule_input),
+        resources_(resources) {}
+
+  virtual void RunTask(int task_index) {
+    int compressed_size = 0;
+    rule_input_.GetCompressedResponseBodySize(*resources_[task_index],
+                                              &compressed_size);
+  }
+
+ private:
+  const pagespeed::RuleInput& rule_input_;
+  const std::vector<const pagespeed::Resource*>& resources_;
+
+  DISALLOW_COPY_AND_ASSIGN(PopulateCompressedSizesTask);
+};
+
+// Orders resources by decreasing response body size, so that the
+// largest images, which are usually the slowest to decode, are started
+// first.
+struct ResponseBodySizeGreaterThan {
+  bool operator() (const pagespeed::Resource* lhs,
+                   const pagespeed::Resource* rhs) const {
+    return lhs->GetResponseBodyPiece().size() >
+        rhs->GetResponseBodyPiece().size();
+  }
+};
+
+// ParallelTask that populates the image dimension memo for each of the
+// given image resources.
+class PopulateImageDimensionsTask : public pagespeed::ParallelTask {
+ public:
+  PopulateImageDimensionsTask(
+      const pagespeed::RuleInput& rule_input,
+      const std::vector<const pagespeed::Resource*>& resources)
+      : rule_input_(rule_input),
+        resources_(resources) {}
+
+  virtual void RunTask(int task_index) {
+    int width = 0;
+    int height = 0;
+    rule_input_.GetImageDimensions(*resources_[task_index], &width, &height);
+  }
+
+ private:
+  const pagespeed::RuleInput& rule_input_;
+  const std::vector<const pagespeed::Resource*>& resources_;
+
+  DISALLOW_COPY_AND_ASSIGN(PopulateImageDimensionsTask);
+};
+
+}  // namespace
 
 namespace pagespeed {
 
+RuleInput::ScopedDeadline::ScopedDeadline(const Deadline* deadline)
+    : previous_deadline_(g_rule_deadline.Pointer()->Get()) {
+  g_rule_deadline.Pointer()->Set(deadline);
+}
+
+RuleInput::ScopedDeadline::~ScopedDeadline() {
+  g_rule_deadline.Pointer()->Set(previous_deadline_);
+}
+
+struct RuleInput::ResourceArtifacts {
+  ConcurrentMemo<ArtifactSize> compressed_size;
+  ConcurrentMemo<MinifiedContent> minified_javascript;
+  ConcurrentMemo<ArtifactSize> minified_javascript_size;
+  ConcurrentMemo<ArtifactSize> string_collapsed_javascript_size;
+  ConcurrentMemo<MinifiedContent> minified_css;
+  ConcurrentMemo<ArtifactSize> minified_css_size;
+  ConcurrentMemo<MinifiedContent> minified_html;
+  ConcurrentMemo<ImageDimensions> image_dimensions;
+  ConcurrentMemo<ContentHash> content_hash;
+};
+
 RuleInput::RuleInput(const PagespeedInput& pagespeed_input)
     : pagespeed_input_(&pagespeed_input),
+      artifact_computer_(NULL),
+      artifacts_(new ResourceArtifacts[pagespeed_input.num_resources()]),
+      num_threads_(1),
+      estimate_compressed_sizes_(false),
+      dom_visitor_time_budget_millis_(0),
+      profile_dom_visitors_(false),
       initialized_(false) {
   if (!pagespeed_input_->is_frozen()) {
     LOG(DFATAL) << "Passed non-frozen PagespeedInput to RuleInput.";
   }
+  for (int i = 0; i < NUM_ARTIFACT_KINDS; ++i) {
+    artifact_cache_hits_[i] = 0;
+    artifact_cache_misses_[i] = 0;
+  }
+}
+
+RuleInput::~RuleInput() {
+  STLDeleteValues(&dom_visitor_results_);
 }
 
 void RuleInput::Init() {
-  if (!initialized_) {
-    initialized_ = true;
+  if (initialized_) {
+    return;
+  }
+  initialized_ = true;
+
+  if (num_threads_ > 1) {
+    // Compute the compressed sizes of all resources up front, so the
+    // cost is spread across threads instead of being paid by whichever
+    // rule happens to ask first.
+    std::vector<const Resource*> resources;
+    resources.reserve(pagespeed_input_->num_resources());
+    for (int i = 0, num = pagespeed_input_->num_resources(); i < num; ++i) {
+      resources.push_back(&pagespeed_input_->GetResource(i));
+    }
+    std::stable_sort(resources.begin(), resources.end(),
+                     CompressionCostGreaterThan());
+    PopulateCompressedSizesTask task(*this, resources);
+    ThreadPool thread_pool(num_threads_);
+    thread_pool.Run(&task, static_cast<int>(resources.size()));
   }
 }
 
+void RuleInput::TraverseDom(const std::vector<const Rule*>& rules) {
+  DCHECK(initialized_);
+  const DomDocument* document = pagespeed_input_->dom_document();
+  if (document == NULL) {
+    return;
+  }
+
+  // Each visitor adds its results to a RuleResults of its own, from
+  // which Rule::AppendDomVisitorResults later copies them. Visitors are
+  // only metered when needed, since that reads the clock on every
+  // callback.
+  const bool metered =
+      dom_visitor_time_budget_millis_ > 0 || profile_dom_visitors_;
+  const base::TimeDelta time_budget =
+      base::TimeDelta::FromMilliseconds(dom_visitor_time_budget_millis_);
+  std::vector<const Rule*> visitor_rules;
+  std::vector<ResultProvider*> providers;
+  std::vector<DomTraversalVisitor*> visitors;
+  bool uses_image_dimensions = false;
+  DomTraversal traversal;
+  for (std::vector<const Rule*>::const_iterator it = rules.begin(),
+           end = rules.end(); it != end; ++it) {
+    const Rule* rule = *it;
+    if (dom_visitor_results_.find(rule) != dom_visitor_results_.end()) {
+      continue;
+    }
+    RuleResults* rule_results = new RuleResults();
+    ResultProvider* provider = new ResultProvider(*rule, rule_results, 0);
+    DomTraversalVisitor* visitor = rule->NewDomVisitor(*this, provider);
+    if (visitor == NULL) {
+      delete provider;
+      delete rule_results;
+      continue;
+    }
+    if (metered) {
+      visitor = new MeteredDomVisitor(visitor, time_budget);
+    }
+    dom_visitor_results_[rule] = rule_results;
+    uses_image_dimensions =
+        uses_image_dimensions || rule->DomVisitorUsesImageDimensions();
+    visitor_rules.push_back(rule);
+    providers.push_back(provider);
+    visitors.push_back(visitor);
+    traversal.AddVisitor(visitor);
+  }
+  if (!traversal.empty()) {
+    // The traversal itself is serial, so decode the images the visitors
+    // need up front, spread across threads, instead of one at a time as
+    // the visitors reach them.
+    if (uses_image_dimensions && num_threads_ > 1) {
+      PopulateImageDimensions();
+    }
+    traversal.Traverse(*document);
+  }
+  if (metered) {
+    for (size_t i = 0; i < visitors.size(); ++i) {
+      const MeteredDomVisitor* visitor =
+          static_cast<const MeteredDomVisitor*>(visitors[i]);
+      const Rule* rule = visitor_rules[i];
+      if (visitor->timed_out()) {
+        timed_out_dom_visitors_.insert(rule);
+      }
+      if (profile_dom_visitors_) {
+        RuleTiming* timing = dom_visitor_results_[rule]->mutable_timing();
+        timing->set_name(rule->name());
+        timing->set_wall_time_millis(visitor->elapsed().InMillisecondsF());
+      }
+    }
+  }
+  STLDeleteElements(&visitors);
+  STLDeleteElements(&providers);
+}
+
+void RuleInput::PopulateImageDimensions() const {
+  std::vector<const Resource*> images;
+  for (int i = 0, num = pagespeed_input_->num_resources(); i < num; ++i) {
+    const Resource& resource = pagespeed_input_->GetResource(i);
+    if (resource.GetResourceType() == IMAGE) {
+      images.push_back(&resource);
+    }
+  }
+  std::stable_sort(images.begin(), images.end(),
+                   ResponseBodySizeGreaterThan());
+  PopulateImageDimensionsTask task(*this, images);
+  ThreadPool thread_pool(num_threads_);
+  thread_pool.Run(&task, static_cast<int>(images.size()));
+}
+
+const RuleResults* RuleInput::GetDomVisitorResults(const Rule& rule) const {
+  std::map<const Rule*, RuleResults*>::const_iterator it =
+      dom_visitor_results_.find(&rule);
+  return it == dom_visitor_results_.end() ? NULL : it->second;
+}
+
+bool RuleInput::DomVisitorTimedOut(const Rule& rule) const {
+  return timed_out_dom_visitors_.count(&rule) != 0;
+}
+
+const Deadline* RuleInput::deadline() const {
+  return g_rule_deadline.Pointer()->Get();
+}
+
+int RuleInput::GetResourceIndex(const Resource& resource) const {
+  const int index = resource.GetResourceIndex();
+  if (index < 0 || index >= pagespeed_input_->num_resources() ||
+      &pagespeed_input_->GetResource(index) != &resource) {
+    return -1;
+  }
+  return index;
+}
+
+RuleInput::ResourceArtifacts* RuleInput::GetResourceArtifacts(
+    const Resource& resource) const {
+  const int index = GetResourceIndex(resource);
+  if (index < 0) {
+    LOG(DFATAL) << "Resource " << resource.GetRequestUrl()
+                << " is not part of the PagespeedInput.";
+    return NULL;
+  }
+  return &artifacts_[index];
+}
+
+void RuleInput::RecordArtifactLookup(ArtifactKind kind, bool hit) const {
+  base::subtle::NoBarrier_AtomicIncrement(
+      hit ? &artifact_cache_hits_[kind] : &artifact_cache_misses_[kind], 1);
+}
+
+int RuleInput::GetArtifactCacheHits(ArtifactKind kind) const {
+  return base::subtle::NoBarrier_Load(&artifact_cache_hits_[kind]);
+}
+
+int RuleInput::GetArtifactCacheMisses(ArtifactKind kind) const {
+  return base::subtle::NoBarrier_Load(&artifact_cache_misses_[kind]);
+}
+
 bool RuleInput::GetCompressedResponseBodySize(const Resource& resource,
                                               int* output) const {
-  // If the compressed size for this resource is already in the map, return
-  // that memoized value.
-  const std::map<const Resource*, int>::const_iterator iter =
-      compressed_response_body_sizes_.find(&resource);
-  if (iter != compressed_response_body_sizes_.end()) {
-    *output = iter->second;
-    return true;
+  ResourceArtifacts* artifacts = GetResourceArtifacts(resource);
+  if (artifacts == NULL) {
+    return ComputeCompressedResponseBodySize(
+        resource, estimate_compressed_sizes_, output);
   }
 
-  // Compute the compressed size of the resource (or original size if the
-  // resource is not compressible).
-  int compressed_size;
-  if (::pagespeed::resource_util::IsCompressibleResource(resource) ||
-      ::pagespeed::resource_util::IsCompressedResource(resource)) {
-    if (!::pagespeed::resource_util::GetGzippedSize(
-            resource.GetResponseBody(), &compressed_size)) {
-      return false;
-    }
-  } else {
-    compressed_size = resource.GetResponseBody().size();
+  bool hit = false;
+  const ArtifactSize* compressed_size = GetOrComputeArtifact(
+      &artifacts->compressed_size,
+      estimate_compressed_sizes_ ?
+          &ComputeEstimatedCompressedSize : &ComputeCompressedSize,
+      *this, resource, deadline(), &hit);
+  RecordArtifactLookup(COMPRESSED_SIZE, hit);
+  if (compressed_size == NULL || !compressed_size->success) {
+    return false;
+  }
+  *output = compressed_size->size;
+  return true;
+}
+
+bool RuleInput::GetCompressedSize(const base::StringPiece& content,
+                                  int* output) const {
+  return ComputeGzippedSize(content, estimate_compressed_sizes_, output);
+}
+
+const std::string* RuleInput::GetMinifiedJavaScript(
+    const Resource& resource) const {
+  ResourceArtifacts* artifacts = GetResourceArtifacts(resource);
+  if (artifacts == NULL) {
+    return NULL;
+  }
+
+  bool hit = false;
+  const MinifiedContent* minified = GetOrComputeArtifact(
+      &artifacts->minified_javascript, &ComputeMinifiedJavaScript,
+      *this, resource, deadline(), &hit);
+  RecordArtifactLookup(MINIFIED_JAVASCRIPT, hit);
+  return minified != NULL && minified->success ? &minified->content : NULL;
+}
+
+bool RuleInput::GetMinifiedJavaScriptSize(const Resource& resource,
+                                          int* output) const {
+  ResourceArtifacts* artifacts = GetResourceArtifacts(resource);
+  if (artifacts == NULL) {
+    return false;
+  }
+
+  bool hit = false;
+  const bool success = GetOrComputeMinifiedSize(
+      artifacts->minified_javascript, &artifacts->minified_javascript_size,
+      &ComputeMinifiedJavaScriptSize, *this, resource, &hit, output);
+  RecordArtifactLookup(MINIFIED_JAVASCRIPT_SIZE, hit);
+  return success;
+}
+
+bool RuleInput::GetStringCollapsedMinifiedJavaScriptSize(
+    const Resource& resource, int* output) const {
+  ResourceArtifacts* artifacts = GetResourceArtifacts(resource);
+  if (artifacts == NULL) {
+    return false;
+  }
+
+  bool hit = false;
+  const ArtifactSize* size = GetOrComputeArtifact(
+      &artifacts->string_collapsed_javascript_size,
+      &ComputeStringCollapsedJavaScriptSize,
+      *this, resource, deadline(), &hit);
+  RecordArtifactLookup(STRING_COLLAPSED_JAVASCRIPT_SIZE, hit);
+  if (size == NULL || !size->success) {
+    return false;
+  }
+  *output = size->size;
+  return true;
+}
+
+const std::string* RuleInput::GetMinifiedCss(const Resource& resource) const {
+  ResourceArtifacts* artifacts = GetResourceArtifacts(resource);
+  if (artifacts == NULL) {
+    return NULL;
+  }
+
+  bool hit = false;
+  const MinifiedContent* minified = GetOrComputeArtifact(
+      &artifacts->minified_css, &ComputeMinifiedCss,
+      *this, resource, deadline(), &hit);
+  RecordArtifactLookup(MINIFIED_CSS, hit);
+  return minified != NULL && minified->success ? &minified->content : NULL;
+}
+
+bool RuleInput::GetMinifiedCssSize(const Resource& resource,
+                                   int* output) const {
+  ResourceArtifacts* artifacts = GetResourceArtifacts(resource);
+  if (artifacts == NULL) {
+    return false;
   }
 
-  // Memoize and return the compressed size.
-  compressed_response_body_sizes_[&resource] = compressed_size;
-  *output = compressed_size;
+  bool hit = false;
+  const bool success = GetOrComputeMinifiedSize(
+      artifacts->minified_css, &artifacts->minified_css_size,
+      &ComputeMinifiedCssSize, *this, resource, &hit, output);
+  RecordArtifactLookup(MINIFIED_CSS_SIZE, hit);
+  return success;
+}
+
+const std::string* RuleInput::GetMinifiedHtml(const Resource& resource) const {
+  ResourceArtifacts* artifacts = GetResourceArtifacts(resource);
+  if (artifacts == NULL) {
+    return NULL;
+  }
+
+  bool hit = false;
+  const MinifiedContent* minified = GetOrComputeArtifact(
+      &artifacts->minified_html, &ComputeMinifiedHtml,
+      *this, resource, deadline(), &hit);
+  RecordArtifactLookup(MINIFIED_HTML, hit);
+  return minified != NULL && minified->success ? &minified->content : NULL;
+}
+
+bool RuleInput::GetImageDimensions(const Resource& resource,
+                                   int* out_width,
+                                   int* out_height) const {
+  ResourceArtifacts* artifacts = GetResourceArtifacts(resource);
+  if (artifacts == NULL) {
+    return false;
+  }
+
+  bool hit = false;
+  const ImageDimensions* dimensions = GetOrComputeArtifact(
+      &artifacts->image_dimensions, &ComputeImageDimensions,
+      *this, resource, deadline(), &hit);
+  RecordArtifactLookup(IMAGE_DIMENSIONS, hit);
+  if (dimensions == NULL || !dimensions->success) {
+    return false;
+  }
+  *out_width = dimensions->width;
+  *out_height = dimensions->height;
   return true;
 }
 
+const std::string* RuleInput::GetResourceContentHash(
+    const Resource& resource) const {
+  ResourceArtifacts* artifacts = GetResourceArtifacts(resource);
+  if (artifacts == NULL) {
+    return NULL;
+  }
+
+  bool hit = false;
+  const ContentHash* content_hash = GetOrComputeArtifact(
+      &artifacts->content_hash, &ComputeContentHash,
+      *this, resource, deadline(), &hit);
+  RecordArtifactLookup(CONTENT_HASH, hit);
+  if (content_hash == NULL || !content_hash->success) {
+    return NULL;
+  }
+  return &content_hash->hash;
+}
+
 }  // namespace pagespeed
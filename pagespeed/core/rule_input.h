@@ -16,33 +16,240 @@
 #define PAGESPEED_CORE_RULE_INPUT_H_
 
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 
+#include "base/atomicops.h"
 #include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/string_piece.h"
 
 namespace pagespeed {
 
+class ArtifactComputer;
+class Deadline;
 class PagespeedInput;
 class Resource;
+class Rule;
+class RuleResults;
 
 class RuleInput {
  public:
+  // Kinds of per-resource artifacts that RuleInput computes on demand
+  // and caches, so that rules which need the same derived data do not
+  // each recompute it.
+  enum ArtifactKind {
+    COMPRESSED_SIZE,
+    MINIFIED_JAVASCRIPT,
+    MINIFIED_JAVASCRIPT_SIZE,
+    STRING_COLLAPSED_JAVASCRIPT_SIZE,
+    MINIFIED_CSS,
+    MINIFIED_CSS_SIZE,
+    MINIFIED_HTML,
+    IMAGE_DIMENSIONS,
+    CONTENT_HASH,
+    NUM_ARTIFACT_KINDS,
+  };
+
+  // Sets the deadline for the rule running on the calling thread for
+  // the lifetime of this object, restoring the previous deadline on
+  // destruction. The deadline is per-thread rather than per-RuleInput,
+  // since rules that share a RuleInput may run concurrently on
+  // different threads, each with its own time budget.
+  class ScopedDeadline {
+   public:
+    explicit ScopedDeadline(const Deadline* deadline);
+    ~ScopedDeadline();
+
+   private:
+    const Deadline* const previous_deadline_;
+
+    DISALLOW_COPY_AND_ASSIGN(ScopedDeadline);
+  };
+
   explicit RuleInput(const PagespeedInput& pagespeed_input);
+  ~RuleInput();
+
+  // Set the number of threads Init() may use to precompute
+  // per-resource data. Must be called before Init(). With the default
+  // of a single thread, per-resource data is computed lazily, the first
+  // time a rule asks for it.
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
+  // Set whether compressed sizes are estimated with
+  // resource_util::EstimateGzippedSize, rather than computed exactly
+  // with resource_util::GetGzippedSize. Estimating is faster, but the
+  // savings rules report from compressed sizes become approximate. Must
+  // be called before Init().
+  void set_estimate_compressed_sizes(bool estimate) {
+    estimate_compressed_sizes_ = estimate;
+  }
+  bool estimate_compressed_sizes() const { return estimate_compressed_sizes_; }
+
+  // Set the time budget, in milliseconds, of each DOM visitor run by
+  // TraverseDom, or 0 (the default) for no limit. A visitor is charged
+  // for the time spent in its own callbacks, since the visitors of all
+  // rules run interleaved, and is stopped once it has used up its
+  // budget (see DomVisitorTimedOut).
+  void set_dom_visitor_time_budget_millis(int millis) {
+    dom_visitor_time_budget_millis_ = millis;
+  }
+
+  // Set whether TraverseDom measures the wall time each DOM visitor
+  // spends in its callbacks, recording it in the timing of the
+  // visitor's GetDomVisitorResults.
+  void set_profile_dom_visitors(bool profile) {
+    profile_dom_visitors_ = profile;
+  }
+
+  // Set the ArtifactComputer used to compute minified content. The
+  // computer is not owned, and must outlive this RuleInput. Without
+  // one, minified content can not be computed. Must be called before
+  // Init().
+  void set_artifact_computer(const ArtifactComputer* computer) {
+    artifact_computer_ = computer;
+  }
+  const ArtifactComputer* artifact_computer() const {
+    return artifact_computer_;
+  }
+
   void Init();
 
   const PagespeedInput& pagespeed_input() const { return *pagespeed_input_; }
 
+  // Run the DOM visitors of the given rules (see Rule::NewDomVisitor)
+  // in a single DomTraversal of the input's DOM, keeping the results
+  // they generate for GetDomVisitorResults. If more than one thread is
+  // allowed and a visitor uses image dimensions (see
+  // Rule::DomVisitorUsesImageDimensions), those are computed in
+  // parallel first. Must be called after Init(), and before the rules
+  // run.
+  void TraverseDom(const std::vector<const Rule*>& rules);
+
+  // Get the results generated by the given rule's DOM visitor in
+  // TraverseDom, or NULL if TraverseDom did not run it.
+  const RuleResults* GetDomVisitorResults(const Rule& rule) const;
+
+  // Whether TraverseDom stopped the given rule's DOM visitor because it
+  // ran out of time, in which case its results may be incomplete.
+  bool DomVisitorTimedOut(const Rule& rule) const;
+
+  // Get the deadline for the rule running on the calling thread, or
+  // NULL if it has no deadline. Rules that do a lot of work should
+  // poll it (see Deadline::IsExpired), and stop early once it has
+  // expired. The artifact getters below honor this deadline, and fail
+  // if it expires before the artifact could be computed.
+  const Deadline* deadline() const;
+
   // Determine how many bytes would the response body be if it were gzipped
   // (whether or not the resource actually was gzipped).  For resources that
   // aren't compressible (e.g. PNGs), yields the original request body size.
   // Return true on success, false on error.  This method is memoized, so it is
-  // cheap to call.
+  // cheap to call.  It is safe to call from multiple threads.
   bool GetCompressedResponseBodySize(const Resource& resource,
                                      int* output) const;
 
+  // Determine how many bytes the given content would be if it were
+  // gzipped, computed the same way as GetCompressedResponseBodySize, so
+  // that the two can be compared. This method is not memoized. Return
+  // true on success, false on error.
+  bool GetCompressedSize(const base::StringPiece& content, int* output) const;
+
+  // The following methods return artifacts derived from a resource's
+  // response body. Each is computed at most once per resource, and all
+  // are safe to call from multiple threads. The resource must be part
+  // of this RuleInput's PagespeedInput. Returned pointers remain valid
+  // for the lifetime of this RuleInput. The minified content is
+  // computed by the artifact computer (see set_artifact_computer).
+
+  // Get the minified JavaScript for the given resource, or NULL if the
+  // resource could not be minified.
+  const std::string* GetMinifiedJavaScript(const Resource& resource) const;
+
+  // Get the size of the given resource's minified JavaScript. This is
+  // cheaper than GetMinifiedJavaScript for rules that do not need the
+  // content, unless another rule already asked for it. Return true on
+  // success.
+  bool GetMinifiedJavaScriptSize(const Resource& resource, int* output) const;
+
+  // Get the size of the given resource's JavaScript after minifying it
+  // and collapsing its string literals. Return true on success.
+  bool GetStringCollapsedMinifiedJavaScriptSize(const Resource& resource,
+                                                int* output) const;
+
+  // Get the minified CSS for the given resource, or NULL if the
+  // resource could not be minified.
+  const std::string* GetMinifiedCss(const Resource& resource) const;
+
+  // Get the size of the given resource's minified CSS. As with
+  // GetMinifiedJavaScriptSize, the content is not kept. Return true on
+  // success.
+  bool GetMinifiedCssSize(const Resource& resource, int* output) const;
+
+  // Get the minified HTML for the given resource, or NULL if the
+  // resource could not be minified.
+  const std::string* GetMinifiedHtml(const Resource& resource) const;
+
+  // Get the dimensions of the given image resource. Return false if the
+  // image attributes could not be computed (see
+  // PagespeedInput::NewImageAttributes).
+  bool GetImageDimensions(const Resource& resource,
+                          int* out_width,
+                          int* out_height) const;
+
+  // Get a hash of everything that may affect the results a
+  // resource-local rule (see Rule::IsResourceLocal) generates for the
+  // given resource: its request, its response headers and body, and its
+  // resource type. Resources with the same content hash can be assumed
+  // to produce the same results, even across PagespeedInputs. Returns
+  // NULL if the resource is not part of our PagespeedInput.
+  const std::string* GetResourceContentHash(const Resource& resource) const;
+
+  // Number of artifact requests of the given kind that were served from
+  // the cache, and that had to be computed, respectively. These are
+  // useful for tuning, and are only approximate while rules are still
+  // running.
+  int GetArtifactCacheHits(ArtifactKind kind) const;
+  int GetArtifactCacheMisses(ArtifactKind kind) const;
+
  private:
+  struct ResourceArtifacts;
+
+  // Get the index of the given resource in our PagespeedInput, or -1
+  // if the resource is not part of our PagespeedInput.
+  int GetResourceIndex(const Resource& resource) const;
+
+  // Get the cached artifacts for the given resource, or NULL if the
+  // resource is not part of our PagespeedInput.
+  ResourceArtifacts* GetResourceArtifacts(const Resource& resource) const;
+
+  // Record a cache lookup for an artifact of the given kind.
+  void RecordArtifactLookup(ArtifactKind kind, bool hit) const;
+
+  // Compute the dimensions of every image resource on num_threads_
+  // threads, so that they are cached before the DOM visitors ask for
+  // them.
+  void PopulateImageDimensions() const;
+
   const PagespeedInput* pagespeed_input_;
-  mutable std::map<const Resource*, int> compressed_response_body_sizes_;
+  const ArtifactComputer* artifact_computer_;
+
+  // Memoized artifacts, indexed by resource index.
+  scoped_array<ResourceArtifacts> artifacts_;
+
+  // Results of the DOM visitors run by TraverseDom, by rule.
+  std::map<const Rule*, RuleResults*> dom_visitor_results_;
+  // The rules whose DOM visitors ran out of time in TraverseDom.
+  std::set<const Rule*> timed_out_dom_visitors_;
+
+  mutable base::subtle::Atomic32 artifact_cache_hits_[NUM_ARTIFACT_KINDS];
+  mutable base::subtle::Atomic32 artifact_cache_misses_[NUM_ARTIFACT_KINDS];
+
+  int num_threads_;
+  bool estimate_compressed_sizes_;
+  int dom_visitor_time_budget_millis_;
+  bool profile_dom_visitors_;
   bool initialized_;
 
   DISALLOW_COPY_AND_ASSIGN(RuleInput);
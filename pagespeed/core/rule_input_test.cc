@@ -12,12 +12,106 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string>
+
+#include "pagespeed/core/artifact_computer.h"
+#include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource_util.h"
 #include "pagespeed/core/rule_input.h"
+#include "pagespeed/core/string_util.h"
 #include "pagespeed/testing/pagespeed_test.h"
+#include "pagespeed/util/deadline.h"
 
+using pagespeed::ArtifactComputer;
+using pagespeed::Deadline;
 using pagespeed::Resource;
 using pagespeed::RuleInput;
+using pagespeed::string_util::IntToString;
+using pagespeed_testing::FakeImageAttributesFactory;
+
+namespace {
+
+// ArtifactComputer that "minifies" content by removing its spaces,
+// and counts how often it is asked to.
+class FakeArtifactComputer : public ArtifactComputer {
+ public:
+  FakeArtifactComputer() : num_minify_calls_(0), num_size_calls_(0) {}
+
+  virtual bool MinifyJavaScript(const Resource& resource,
+                                const Deadline* deadline,
+                                std::string* output) const {
+    return Minify(resource, deadline, output);
+  }
+  virtual bool GetMinifiedJavaScriptSize(const Resource& resource,
+                                         const Deadline* deadline,
+                                         int* output) const {
+    return GetMinifiedSize(resource, deadline, output);
+  }
+  virtual bool GetStringCollapsedMinifiedJavaScriptSize(
+      const Resource& resource,
+      const Deadline* deadline,
+      int* output) const {
+    return GetMinifiedSize(resource, deadline, output);
+  }
+  virtual bool MinifyCss(const Resource& resource,
+                         const Deadline* deadline,
+                         std::string* output) const {
+    return Minify(resource, deadline, output);
+  }
+  virtual bool GetMinifiedCssSize(const Resource& resource,
+                                  const Deadline* deadline,
+                                  int* output) const {
+    return GetMinifiedSize(resource, deadline, output);
+  }
+  virtual bool MinifyHtml(const Resource& resource,
+                          const Deadline* deadline,
+                          std::string* output) const {
+    return Minify(resource, deadline, output);
+  }
+
+  int num_minify_calls() const { return num_minify_calls_; }
+  int num_size_calls() const { return num_size_calls_; }
+
+ private:
+  static bool RemoveSpaces(const Resource& resource,
+                           const Deadline* deadline,
+                           std::string* output) {
+    if (Deadline::IsExpired(deadline)) {
+      return false;
+    }
+    const base::StringPiece body = resource.GetResponseBodyPiece();
+    for (size_t i = 0; i < body.size(); ++i) {
+      if (body[i] != ' ') {
+        output->push_back(body[i]);
+      }
+    }
+    return true;
+  }
+
+  bool Minify(const Resource& resource,
+              const Deadline* deadline,
+              std::string* output) const {
+    ++num_minify_calls_;
+    return RemoveSpaces(resource, deadline, output);
+  }
+
+  bool GetMinifiedSize(const Resource& resource,
+                       const Deadline* deadline,
+                       int* output) const {
+    ++num_size_calls_;
+    std::string minified;
+    if (!RemoveSpaces(resource, deadline, &minified)) {
+      return false;
+    }
+    *output = minified.size();
+    return true;
+  }
+
+  mutable int num_minify_calls_;
+  mutable int num_size_calls_;
+};
+
+}  // namespace
 
 class RuleInputTest : public ::pagespeed_testing::PagespeedTest {};
 
@@ -66,3 +160,277 @@ TEST_F(RuleInputTest, GetCompressedResponseBodySize) {
   ASSERT_NE(actual_compressed_size, cached_compressed_size);
   ASSERT_EQ(cached_compressed_size, compressed_size);
 }
+
+TEST_F(RuleInputTest, InitPrecomputesCompressedSizes) {
+  Resource* r1 = NewScriptResource(kUrl1, NULL, NULL);
+  r1->SetResponseBody(std::string(1000, 'a'));
+  Resource* r2 = NewPngResource(kUrl2, NULL, NULL);
+  r2->SetResponseBody(std::string(100, 'b'));
+
+  Freeze();
+
+  RuleInput rule_input(*pagespeed_input());
+  rule_input.set_num_threads(4);
+  rule_input.Init();
+
+  // Clear the response bodies. Since the compressed sizes were
+  // computed during Init(), we expect to get the sizes of the original
+  // bodies.
+  r1->SetResponseBody("");
+  r2->SetResponseBody("");
+
+  int compressed_size = 0;
+  ASSERT_TRUE(
+      rule_input.GetCompressedResponseBodySize(*r1, &compressed_size));
+  ASSERT_EQ(29, compressed_size);
+
+  // PNGs are not compressible, so we expect the original size.
+  ASSERT_TRUE(
+      rule_input.GetCompressedResponseBodySize(*r2, &compressed_size));
+  ASSERT_EQ(100, compressed_size);
+}
+
+TEST_F(RuleInputTest, InitPrecomputesAllCompressedSizes) {
+  NewScriptResource(kUrl1, NULL, NULL)->SetResponseBody(
+      std::string(100, 'a'));
+  NewPngResource(kUrl2, NULL, NULL)->SetResponseBody(std::string(5000, 'b'));
+  NewScriptResource(kUrl3, NULL, NULL)->SetResponseBody(
+      std::string(10000, 'c'));
+  NewCssResource(kUrl4, NULL)->SetResponseBody(std::string(1000, 'd'));
+
+  Freeze();
+
+  RuleInput rule_input(*pagespeed_input());
+  rule_input.set_num_threads(2);
+  rule_input.Init();
+  ASSERT_EQ(4, rule_input.GetArtifactCacheMisses(RuleInput::COMPRESSED_SIZE));
+
+  for (int i = 0; i < pagespeed_input()->num_resources(); ++i) {
+    int compressed_size = 0;
+    ASSERT_TRUE(rule_input.GetCompressedResponseBodySize(
+        pagespeed_input()->GetResource(i), &compressed_size));
+  }
+  ASSERT_EQ(4, rule_input.GetArtifactCacheHits(RuleInput::COMPRESSED_SIZE));
+  ASSERT_EQ(4, rule_input.GetArtifactCacheMisses(RuleInput::COMPRESSED_SIZE));
+}
+
+TEST_F(RuleInputTest, EstimateCompressedSizes) {
+  std::string body;
+  for (int i = 0; i < 2000; ++i) {
+    body += "var v" + IntToString(i) + " = f(" + IntToString(i * i % 997) +
+        ");\n";
+  }
+  Resource* r1 = NewScriptResource(kUrl1, NULL, NULL);
+  r1->SetResponseBody(body);
+
+  Freeze();
+
+  RuleInput rule_input(*pagespeed_input());
+  rule_input.set_estimate_compressed_sizes(true);
+  rule_input.Init();
+
+  int compressed_size = 0;
+  ASSERT_TRUE(
+      rule_input.GetCompressedResponseBodySize(*r1, &compressed_size));
+  int estimated_size = 0;
+  ASSERT_TRUE(
+      pagespeed::resource_util::EstimateGzippedSize(body, &estimated_size));
+  ASSERT_EQ(estimated_size, compressed_size);
+
+  // Other content is compressed the same way, so that sizes can be
+  // compared.
+  ASSERT_TRUE(rule_input.GetCompressedSize(body, &compressed_size));
+  ASSERT_EQ(estimated_size, compressed_size);
+}
+
+TEST_F(RuleInputTest, MinifiedJavaScriptIsCached) {
+  Resource* r1 = NewScriptResource(kUrl1, NULL, NULL);
+  r1->SetResponseBody("var a = 1;");
+
+  Freeze();
+
+  FakeArtifactComputer computer;
+  RuleInput rule_input(*pagespeed_input());
+  rule_input.set_artifact_computer(&computer);
+
+  const std::string* minified = rule_input.GetMinifiedJavaScript(*r1);
+  ASSERT_TRUE(minified != NULL);
+  ASSERT_EQ("vara=1;", *minified);
+  ASSERT_EQ(0, rule_input.GetArtifactCacheHits(
+      RuleInput::MINIFIED_JAVASCRIPT));
+  ASSERT_EQ(1, rule_input.GetArtifactCacheMisses(
+      RuleInput::MINIFIED_JAVASCRIPT));
+
+  // A second request should return the same instance, without
+  // minifying again.
+  ASSERT_EQ(minified, rule_input.GetMinifiedJavaScript(*r1));
+  ASSERT_EQ(1, computer.num_minify_calls());
+  ASSERT_EQ(1, rule_input.GetArtifactCacheHits(
+      RuleInput::MINIFIED_JAVASCRIPT));
+  ASSERT_EQ(1, rule_input.GetArtifactCacheMisses(
+      RuleInput::MINIFIED_JAVASCRIPT));
+
+  // Other artifact kinds are tracked separately.
+  ASSERT_EQ(0, rule_input.GetArtifactCacheMisses(RuleInput::MINIFIED_CSS));
+}
+
+TEST_F(RuleInputTest, ExpiredDeadlineIsNotCached) {
+  Resource* r1 = NewScriptResource(kUrl1, NULL, NULL);
+  r1->SetResponseBody("var a = 1;");
+
+  Freeze();
+
+  FakeArtifactComputer computer;
+  RuleInput rule_input(*pagespeed_input());
+  rule_input.set_artifact_computer(&computer);
+  ASSERT_TRUE(rule_input.deadline() == NULL);
+
+  Deadline deadline;
+  deadline.Cancel();
+  {
+    RuleInput::ScopedDeadline scoped_deadline(&deadline);
+    ASSERT_EQ(&deadline, rule_input.deadline());
+    ASSERT_TRUE(rule_input.GetMinifiedJavaScript(*r1) == NULL);
+  }
+  ASSERT_TRUE(rule_input.deadline() == NULL);
+
+  // Without a deadline, minification is attempted again, and succeeds.
+  const std::string* minified = rule_input.GetMinifiedJavaScript(*r1);
+  ASSERT_TRUE(minified != NULL);
+  ASSERT_EQ("vara=1;", *minified);
+  ASSERT_EQ(2, rule_input.GetArtifactCacheMisses(
+      RuleInput::MINIFIED_JAVASCRIPT));
+}
+
+TEST_F(RuleInputTest, MinifiedCss) {
+  Resource* r1 = NewCssResource(kUrl1, NULL, NULL);
+  r1->SetResponseBody("body { color: red; }");
+
+  Freeze();
+
+  FakeArtifactComputer computer;
+  RuleInput rule_input(*pagespeed_input());
+  rule_input.set_artifact_computer(&computer);
+
+  const std::string* minified = rule_input.GetMinifiedCss(*r1);
+  ASSERT_TRUE(minified != NULL);
+  ASSERT_EQ("body{color:red;}", *minified);
+}
+
+TEST_F(RuleInputTest, MinifiedSizeDoesNotKeepContent) {
+  Resource* r1 = NewCssResource(kUrl1, NULL, NULL);
+  r1->SetResponseBody("body { color: red; }");
+  Resource* r2 = NewCssResource(kUrl2, NULL, NULL);
+  r2->SetResponseBody("a { color: blue; }");
+
+  Freeze();
+
+  FakeArtifactComputer computer;
+  RuleInput rule_input(*pagespeed_input());
+  rule_input.set_artifact_computer(&computer);
+
+  // Only the size is computed, and it is cached.
+  int size = 0;
+  ASSERT_TRUE(rule_input.GetMinifiedCssSize(*r1, &size));
+  ASSERT_EQ(16, size);
+  ASSERT_TRUE(rule_input.GetMinifiedCssSize(*r1, &size));
+  ASSERT_EQ(16, size);
+  ASSERT_EQ(1, computer.num_size_calls());
+  ASSERT_EQ(0, computer.num_minify_calls());
+  ASSERT_EQ(1, rule_input.GetArtifactCacheHits(RuleInput::MINIFIED_CSS_SIZE));
+  ASSERT_EQ(1, rule_input.GetArtifactCacheMisses(
+      RuleInput::MINIFIED_CSS_SIZE));
+
+  // Once the content has been computed, the size is taken from it.
+  const std::string* minified = rule_input.GetMinifiedCss(*r2);
+  ASSERT_TRUE(minified != NULL);
+  ASSERT_TRUE(rule_input.GetMinifiedCssSize(*r2, &size));
+  ASSERT_EQ(static_cast<int>(minified->size()), size);
+  ASSERT_EQ(1, computer.num_size_calls());
+  ASSERT_EQ(1, computer.num_minify_calls());
+  ASSERT_EQ(2, rule_input.GetArtifactCacheHits(RuleInput::MINIFIED_CSS_SIZE));
+
+  // JavaScript sizes are tracked separately.
+  ASSERT_EQ(0, rule_input.GetArtifactCacheMisses(
+      RuleInput::MINIFIED_JAVASCRIPT_SIZE));
+}
+
+TEST_F(RuleInputTest, ImageDimensions) {
+  Resource* r1 = NewPngResource(kUrl1, NULL, NULL);
+  Resource* r2 = NewPngResource(kUrl2, NULL, NULL);
+  FakeImageAttributesFactory::ResourceSizeMap size_map;
+  size_map[r1] = std::make_pair(42, 23);
+  ASSERT_TRUE(AddFakeImageAttributesFactory(size_map));
+
+  Freeze();
+
+  RuleInput rule_input(*pagespeed_input());
+
+  int width = 0;
+  int height = 0;
+  ASSERT_TRUE(rule_input.GetImageDimensions(*r1, &width, &height));
+  ASSERT_EQ(42, width);
+  ASSERT_EQ(23, height);
+
+  // Failures are cached too.
+  ASSERT_FALSE(rule_input.GetImageDimensions(*r2, &width, &height));
+  ASSERT_FALSE(rule_input.GetImageDimensions(*r2, &width, &height));
+  ASSERT_EQ(1, rule_input.GetArtifactCacheHits(RuleInput::IMAGE_DIMENSIONS));
+  ASSERT_EQ(2, rule_input.GetArtifactCacheMisses(
+      RuleInput::IMAGE_DIMENSIONS));
+}
+
+TEST_F(RuleInputTest, ResourceContentHash) {
+  Resource* r1 = NewScriptResource(kUrl1, NULL, NULL);
+  r1->SetResponseBody("alert(1);");
+  Resource* r2 = NewScriptResource(kUrl2, NULL, NULL);
+  r2->SetResponseBody("alert(1);");
+  Resource* r3 = NewScriptResource(kUrl3, NULL, NULL);
+  r3->SetResponseBody("alert(1);");
+  r3->AddResponseHeader("Cache-Control", "max-age=300");
+
+  Freeze();
+
+  RuleInput rule_input(*pagespeed_input());
+  const std::string* hash1 = rule_input.GetResourceContentHash(*r1);
+  const std::string* hash2 = rule_input.GetResourceContentHash(*r2);
+  const std::string* hash3 = rule_input.GetResourceContentHash(*r3);
+  ASSERT_TRUE(hash1 != NULL);
+  ASSERT_TRUE(hash2 != NULL);
+  ASSERT_TRUE(hash3 != NULL);
+  ASSERT_EQ(32U, hash1->size());
+
+  // Resources with the same body but a different URL or different
+  // headers have different hashes.
+  ASSERT_NE(*hash1, *hash2);
+  ASSERT_NE(*hash1, *hash3);
+  ASSERT_NE(*hash2, *hash3);
+
+  // The hash only depends on the resource, so identical resources in
+  // another input have the same hash.
+  pagespeed::PagespeedInput other_input;
+  Resource* other = new Resource();
+  other->SetRequestUrl(r1->GetRequestUrl());
+  other->SetRequestMethod(r1->GetRequestMethod());
+  other->SetResponseStatusCode(r1->GetResponseStatusCode());
+  const Resource::HeaderMap& headers = *r1->GetResponseHeaders();
+  for (Resource::HeaderMap::const_iterator it = headers.begin(),
+           end = headers.end();
+       it != end;
+       ++it) {
+    other->AddResponseHeader(it->name(), it->value());
+  }
+  other->SetResponseBody(r1->GetResponseBody());
+  other->SetResourceType(r1->GetResourceType());
+  ASSERT_TRUE(other_input.AddResource(other));
+  ASSERT_TRUE(other_input.Freeze());
+  RuleInput other_rule_input(other_input);
+  const std::string* other_hash =
+      other_rule_input.GetResourceContentHash(*other);
+  ASSERT_TRUE(other_hash != NULL);
+  ASSERT_EQ(*hash1, *other_hash);
+
+  ASSERT_EQ(hash1, rule_input.GetResourceContentHash(*r1));
+  ASSERT_EQ(1, rule_input.GetArtifactCacheHits(RuleInput::CONTENT_HASH));
+  ASSERT_EQ(3, rule_input.GetArtifactCacheMisses(RuleInput::CONTENT_HASH));
+}
@@ -0,0 +1,177 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pagespeed/core/shared_buffer.h"
+
+#if defined(_WIN32)
+#include <stdio.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "base/logging.h"
+#include "base/md5.h"
+
+namespace pagespeed {
+
+namespace {
+
+class StringBuffer : public SharedBuffer {
+ public:
+  // Takes ownership of the given string, which must not be modified
+  // afterwards.
+  explicit StringBuffer(std::string* contents)
+      : SharedBuffer(*contents), contents_(contents) {}
+
+ private:
+  virtual ~StringBuffer() {
+    delete contents_;
+  }
+
+  std::string* const contents_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringBuffer);
+};
+
+#if !defined(_WIN32)
+
+class MappedFileBuffer : public SharedBuffer {
+ public:
+  // Takes ownership of the given mapping.
+  MappedFileBuffer(void* address, size_t length)
+      : SharedBuffer(base::StringPiece(static_cast<const char*>(address),
+                                       length)),
+        address_(address), length_(length) {}
+
+ private:
+  virtual ~MappedFileBuffer() {
+    if (munmap(address_, length_) != 0) {
+      LOG(DFATAL) << "Failed to unmap file.";
+    }
+  }
+
+  void* const address_;
+  const size_t length_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFileBuffer);
+};
+
+#endif  // !defined(_WIN32)
+
+}  // namespace
+
+SharedBuffer::SharedBuffer(const base::StringPiece& data) : data_(data) {}
+
+SharedBuffer::~SharedBuffer() {}
+
+SharedBuffer* SharedBuffer::TakeString(std::string* contents) {
+  std::string* owned_contents = new std::string;
+  owned_contents->swap(*contents);
+  return new StringBuffer(owned_contents);
+}
+
+base::StringPiece SharedBuffer::Substr(size_t offset, size_t length) const {
+  DCHECK_LE(offset, data_.size());
+  DCHECK_LE(length, data_.size() - offset);
+  return base::StringPiece(data_.data() + offset, length);
+}
+
+#if defined(_WIN32)
+
+SharedBuffer* SharedBuffer::MapFile(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  std::string contents;
+  char buffer[4096];
+  size_t num_read;
+  while ((num_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents.append(buffer, num_read);
+  }
+  const bool ok = !ferror(file);
+  fclose(file);
+  if (!ok) {
+    return NULL;
+  }
+  return TakeString(&contents);
+}
+
+#else
+
+SharedBuffer* SharedBuffer::MapFile(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return NULL;
+  }
+  const size_t length = static_cast<size_t>(file_stat.st_size);
+  if (length == 0) {
+    // Empty files cannot be mapped.
+    close(fd);
+    std::string empty;
+    return TakeString(&empty);
+  }
+  void* address = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping remains valid after the file is closed.
+  close(fd);
+  if (address == MAP_FAILED) {
+    return NULL;
+  }
+  return new MappedFileBuffer(address, length);
+}
+
+#endif  // defined(_WIN32)
+
+SharedBufferInterner::SharedBufferInterner() {}
+
+SharedBufferInterner::~SharedBufferInterner() {}
+
+SharedBuffer* SharedBufferInterner::Intern(SharedBuffer* buffer) {
+  // Hold a reference so that the buffer is deleted if it is not used.
+  scoped_refptr<SharedBuffer> candidate(buffer);
+
+  // Hash outside of the lock, since that is the expensive part.
+  base::MD5Digest digest;
+  base::MD5Sum(buffer->data().data(), buffer->size(), &digest);
+  const std::string key(reinterpret_cast<const char*>(digest.a),
+                        sizeof(digest.a));
+
+  base::AutoLock lock(lock_);
+  std::pair<BufferMap::iterator, bool> inserted =
+      buffers_.insert(std::make_pair(key, candidate));
+  SharedBuffer* existing = inserted.first->second.get();
+  if (!inserted.second && existing->data() != buffer->data()) {
+    // A digest collision. Leave the buffer unshared, but keep it alive
+    // as promised.
+    unshared_buffers_.push_back(candidate);
+    return buffer;
+  }
+  return existing;
+}
+
+size_t SharedBufferInterner::size() const {
+  base::AutoLock lock(lock_);
+  return buffers_.size() + unshared_buffers_.size();
+}
+
+}  // namespace pagespeed
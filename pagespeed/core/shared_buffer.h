@@ -0,0 +1,102 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PAGESPEED_CORE_SHARED_BUFFER_H_
+#define PAGESPEED_CORE_SHARED_BUFFER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "base/string_piece.h"
+#include "base/synchronization/lock.h"
+
+namespace pagespeed {
+
+// An immutable, reference-counted block of memory that can be shared by
+// several owners without copying it. Resources use it to hold response
+// bodies without copying them, either as views into a larger buffer,
+// such as a memory-mapped input file, or as buffers that took over a
+// decoded string. Buffers may be referenced from several threads at
+// once.
+class SharedBuffer : public base::RefCountedThreadSafe<SharedBuffer> {
+ public:
+  // Create a buffer that takes the contents of the given string,
+  // leaving it empty, so no copy is made.
+  static SharedBuffer* TakeString(std::string* contents);
+
+  // Create a buffer holding the contents of the file at the given path,
+  // by mapping the file into memory where supported, or by reading it
+  // otherwise. Returns NULL if the file could not be read. The file
+  // must not be modified while the buffer exists.
+  static SharedBuffer* MapFile(const std::string& path);
+
+  const base::StringPiece& data() const { return data_; }
+  size_t size() const { return data_.size(); }
+
+  // Get a view of the given range of the buffer, which must lie within
+  // it. The view is valid as long as a reference to the buffer is held.
+  base::StringPiece Substr(size_t offset, size_t length) const;
+
+ protected:
+  friend class base::RefCountedThreadSafe<SharedBuffer>;
+
+  explicit SharedBuffer(const base::StringPiece& data);
+  virtual ~SharedBuffer();
+
+ private:
+  const base::StringPiece data_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedBuffer);
+};
+
+// Maps the contents of buffers to a single buffer holding those
+// contents, so that identical data loaded from several places (such as
+// a stylesheet fetched by every page of a site) is held in memory only
+// once. Buffers are looked up by a digest of their contents, and are
+// only shared if their contents are actually equal. Intern may be
+// called from several threads at once.
+class SharedBufferInterner {
+ public:
+  SharedBufferInterner();
+  ~SharedBufferInterner();
+
+  // Get a buffer with the same contents as the given buffer: either one
+  // that was interned earlier, or buffer itself, which is then interned
+  // for later calls. If an earlier buffer is returned and the given
+  // buffer is not referenced elsewhere, the given buffer is deleted.
+  // The returned buffer is referenced by the interner until it is
+  // destroyed.
+  SharedBuffer* Intern(SharedBuffer* buffer);
+
+  // The number of distinct buffers that have been interned.
+  size_t size() const;
+
+ private:
+  typedef std::map<std::string, scoped_refptr<SharedBuffer> > BufferMap;
+
+  mutable base::Lock lock_;
+  BufferMap buffers_;
+  // Buffers whose digest matched that of a different interned buffer.
+  std::vector<scoped_refptr<SharedBuffer> > unshared_buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedBufferInterner);
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_CORE_SHARED_BUFFER_H_
@@ -0,0 +1,89 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pagespeed/core/shared_buffer.h"
+
+#include <stdio.h>
+
+#include <string>
+
+#include "base/memory/ref_counted.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using pagespeed::SharedBuffer;
+using pagespeed::SharedBufferInterner;
+
+namespace {
+
+TEST(SharedBufferTest, TakeString) {
+  // Long enough that the string's contents are heap-allocated.
+  std::string contents("hello, world, from a shared buffer");
+  const char* contents_data = contents.data();
+  scoped_refptr<SharedBuffer> buffer(SharedBuffer::TakeString(&contents));
+  EXPECT_TRUE(contents.empty());
+  EXPECT_EQ("hello, world, from a shared buffer", buffer->data().as_string());
+  EXPECT_EQ(34U, buffer->size());
+  // The string's contents were moved, not copied.
+  EXPECT_EQ(contents_data, buffer->data().data());
+  EXPECT_EQ("world", buffer->Substr(7, 5).as_string());
+  EXPECT_EQ("", buffer->Substr(34, 0).as_string());
+}
+
+TEST(SharedBufferTest, MapFile) {
+  const std::string path = "shared_buffer_test.tmp";
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(file != NULL);
+  fputs("mapped contents", file);
+  fclose(file);
+
+  scoped_refptr<SharedBuffer> buffer(SharedBuffer::MapFile(path));
+  remove(path.c_str());
+  ASSERT_TRUE(buffer != NULL);
+  EXPECT_EQ("mapped contents", buffer->data().as_string());
+  EXPECT_EQ("contents", buffer->Substr(7, 8).as_string());
+}
+
+TEST(SharedBufferTest, MapMissingFile) {
+  scoped_refptr<SharedBuffer> buffer(
+      SharedBuffer::MapFile("no_such_shared_buffer_test_file.tmp"));
+  EXPECT_TRUE(buffer == NULL);
+}
+
+TEST(SharedBufferTest, Intern) {
+  SharedBufferInterner interner;
+  std::string contents("first");
+  SharedBuffer* first = interner.Intern(SharedBuffer::TakeString(&contents));
+  EXPECT_EQ("first", first->data());
+
+  contents = "first";
+  scoped_refptr<SharedBuffer> duplicate(SharedBuffer::TakeString(&contents));
+  EXPECT_EQ(first, interner.Intern(duplicate.get()));
+  // The duplicate is still referenced by us, so it is not deleted.
+  EXPECT_EQ("first", duplicate->data());
+
+  contents = "second";
+  SharedBuffer* second = interner.Intern(SharedBuffer::TakeString(&contents));
+  EXPECT_NE(first, second);
+  EXPECT_EQ("second", second->data());
+  EXPECT_EQ(2U, interner.size());
+
+  // A buffer that is not referenced elsewhere is released when an
+  // earlier one is returned in its place.
+  contents = "second";
+  EXPECT_EQ(second, interner.Intern(SharedBuffer::TakeString(&contents)));
+  EXPECT_EQ(2U, interner.size());
+}
+
+}  // namespace
@@ -0,0 +1,125 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pagespeed/core/thread_pool.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/logging.h"
+#include "base/threading/platform_thread.h"
+
+namespace {
+
+// Shared state for a single ThreadPool::Run invocation. Each thread
+// repeatedly claims the lowest unclaimed task index until none remain.
+class TaskDispatcher : public base::PlatformThread::Delegate {
+ public:
+  TaskDispatcher(pagespeed::ParallelTask* task, int num_tasks)
+      : task_(task), num_tasks_(num_tasks), next_task_index_(0) {}
+  virtual ~TaskDispatcher() {}
+
+  virtual void ThreadMain() {
+    while (true) {
+      const int task_index =
+          base::subtle::Barrier_AtomicIncrement(&next_task_index_, 1) - 1;
+      if (task_index >= num_tasks_) {
+        return;
+      }
+      task_->RunTask(task_index);
+    }
+  }
+
+ private:
+  pagespeed::ParallelTask* const task_;
+  const int num_tasks_;
+  volatile base::subtle::Atomic32 next_task_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskDispatcher);
+};
+
+}  // namespace
+
+namespace pagespeed {
+
+ParallelTask::ParallelTask() {}
+
+ParallelTask::~ParallelTask() {}
+
+ThreadPool::ThreadPool(int num_threads)
+    : num_threads_(std::max(1, num_threads)) {}
+
+ThreadPool::~ThreadPool() {}
+
+void ThreadPool::Run(ParallelTask* task, int num_tasks) const {
+  if (num_tasks <= 0) {
+    return;
+  }
+
+  const int num_workers = std::min(num_threads_, num_tasks);
+  if (num_workers <= 1) {
+    for (int task_index = 0; task_index < num_tasks; ++task_index) {
+      task->RunTask(task_index);
+    }
+    return;
+  }
+
+  TaskDispatcher dispatcher(task, num_tasks);
+  std::vector<base::PlatformThreadHandle> workers;
+  workers.reserve(num_workers - 1);
+  for (int i = 1; i < num_workers; ++i) {
+    base::PlatformThreadHandle handle;
+    if (!base::PlatformThread::Create(0, &dispatcher, &handle)) {
+      // The calling thread also runs tasks, so we can still make
+      // progress with fewer workers than requested.
+      LOG(WARNING) << "Failed to create worker thread. Continuing with "
+                   << workers.size() + 1 << " threads.";
+      break;
+    }
+    workers.push_back(handle);
+  }
+
+  dispatcher.ThreadMain();
+
+  for (std::vector<base::PlatformThreadHandle>::const_iterator
+           it = workers.begin(), end = workers.end();
+       it != end;
+       ++it) {
+    base::PlatformThread::Join(*it);
+  }
+}
+
+// static
+int ThreadPool::GetNumberOfProcessors() {
+#if defined(_WIN32)
+  SYSTEM_INFO system_info;
+  GetSystemInfo(&system_info);
+  const long num_processors = system_info.dwNumberOfProcessors;
+#else
+  const long num_processors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if (num_processors < 1) {
+    return 1;
+  }
+  return static_cast<int>(num_processors);
+}
+
+}  // namespace pagespeed
@@ -0,0 +1,68 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PAGESPEED_CORE_THREAD_POOL_H_
+#define PAGESPEED_CORE_THREAD_POOL_H_
+
+#include "base/basictypes.h"
+
+namespace pagespeed {
+
+// A body of work that can be split into independent tasks, identified
+// by index, and executed by a ThreadPool.
+class ParallelTask {
+ public:
+  ParallelTask();
+  virtual ~ParallelTask();
+
+  // Run the task with the given index. This method may be invoked
+  // concurrently from several threads, though never twice for the same
+  // index, so implementations must only mutate state owned by that
+  // index.
+  virtual void RunTask(int task_index) = 0;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ParallelTask);
+};
+
+// ThreadPool executes the tasks of a ParallelTask across a fixed
+// number of threads. Tasks are handed out in increasing index order,
+// so callers that want their most expensive tasks started first should
+// give them the lowest indices. The calling thread participates in the
+// work, and Run() does not return until every task has completed.
+class ThreadPool {
+ public:
+  // A ThreadPool with num_threads <= 1 runs all tasks serially on the
+  // calling thread.
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  int num_threads() const { return num_threads_; }
+
+  // Invoke task->RunTask(i) once for each i in [0, num_tasks).
+  void Run(ParallelTask* task, int num_tasks) const;
+
+  // Get the number of processors available to this process, or 1 if
+  // that number cannot be determined.
+  static int GetNumberOfProcessors();
+
+ private:
+  const int num_threads_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_CORE_THREAD_POOL_H_
@@ -0,0 +1,116 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "pagespeed/core/thread_pool.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using pagespeed::ParallelTask;
+using pagespeed::ThreadPool;
+
+namespace {
+
+// Records the number of times each task index was run, and the order
+// in which the indices were run.
+class RecordingTask : public ParallelTask {
+ public:
+  explicit RecordingTask(int num_tasks) : run_counts_(num_tasks, 0) {}
+
+  virtual void RunTask(int task_index) {
+    ++run_counts_[task_index];
+    run_order_.push_back(task_index);
+  }
+
+  const std::vector<int>& run_counts() const { return run_counts_; }
+  const std::vector<int>& run_order() const { return run_order_; }
+
+ private:
+  std::vector<int> run_counts_;
+  std::vector<int> run_order_;
+
+  DISALLOW_COPY_AND_ASSIGN(RecordingTask);
+};
+
+// Writes only to the slot owned by each task index, so it may safely be
+// run concurrently.
+class SquareTask : public ParallelTask {
+ public:
+  explicit SquareTask(int num_tasks) : squares_(num_tasks, 0) {}
+
+  virtual void RunTask(int task_index) {
+    squares_[task_index] = task_index * task_index;
+  }
+
+  const std::vector<int>& squares() const { return squares_; }
+
+ private:
+  std::vector<int> squares_;
+
+  DISALLOW_COPY_AND_ASSIGN(SquareTask);
+};
+
+TEST(ThreadPoolTest, SingleThreadRunsInOrder) {
+  ThreadPool pool(1);
+  RecordingTask task(5);
+  pool.Run(&task, 5);
+  ASSERT_EQ(5U, task.run_order().size());
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(1, task.run_counts()[i]);
+    EXPECT_EQ(i, task.run_order()[i]);
+  }
+}
+
+TEST(ThreadPoolTest, NonPositiveThreadCountRunsSerially) {
+  ThreadPool pool(0);
+  ASSERT_EQ(1, pool.num_threads());
+  RecordingTask task(3);
+  pool.Run(&task, 3);
+  ASSERT_EQ(3U, task.run_order().size());
+  EXPECT_EQ(0, task.run_order()[0]);
+  EXPECT_EQ(1, task.run_order()[1]);
+  EXPECT_EQ(2, task.run_order()[2]);
+}
+
+TEST(ThreadPoolTest, NoTasks) {
+  ThreadPool pool(4);
+  RecordingTask task(0);
+  pool.Run(&task, 0);
+  ASSERT_TRUE(task.run_order().empty());
+}
+
+TEST(ThreadPoolTest, MultipleThreadsRunEachTaskOnce) {
+  const int kNumTasks = 1000;
+  ThreadPool pool(8);
+  SquareTask task(kNumTasks);
+  pool.Run(&task, kNumTasks);
+  for (int i = 0; i < kNumTasks; ++i) {
+    EXPECT_EQ(i * i, task.squares()[i]);
+  }
+}
+
+TEST(ThreadPoolTest, MoreThreadsThanTasks) {
+  ThreadPool pool(16);
+  SquareTask task(3);
+  pool.Run(&task, 3);
+  EXPECT_EQ(0, task.squares()[0]);
+  EXPECT_EQ(1, task.squares()[1]);
+  EXPECT_EQ(4, task.squares()[2]);
+}
+
+TEST(ThreadPoolTest, GetNumberOfProcessors) {
+  ASSERT_GE(ThreadPool::GetNumberOfProcessors(), 1);
+}
+
+}  // namespace
@@ -18,7 +18,6 @@
 #include <string>
 
 #include "base/logging.h"
-#include "base/memory/scoped_ptr.h"
 #include "googleurl/src/gurl.h"
 #include "googleurl/src/url_canon.h"
 #include "pagespeed/core/dom.h"
@@ -27,57 +26,49 @@
 
 namespace {
 
-class DocumentFinderVisitor : public pagespeed::DomElementVisitor {
+// Resolves a URI against the base URL of the first document, in
+// pre-order, with the given URL, and stops the traversal as soon as it
+// has found that document.
+class DocumentFinderVisitor : public pagespeed::DomTraversalVisitor {
  public:
-  explicit DocumentFinderVisitor(const std::string& url) : url_(url) {}
+  DocumentFinderVisitor(const std::string& uri_to_resolve,
+                        const std::string& url)
+      : uri_to_resolve_(uri_to_resolve), url_(url), found_(false) {}
 
-  virtual void Visit(const pagespeed::DomElement& node);
+  virtual bool EnterDocument(const pagespeed::DomDocument& document,
+                             const pagespeed::DomElement* frame);
 
-  bool HasDocument() { return document_.get() != NULL; }
-  pagespeed::DomDocument* AcquireDocument() {
-    DCHECK(HasDocument());
-    return document_.release();
-  }
+  // Nothing but the IFRAMEs matter, since their content documents are
+  // entered separately.
+  virtual void Visit(const pagespeed::DomElement& node) {}
+
+  virtual bool IsDone() const { return found_; }
+
+  bool HasDocument() const { return found_; }
+  const std::string& resolved_uri() const { return resolved_uri_; }
 
  private:
+  const std::string& uri_to_resolve_;
   const std::string& url_;
-  scoped_ptr<pagespeed::DomDocument> document_;
+  bool found_;
+  std::string resolved_uri_;
 
   DISALLOW_COPY_AND_ASSIGN(DocumentFinderVisitor);
 };
 
-void DocumentFinderVisitor::Visit(const pagespeed::DomElement& node) {
-  if (HasDocument()) {
-    // Already found a document so we do not need to visit any
-    // additional nodes.
-    return;
-  }
-
-  if (node.GetTagName() != "IFRAME") {
-    return;
-  }
-
-  scoped_ptr<pagespeed::DomDocument> child_doc(node.GetContentDocument());
-  if (child_doc.get() == NULL) {
-    // Failed to get the child document, so bail.
-    return;
-  }
-
+bool DocumentFinderVisitor::EnterDocument(
+    const pagespeed::DomDocument& document,
+    const pagespeed::DomElement* frame) {
   // TODO: consider performing a match after removing the document
   // fragments.
-  if (child_doc->GetDocumentUrl() == url_) {
-    // We found the document instance, so hold onto it.
-    document_.reset(child_doc.release());
-    return;
-  }
-
-  // Search for the document within this child document.
-  DocumentFinderVisitor visitor(url_);
-  child_doc->Traverse(&visitor);
-  if (visitor.HasDocument()) {
-    // We found a matching document.
-    document_.reset(visitor.AcquireDocument());
+  if (document.GetDocumentUrl() == url_) {
+    // We found the document instance, so we need not look any further.
+    resolved_uri_ = document.ResolveUri(uri_to_resolve_);
+    found_ = true;
+    return false;
   }
+  // Search for the document within this document.
+  return true;
 }
 
 GURL GetUriWithoutFragmentInternal(const GURL& url) {
@@ -204,19 +195,13 @@ bool ResolveUriForDocumentWithUrl(
     return false;
   }
 
-  if (root_document->GetDocumentUrl() == document_url_to_find) {
-    *out_resolved_url = root_document->ResolveUri(uri_to_resolve);
-    return true;
-  }
-
-  DocumentFinderVisitor visitor(document_url_to_find);
-  root_document->Traverse(&visitor);
+  DocumentFinderVisitor visitor(uri_to_resolve, document_url_to_find);
+  pagespeed::DomTraversal::TraverseWithVisitor(*root_document, &visitor);
   if (!visitor.HasDocument()) {
     return false;
   }
 
-  scoped_ptr<pagespeed::DomDocument> doc(visitor.AcquireDocument());
-  *out_resolved_url = doc->ResolveUri(uri_to_resolve);
+  *out_resolved_url = visitor.resolved_uri();
   return true;
 }
 
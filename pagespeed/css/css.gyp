@@ -23,6 +23,7 @@
       'type': '<(library)',
       'dependencies': [
         '<(DEPTH)/base/base.gyp:base',
+        '<(pagespeed_root)/pagespeed/util/util.gyp:pagespeed_util',
       ],
       'sources': [
         'cssmin.cc',
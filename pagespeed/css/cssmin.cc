@@ -20,11 +20,19 @@
 #include "base/logging.h"
 #include "base/string_piece.h"
 #include "pagespeed/core/string_util.h"
+#include "pagespeed/util/deadline.h"
+
+using pagespeed::Deadline;
 
 namespace {
 
 const int kEOF = -1;  // represents the end of the input
 
+// Number of iterations of the main minification loop between checks of
+// the deadline. Checking the deadline requires reading the clock, so we
+// do not want to do it for every character.
+const int kDeadlineCheckInterval = 4096;
+
 // A token can either be a character (0-255) or one of these constants:
 const int kStartToken = 256;  // the start of the input
 const int kCommentToken = 257;  // a comment (that we chose to preserve)
@@ -125,6 +133,11 @@ class Minifier {
   // successful, NULL otherwise.
   OutputConsumer* GetOutput();
 
+  // Give up (and fail) if the given deadline expires before
+  // minification is complete. Should call after constructor, and before
+  // calling GetOutput().
+  void SetDeadline(const Deadline* deadline) { deadline_ = deadline; }
+
  private:
   int Peek();
   void ChangeToken(int next_token);
@@ -144,6 +157,7 @@ class Minifier {
   Whitespace whitespace_;  // whitespace since the previous token
   int prev_token_;
   bool error_;
+  const Deadline* deadline_;
 };
 
 template<typename OutputConsumer>
@@ -154,7 +168,8 @@ Minifier<OutputConsumer>::Minifier(const base::StringPiece& input,
     output_(output),
     whitespace_(NO_WHITESPACE),
     prev_token_(kStartToken),
-    error_(false) {}
+    error_(false),
+    deadline_(NULL) {}
 
 template<typename OutputConsumer>
 OutputConsumer* Minifier<OutputConsumer>::GetOutput() {
@@ -238,7 +253,15 @@ void Minifier<OutputConsumer>::ConsumeString() {
 
 template<typename OutputConsumer>
 void Minifier<OutputConsumer>::Minify() {
+  int iterations_until_deadline_check = 1;
   while (index_ < input_.size() && !error_) {
+    if (deadline_ != NULL && --iterations_until_deadline_check == 0) {
+      if (deadline_->IsExpired()) {
+        error_ = true;
+        break;
+      }
+      iterations_until_deadline_check = kDeadlineCheckInterval;
+    }
     const char ch = input_[index_];
     // Track whitespace since the previous token.  NO_WHITESPACE means no
     // whitespace; LINEBREAK means there's been at least one linebreak; SPACE
@@ -276,13 +299,28 @@ namespace pagespeed {
 
 namespace css {
 
-bool MinifyCss(const std::string& input, std::string* out) {
+bool MinifyCss(const base::StringPiece& input, std::string* out) {
+  return MinifyCssWithDeadline(input, NULL, out);
+}
+
+bool MinifyCssWithDeadline(const base::StringPiece& input,
+                           const Deadline* deadline,
+                           std::string* out) {
   Minifier<StringConsumer> minifier(input, out);
+  minifier.SetDeadline(deadline);
   return (minifier.GetOutput() != NULL);
 }
 
-bool GetMinifiedCssSize(const std::string& input, int* minified_size) {
+bool GetMinifiedCssSize(const base::StringPiece& input,
+                        int* minified_size) {
+  return GetMinifiedCssSizeWithDeadline(input, NULL, minified_size);
+}
+
+bool GetMinifiedCssSizeWithDeadline(const base::StringPiece& input,
+                                    const Deadline* deadline,
+                                    int* minified_size) {
   Minifier<SizeConsumer> minifier(input, NULL);
+  minifier.SetDeadline(deadline);
   SizeConsumer* output = minifier.GetOutput();
   if (output) {
     *minified_size = output->size();
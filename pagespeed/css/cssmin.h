@@ -19,16 +19,33 @@
 
 #include <string>
 
+#include "base/string_piece.h"
+
 namespace pagespeed {
 
+class Deadline;
+
 namespace css {
 
 // Minifies CSS by removing comments and whitespaces.
-bool MinifyCss(const std::string& input, std::string* out);
+bool MinifyCss(const base::StringPiece& input, std::string* out);
+
+// Same as above, but fail if the given deadline (which may be NULL)
+// expires before minification is complete.
+bool MinifyCssWithDeadline(const base::StringPiece& input,
+                           const Deadline* deadline,
+                           std::string* out);
 
 // Calculate the minified size without actually constructing the minified
 // output.
-bool GetMinifiedCssSize(const std::string& input, int* minified_size);
+bool GetMinifiedCssSize(const base::StringPiece& input,
+                        int* minified_size);
+
+// Same as above, but fail if the given deadline (which may be NULL)
+// expires before minification is complete.
+bool GetMinifiedCssSizeWithDeadline(const base::StringPiece& input,
+                                    const Deadline* deadline,
+                                    int* minified_size);
 
 }  // namespace css
 
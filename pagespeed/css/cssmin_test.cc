@@ -15,6 +15,7 @@
 #include <string>
 
 #include "pagespeed/css/cssmin.h"
+#include "pagespeed/util/deadline.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace {
@@ -139,4 +140,20 @@ TEST_F(CssminTest, DoNotJoinTokensSeparatedByComment1) {
                     ".foo .bar{color:blue;}");
 }
 
+TEST_F(CssminTest, ExpiredDeadline) {
+  pagespeed::Deadline deadline;
+  std::string output;
+  ASSERT_TRUE(pagespeed::css::MinifyCssWithDeadline(
+      "body { color: red; }", &deadline, &output));
+  ASSERT_EQ("body{color:red;}", output);
+
+  deadline.Cancel();
+  output.clear();
+  ASSERT_FALSE(pagespeed::css::MinifyCssWithDeadline(
+      "body { color: red; }", &deadline, &output));
+  int size = 0;
+  ASSERT_FALSE(pagespeed::css::GetMinifiedCssSizeWithDeadline(
+      "body { color: red; }", &deadline, &size));
+}
+
 }  // namespace
@@ -63,12 +63,12 @@ void FindExternalResourcesInCssResource(
     return;
   }
   FindExternalResourcesInCssBlock(
-      resource.GetRequestUrl(), resource.GetResponseBody(),
+      resource.GetRequestUrl(), resource.GetResponseBodyPiece(),
       external_resource_urls);
 }
 
 void FindExternalResourcesInCssBlock(
-    const std::string& resource_url, const std::string& css_body,
+    const std::string& resource_url, const base::StringPiece& css_body,
     std::set<std::string>* external_resource_urls) {
   std::string body;
 
@@ -119,12 +119,12 @@ void FindImportsInCssResource(
     return;
   }
   FindImportsInCssBlock(
-      resource.GetRequestUrl(), resource.GetResponseBody(),
+      resource.GetRequestUrl(), resource.GetResponseBodyPiece(),
       imported_urls);
 }
 
 void FindImportsInCssBlock(
-    const std::string& resource_url, const std::string& css_body,
+    const std::string& resource_url, const base::StringPiece& css_body,
     std::set<std::string>* imported_urls) {
   std::string body;
 
@@ -176,19 +176,19 @@ void FindImportsInCssBlock(
 // SGML comments, since these are supported only for very old user
 // agents. If many web pages do use such comments, we may need to add
 // support for them.
-void RemoveCssComments(const std::string& in, std::string* out) {
+void RemoveCssComments(const base::StringPiece& in, std::string* out) {
   size_t comment_start = 0;
   while (true) {
     const size_t previous_start = comment_start;
     comment_start = in.find(kCommentStart, comment_start);
     if (comment_start == in.npos) {
       // No more comments. Append to end of string and we're done.
-      out->append(in, previous_start, in.length() - previous_start);
+      out->append(in.data() + previous_start, in.length() - previous_start);
       break;
     }
 
     // Append the content before the start of the comment.
-    out->append(in, previous_start, comment_start - previous_start);
+    out->append(in.data() + previous_start, comment_start - previous_start);
 
     const size_t comment_end =
         in.find(kCommentEnd, comment_start + kCommentStartLen);
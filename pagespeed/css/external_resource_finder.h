@@ -19,6 +19,7 @@
 #include <string>
 
 #include "base/basictypes.h"
+#include "base/string_piece.h"
 
 namespace pagespeed {
 
@@ -36,7 +37,7 @@ void FindExternalResourcesInCssResource(
 // either be the body of an external CSS resource, or the contents of an inline
 // CSS block in an HTML resource.
 void FindExternalResourcesInCssBlock(
-    const std::string& resource_url, const std::string& css_body,
+    const std::string& resource_url, const base::StringPiece& css_body,
     std::set<std::string>* external_resource_urls);
 
 // Get all imported URLs contained in the body of the given CSS
@@ -49,12 +50,12 @@ void FindImportsInCssResource(
 // either be the body of an external CSS resource, or the contents of an inline
 // CSS block in an HTML resource.
 void FindImportsInCssBlock(
-    const std::string& resource_url, const std::string& css_body,
+    const std::string& resource_url, const base::StringPiece& css_body,
     std::set<std::string>* imported_urls);
 
 // These function is exposed only for unit testing.  It should not be called by
 // non-test code.
-void RemoveCssComments(const std::string& in, std::string* out);
+void RemoveCssComments(const base::StringPiece& in, std::string* out);
 
 
 // Simple CSS tokenizer.  Generates a stream of tokens along with the
@@ -15,12 +15,17 @@
 #include "pagespeed/dom/json_dom.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/basictypes.h"
+#include "base/hash_tables.h"
 #include "base/logging.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/stl_util.h"
 #include "base/values.h"
+#include "pagespeed/core/json_stream_parser.h"
 
 namespace pagespeed {
 
@@ -28,35 +33,370 @@ namespace dom {
 
 namespace {
 
-std::string DemandString(const base::DictionaryValue& dict, const std::string& key) {
-  std::string out;
-  if (!dict.GetStringWithoutPathExpansion(key, &out)) {
-    LOG(DFATAL) << "Could not get string: " << key;
+// A string stored in CompactDom::strings.
+struct StringRef {
+  uint32 offset;
+  uint32 length;
+};
+
+struct Attribute {
+  int32 name;  // Index into CompactDom::names.
+  StringRef value;
+};
+
+// Bits of Element::flags.
+enum {
+  kElementIsObject = 1 << 0,  // False for non-object items of "elements".
+  kHasWidth = 1 << 1,
+  kHasHeight = 1 << 2,
+  kHasWidthSpecified = 1 << 3,
+  kWidthSpecified = 1 << 4,
+  kHasHeightSpecified = 1 << 5,
+  kHeightSpecified = 1 << 6,
+};
+
+struct Element {
+  int32 tag;  // Index into CompactDom::names, or -1 if there is no tag.
+  uint32 flags;
+  int32 width;
+  int32 height;
+  uint32 first_attribute;
+  uint32 num_attributes;
+  uint32 first_child;
+  uint32 num_children;
+  int32 content_document;  // Index into CompactDom::documents, or -1.
+};
+
+// Bits of Document::flags.
+enum {
+  kHasDocumentUrl = 1 << 0,
+  kHasBaseUrl = 1 << 1,
+  kHasElements = 1 << 2,
+  kIsResponsive = 1 << 3,
+};
+
+struct Document {
+  StringRef document_url;
+  StringRef base_url;
+  uint32 flags;
+  uint32 first_element;
+  uint32 num_elements;
+};
+
+// A JSON DOM, and the DOMs of all of its subdocuments, stored in flat
+// arrays so that each element, attribute and child is a few array
+// lookups away. Element and attribute names are interned. Built once
+// from the JSON, and then shared by the JsonDocuments and JsonElements
+// that refer to it.
+struct CompactDom : public base::RefCountedThreadSafe<CompactDom> {
+  typedef base::hash_map<std::string, int32> NameMap;
+
+  base::StringPiece GetString(const StringRef& ref) const {
+    return base::StringPiece(strings).substr(ref.offset, ref.length);
+  }
+
+  // Returns the index of the given name, or -1 if no element or
+  // attribute has that name.
+  int32 FindName(const std::string& name) const {
+    NameMap::const_iterator it = name_indices.find(name);
+    return it == name_indices.end() ? -1 : it->second;
+  }
+
+  std::vector<Document> documents;  // The root document comes first.
+  std::vector<Element> elements;
+  std::vector<Attribute> attributes;
+  std::vector<int32> children;  // Indices into elements, or -1.
+  std::vector<std::string> names;
+  NameMap name_indices;
+  std::string strings;
+
+ private:
+  friend class base::RefCountedThreadSafe<CompactDom>;
+  ~CompactDom() {}
+};
+
+// Builds a CompactDom, one document at a time. The elements of each
+// document are added contiguously, so the subdocuments of a document
+// are only added once all of its elements have been.
+class CompactDomBuilder : public pagespeed::JsonStreamParser::Delegate {
+ public:
+  CompactDomBuilder() : dom_(new CompactDom) {}
+  virtual ~CompactDomBuilder() { STLDeleteElements(&owned_values_); }
+
+  // Add the document described by the given JSON, and all of its
+  // subdocuments. Returns the index of the document.
+  int32 AddDocument(const base::DictionaryValue& json);
+
+  // Parse the given JSON document, adding its elements as they are
+  // parsed, rather than once the whole document has been. Returns false
+  // if the JSON is malformed.
+  bool ParseRootDocument(const base::StringPiece& json,
+                         std::string* error_msg_out);
+
+  CompactDom* dom() { return dom_.get(); }
+
+  // JsonStreamParser::Delegate interface:
+  virtual bool ShouldStreamArrayElements(
+      const pagespeed::JsonStreamParser::Path& path);
+  virtual bool OnArrayElement(const pagespeed::JsonStreamParser::Path& path,
+                              base::Value* element);
+
+ private:
+  // A subdocument whose elements are to be added once those of its
+  // parent document have been.
+  struct PendingDocument {
+    uint32 element;
+    const base::DictionaryValue* json;
+  };
+
+  int32 StartDocument();
+  void SetDocumentFields(int32 document, const base::DictionaryValue& json);
+  void AddElement(const base::Value& json);
+  void FinishDocument(int32 document);
+
+  StringRef AddString(const std::string& value);
+  int32 InternName(const std::string& name);
+
+  scoped_refptr<CompactDom> dom_;
+
+  // The element indices listed in the "children" of each element of the
+  // current document, indexed by their position within the document.
+  std::vector<std::vector<int> > pending_children_;
+  std::vector<PendingDocument> pending_documents_;
+
+  // Elements passed to OnArrayElement that hold subdocuments, which are
+  // added after the root document's elements.
+  std::vector<base::Value*> owned_values_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompactDomBuilder);
+};
+
+StringRef CompactDomBuilder::AddString(const std::string& value) {
+  StringRef ref;
+  ref.offset = dom_->strings.size();
+  ref.length = value.size();
+  dom_->strings.append(value);
+  return ref;
+}
+
+int32 CompactDomBuilder::InternName(const std::string& name) {
+  std::pair<CompactDom::NameMap::iterator, bool> inserted =
+      dom_->name_indices.insert(
+          std::make_pair(name, static_cast<int32>(dom_->names.size())));
+  if (inserted.second) {
+    dom_->names.push_back(name);
+  }
+  return inserted.first->second;
+}
+
+int32 CompactDomBuilder::StartDocument() {
+  Document document;
+  document.document_url.offset = 0;
+  document.document_url.length = 0;
+  document.base_url = document.document_url;
+  document.flags = 0;
+  document.first_element = dom_->elements.size();
+  document.num_elements = 0;
+  dom_->documents.push_back(document);
+  pending_children_.clear();
+  return static_cast<int32>(dom_->documents.size() - 1);
+}
+
+void CompactDomBuilder::SetDocumentFields(int32 index,
+                                          const base::DictionaryValue& json) {
+  Document& document = dom_->documents[index];
+  std::string value;
+  if (json.GetStringWithoutPathExpansion("documentUrl", &value)) {
+    document.document_url = AddString(value);
+    document.flags |= kHasDocumentUrl;
+  }
+  if (json.GetStringWithoutPathExpansion("baseUrl", &value)) {
+    document.base_url = AddString(value);
+    document.flags |= kHasBaseUrl;
+  }
+  bool is_responsive = false;
+  if (json.GetBoolean("isResponsive", &is_responsive) && is_responsive) {
+    document.flags |= kIsResponsive;
+  }
+  const base::ListValue* elements = NULL;
+  if (json.GetListWithoutPathExpansion("elements", &elements)) {
+    document.flags |= kHasElements;
   }
-  return out;
 }
 
-void DemandIntegerList(const base::DictionaryValue& dict,
-                       const std::string& key, std::vector<int>* out) {
-  out->clear();
-  const base::ListValue* list;
-  if (dict.GetListWithoutPathExpansion(key, &list)) {
-    for (size_t idx = 0, size = list->GetSize(); idx < size; ++idx) {
-      int num;
-      if (!list->GetInteger(idx, &num)) {
+void CompactDomBuilder::AddElement(const base::Value& value) {
+  Element element;
+  element.tag = -1;
+  element.flags = 0;
+  element.width = 0;
+  element.height = 0;
+  element.first_attribute = dom_->attributes.size();
+  element.num_attributes = 0;
+  element.first_child = 0;
+  element.num_children = 0;
+  element.content_document = -1;
+  pending_children_.push_back(std::vector<int>());
+
+  if (!value.IsType(base::Value::TYPE_DICTIONARY)) {
+    LOG(ERROR) << "non-object item in \"elements\" list";
+    dom_->elements.push_back(element);
+    return;
+  }
+  const base::DictionaryValue& json =
+      static_cast<const base::DictionaryValue&>(value);
+  element.flags |= kElementIsObject;
+
+  std::string tag;
+  if (json.GetStringWithoutPathExpansion("tag", &tag)) {
+    element.tag = InternName(tag);
+  }
+
+  const base::DictionaryValue* attrs = NULL;
+  if (json.GetDictionaryWithoutPathExpansion("attrs", &attrs)) {
+    for (base::DictionaryValue::key_iterator it = attrs->begin_keys(),
+             end = attrs->end_keys(); it != end; ++it) {
+      std::string attr_value;
+      if (!attrs->GetStringWithoutPathExpansion(*it, &attr_value)) {
+        continue;
+      }
+      Attribute attribute;
+      attribute.name = InternName(*it);
+      attribute.value = AddString(attr_value);
+      dom_->attributes.push_back(attribute);
+      ++element.num_attributes;
+    }
+  }
+
+  int size = 0;
+  if (json.GetIntegerWithoutPathExpansion("width", &size)) {
+    element.width = size;
+    element.flags |= kHasWidth;
+  }
+  if (json.GetIntegerWithoutPathExpansion("height", &size)) {
+    element.height = size;
+    element.flags |= kHasHeight;
+  }
+  bool specified = false;
+  if (json.GetBooleanWithoutPathExpansion("hasWidthSpecified", &specified)) {
+    element.flags |= kHasWidthSpecified | (specified ? kWidthSpecified : 0);
+  }
+  if (json.GetBooleanWithoutPathExpansion("hasHeightSpecified", &specified)) {
+    element.flags |= kHasHeightSpecified | (specified ? kHeightSpecified : 0);
+  }
+
+  const base::ListValue* children = NULL;
+  if (json.GetListWithoutPathExpansion("children", &children)) {
+    std::vector<int>* child_indices = &pending_children_.back();
+    for (size_t idx = 0, size = children->GetSize(); idx < size; ++idx) {
+      int child = -1;
+      if (!children->GetInteger(idx, &child)) {
         LOG(DFATAL) << "Could not get integer from list at " << idx << ".";
-        num = -1;
+        child = -1;
       }
-      out->push_back(num);
+      child_indices->push_back(child);
     }
-  } else {
-    // The key does not exist, keep the output empty.
   }
+
+  const base::DictionaryValue* content_document = NULL;
+  if (json.GetDictionaryWithoutPathExpansion("contentDocument",
+                                             &content_document)) {
+    PendingDocument pending;
+    pending.element = dom_->elements.size();
+    pending.json = content_document;
+    pending_documents_.push_back(pending);
+  }
+
+  dom_->elements.push_back(element);
+}
+
+void CompactDomBuilder::FinishDocument(int32 index) {
+  Document& document = dom_->documents[index];
+  document.num_elements = dom_->elements.size() - document.first_element;
+  DCHECK_EQ(document.num_elements, pending_children_.size());
+
+  // Now that the document's elements are known, resolve the
+  // document-relative indices of their children.
+  for (uint32 i = 0; i < document.num_elements; ++i) {
+    Element& element = dom_->elements[document.first_element + i];
+    const std::vector<int>& child_indices = pending_children_[i];
+    element.first_child = dom_->children.size();
+    element.num_children = child_indices.size();
+    for (std::vector<int>::const_iterator it = child_indices.begin(),
+             end = child_indices.end(); it != end; ++it) {
+      const bool in_range =
+          *it >= 0 && static_cast<uint32>(*it) < document.num_elements;
+      dom_->children.push_back(
+          in_range ? static_cast<int32>(document.first_element + *it) : -1);
+    }
+  }
+  pending_children_.clear();
+
+  std::vector<PendingDocument> subdocuments;
+  subdocuments.swap(pending_documents_);
+  for (std::vector<PendingDocument>::const_iterator it = subdocuments.begin(),
+           end = subdocuments.end(); it != end; ++it) {
+    const int32 subdocument = AddDocument(*it->json);
+    dom_->elements[it->element].content_document = subdocument;
+  }
+}
+
+int32 CompactDomBuilder::AddDocument(const base::DictionaryValue& json) {
+  const int32 document = StartDocument();
+  SetDocumentFields(document, json);
+  const base::ListValue* elements = NULL;
+  if (json.GetListWithoutPathExpansion("elements", &elements)) {
+    for (size_t idx = 0, size = elements->GetSize(); idx < size; ++idx) {
+      const base::Value* element = NULL;
+      elements->Get(idx, &element);
+      AddElement(*element);
+    }
+  }
+  FinishDocument(document);
+  return document;
+}
+
+bool CompactDomBuilder::ParseRootDocument(const base::StringPiece& json,
+                                          std::string* error_msg_out) {
+  const int32 document = StartDocument();
+  pagespeed::JsonStreamParser parser(this);
+  scoped_ptr<base::Value> root(parser.Parse(json, error_msg_out));
+  if (root == NULL) {
+    return false;
+  }
+  if (!root->IsType(base::Value::TYPE_DICTIONARY)) {
+    if (error_msg_out != NULL) {
+      *error_msg_out = "DOM JSON is not an object";
+    }
+    return false;
+  }
+  SetDocumentFields(document,
+                    *static_cast<const base::DictionaryValue*>(root.get()));
+  FinishDocument(document);
+  return true;
+}
+
+bool CompactDomBuilder::ShouldStreamArrayElements(
+    const pagespeed::JsonStreamParser::Path& path) {
+  return path.size() == 1 && path[0] == "elements";
+}
+
+bool CompactDomBuilder::OnArrayElement(
+    const pagespeed::JsonStreamParser::Path& path, base::Value* element) {
+  scoped_ptr<base::Value> value(element);
+  const size_t num_pending_documents = pending_documents_.size();
+  AddElement(*value);
+  if (pending_documents_.size() != num_pending_documents) {
+    // Keep the element, which owns its subdocument, until the
+    // subdocument has been added.
+    owned_values_.push_back(value.release());
+  }
+  return true;
 }
 
 class JsonDocument : public pagespeed::DomDocument {
  public:
-  explicit JsonDocument(const base::DictionaryValue* json) { json_.reset(json); }
+  JsonDocument(const CompactDom* dom, int32 index)
+      : dom_(dom), document_(dom->documents[index]) {}
   virtual ~JsonDocument() {}
 
   // DomDocument interface:
@@ -65,18 +405,17 @@ class JsonDocument : public pagespeed::DomDocument {
   virtual bool IsResponsive() const;
   virtual void Traverse(pagespeed::DomElementVisitor* visitor) const;
 
-  bool GetElement(int index, const base::DictionaryValue** element) const;
-
  private:
-  scoped_ptr<const base::DictionaryValue> json_;
+  scoped_refptr<const CompactDom> dom_;
+  const Document& document_;
 
   DISALLOW_COPY_AND_ASSIGN(JsonDocument);
 };
 
 class JsonElement : public pagespeed::DomElement {
  public:
-  JsonElement(const base::DictionaryValue* json, const JsonDocument* json_doc)
-      : json_(json), json_doc_(json_doc) {}
+  JsonElement(const CompactDom* dom, int32 index)
+      : dom_(dom), element_(dom->elements[index]) {}
   virtual ~JsonElement() {}
 
   // DomElement interface:
@@ -91,80 +430,88 @@ class JsonElement : public pagespeed::DomElement {
   virtual Status GetNumChildren(size_t* number) const;
   virtual Status GetChild(const DomElement** child, size_t index) const;
  private:
-  const base::DictionaryValue* json_;
-  const JsonDocument* json_doc_;
+  // JsonElements only live while the document they belong to, and so
+  // the CompactDom, is alive.
+  const CompactDom* dom_;
+  const Element& element_;
 
   DISALLOW_COPY_AND_ASSIGN(JsonElement);
 };
 
 std::string JsonDocument::GetDocumentUrl() const {
-  return DemandString(*json_, "documentUrl");
+  if ((document_.flags & kHasDocumentUrl) == 0) {
+    LOG(DFATAL) << "Could not get string: documentUrl";
+  }
+  return dom_->GetString(document_.document_url).as_string();
 }
 
 std::string JsonDocument::GetBaseUrl() const {
-  return DemandString(*json_, "baseUrl");
+  if ((document_.flags & kHasBaseUrl) == 0) {
+    LOG(DFATAL) << "Could not get string: baseUrl";
+  }
+  return dom_->GetString(document_.base_url).as_string();
 }
 
 bool JsonDocument::IsResponsive() const {
-  bool isResponsive = false;
-  if (!json_->GetBoolean("isResponsive", &isResponsive)) {
-    return false;
-  }
-  return isResponsive;
+  return (document_.flags & kIsResponsive) != 0;
 }
 
 void JsonDocument::Traverse(pagespeed::DomElementVisitor* visitor) const {
-  const base::ListValue* elements;
-  if (!json_->GetListWithoutPathExpansion("elements", &elements)) {
+  if ((document_.flags & kHasElements) == 0) {
     LOG(ERROR) << "missing \"elements\" in JSON for JsonDocument";
     return;
   }
 
-  for (int index = 0, size = elements->GetSize(); index < size; ++index) {
-    const base::DictionaryValue* dict;
-    if (!elements->GetDictionary(index, &dict)) {
-      LOG(ERROR) << "non-object item in \"elements\" list";
+  for (uint32 index = document_.first_element,
+           end = document_.first_element + document_.num_elements;
+       index < end; ++index) {
+    if ((dom_->elements[index].flags & kElementIsObject) == 0) {
       continue;
     }
-    JsonElement element(dict, this);
+    JsonElement element(dom_.get(), index);
     visitor->Visit(element);
   }
 }
 
-bool JsonDocument::GetElement(int index, const base::DictionaryValue** element) const {
-  const base::ListValue* elements;
-  if (!json_->GetListWithoutPathExpansion("elements", &elements)) {
-    LOG(ERROR) << "missing \"elements\" in JSON for JsonDocument";
-    return false;
-  }
-
-  if (!elements->GetDictionary(index, element)) {
-    LOG(ERROR) << "non-object item in \"elements\" list";
-    return false;
-  }
-  return true;
-}
-
 pagespeed::DomDocument* JsonElement::GetContentDocument() const {
-  const base::DictionaryValue* out;
-  // TODO(lsong): Use ref counted instead of DeepCopy().
-  return (json_->GetDictionaryWithoutPathExpansion("contentDocument", &out) ?
-          new JsonDocument(static_cast<base::DictionaryValue*>(out->DeepCopy()))
-          : NULL);
+  return element_.content_document < 0 ?
+      NULL : new JsonDocument(dom_, element_.content_document);
 }
 
 std::string JsonElement::GetTagName() const {
-  return DemandString(*json_, "tag");
+  if (element_.tag < 0) {
+    LOG(DFATAL) << "Could not get string: tag";
+    return "";
+  }
+  return dom_->names[element_.tag];
 }
 
 bool JsonElement::GetAttributeByName(const std::string& name,
                                      std::string* attr_value) const {
-  return json_->GetString("attrs." + name, attr_value);
+  if (element_.num_attributes == 0) {
+    return false;
+  }
+  const int32 name_index = dom_->FindName(name);
+  if (name_index < 0) {
+    return false;
+  }
+  for (uint32 i = element_.first_attribute,
+           end = element_.first_attribute + element_.num_attributes;
+       i < end; ++i) {
+    const Attribute& attribute = dom_->attributes[i];
+    if (attribute.name == name_index) {
+      dom_->GetString(attribute.value).CopyToString(attr_value);
+      return true;
+    }
+  }
+  return false;
 }
 
 JsonElement::Status
 JsonElement::HasWidthSpecified(bool* out_width_specified) const {
-  if (!json_->GetBoolean("hasWidthSpecified", out_width_specified)) {
+  if ((element_.flags & kHasWidthSpecified) != 0) {
+    *out_width_specified = (element_.flags & kWidthSpecified) != 0;
+  } else {
     std::string value;
     *out_width_specified = (GetAttributeByName("width", &value) &&
                             !value.empty());
@@ -174,7 +521,9 @@ JsonElement::HasWidthSpecified(bool* out_width_specified) const {
 
 JsonElement::Status
 JsonElement::HasHeightSpecified(bool* out_height_specified) const {
-  if (!json_->GetBoolean("hasHeightSpecified", out_height_specified)) {
+  if ((element_.flags & kHasHeightSpecified) != 0) {
+    *out_height_specified = (element_.flags & kHeightSpecified) != 0;
+  } else {
     std::string value;
     *out_height_specified = (GetAttributeByName("height", &value) &&
                             !value.empty());
@@ -183,41 +532,55 @@ JsonElement::HasHeightSpecified(bool* out_height_specified) const {
 }
 
 JsonElement::Status JsonElement::GetActualWidth(int* out_width) const {
-  return (json_->GetIntegerWithoutPathExpansion("width", out_width) ?
-          SUCCESS : FAILURE);
+  if ((element_.flags & kHasWidth) == 0) {
+    return FAILURE;
+  }
+  *out_width = element_.width;
+  return SUCCESS;
 }
 
 JsonElement::Status JsonElement::GetActualHeight(int* out_height) const {
-  return (json_->GetIntegerWithoutPathExpansion("height", out_height) ?
-          SUCCESS : FAILURE);
+  if ((element_.flags & kHasHeight) == 0) {
+    return FAILURE;
+  }
+  *out_height = element_.height;
+  return SUCCESS;
 }
 
 DomElement::Status JsonElement::GetNumChildren(size_t* number) const {
-  *number = 0;
-  const base::ListValue* list;
-  if (json_->GetListWithoutPathExpansion("children", &list)) {
-    *number = list->GetSize();
-  }
+  *number = element_.num_children;
   return SUCCESS;
 }
 
 DomElement::Status JsonElement::GetChild(
     const DomElement** child, size_t index) const {
-  std::vector<int> children_indices;
-  DemandIntegerList(*json_, "children", &children_indices);
-  const base::DictionaryValue* dict = NULL;
-  if (index < children_indices.size() &&
-      json_doc_->GetElement(children_indices[index], &dict)) {
-    *child = new JsonElement(dict, json_doc_);
+  const int32 child_index = index < element_.num_children ?
+      dom_->children[element_.first_child + index] : -1;
+  if (child_index >= 0 &&
+      (dom_->elements[child_index].flags & kElementIsObject) != 0) {
+    *child = new JsonElement(dom_, child_index);
   } else {
     *child = NULL;
   }
   return SUCCESS;
 }
+
 }  // namespace
 
 pagespeed::DomDocument* CreateDocument(const base::DictionaryValue* json) {
-  return new JsonDocument(json);
+  scoped_ptr<const base::DictionaryValue> json_ptr(json);
+  CompactDomBuilder builder;
+  builder.AddDocument(*json);
+  return new JsonDocument(builder.dom(), 0);
+}
+
+pagespeed::DomDocument* CreateDocumentFromJson(const base::StringPiece& json,
+                                               std::string* error_msg_out) {
+  CompactDomBuilder builder;
+  if (!builder.ParseRootDocument(json, error_msg_out)) {
+    return NULL;
+  }
+  return new JsonDocument(builder.dom(), 0);
 }
 
 }  // namespace dom
@@ -15,6 +15,9 @@
 #ifndef PAGESPEED_DOM_JSON_DOM_H_
 #define PAGESPEED_DOM_JSON_DOM_H_
 
+#include <string>
+
+#include "base/string_piece.h"
 #include "pagespeed/core/dom.h"
 
 namespace base {
@@ -24,9 +27,19 @@ class DictionaryValue;
 namespace pagespeed {
 namespace dom {
 
-// Create DomDocument from JSON. The created docuemnt owns the JSON.
+// Create DomDocument from JSON. Takes ownership of the JSON, which is
+// converted into a compact representation of the document and then
+// deleted.
 pagespeed::DomDocument* CreateDocument(const base::DictionaryValue* json);
 
+// Create DomDocument from a JSON string, converting the elements of the
+// document as they are parsed, so that the JSON for the whole document
+// is never held in memory. Returns NULL if the JSON is malformed, in
+// which case error_msg_out (if non-NULL) is set to a description of the
+// error.
+pagespeed::DomDocument* CreateDocumentFromJson(const base::StringPiece& json,
+                                               std::string* error_msg_out);
+
 }  // namespace dom
 }  // namespace pagespeed
 
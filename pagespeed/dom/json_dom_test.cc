@@ -18,6 +18,7 @@
 #include "base/basictypes.h"
 #include "base/json/json_reader.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/stl_util.h"
 #include "base/values.h"
 #include "pagespeed/core/dom.h"
 #include "pagespeed/core/string_util.h"
@@ -54,6 +55,15 @@ class JsonDomTest : public testing::Test {
         static_cast<const base::DictionaryValue*>(value.release())));
   }
 
+  void ParseStreaming(const std::string& json_text) {
+    std::string error_msg_out;
+    document_.reset(pagespeed::dom::CreateDocumentFromJson(json_text,
+                                                           &error_msg_out));
+    if (document_ == NULL) {
+      ADD_FAILURE() << "Couldn't parse JSON text: " << error_msg_out;
+    }
+  }
+
   DomDocument* document() { return document_.get(); }
 
  private:
@@ -261,4 +271,145 @@ TEST_F(JsonDomTest, Children) {
 }
 
 
+
+const char* kSubDocumentsJson =
+    "{\"documentUrl\":\"http://www.example.com/index.html\","
+    " \"baseUrl\":\"http://www.example.com/\",\"elements\":["
+    "  {\"tag\":\"HTML\", \"children\":[1,2]},"
+    "  {\"tag\":\"IFRAME\", \"attrs\":{\"src\":\"foo.html\"},"
+    "   \"contentDocument\":"
+    "    {\"documentUrl\":\"foo.html\",\"baseUrl\":\"\",\"elements\":["
+    "      {\"tag\":\"DIV\", \"children\":[1]},"
+    "      {\"tag\":\"IMG\", \"attrs\":{\"src\":\"a.png\"}}"
+    "    ]}},"
+    "  {\"tag\":\"IMG\", \"attrs\":{\"src\":\"b.png\"},"
+    "   \"width\":10,\"height\":20}"
+    "], \"isResponsive\":true}";
+
+TEST_F(JsonDomTest, Streaming) {
+  ParseStreaming(kSubDocumentsJson);
+  ASSERT_FALSE(NULL == document());
+  EXPECT_EQ("http://www.example.com/index.html", document()->GetDocumentUrl());
+  EXPECT_EQ("http://www.example.com/", document()->GetBaseUrl());
+  EXPECT_TRUE(document()->IsResponsive());
+
+  TagVisitor tag_visitor;
+  document()->Traverse(&tag_visitor);
+  ASSERT_EQ(5u, tag_visitor.tags().size());
+  EXPECT_EQ("HTML", tag_visitor.tags()[0]);
+  EXPECT_EQ("IFRAME", tag_visitor.tags()[1]);
+  EXPECT_EQ("DIV", tag_visitor.tags()[2]);
+  EXPECT_EQ("IMG", tag_visitor.tags()[3]);
+  EXPECT_EQ("IMG", tag_visitor.tags()[4]);
+
+  ChildrenVisitor children_visitor;
+  document()->Traverse(&children_visitor);
+  ASSERT_EQ(3u, children_visitor.children().size());
+  EXPECT_EQ("IFRAME", children_visitor.children()[0]);
+  EXPECT_EQ("IMG", children_visitor.children()[1]);
+  EXPECT_EQ("IMG", children_visitor.children()[2]);
+
+  // ImageVisitor does not visit subdocuments.
+  ImageVisitor image_visitor;
+  document()->Traverse(&image_visitor);
+  EXPECT_EQ("[b.png|10x20|wh]", image_visitor.output());
+}
+
+TEST_F(JsonDomTest, StreamingMatchesDictionary) {
+  Parse(kSubDocumentsJson);
+  ASSERT_FALSE(NULL == document());
+  TagVisitor dictionary_visitor;
+  document()->Traverse(&dictionary_visitor);
+  ImageVisitor dictionary_image_visitor;
+  document()->Traverse(&dictionary_image_visitor);
+
+  ParseStreaming(kSubDocumentsJson);
+  ASSERT_FALSE(NULL == document());
+  TagVisitor streaming_visitor;
+  document()->Traverse(&streaming_visitor);
+  ImageVisitor streaming_image_visitor;
+  document()->Traverse(&streaming_image_visitor);
+
+  EXPECT_EQ(dictionary_visitor.tags(), streaming_visitor.tags());
+  EXPECT_EQ(dictionary_image_visitor.output(),
+            streaming_image_visitor.output());
+}
+
+TEST_F(JsonDomTest, StreamingMalformed) {
+  std::string error_msg_out;
+  scoped_ptr<DomDocument> document(pagespeed::dom::CreateDocumentFromJson(
+      "{\"elements\":[{\"tag\":\"HTML\"},", &error_msg_out));
+  EXPECT_TRUE(document == NULL);
+  EXPECT_FALSE(error_msg_out.empty());
+
+  document.reset(pagespeed::dom::CreateDocumentFromJson("[]", NULL));
+  EXPECT_TRUE(document == NULL);
+}
+
+TEST_F(JsonDomTest, ChildOutOfRange) {
+  Parse("{\"documentUrl\":\"http://www.example.com/index.html\","
+        " \"baseUrl\":\"http://www.example.com/\",\"elements\":["
+        "  {\"tag\":\"HTML\", \"children\":[1,5]},"
+        "  {\"tag\":\"BODY\"}"
+        "]}");
+  ASSERT_FALSE(NULL == document());
+
+  class FirstElementVisitor : public pagespeed::DomElementVisitor {
+   public:
+    FirstElementVisitor() : visited_(false) {}
+    virtual void Visit(const DomElement& node) {
+      if (visited_) {
+        return;
+      }
+      visited_ = true;
+      size_t size = 0;
+      ASSERT_EQ(DomElement::SUCCESS, node.GetNumChildren(&size));
+      ASSERT_EQ(2u, size);
+      const DomElement* child = NULL;
+      ASSERT_EQ(DomElement::SUCCESS, node.GetChild(&child, 0));
+      scoped_ptr<const DomElement> child_ptr(child);
+      ASSERT_FALSE(NULL == child);
+      EXPECT_EQ("BODY", child->GetTagName());
+      ASSERT_EQ(DomElement::SUCCESS, node.GetChild(&child, 1));
+      EXPECT_TRUE(NULL == child);
+      ASSERT_EQ(DomElement::SUCCESS, node.GetChild(&child, 2));
+      EXPECT_TRUE(NULL == child);
+    }
+   private:
+    bool visited_;
+  };
+  FirstElementVisitor visitor;
+  document()->Traverse(&visitor);
+}
+
+class ContentDocumentVisitor : public pagespeed::DomElementVisitor {
+ public:
+  ContentDocumentVisitor() {}
+  virtual void Visit(const DomElement& node) {
+    DomDocument* document = node.GetContentDocument();
+    if (document != NULL) {
+      documents_.push_back(document);
+    }
+  }
+  ~ContentDocumentVisitor() { STLDeleteElements(&documents_); }
+  const std::vector<DomDocument*>& documents() const { return documents_; }
+ private:
+  std::vector<DomDocument*> documents_;
+  DISALLOW_COPY_AND_ASSIGN(ContentDocumentVisitor);
+};
+
+TEST_F(JsonDomTest, ContentDocumentOutlivesDocument) {
+  ParseStreaming(kSubDocumentsJson);
+  ASSERT_FALSE(NULL == document());
+  ContentDocumentVisitor visitor;
+  document()->Traverse(&visitor);
+  ParseStreaming("{\"documentUrl\":\"\",\"baseUrl\":\"\",\"elements\":[]}");
+
+  ASSERT_EQ(1u, visitor.documents().size());
+  EXPECT_EQ("foo.html", visitor.documents()[0]->GetDocumentUrl());
+  ImageVisitor image_visitor;
+  visitor.documents()[0]->Traverse(&image_visitor);
+  EXPECT_EQ("[a.png|x|wh]", image_visitor.output());
+}
+
 }  // namespace
@@ -0,0 +1,51 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PAGESPEED_FILTERS_RULE_NAME_RESULT_FILTER_H_
+#define PAGESPEED_FILTERS_RULE_NAME_RESULT_FILTER_H_
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "pagespeed/core/engine.h"
+
+namespace pagespeed {
+
+class Result;
+class Rule;
+class RuleResults;
+
+// RuleNameResultFilter accepts only the results of the rules with the
+// given names. Since its decision depends only on the rule name, the
+// Engine uses it to avoid running the rules it rejects at all.
+class RuleNameResultFilter : public ResultFilter {
+ public:
+  explicit RuleNameResultFilter(const std::vector<std::string>& rule_names);
+  virtual ~RuleNameResultFilter();
+
+  virtual bool IsResultAccepted(const Result& result) const;
+  virtual bool IsRuleResultsAccepted(const RuleResults& results) const;
+  virtual bool IsRuleAccepted(const Rule& rule) const;
+
+ private:
+  std::set<std::string> rule_names_;
+
+  DISALLOW_COPY_AND_ASSIGN(RuleNameResultFilter);
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_FILTERS_RULE_NAME_RESULT_FILTER_H_
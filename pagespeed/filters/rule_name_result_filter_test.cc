@@ -0,0 +1,54 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <string>
+#include <vector>
+
+#include "pagespeed/filters/rule_name_result_filter.h"
+#include "pagespeed/proto/pagespeed_output.pb.h"
+#include "pagespeed/rules/avoid_bad_requests.h"
+#include "pagespeed/rules/avoid_css_import.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace pagespeed {
+
+TEST(RuleNameResultFilterTest, RuleNameResultFilter) {
+  std::vector<std::string> rule_names;
+  rule_names.push_back("AvoidBadRequests");
+  RuleNameResultFilter filter(rule_names);
+
+  rules::AvoidBadRequests accepted_rule;
+  rules::AvoidCssImport rejected_rule;
+  EXPECT_TRUE(filter.IsRuleAccepted(accepted_rule));
+  EXPECT_FALSE(filter.IsRuleAccepted(rejected_rule));
+
+  RuleResults rule_results;
+  rule_results.set_rule_name("AvoidBadRequests");
+  EXPECT_TRUE(filter.IsRuleResultsAccepted(rule_results));
+  rule_results.set_rule_name("AvoidCssImport");
+  EXPECT_FALSE(filter.IsRuleResultsAccepted(rule_results));
+
+  Result result;
+  EXPECT_TRUE(filter.IsResultAccepted(result));
+}
+
+TEST(RuleNameResultFilterTest, EmptyRuleNames) {
+  RuleNameResultFilter filter((std::vector<std::string>()));
+
+  rules::AvoidBadRequests rule;
+  EXPECT_FALSE(filter.IsRuleAccepted(rule));
+}
+
+}  // namespace pagespeed
@@ -220,7 +220,7 @@ void FillFormatString(const Localizer* loc,
 
 ProtoFormatter::ProtoFormatter(const Localizer* localizer,
                                FormattedResults* results)
-    : localizer_(localizer), results_(results) {
+    : localizer_(localizer), results_(results), listener_(NULL) {
   DCHECK(localizer_);
   DCHECK(results_);
 }
@@ -262,6 +262,23 @@ void ProtoFormatter::SetOverallScore(int score) {
   results_->set_score(score);
 }
 
+void ProtoFormatter::FinishRule() {
+  if (results_->rule_results_size() == 0) {
+    LOG(DFATAL) << "FinishRule called before AddRule.";
+    return;
+  }
+  FormattedRuleResults* rule_results =
+      results_->mutable_rule_results(results_->rule_results_size() - 1);
+  // Repair the impact as Finalize does, so that listeners see the
+  // rule's final impact.
+  if (rule_results->url_blocks_size() == 0) {
+    rule_results->set_rule_impact(0.0);
+  }
+  if (listener_ != NULL) {
+    listener_->OnRuleResults(*rule_results);
+  }
+}
+
 void ProtoFormatter::Finalize() {
   // Now for a superhack. If a ResultFilter is used, it may produce
   // rule results with no suggestions, or possibly an overall
@@ -281,6 +298,9 @@ void ProtoFormatter::Finalize() {
   if (!has_any_results && results_->has_score()) {
     results_->set_score(100);
   }
+  if (listener_ != NULL) {
+    listener_->OnFinalize(*results_);
+  }
 }
 
 ProtoRuleFormatter::ProtoRuleFormatter(const Localizer* localizer,
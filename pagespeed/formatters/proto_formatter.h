@@ -34,6 +34,27 @@ namespace l10n { class Localizer; }
 
 namespace formatters {
 
+/**
+ * Receives the formatted results of a ProtoFormatter incrementally, so
+ * that they can be written out before every rule has been formatted.
+ */
+class FormattedResultsListener {
+ public:
+  FormattedResultsListener() {}
+  virtual ~FormattedResultsListener() {}
+
+  // Called with the formatted results of each rule, in the order the
+  // rules were added, as soon as they are complete.
+  virtual void OnRuleResults(const FormattedRuleResults& rule_results) = 0;
+
+  // Called once all rules have been formatted, with the finalized
+  // results, which include the overall score.
+  virtual void OnFinalize(const FormattedResults& results) = 0;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(FormattedResultsListener);
+};
+
 /**
  * Formatter that fills in a localized FormattedResults proto.
  */
@@ -43,14 +64,22 @@ class ProtoFormatter : public Formatter {
                  FormattedResults* results);
   ~ProtoFormatter();
 
+  // Set a listener to notify as each rule is finished, and when the
+  // results are finalized. Ownership is not transferred.
+  void set_listener(FormattedResultsListener* listener) {
+    listener_ = listener;
+  }
+
   // Formatter interface.
   virtual RuleFormatter* AddRule(const Rule& rule, double impact);
   void SetOverallScore(int score);
+  void FinishRule();
   void Finalize();
 
  private:
   const pagespeed::l10n::Localizer* localizer_;
   FormattedResults* results_;
+  FormattedResultsListener* listener_;
   std::vector<RuleFormatter*> rule_formatters_;
 
   DISALLOW_COPY_AND_ASSIGN(ProtoFormatter);
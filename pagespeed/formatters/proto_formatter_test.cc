@@ -36,6 +36,7 @@ using pagespeed::RuleFormatter;
 using pagespeed::UrlBlockFormatter;
 using pagespeed::UrlFormatter;
 using pagespeed::UserFacingString;
+using pagespeed::formatters::FormattedResultsListener;
 using pagespeed::formatters::ProtoFormatter;
 using pagespeed::l10n::Localizer;
 using pagespeed::l10n::NullLocalizer;
@@ -315,4 +316,65 @@ TEST(ProtoFormatterTest, LocalizerTest) {
   ASSERT_EQ(0, r2.url_blocks_size());
 }
 
+// Records the rule results and finalized results passed to the listener.
+class RecordingListener : public FormattedResultsListener {
+ public:
+  RecordingListener() : num_finalize_calls_(0), score_(-1) {}
+
+  virtual void OnRuleResults(const FormattedRuleResults& rule_results) {
+    rule_results_.push_back(rule_results.SerializeAsString());
+  }
+
+  virtual void OnFinalize(const FormattedResults& results) {
+    ++num_finalize_calls_;
+    score_ = results.score();
+  }
+
+  const std::vector<std::string>& rule_results() const {
+    return rule_results_;
+  }
+  int num_finalize_calls() const { return num_finalize_calls_; }
+  int score() const { return score_; }
+
+ private:
+  std::vector<std::string> rule_results_;
+  int num_finalize_calls_;
+  int score_;
+
+  DISALLOW_COPY_AND_ASSIGN(RecordingListener);
+};
+
+TEST(ProtoFormatterTest, ListenerTest) {
+  FormattedResults results;
+  NullLocalizer localizer;
+  ProtoFormatter formatter(&localizer, &results);
+  RecordingListener listener;
+  formatter.set_listener(&listener);
+  results.set_locale("en_US.UTF-8");
+
+  DummyTestRule rule1(_N("rule1"));
+  DummyTestRule rule2(_N("rule2"));
+  RuleFormatter* rule_formatter = formatter.AddRule(rule1, 12.0);
+  rule_formatter->AddUrlBlock(_N("block"));
+  formatter.FinishRule();
+  ASSERT_EQ(1U, listener.rule_results().size());
+  ASSERT_EQ(results.rule_results(0).SerializeAsString(),
+            listener.rule_results()[0]);
+
+  // A rule without url blocks has its impact repaired before the
+  // listener sees it.
+  formatter.AddRule(rule2, 3.0);
+  formatter.FinishRule();
+  ASSERT_EQ(2U, listener.rule_results().size());
+  ASSERT_EQ(0.0, results.rule_results(1).rule_impact());
+  ASSERT_EQ(results.rule_results(1).SerializeAsString(),
+            listener.rule_results()[1]);
+
+  ASSERT_EQ(0, listener.num_finalize_calls());
+  formatter.SetOverallScore(42);
+  formatter.Finalize();
+  ASSERT_EQ(1, listener.num_finalize_calls());
+  ASSERT_EQ(42, listener.score());
+}
+
 } // namespace
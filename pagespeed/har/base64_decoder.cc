@@ -0,0 +1,174 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pagespeed/har/base64_decoder.h"
+
+#if defined(PAGESPEED_BASE64_SIMD)
+#if defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif  // defined(PAGESPEED_BASE64_SIMD)
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "pagespeed/har/base64_decoder_internal.h"
+#include "third_party/modp_b64/modp_b64.h"
+
+namespace {
+
+using pagespeed::Base64Implementation;
+
+#if defined(PAGESPEED_BASE64_SIMD)
+
+// Feature bits, from the Intel 64 and IA-32 Architectures Software
+// Developer's Manual, volume 2A, CPUID.
+const unsigned kCpuIdLeaf1EcxSsse3 = 1 << 9;
+const unsigned kCpuIdLeaf1EcxOsxsave = 1 << 27;
+const unsigned kCpuIdLeaf1EcxAvx = 1 << 28;
+const unsigned kCpuIdLeaf7EbxAvx2 = 1 << 5;
+// The XCR0 bits indicating that the OS saves the SSE and AVX state.
+const unsigned kXcr0SseAndAvxState = 0x6;
+
+void cpuid(unsigned leaf, unsigned* eax, unsigned* ebx, unsigned* ecx,
+           unsigned* edx) {
+#if defined(_MSC_VER)
+  int cpu_info[4] = {0};
+  __cpuidex(cpu_info, leaf, 0);
+  *eax = cpu_info[0];
+  *ebx = cpu_info[1];
+  *ecx = cpu_info[2];
+  *edx = cpu_info[3];
+#else
+  __cpuid_count(leaf, 0, *eax, *ebx, *ecx, *edx);
+#endif
+}
+
+unsigned GetXcr0() {
+#if defined(_MSC_VER)
+  return static_cast<unsigned>(_xgetbv(0));
+#else
+  unsigned eax = 0, edx = 0;
+  // xgetbv, spelled out for assemblers that do not know it.
+  __asm__ volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0));
+  return eax;
+#endif
+}
+
+Base64Implementation DetectBestImplementation() {
+  unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+  cpuid(0, &eax, &ebx, &ecx, &edx);
+  const unsigned max_leaf = eax;
+  if (max_leaf < 1) {
+    return pagespeed::BASE64_SCALAR;
+  }
+  cpuid(1, &eax, &ebx, &ecx, &edx);
+  if ((ecx & kCpuIdLeaf1EcxSsse3) == 0) {
+    return pagespeed::BASE64_SCALAR;
+  }
+  // AVX2 also requires the OS to save the AVX registers on context
+  // switches.
+  if (max_leaf >= 7 &&
+      (ecx & kCpuIdLeaf1EcxAvx) != 0 &&
+      (ecx & kCpuIdLeaf1EcxOsxsave) != 0 &&
+      (GetXcr0() & kXcr0SseAndAvxState) == kXcr0SseAndAvxState) {
+    cpuid(7, &eax, &ebx, &ecx, &edx);
+    if ((ebx & kCpuIdLeaf7EbxAvx2) != 0) {
+      return pagespeed::BASE64_AVX2;
+    }
+  }
+  return pagespeed::BASE64_SSSE3;
+}
+
+#else
+
+Base64Implementation DetectBestImplementation() {
+  return pagespeed::BASE64_SCALAR;
+}
+
+#endif  // defined(PAGESPEED_BASE64_SIMD)
+
+// Detects the best implementation once.
+class BestImplementation {
+ public:
+  BestImplementation() : implementation_(DetectBestImplementation()) {}
+
+  Base64Implementation get() const { return implementation_; }
+
+ private:
+  const Base64Implementation implementation_;
+
+  DISALLOW_COPY_AND_ASSIGN(BestImplementation);
+};
+
+base::LazyInstance<BestImplementation>::Leaky g_best_implementation =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+namespace pagespeed {
+
+size_t Base64DecodedLengthBound(size_t input_length) {
+  return modp_b64_decode_len(input_length);
+}
+
+int Base64Decode(const char* input, size_t input_length, char* output) {
+  return Base64DecodeWithImplementation(
+      GetBestBase64Implementation(), input, input_length, output);
+}
+
+int Base64DecodeWithImplementation(Base64Implementation implementation,
+                                   const char* input,
+                                   size_t input_length,
+                                   char* output) {
+  DCHECK_LE(implementation, GetBestBase64Implementation());
+  size_t consumed = 0;
+  bool valid = true;
+#if defined(PAGESPEED_BASE64_SIMD)
+  // Decode as much as possible with the widest instructions available,
+  // then continue with narrower ones.
+  if (implementation >= BASE64_AVX2) {
+    consumed += base64_internal::DecodeBlocksAvx2(
+        input, input_length, output, &valid);
+  }
+  if (valid && implementation >= BASE64_SSSE3) {
+    consumed += base64_internal::DecodeBlocksSsse3(
+        input + consumed, input_length - consumed,
+        output + consumed / 4 * 3, &valid);
+  }
+#endif
+  if (!valid) {
+    return -1;
+  }
+
+  // Decode the rest, including any padding, with modp_b64. Since the
+  // SIMD decoders consume whole quanta, the result is the same as if
+  // modp_b64 had decoded the entire input.
+  const int tail_size = modp_b64_decode(output + consumed / 4 * 3,
+                                        input + consumed,
+                                        input_length - consumed);
+  if (tail_size < 0) {
+    return -1;
+  }
+  return static_cast<int>(consumed / 4 * 3) + tail_size;
+}
+
+Base64Implementation GetBestBase64Implementation() {
+  return g_best_implementation.Get().get();
+}
+
+}  // namespace pagespeed
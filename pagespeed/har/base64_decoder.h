@@ -0,0 +1,57 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PAGESPEED_HAR_BASE64_DECODER_H_
+#define PAGESPEED_HAR_BASE64_DECODER_H_
+
+#include <stddef.h>
+
+namespace pagespeed {
+
+// The implementations Base64Decode can use. Each one is only available
+// if the CPU supports it (see GetBestBase64Implementation).
+enum Base64Implementation {
+  BASE64_SCALAR,
+  BASE64_SSSE3,
+  BASE64_AVX2,
+};
+
+// Get the number of bytes that must be available in the output buffer
+// passed to Base64Decode, for an input of the given length. This is
+// the same as modp_b64_decode_len.
+size_t Base64DecodedLengthBound(size_t input_length);
+
+// Decode the given base64 input into output, which must have room for
+// Base64DecodedLengthBound(input_length) bytes (which may all be
+// written to, even if fewer are decoded). Returns the number of bytes
+// decoded, or -1 if the input is not valid base64. This accepts the
+// same inputs and produces the same output as modp_b64_decode, using
+// the fastest implementation the CPU supports.
+int Base64Decode(const char* input, size_t input_length, char* output);
+
+// Same as above, but using the given implementation, which must not be
+// better than GetBestBase64Implementation(). Exposed for tests and
+// benchmarks.
+int Base64DecodeWithImplementation(Base64Implementation implementation,
+                                   const char* input,
+                                   size_t input_length,
+                                   char* output);
+
+// Get the best implementation supported by the CPU and by this build.
+Base64Implementation GetBestBase64Implementation();
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_HAR_BASE64_DECODER_H_
@@ -0,0 +1,92 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Base64 decoding with AVX2, 32 characters at a time. This file must
+// be compiled with AVX2 enabled, and its functions must only be called
+// on CPUs (and operating systems) that support it. See
+// base64_decoder_ssse3.cc for a description of the algorithm; the AVX2
+// version processes two 16-character lanes at once, then moves the 12
+// decoded bytes of each lane together.
+
+#include <immintrin.h>
+
+#include "pagespeed/har/base64_decoder_internal.h"
+
+namespace pagespeed {
+
+namespace base64_internal {
+
+size_t DecodeBlocksAvx2(const char* input, size_t input_length,
+                        char* output, bool* valid) {
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71,
+      0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71,
+      0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+  const __m256i merge_multiplier = _mm256_set1_epi32(0x01400140);
+  const __m256i pack_multiplier = _mm256_set1_epi32(0x00011000);
+  const __m256i pack_shuffle = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i lane_permutation = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+  // Each block stores 32 bytes, of which only the first 24 are decoded
+  // output. Stopping 64 characters from the end of the input leaves
+  // room for the extra bytes within the output buffer, and leaves the
+  // final quantum for the scalar decoder.
+  size_t consumed = 0;
+  while (consumed + 64 <= input_length) {
+    __m256i block = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(input + consumed));
+    const __m256i hi_nibbles =
+        _mm256_and_si256(_mm256_srli_epi32(block, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(block, mask_2f);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+      *valid = false;
+      return 0;
+    }
+    const __m256i eq_2f = _mm256_cmpeq_epi8(block, mask_2f);
+    const __m256i roll =
+        _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    block = _mm256_add_epi8(block, roll);
+
+    const __m256i merged = _mm256_maddubs_epi16(block, merge_multiplier);
+    const __m256i packed = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(_mm256_madd_epi16(merged, pack_multiplier),
+                            pack_shuffle),
+        lane_permutation);
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(output + consumed / 4 * 3), packed);
+    consumed += 32;
+  }
+  return consumed;
+}
+
+}  // namespace base64_internal
+
+}  // namespace pagespeed
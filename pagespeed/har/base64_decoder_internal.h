@@ -0,0 +1,44 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PAGESPEED_HAR_BASE64_DECODER_INTERNAL_H_
+#define PAGESPEED_HAR_BASE64_DECODER_INTERNAL_H_
+
+#include <stddef.h>
+
+namespace pagespeed {
+
+namespace base64_internal {
+
+// Each of these decodes as many leading blocks of the input as it can
+// with SIMD instructions, writing 3 bytes of output for every 4
+// characters of input, and returns the number of characters
+// consumed. Consumed input is always a multiple of 4 characters, and
+// leaves at least one 4-character quantum (the one that may contain
+// padding) for the scalar decoder. Sets *valid to false, and returns
+// 0, if a consumed block contains a character that is not in the base64
+// alphabet. The output buffer must have room for
+// modp_b64_decode_len(input_length) bytes, and bytes past the decoded
+// output may be overwritten.
+size_t DecodeBlocksSsse3(const char* input, size_t input_length,
+                         char* output, bool* valid);
+size_t DecodeBlocksAvx2(const char* input, size_t input_length,
+                        char* output, bool* valid);
+
+}  // namespace base64_internal
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_HAR_BASE64_DECODER_INTERNAL_H_
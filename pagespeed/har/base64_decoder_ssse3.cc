@@ -0,0 +1,89 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Base64 decoding with SSSE3, 16 characters at a time. This file must
+// be compiled with SSSE3 enabled, and its functions must only be called
+// on CPUs that support it.
+//
+// The algorithm is due to Wojciech Mula and Daniel Lemire ("Faster
+// Base64 Encoding and Decoding Using AVX2 Instructions", 2018). Each
+// character is classified by looking up its low and high nibbles in two
+// tables; the character is valid iff the two lookups share no bits. A
+// third table, indexed by the high nibble, gives the offset that maps
+// the character to its 6-bit value. Finally, multiply-adds pack four
+// 6-bit values into three bytes.
+
+#include <tmmintrin.h>
+
+#include "pagespeed/har/base64_decoder_internal.h"
+
+namespace pagespeed {
+
+namespace base64_internal {
+
+size_t DecodeBlocksSsse3(const char* input, size_t input_length,
+                         char* output, bool* valid) {
+  const __m128i lut_lo = _mm_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lut_hi = _mm_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lut_roll = _mm_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71,
+      0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask_2f = _mm_set1_epi8(0x2f);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i merge_multiplier = _mm_set1_epi32(0x01400140);
+  const __m128i pack_multiplier = _mm_set1_epi32(0x00011000);
+  const __m128i pack_shuffle = _mm_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+  // Each block stores 16 bytes, of which only the first 12 are decoded
+  // output. Stopping 32 characters from the end of the input leaves
+  // room for the extra bytes within the output buffer, and leaves the
+  // final quantum for the scalar decoder.
+  size_t consumed = 0;
+  while (consumed + 32 <= input_length) {
+    __m128i block = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(input + consumed));
+    const __m128i hi_nibbles =
+        _mm_and_si128(_mm_srli_epi32(block, 4), mask_2f);
+    const __m128i lo_nibbles = _mm_and_si128(block, mask_2f);
+    const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    if (_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero)) != 0xFFFF) {
+      *valid = false;
+      return 0;
+    }
+    const __m128i eq_2f = _mm_cmpeq_epi8(block, mask_2f);
+    const __m128i roll =
+        _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    block = _mm_add_epi8(block, roll);
+
+    const __m128i merged = _mm_maddubs_epi16(block, merge_multiplier);
+    const __m128i packed = _mm_shuffle_epi8(
+        _mm_madd_epi16(merged, pack_multiplier), pack_shuffle);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + consumed / 4 * 3),
+                     packed);
+    consumed += 16;
+  }
+  return consumed;
+}
+
+}  // namespace base64_internal
+
+}  // namespace pagespeed
@@ -0,0 +1,145 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pagespeed/har/base64_decoder.h"
+
+#include <string.h>
+
+#include <string>
+
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/modp_b64/modp_b64.h"
+
+using pagespeed::Base64DecodeWithImplementation;
+using pagespeed::Base64DecodedLengthBound;
+using pagespeed::Base64Implementation;
+using pagespeed::GetBestBase64Implementation;
+
+namespace {
+
+const char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Generate a deterministic sequence of bytes of the given length,
+// covering every byte value.
+std::string MakeBytes(size_t length) {
+  std::string bytes;
+  unsigned int state = 12345;
+  for (size_t i = 0; i < length; ++i) {
+    state = state * 1103515245 + 12345;
+    bytes.push_back(static_cast<char>((state >> 16) & 0xFF));
+  }
+  return bytes;
+}
+
+std::string Encode(const std::string& bytes) {
+  std::string encoded;
+  encoded.resize(modp_b64_encode_len(bytes.size()));
+  const int encoded_size =
+      modp_b64_encode(&encoded[0], bytes.data(), bytes.size());
+  encoded.resize(encoded_size);
+  return encoded;
+}
+
+class Base64DecoderTest : public testing::Test {
+ protected:
+  // Decode the input with modp_b64 and with each available
+  // implementation, and check that they all agree.
+  void ExpectSameAsModp(const std::string& input) {
+    std::string expected;
+    expected.resize(modp_b64_decode_len(input.size()));
+    const int expected_size =
+        modp_b64_decode(&expected[0], input.data(), input.size());
+    if (expected_size >= 0) {
+      expected.resize(expected_size);
+    }
+
+    for (int i = pagespeed::BASE64_SCALAR;
+         i <= GetBestBase64Implementation();
+         ++i) {
+      const Base64Implementation implementation =
+          static_cast<Base64Implementation>(i);
+      std::string actual;
+      actual.resize(Base64DecodedLengthBound(input.size()));
+      const int actual_size = Base64DecodeWithImplementation(
+          implementation, input.data(), input.size(), &actual[0]);
+      ASSERT_EQ(expected_size, actual_size)
+          << "implementation " << i << ", input " << input;
+      if (actual_size >= 0) {
+        actual.resize(actual_size);
+        ASSERT_EQ(expected, actual)
+            << "implementation " << i << ", input " << input;
+      }
+    }
+  }
+};
+
+TEST_F(Base64DecoderTest, Empty) {
+  ExpectSameAsModp("");
+}
+
+TEST_F(Base64DecoderTest, RoundTrip) {
+  // Cover every padding and every combination of SIMD block and tail.
+  for (size_t length = 0; length < 300; ++length) {
+    const std::string bytes = MakeBytes(length);
+    const std::string encoded = Encode(bytes);
+    ExpectSameAsModp(encoded);
+
+    std::string decoded;
+    decoded.resize(Base64DecodedLengthBound(encoded.size()));
+    const int decoded_size = pagespeed::Base64Decode(
+        encoded.data(), encoded.size(), &decoded[0]);
+    ASSERT_EQ(static_cast<int>(length), decoded_size);
+    decoded.resize(decoded_size);
+    ASSERT_EQ(bytes, decoded);
+  }
+}
+
+TEST_F(Base64DecoderTest, EveryAlphabetCharacter) {
+  std::string input;
+  for (int i = 0; i < 8; ++i) {
+    input.append(kAlphabet, sizeof(kAlphabet) - 1);
+  }
+  ExpectSameAsModp(input);
+}
+
+TEST_F(Base64DecoderTest, InvalidCharacters) {
+  const std::string valid = Encode(MakeBytes(150));
+  // Replace each character in turn with each byte value that is not in
+  // the alphabet, so that invalid characters are found in SIMD blocks
+  // as well as in the tail.
+  for (size_t position = 0; position < valid.size(); ++position) {
+    for (int c = 0; c < 256; ++c) {
+      if (c != 0 && strchr(kAlphabet, c) != NULL) {
+        continue;
+      }
+      std::string input = valid;
+      input[position] = static_cast<char>(c);
+      ExpectSameAsModp(input);
+    }
+  }
+}
+
+TEST_F(Base64DecoderTest, MalformedLengthsAndPadding) {
+  const std::string valid = Encode(MakeBytes(120));
+  for (size_t length = 0; length < valid.size(); ++length) {
+    ExpectSameAsModp(valid.substr(0, length));
+  }
+  ExpectSameAsModp(valid + "=");
+  ExpectSameAsModp(valid + "====");
+  ExpectSameAsModp("====" + valid);
+}
+
+}  // namespace
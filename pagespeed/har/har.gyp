@@ -27,6 +27,7 @@
         '<(pagespeed_root)/pagespeed/core/core.gyp:pagespeed_core',
       ],
       'sources': [
+        'base64_decoder.cc',
         'http_archive.cc',
       ],
       'include_dirs': [
@@ -40,7 +41,68 @@
             '_CRT_SECURE_NO_WARNINGS',
           ],
         }],
+        ['target_arch=="ia32" or target_arch=="x64"', {
+          'defines': [
+            'PAGESPEED_BASE64_SIMD',
+          ],
+          'dependencies': [
+            'pagespeed_har_base64_avx2',
+            'pagespeed_har_base64_ssse3',
+          ],
+        }],
       ],
     },
   ],
+  'conditions': [
+    ['target_arch=="ia32" or target_arch=="x64"', {
+      'targets': [
+        # The SIMD decoders are built in their own targets so that only
+        # they are compiled with the extended instruction sets; the
+        # dispatcher in base64_decoder.cc checks CPU support at runtime
+        # before calling into them.
+        {
+          'target_name': 'pagespeed_har_base64_ssse3',
+          'type': '<(library)',
+          'sources': [
+            'base64_decoder_ssse3.cc',
+          ],
+          'include_dirs': [
+            '<(DEPTH)',
+            '<(pagespeed_root)',
+          ],
+          'conditions': [
+            ['os_posix==1 and OS!="mac"', {
+              'cflags': [ '-mssse3' ],
+            }],
+            ['OS=="mac"', {
+              'xcode_settings': {
+                'OTHER_CFLAGS': [ '-mssse3' ],
+              },
+            }],
+          ],
+        },
+        {
+          'target_name': 'pagespeed_har_base64_avx2',
+          'type': '<(library)',
+          'sources': [
+            'base64_decoder_avx2.cc',
+          ],
+          'include_dirs': [
+            '<(DEPTH)',
+            '<(pagespeed_root)',
+          ],
+          'conditions': [
+            ['os_posix==1 and OS!="mac"', {
+              'cflags': [ '-mavx2' ],
+            }],
+            ['OS=="mac"', {
+              'xcode_settings': {
+                'OTHER_CFLAGS': [ '-mavx2' ],
+              },
+            }],
+          ],
+        },
+      ],
+    }],
+  ],
 }
@@ -18,156 +18,408 @@
 #include <stdio.h>  // for sscanf
 
 #include <map>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "base/logging.h"
-#include "base/json/json_reader.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/stl_util.h"  // for STLDeleteElements
 #include "base/third_party/nspr/prtime.h"
 #include "base/values.h"
+#include "pagespeed/core/json_stream_parser.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource_filter.h"
+#include "pagespeed/core/shared_buffer.h"
+#include "pagespeed/core/thread_pool.h"
 #include "pagespeed/core/uri_util.h"
-#include "third_party/modp_b64/modp_b64.h"
+#include "pagespeed/har/base64_decoder.h"
 
 namespace pagespeed {
 
 namespace {
 
-class InputPopulator {
+// The number of entries that are parsed before they are populated, per
+// thread used to populate them. The ThreadPool starts and joins its
+// threads for each batch, so batches must be large enough for that
+// cost to be small next to populating the entries, while still
+// bounding the number of parsed entries held in memory at once.
+const int kEntriesPerThread = 64;
+
+// Populates a PagespeedInput from a HAR as it is parsed. The entries of
+// the HAR are streamed to OnArrayElement and collected into batches,
+// each of which is converted to Resources as soon as it is full, so
+// only one batch of entries is held as base::Values at a time. Each
+// entry is independent, so the entries of a batch are populated
+// concurrently on a ThreadPool; the results are merged, and the
+// resources added to the input, in the original order. The JSON itself
+// is still parsed serially, as it is streamed. Each decoded response
+// body is handed to its resource as a SharedBuffer without being
+// copied, and, if an interner is given, identical bodies share one
+// buffer. The rest of the HAR (which is small) is passed to Finish once
+// parsing completes.
+class InputPopulator : public JsonStreamParser::Delegate {
  public:
-  static bool Populate(const Value& har_json, PagespeedInput* input);
+  // If body_interner is non-NULL, identical response bodies are shared
+  // through it rather than held once per resource.
+  InputPopulator(int num_threads, SharedBufferInterner* body_interner)
+      : thread_pool_(num_threads),
+        batch_size_(num_threads > 1 ? num_threads * kEntriesPerThread : 1),
+        body_interner_(body_interner),
+        page_started_millis_(-1),
+        error_(false) {}
+  virtual ~InputPopulator();
+
+  // JsonStreamParser::Delegate interface.
+  virtual bool ShouldStreamArrayElements(const JsonStreamParser::Path& path);
+  virtual bool OnArrayElement(const JsonStreamParser::Path& path,
+                              Value* element);
+
+  // Add the resources from the streamed entries to the input, using
+  // the given HAR, from which the entries have been removed, for the
+  // remaining information. Returns false if the HAR was malformed.
+  bool Finish(const Value& har_json, PagespeedInput* input);
+
+  // Same as Finish, but adds the resources to one input per page of the
+  // HAR, based on the page each entry refers to. Entries that do not
+  // refer to a page are dropped. If the HAR has no pages, a single input
+  // holding every resource is produced. Returns false if the HAR was
+  // malformed, in which case inputs is unchanged.
+  bool FinishPages(const Value& har_json,
+                   std::vector<PagespeedInput*>* inputs);
 
  private:
+  friend class PopulateEntriesTask;
+
   enum HeaderType { REQUEST_HEADERS, RESPONSE_HEADERS };
 
-  InputPopulator() : page_started_millis_(-1), error_(false) {}
-  ~InputPopulator() {}
+  // A resource populated from an entry, along with the information
+  // needed to compute its timings, which depend on the page and on
+  // other entries, and so can only be computed once every entry has
+  // been parsed.
+  struct PopulatedEntry {
+    PopulatedEntry()
+        : resource(NULL), has_started_millis(false), started_millis(0),
+          wait_ms(-1), connect_ms(-1), error(false) {}
+
+    Resource* resource;
+    // The id of the page the entry belongs to, if any.
+    std::string pageref;
+    bool has_started_millis;
+    int64 started_millis;
+    std::string host;
+    int wait_ms;
+    // The time taken to connect to the host for this entry, or -1 if
+    // unknown.
+    int connect_ms;
+    // Whether the entry was malformed.
+    bool error;
+  };
 
-  void PopulateInput(const Value& har_json, PagespeedInput* input);
+  const base::DictionaryValue* GetLog(const Value& har_json);
+  void PopulatePendingEntries();
+  void UpdateMinConnectTime(const PopulatedEntry& entry);
   void DeterminePageTimings(const base::DictionaryValue& log_json,
                             PagespeedInput* input);
-  void PopulateResource(const base::DictionaryValue& entry_json,
-                        Resource* resource,
-                        const std::map<std::string, int>& min_connect_times);
-  void PopulateHeaders(const base::DictionaryValue& headers_json,
-                       HeaderType htype, Resource* resource);
-  std::string GetString(const base::DictionaryValue& object,
-                        const std::string& key);
+  void PopulatePageTimings(const base::DictionaryValue& page_json,
+                           PagespeedInput* input,
+                           int64* page_started_millis);
+  void PopulateTimings(const PopulatedEntry& entry,
+                       int64 page_started_millis);
+  int GetMinConnectTimeForHost(const std::string& host);
+
+  // The methods below only touch the entry they are given, so they may
+  // be called concurrently for different entries.
+  static void PopulateEntry(const Value& entry_value,
+                            SharedBufferInterner* body_interner,
+                            PopulatedEntry* entry);
+  static void PopulateConnectTime(const base::DictionaryValue& entry_json,
+                                  PopulatedEntry* entry);
+  static void PopulateResource(const base::DictionaryValue& entry_json,
+                               SharedBufferInterner* body_interner,
+                               PopulatedEntry* entry);
+  static void SetResponseBody(std::string* body,
+                              SharedBufferInterner* body_interner,
+                              PopulatedEntry* entry);
+  static void PopulateHeaders(const base::DictionaryValue& headers_json,
+                              HeaderType htype, PopulatedEntry* entry);
+  static std::string GetString(const base::DictionaryValue& object,
+                               const std::string& key,
+                               bool* error);
+  static int GetEntryTiming(const base::DictionaryValue* entry_json,
+                            const std::string& name);
+  static std::string GetEntryHost(const base::DictionaryValue* entry_json);
+
+  const ThreadPool thread_pool_;
+  const size_t batch_size_;
+  SharedBufferInterner* const body_interner_;
+  // Entries that have been parsed but not yet populated.
+  std::vector<Value*> pending_entries_;
+  std::vector<PopulatedEntry> entries_;
+  std::map<std::string, int> min_connect_times_;
+  int64 page_started_millis_;
+  bool error_;
 
-  int GetEntryTiming(const base::DictionaryValue* entry_json,
-                     const std::string& name);
-  int GetMinConnectTimeForHost(
-      const std::map<std::string, int>& min_connect_times,
-      const std::string& host);
-  std::string GetEntryHost(const base::DictionaryValue* entry_json);
+  DISALLOW_COPY_AND_ASSIGN(InputPopulator);
+};
 
+// Populates one batch of entries, each in its own task.
+class PopulateEntriesTask : public ParallelTask {
+ public:
+  PopulateEntriesTask(const std::vector<Value*>& entry_values,
+                      SharedBufferInterner* body_interner,
+                      InputPopulator::PopulatedEntry* entries)
+      : entry_values_(entry_values),
+        body_interner_(body_interner),
+        entries_(entries) {}
+
+  virtual void RunTask(int task_index) {
+    InputPopulator::PopulateEntry(*entry_values_[task_index],
+                                  body_interner_,
+                                  &entries_[task_index]);
+  }
 
+ private:
+  const std::vector<Value*>& entry_values_;
+  SharedBufferInterner* const body_interner_;
+  InputPopulator::PopulatedEntry* const entries_;
 
+  DISALLOW_COPY_AND_ASSIGN(PopulateEntriesTask);
+};
 
-  int64 page_started_millis_;
-  bool error_;
+InputPopulator::~InputPopulator() {
+  STLDeleteElements(&pending_entries_);
+  // Delete any resources that were not added to an input.
+  for (std::vector<PopulatedEntry>::iterator it = entries_.begin(),
+           end = entries_.end();
+       it != end;
+       ++it) {
+    delete it->resource;
+  }
+}
 
-  DISALLOW_COPY_AND_ASSIGN(InputPopulator);
-};
+bool InputPopulator::ShouldStreamArrayElements(
+    const JsonStreamParser::Path& path) {
+  return path.size() == 2 && path[0] == "log" && path[1] == "entries";
+}
 
-bool InputPopulator::Populate(const Value& har_json, PagespeedInput* input) {
-  InputPopulator populator;
-  populator.PopulateInput(har_json, input);
-  return !populator.error_;
+bool InputPopulator::OnArrayElement(const JsonStreamParser::Path& path,
+                                    Value* element) {
+  pending_entries_.push_back(element);
+  if (pending_entries_.size() >= batch_size_) {
+    PopulatePendingEntries();
+  }
+  return true;
 }
 
-// Macro to be used only within InputPopulator instance methods:
+// Macros to be used only within InputPopulator methods. ENTRY_ERROR
+// records an error in the given PopulatedEntry rather than in the
+// populator, so that it is safe to use from concurrent tasks.
 #define INPUT_POPULATOR_ERROR() error_ = true; LOG(ERROR)
+#define ENTRY_ERROR(entry) (entry)->error = true; LOG(ERROR)
+
+bool InputPopulator::Finish(const Value& har_json, PagespeedInput* input) {
+  const base::DictionaryValue* log_json = GetLog(har_json);
+  if (log_json == NULL) {
+    return false;
+  }
+
+  DeterminePageTimings(*log_json, input);
+
+  for (std::vector<PopulatedEntry>::iterator it = entries_.begin(),
+           end = entries_.end();
+       it != end && !error_;
+       ++it) {
+    PopulateTimings(*it, page_started_millis_);
+    input->AddResource(it->resource);
+    it->resource = NULL;
+  }
+  return !error_;
+}
+
+bool InputPopulator::FinishPages(const Value& har_json,
+                                 std::vector<PagespeedInput*>* inputs) {
+  const base::DictionaryValue* log_json = GetLog(har_json);
+  if (log_json == NULL) {
+    return false;
+  }
+
+  const base::ListValue* pages_json;
+  if (!log_json->GetList("pages", &pages_json) || pages_json->empty()) {
+    // The "pages" field is optional; without it, every entry belongs
+    // to a single page.
+    scoped_ptr<PagespeedInput> input(new PagespeedInput());
+    if (!Finish(har_json, input.get())) {
+      return false;
+    }
+    inputs->push_back(input.release());
+    return true;
+  }
+
+  std::vector<PagespeedInput*> page_inputs;
+  std::vector<int64> page_started_millis;
+  std::map<std::string, size_t> page_indices;
+  for (size_t index = 0, size = pages_json->GetSize();
+       index < size && !error_; ++index) {
+    const base::DictionaryValue* page_json;
+    if (!pages_json->GetDictionary(index, &page_json)) {
+      INPUT_POPULATOR_ERROR() << "Page item must be an object.";
+      break;
+    }
+    const std::string id = GetString(*page_json, "id", &error_);
+    if (!page_indices.insert(std::make_pair(id, index)).second) {
+      INPUT_POPULATOR_ERROR() << "Duplicate page id: " << id;
+      break;
+    }
+    page_inputs.push_back(new PagespeedInput());
+    page_started_millis.push_back(-1);
+    PopulatePageTimings(*page_json, page_inputs.back(),
+                        &page_started_millis.back());
+  }
+
+  for (std::vector<PopulatedEntry>::iterator it = entries_.begin(),
+           end = entries_.end();
+       it != end && !error_;
+       ++it) {
+    const std::map<std::string, size_t>::const_iterator page =
+        page_indices.find(it->pageref);
+    if (page == page_indices.end()) {
+      LOG(WARNING) << "Dropping entry that refers to no known page: "
+                   << it->resource->GetRequestUrl();
+      continue;
+    }
+    PopulateTimings(*it, page_started_millis[page->second]);
+    page_inputs[page->second]->AddResource(it->resource);
+    it->resource = NULL;
+  }
+
+  if (error_) {
+    STLDeleteElements(&page_inputs);
+    return false;
+  }
+  inputs->insert(inputs->end(), page_inputs.begin(), page_inputs.end());
+  return true;
+}
+
+const base::DictionaryValue* InputPopulator::GetLog(const Value& har_json) {
+  PopulatePendingEntries();
 
-void InputPopulator::PopulateInput(const Value& har_json,
-                                   PagespeedInput* input) {
   if (!har_json.IsType(Value::TYPE_DICTIONARY)) {
     INPUT_POPULATOR_ERROR() << "Top-level JSON value must be an object.";
-    return;
+    return NULL;
   }
 
   const base::DictionaryValue* log_json;
   if (!static_cast<const base::DictionaryValue&>(har_json).
       GetDictionary("log", &log_json)) {
     INPUT_POPULATOR_ERROR() << "\"log\" field must be an object.";
-    return;
+    return NULL;
   }
 
-  DeterminePageTimings(*log_json, input);
-
   const base::ListValue* entries_json;
   if (!log_json->GetList("entries", &entries_json)) {
     INPUT_POPULATOR_ERROR() << "\"entries\" field must be an array.";
+    return NULL;
+  }
+  // The entries themselves were streamed to OnArrayElement.
+  DCHECK(entries_json->empty());
+
+  return log_json;
+}
+
+void InputPopulator::PopulatePendingEntries() {
+  if (pending_entries_.empty()) {
     return;
   }
 
-  // We need to get the minimum connect time that is greater than zero in
-  // order to estimate our RTT. We do this by looping through our entries once
-  // before we do our full analysis.
-  size_t index = 0, size = 0;
-  std::map<std::string, int> min_connect_times;
-  const base::DictionaryValue* entry_json;
-  for (index = 0, size = entries_json->GetSize(); index < size; ++index) {
-    if (!entries_json->GetDictionary(index, &entry_json)) {
-      INPUT_POPULATOR_ERROR() << "Entry item must be an object.";
-      continue;
-    }
-    int connect_ms = GetEntryTiming(entry_json, "connect");
-    if (connect_ms < 0) {
-      // See: https://code.google.com/p/chromium/issues/detail?id=152201
-      // If connect < 0 and dns > 0, the real connect time may be (connect +
-      // dns).
-      int dns_ms = GetEntryTiming(entry_json, "dns");
-      if (dns_ms > 0 && (connect_ms + dns_ms) > 0) {
-        connect_ms = connect_ms + dns_ms;
-      } else {
-        LOG(WARNING) << "No connect time set: " << connect_ms;
-        continue;
-      }
-    }
+  const size_t first = entries_.size();
+  entries_.resize(first + pending_entries_.size());
+  for (size_t i = first; i < entries_.size(); ++i) {
+    entries_[i].resource = new Resource;
+  }
 
-    int ssl_ms = GetEntryTiming(entry_json, "ssl");
-    if (ssl_ms > 0) {
-      // If the connection is over SSL, we need to subtract the SSL handshake
-      // time from the connect time.
-      //
-      // http://www.softwareishard.com/blog/har-12-spec/#timings
-      // "ssl [number, optional] (new in 1.2) - Time required for SSL/TLS
-      // negotiation. If this field is defined then the time is also included in
-      // the connect field (to ensure backward compatibility with HAR 1.1). Use
-      // -1 if the timing does not apply to the current request."
-      connect_ms = connect_ms - ssl_ms;
-    }
+  PopulateEntriesTask task(pending_entries_, body_interner_, &entries_[first]);
+  thread_pool_.Run(&task, pending_entries_.size());
+  STLDeleteElements(&pending_entries_);
 
-    if (connect_ms < 0) {
-      LOG(WARNING) << "Timing error from devtools: connet-ssl=" << connect_ms;
-      continue;
+  // Merge the results in order, so that the outcome does not depend on
+  // how the tasks were scheduled.
+  for (size_t i = first; i < entries_.size(); ++i) {
+    PopulatedEntry& entry = entries_[i];
+    if (entry.error) {
+      error_ = true;
     }
+    UpdateMinConnectTime(entry);
+  }
+}
 
-    std::string host = GetEntryHost(entry_json);
-    if (host.empty()) {
-      INPUT_POPULATOR_ERROR() << "Request URL must be a string";
-      continue;
-    }
-    int min_connect_ms = GetMinConnectTimeForHost(min_connect_times, host);
-    if (min_connect_ms == -1 || connect_ms < min_connect_ms) {
-      min_connect_times[host] = connect_ms;
-    }
+void InputPopulator::PopulateEntry(const Value& entry_value,
+                                   SharedBufferInterner* body_interner,
+                                   PopulatedEntry* entry) {
+  if (!entry_value.IsType(Value::TYPE_DICTIONARY)) {
+    ENTRY_ERROR(entry) << "Entry item must be an object.";
+    return;
   }
+  const base::DictionaryValue& entry_json =
+      static_cast<const base::DictionaryValue&>(entry_value);
+
+  PopulateResource(entry_json, body_interner, entry);
+  // We need the minimum connect time that is greater than zero over
+  // all entries in order to estimate our RTT, so we record it for each
+  // entry, and compute the timings that depend on it in Finish.
+  PopulateConnectTime(entry_json, entry);
+}
 
-  for (index = 0, size = entries_json->GetSize();
-       index < size; ++index) {
-    if (!entries_json->GetDictionary(index, &entry_json)) {
-      INPUT_POPULATOR_ERROR() << "Entry item must be an object.";
-      continue;
-    }
-    scoped_ptr<Resource> resource(new Resource);
-    PopulateResource(*entry_json, resource.get(), min_connect_times);
-    if (!error_) {
-      input->AddResource(resource.release());
+void InputPopulator::UpdateMinConnectTime(const PopulatedEntry& entry) {
+  if (entry.connect_ms < 0) {
+    return;
+  }
+  int min_connect_ms = GetMinConnectTimeForHost(entry.host);
+  if (min_connect_ms == -1 || entry.connect_ms < min_connect_ms) {
+    min_connect_times_[entry.host] = entry.connect_ms;
+  }
+}
+
+void InputPopulator::PopulateConnectTime(
+    const base::DictionaryValue& entry_json, PopulatedEntry* entry) {
+  int connect_ms = GetEntryTiming(&entry_json, "connect");
+  if (connect_ms < 0) {
+    // See: https://code.google.com/p/chromium/issues/detail?id=152201
+    // If connect < 0 and dns > 0, the real connect time may be (connect +
+    // dns).
+    int dns_ms = GetEntryTiming(&entry_json, "dns");
+    if (dns_ms > 0 && (connect_ms + dns_ms) > 0) {
+      connect_ms = connect_ms + dns_ms;
+    } else {
+      LOG(WARNING) << "No connect time set: " << connect_ms;
+      return;
     }
   }
+
+  int ssl_ms = GetEntryTiming(&entry_json, "ssl");
+  if (ssl_ms > 0) {
+    // If the connection is over SSL, we need to subtract the SSL handshake
+    // time from the connect time.
+    //
+    // http://www.softwareishard.com/blog/har-12-spec/#timings
+    // "ssl [number, optional] (new in 1.2) - Time required for SSL/TLS
+    // negotiation. If this field is defined then the time is also included in
+    // the connect field (to ensure backward compatibility with HAR 1.1). Use
+    // -1 if the timing does not apply to the current request."
+    connect_ms = connect_ms - ssl_ms;
+  }
+
+  if (connect_ms < 0) {
+    LOG(WARNING) << "Timing error from devtools: connet-ssl=" << connect_ms;
+    return;
+  }
+
+  // PopulateResource has already determined the host.
+  if (entry->host.empty()) {
+    ENTRY_ERROR(entry) << "Request URL must be a string";
+    return;
+  }
+  entry->connect_ms = connect_ms;
 }
 
 int InputPopulator::GetEntryTiming(
@@ -185,12 +437,10 @@ int InputPopulator::GetEntryTiming(
   return time_ms;
 }
 
-int InputPopulator::GetMinConnectTimeForHost(
-    const std::map<std::string, int>& min_connect_times,
-    const std::string& host) {
+int InputPopulator::GetMinConnectTimeForHost(const std::string& host) {
   const std::map<std::string, int>::const_iterator find_host =
-      min_connect_times.find(host);
-  if (find_host == min_connect_times.end()) {
+      min_connect_times_.find(host);
+  if (find_host == min_connect_times_.end()) {
     return -1;
   }
 
@@ -221,8 +471,8 @@ void InputPopulator::DeterminePageTimings(
     return;
   }
 
-  // For now, just take the first page (if any), and ignore others.
-  // TODO(mdsteele): Behave intelligently in the face of multiple pages.
+  // Just take the first page (if any), and ignore others. FinishPages
+  // handles HARs with multiple pages.
   if (pages_json->GetSize() < 1) {
     return;
   }
@@ -232,14 +482,22 @@ void InputPopulator::DeterminePageTimings(
     return;
   }
 
-  const std::string started_datetime(GetString(*page_json, "startedDateTime"));
-  if (!Iso8601ToEpochMillis(started_datetime, &page_started_millis_)) {
+  PopulatePageTimings(*page_json, input, &page_started_millis_);
+}
+
+void InputPopulator::PopulatePageTimings(
+    const base::DictionaryValue& page_json,
+    PagespeedInput* input,
+    int64* page_started_millis) {
+  const std::string started_datetime(
+      GetString(page_json, "startedDateTime", &error_));
+  if (!Iso8601ToEpochMillis(started_datetime, page_started_millis)) {
     INPUT_POPULATOR_ERROR() << "Malformed pages.startedDateTime: "
                             << started_datetime;
   }
 
   double onload_millis;
-  if (page_json->GetDouble("pageTimings.onLoad", &onload_millis)) {
+  if (page_json.GetDouble("pageTimings.onLoad", &onload_millis)) {
     if (onload_millis < 0) {
       // When onLoad is specified but negative, it indicates that
       // onload has not yet fired.
@@ -252,68 +510,45 @@ void InputPopulator::DeterminePageTimings(
 
 void InputPopulator::PopulateResource(
     const base::DictionaryValue& entry_json,
-    Resource* resource,
-    const std::map<std::string, int>& min_connect_times) {
-  // Determine if the resource was loaded after onload.
+    SharedBufferInterner* body_interner,
+    PopulatedEntry* entry) {
+  Resource* resource = entry->resource;
+
+  // The page is optional, and only used for HARs with multiple pages.
+  entry_json.GetString("pageref", &entry->pageref);
+
+  // Record when the resource was requested, so we can determine whether
+  // it was loaded after onload.
   {
     std::string started_datetime;
     if (entry_json.GetString("startedDateTime", &started_datetime)) {
-      int64 started_millis;
-      if (Iso8601ToEpochMillis(started_datetime, &started_millis)) {
-        if (page_started_millis_ > 0) {
-          int64 request_start_time_millis =
-              started_millis - page_started_millis_;
-          // Truncate to 32 bits, which gives us a range of about 24
-          // days.
-          if (request_start_time_millis > kint32max) {
-            LOG(INFO) << "Request starts more than kint32max milliseconds "
-                      << "in the future. Truncating.";
-            request_start_time_millis = kint32max;
-          }
-          // Don't SetRequestStartTimeMillis if request_start_time_millis is
-          // negative, as that will result in an error down the line.
-          if (request_start_time_millis < 0) {
-            LOG(WARNING) << "Request starts before page starts.";
-          } else {
-            resource->SetRequestStartTimeMillis(
-                static_cast<int>(request_start_time_millis));
-          }
-        }
+      if (Iso8601ToEpochMillis(started_datetime, &entry->started_millis)) {
+        entry->has_started_millis = true;
       } else {
-        INPUT_POPULATOR_ERROR() << "Malformed resource startedDateTime: "
-                                << started_datetime;
+        ENTRY_ERROR(entry) << "Malformed resource startedDateTime: "
+                           << started_datetime;
       }
     }
   }
 
-  // Get the timing information.
-  {
-    std::string host = GetEntryHost(&entry_json);
-    if (!host.empty()) {
-      int connect_ms = GetMinConnectTimeForHost(min_connect_times, host);
-      if (connect_ms > 0) {
-        int wait_ms = GetEntryTiming(&entry_json, "wait");
-        if (wait_ms > -1) {
-          // Wait time is required, and it should never be less than 0.
-          // We assume the minimum connect_ms is one round trip time. The wait
-          // time consists 1 rtt and server response time
-          resource->SetFirstByteMillis(wait_ms - connect_ms);
-        }
-      }
-    }
+  // Record the timing information.
+  entry->host = GetEntryHost(&entry_json);
+  if (!entry->host.empty()) {
+    entry->wait_ms = GetEntryTiming(&entry_json, "wait");
   }
 
   // Get the request information.
   {
     const base::DictionaryValue* request_json;
     if (!entry_json.GetDictionary("request", &request_json)) {
-      INPUT_POPULATOR_ERROR() << "\"request\" field must be an object.";
+      ENTRY_ERROR(entry) << "\"request\" field must be an object.";
       return;
     }
 
-    resource->SetRequestMethod(GetString(*request_json, "method"));
-    resource->SetRequestUrl(GetString(*request_json, "url"));
-    PopulateHeaders(*request_json, REQUEST_HEADERS, resource);
+    resource->SetRequestMethod(
+        GetString(*request_json, "method", &entry->error));
+    resource->SetRequestUrl(GetString(*request_json, "url", &entry->error));
+    PopulateHeaders(*request_json, REQUEST_HEADERS, entry);
 
     // Check for optional post data.
     std::string post_data;
@@ -326,7 +561,7 @@ void InputPopulator::PopulateResource(
   {
     const base::DictionaryValue* response_json;
     if (!entry_json.GetDictionary("response", &response_json)) {
-      INPUT_POPULATOR_ERROR() << "\"response\" field must be an object.";
+      ENTRY_ERROR(entry) << "\"response\" field must be an object.";
       return;
     }
 
@@ -344,37 +579,37 @@ void InputPopulator::PopulateResource(
       }
     }
 
-    PopulateHeaders(*response_json, RESPONSE_HEADERS, resource);
+    PopulateHeaders(*response_json, RESPONSE_HEADERS, entry);
 
     const base::DictionaryValue* content_json;
     if (!response_json->GetDictionary("content", &content_json)) {
-      INPUT_POPULATOR_ERROR() << "\"content\" field must be an object.";
+      ENTRY_ERROR(entry) << "\"content\" field must be an object.";
       return;
     }
 
     std::string content_text;
     if (content_json->GetString("text", &content_text)) {
+      // Each body is decoded into its own string, which then becomes
+      // the body's buffer, so the decoded bytes are never copied and
+      // concurrent tasks never share a buffer that is being written.
       std::string encoding;
       if (!content_json->GetString("encoding", &encoding) || encoding == "") {
-        resource->SetResponseBody(content_text);
+        SetResponseBody(&content_text, body_interner, entry);
       } else if (encoding == "base64") {
-        std::string decoded_body;
-        // Reserve enough space to decode into.
-        decoded_body.resize(modp_b64_decode_len(content_text.size()));
-        // Decode into the string's buffer.
-        const int decoded_size = modp_b64_decode(&(decoded_body[0]),
-                                                 content_text.data(),
-                                                 content_text.size());
+        std::string body;
+        body.resize(Base64DecodedLengthBound(content_text.size()));
+        // Decode directly into the body's buffer.
+        const int decoded_size = Base64Decode(content_text.data(),
+                                              content_text.size(),
+                                              &(body[0]));
         if (decoded_size >= 0) {
-          // Resize the buffer to the actual decoded size.
-          decoded_body.resize(decoded_size);
-          resource->SetResponseBody(decoded_body);
+          body.resize(decoded_size);
+          SetResponseBody(&body, body_interner, entry);
         } else {
-          INPUT_POPULATOR_ERROR()
-              << "Failed to base64-decode response content.";
+          ENTRY_ERROR(entry) << "Failed to base64-decode response content.";
         }
       } else {
-        INPUT_POPULATOR_ERROR() << "Received unexpected encoding: " << encoding;
+        ENTRY_ERROR(entry) << "Received unexpected encoding: " << encoding;
       }
 
       // NOTE: modified is a custom field used by PageSpeed that's not
@@ -387,12 +622,60 @@ void InputPopulator::PopulateResource(
   }
 }
 
+void InputPopulator::SetResponseBody(std::string* body,
+                                     SharedBufferInterner* body_interner,
+                                     PopulatedEntry* entry) {
+  SharedBuffer* buffer = SharedBuffer::TakeString(body);
+  if (body_interner != NULL) {
+    buffer = body_interner->Intern(buffer);
+  }
+  entry->resource->SetResponseBody(buffer, 0, buffer->size());
+}
+
+void InputPopulator::PopulateTimings(const PopulatedEntry& entry,
+                                     int64 page_started_millis) {
+  Resource* resource = entry.resource;
+
+  // Determine if the resource was loaded after onload.
+  if (entry.has_started_millis && page_started_millis > 0) {
+    int64 request_start_time_millis =
+        entry.started_millis - page_started_millis;
+    // Truncate to 32 bits, which gives us a range of about 24
+    // days.
+    if (request_start_time_millis > kint32max) {
+      LOG(INFO) << "Request starts more than kint32max milliseconds "
+                << "in the future. Truncating.";
+      request_start_time_millis = kint32max;
+    }
+    // Don't SetRequestStartTimeMillis if request_start_time_millis is
+    // negative, as that will result in an error down the line.
+    if (request_start_time_millis < 0) {
+      LOG(WARNING) << "Request starts before page starts.";
+    } else {
+      resource->SetRequestStartTimeMillis(
+          static_cast<int>(request_start_time_millis));
+    }
+  }
+
+  // Get the timing information.
+  if (!entry.host.empty()) {
+    int connect_ms = GetMinConnectTimeForHost(entry.host);
+    if (connect_ms > 0 && entry.wait_ms > -1) {
+      // Wait time is required, and it should never be less than 0.
+      // We assume the minimum connect_ms is one round trip time. The wait
+      // time consists 1 rtt and server response time
+      resource->SetFirstByteMillis(entry.wait_ms - connect_ms);
+    }
+  }
+}
+
 void InputPopulator::PopulateHeaders(const base::DictionaryValue& json,
                                      HeaderType htype,
-                                     Resource* resource) {
+                                     PopulatedEntry* entry) {
+  Resource* resource = entry->resource;
   const base::ListValue* headers_json;
   if (!json.GetList("headers", &headers_json)) {
-    INPUT_POPULATOR_ERROR() << "\"headers\" field must be an array.";
+    ENTRY_ERROR(entry) << "\"headers\" field must be an array.";
     return;
   }
 
@@ -400,12 +683,12 @@ void InputPopulator::PopulateHeaders(const base::DictionaryValue& json,
        index < size; ++index) {
     const base::DictionaryValue* header_json;
     if (!headers_json->GetDictionary(index,  &header_json)) {
-      INPUT_POPULATOR_ERROR() << "Header item must be an object.";
+      ENTRY_ERROR(entry) << "Header item must be an object.";
       continue;
     }
 
-    const std::string name = GetString(*header_json, "name");
-    const std::string value = GetString(*header_json, "value");
+    const std::string name = GetString(*header_json, "name", &entry->error);
+    const std::string value = GetString(*header_json, "value", &entry->error);
 
     switch (htype) {
       case REQUEST_HEADERS:
@@ -421,10 +704,12 @@ void InputPopulator::PopulateHeaders(const base::DictionaryValue& json,
 }
 
 std::string InputPopulator::GetString(const base::DictionaryValue& object,
-                                      const std::string& key) {
+                                      const std::string& key,
+                                      bool* error) {
   std::string value;
   if (!object.GetString(key, &value)) {
-    INPUT_POPULATOR_ERROR() << '"' << key << "\" field must be a string.";
+    *error = true;
+    LOG(ERROR) << '"' << key << "\" field must be a string.";
   }
   return value;
 }
@@ -432,15 +717,14 @@ std::string InputPopulator::GetString(const base::DictionaryValue& object,
 }  // namespace
 
 // NOTE: takes ownership of the filter instance.
-PagespeedInput* ParseHttpArchiveWithFilter(const std::string& har_data,
-                                           ResourceFilter* filter) {
+PagespeedInput* ParseHttpArchiveWithThreads(const std::string& har_data,
+                                            ResourceFilter* filter,
+                                            int num_threads) {
   scoped_ptr<ResourceFilter> resource_filter(filter);
+  InputPopulator populator(num_threads, NULL);
+  JsonStreamParser parser(&populator);
   std::string error_msg_out;
-  scoped_ptr<const Value> har_json(base::JSONReader::ReadAndReturnError(
-      har_data,
-      true,  // allow_trailing_comma
-      NULL,  // error_code_out (ReadAndReturnError permits NULL here)
-      &error_msg_out));
+  scoped_ptr<const Value> har_json(parser.Parse(har_data, &error_msg_out));
   if (har_json == NULL) {
     LOG(ERROR) << "Failed to parse JSON: " << error_msg_out;
     return NULL;
@@ -450,17 +734,37 @@ PagespeedInput* ParseHttpArchiveWithFilter(const std::string& har_data,
       resource_filter == NULL ?
       new PagespeedInput() :
       new PagespeedInput(resource_filter.release()));
-  if (InputPopulator::Populate(*har_json, input.get())) {
+  if (populator.Finish(*har_json, input.get())) {
     return input.release();
   } else {
     return NULL;
   }
 }
 
+PagespeedInput* ParseHttpArchiveWithFilter(const std::string& har_data,
+                                           ResourceFilter* filter) {
+  return ParseHttpArchiveWithThreads(har_data, filter, 1);
+}
+
 PagespeedInput* ParseHttpArchive(const std::string& har_data) {
   return ParseHttpArchiveWithFilter(har_data, NULL);
 }
 
+bool ParseMultiPageHttpArchive(const std::string& har_data,
+                               int num_threads,
+                               std::vector<PagespeedInput*>* inputs) {
+  SharedBufferInterner body_interner;
+  InputPopulator populator(num_threads, &body_interner);
+  JsonStreamParser parser(&populator);
+  std::string error_msg_out;
+  scoped_ptr<const Value> har_json(parser.Parse(har_data, &error_msg_out));
+  if (har_json == NULL) {
+    LOG(ERROR) << "Failed to parse JSON: " << error_msg_out;
+    return false;
+  }
+  return populator.FinishPages(*har_json, inputs);
+}
+
 // TODO(mdsteele): It would be nice to have a more robust ISO 8601 parser here,
 // but this one seems to do okay for now on our unit tests.
 bool Iso8601ToEpochMillis(const std::string& input, int64* output) {
@@ -16,6 +16,7 @@
 #define PAGESPEED_CORE_HTTP_ARCHIVE_H_
 
 #include <string>
+#include <vector>
 
 #include "base/basictypes.h"  // for int64
 
@@ -35,6 +36,28 @@ PagespeedInput* ParseHttpArchive(const std::string& har_data);
 PagespeedInput* ParseHttpArchiveWithFilter(const std::string& har_data,
                                            ResourceFilter* resource_filter);
 
+// Same as ParseHttpArchiveWithFilter, but populates the resources using
+// up to num_threads threads. The resources are added to the returned
+// PagespeedInput in the same order as the entries of the HAR regardless
+// of the number of threads. resource_filter may be NULL.
+PagespeedInput* ParseHttpArchiveWithThreads(const std::string& har_data,
+                                            ResourceFilter* resource_filter,
+                                            int num_threads);
+
+// Parse a HAR that may describe several pages into one PagespeedInput
+// per page, in the order of the HAR's "pages" array, using up to
+// num_threads threads. Each entry is added to the input for the page
+// named by its "pageref"; entries that refer to no page are dropped. If
+// the HAR has no pages, a single input holding every entry is produced.
+// Resources with identical response bodies, such as the stylesheets
+// and scripts shared by the pages of a site, share a single copy of the
+// body. Returns false if there is an error, in which case inputs is
+// unchanged; otherwise the inputs are appended to inputs, and ownership
+// of them is transferred to the caller.
+bool ParseMultiPageHttpArchive(const std::string& har_data,
+                               int num_threads,
+                               std::vector<PagespeedInput*>* inputs);
+
 // Given a string in ISO 8601 format (see http://www.w3.org/TR/NOTE-datetime),
 // produce the number of milliseconds from midnight on 1 Jan 1970 UTC.  If the
 // parse is successful, return true; otherwise return false and make no change
@@ -13,8 +13,11 @@
 // limitations under the License.
 
 #include <string>
+#include <vector>
 
 #include "base/memory/scoped_ptr.h"
+#include "base/stl_util.h"
+#include "base/stringprintf.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/resource_filter.h"
@@ -25,6 +28,8 @@ using pagespeed::AllowAllResourceFilter;
 using pagespeed::PagespeedInput;
 using pagespeed::ParseHttpArchive;
 using pagespeed::ParseHttpArchiveWithFilter;
+using pagespeed::ParseHttpArchiveWithThreads;
+using pagespeed::ParseMultiPageHttpArchive;
 using pagespeed::Resource;
 
 namespace {
@@ -402,6 +407,245 @@ TEST(HttpArchiveTest, MissingText) {
   ASSERT_TRUE(input.get() != NULL);
 }
 
+// The timings of an entry depend on the page and on later entries, so
+// they must be correct even when the pages follow the entries.
+TEST(HttpArchiveTest, PagesAfterEntries) {
+  const char* kHarPagesAfterEntries =
+      "{"
+      "  \"log\":{"
+      "    \"entries\":["
+      "      {"
+      "        \"startedDateTime\": \"2009-04-16T12:07:23.596Z\","
+      "        \"request\":{"
+      "          \"method\":\"GET\","
+      "          \"url\":\"http://www.example.com/index.html\","
+      "          \"headers\":[]"
+      "        },"
+      "        \"response\":{"
+      "          \"status\":200,"
+      "          \"headers\":[],"
+      "          \"content\":{\"text\":\"Hello, world!\"}"
+      "        },"
+      "        \"timings\":{\"connect\": 50, \"wait\": 100}"
+      "      },"
+      "      {"
+      "        \"startedDateTime\": \"2009-04-16T12:07:25.596Z\","
+      "        \"request\":{"
+      "          \"method\":\"GET\","
+      "          \"url\":\"http://www.example.com/postonload.js\","
+      "          \"headers\":[]"
+      "        },"
+      "        \"response\":{"
+      "          \"status\":200,"
+      "          \"headers\":[],"
+      "          \"content\":{\"text\":\"Hello, world!\"}"
+      "        },"
+      "        \"timings\":{\"connect\": 10, \"wait\": 200}"
+      "      }"
+      "    ],"
+      "    \"pages\":["
+      "      {"
+      "        \"startedDateTime\": \"2009-04-16T12:07:23.321Z\","
+      "        \"id\": \"page_0\","
+      "        \"pageTimings\": {\"onLoad\": 1500}"
+      "      }"
+      "    ]"
+      "  }"
+      "}";
+
+  scoped_ptr<PagespeedInput> input(ParseHttpArchive(kHarPagesAfterEntries));
+  ASSERT_FALSE(input == NULL);
+  input->Freeze();
+
+  ASSERT_EQ(2, input->num_resources());
+  const Resource& resource1 = input->GetResource(0);
+  EXPECT_EQ(90, resource1.GetFirstByteMillis());
+  EXPECT_FALSE(input->IsResourceLoadedAfterOnload(resource1));
+  const Resource& resource2 = input->GetResource(1);
+  EXPECT_EQ(190, resource2.GetFirstByteMillis());
+  EXPECT_TRUE(input->IsResourceLoadedAfterOnload(resource2));
+}
+
+// Build a HAR with the given number of entries, alternating between
+// plain and base64 encoded bodies, with a different connect time for
+// each host.
+std::string BuildHarWithEntries(int num_entries) {
+  std::string har =
+      "{\"log\":{"
+      "\"pages\":[{\"startedDateTime\":\"2009-04-16T12:07:23.000Z\","
+      "\"pageTimings\":{\"onLoad\":1000}}],"
+      "\"entries\":[";
+  for (int i = 0; i < num_entries; ++i) {
+    if (i > 0) {
+      har += ",";
+    }
+    base::StringAppendF(
+        &har,
+        "{\"startedDateTime\":\"2009-04-16T12:07:%02d.000Z\","
+        "\"request\":{\"method\":\"GET\","
+        "\"url\":\"http://host%d.example.com/%d\",\"headers\":[]},"
+        "\"response\":{\"status\":200,"
+        "\"headers\":[{\"name\":\"X-Index\",\"value\":\"%d\"}],"
+        "\"content\":%s},"
+        "\"timings\":{\"connect\":%d,\"wait\":%d}}",
+        23 + i % 30, i % 7, i, i,
+        (i % 2 == 0 ?
+         "{\"text\":\"Hello, world!\"}" :
+         "{\"text\":\"SGVsbG8sIHdvcmxkIQ==\",\"encoding\":\"base64\"}"),
+        10 + i, 100 + i);
+  }
+  har += "]}}";
+  return har;
+}
+
+// Populating the entries on several threads must produce the same
+// resources, in the same order, as populating them on one thread.
+TEST(HttpArchiveTest, MultipleThreads) {
+  const int kNumEntries = 50;
+  const std::string har = BuildHarWithEntries(kNumEntries);
+  scoped_ptr<PagespeedInput> serial(ParseHttpArchive(har));
+  scoped_ptr<PagespeedInput> parallel(
+      ParseHttpArchiveWithThreads(har, NULL, 4));
+  ASSERT_FALSE(serial == NULL);
+  ASSERT_FALSE(parallel == NULL);
+  serial->Freeze();
+  parallel->Freeze();
+
+  ASSERT_EQ(kNumEntries, serial->num_resources());
+  ASSERT_EQ(kNumEntries, parallel->num_resources());
+  for (int i = 0; i < kNumEntries; ++i) {
+    const Resource& expected = serial->GetResource(i);
+    const Resource& actual = parallel->GetResource(i);
+    EXPECT_EQ(base::StringPrintf("http://host%d.example.com/%d", i % 7, i),
+              actual.GetRequestUrl());
+    EXPECT_EQ(expected.GetRequestUrl(), actual.GetRequestUrl());
+    EXPECT_EQ(expected.GetResponseHeader("x-index"),
+              actual.GetResponseHeader("x-index"));
+    EXPECT_EQ("Hello, world!", actual.GetResponseBody());
+    // The first byte time depends on the minimum connect time for the
+    // host over every entry, including those in later batches.
+    EXPECT_EQ(100 + i - (10 + i % 7), actual.GetFirstByteMillis());
+    EXPECT_EQ(expected.GetFirstByteMillis(), actual.GetFirstByteMillis());
+    EXPECT_EQ(serial->IsResourceLoadedAfterOnload(expected),
+              parallel->IsResourceLoadedAfterOnload(actual));
+  }
+}
+
+TEST(HttpArchiveTest, MultipleThreadsMalformedEntry) {
+  std::string har = BuildHarWithEntries(20);
+  // Replace the last entry with one that is not an object.
+  har.replace(har.rfind(",{"), std::string::npos, ",42]}}");
+  scoped_ptr<PagespeedInput> input(ParseHttpArchiveWithThreads(har, NULL, 4));
+  EXPECT_TRUE(input == NULL);
+}
+
+const char* kHarMultiplePages =
+    "{\"log\":{"
+    "\"pages\":["
+    "  {\"id\":\"page_a\",\"startedDateTime\":\"2009-04-16T12:07:23.000Z\","
+    "   \"pageTimings\":{\"onLoad\":1000}},"
+    "  {\"id\":\"page_b\",\"startedDateTime\":\"2009-04-16T12:08:00.000Z\","
+    "   \"pageTimings\":{\"onLoad\":-1}}"
+    "],"
+    "\"entries\":["
+    "  {\"pageref\":\"page_a\","
+    "   \"startedDateTime\":\"2009-04-16T12:07:23.000Z\","
+    "   \"request\":{\"method\":\"GET\",\"url\":\"http://a.com/\","
+    "     \"headers\":[]},"
+    "   \"response\":{\"status\":200,\"headers\":[],"
+    "     \"content\":{\"text\":\"page a\"}},"
+    "   \"timings\":{\"connect\":10,\"wait\":50}},"
+    "  {\"pageref\":\"page_b\","
+    "   \"startedDateTime\":\"2009-04-16T12:08:00.500Z\","
+    "   \"request\":{\"method\":\"GET\",\"url\":\"http://a.com/b\","
+    "     \"headers\":[]},"
+    "   \"response\":{\"status\":200,\"headers\":[],"
+    "     \"content\":{\"text\":\"page b\"}},"
+    "   \"timings\":{\"connect\":-1,\"wait\":40}},"
+    "  {\"pageref\":\"page_a\","
+    "   \"startedDateTime\":\"2009-04-16T12:07:25.000Z\","
+    "   \"request\":{\"method\":\"GET\",\"url\":\"http://a.com/s.css\","
+    "     \"headers\":[]},"
+    "   \"response\":{\"status\":200,\"headers\":[],"
+    "     \"content\":{\"text\":\"Ym9keXtjb2xvcjpyZWR9\","
+    "                  \"encoding\":\"base64\"}},"
+    "   \"timings\":{\"connect\":-1,\"wait\":30}},"
+    "  {\"pageref\":\"page_b\","
+    "   \"startedDateTime\":\"2009-04-16T12:08:00.600Z\","
+    "   \"request\":{\"method\":\"GET\",\"url\":\"http://a.com/s.css\","
+    "     \"headers\":[]},"
+    "   \"response\":{\"status\":200,\"headers\":[],"
+    "     \"content\":{\"text\":\"body{color:red}\"}},"
+    "   \"timings\":{\"connect\":-1,\"wait\":30}},"
+    "  {\"pageref\":\"page_c\","
+    "   \"request\":{\"method\":\"GET\",\"url\":\"http://a.com/c\","
+    "     \"headers\":[]},"
+    "   \"response\":{\"status\":200,\"headers\":[],"
+    "     \"content\":{\"text\":\"page c\"}},"
+    "   \"timings\":{}}"
+    "]}}";
+
+TEST(HttpArchiveTest, MultiplePages) {
+  for (int num_threads = 1; num_threads <= 2; ++num_threads) {
+    std::vector<PagespeedInput*> inputs;
+    ASSERT_TRUE(ParseMultiPageHttpArchive(kHarMultiplePages, num_threads,
+                                          &inputs));
+    ASSERT_EQ(2U, inputs.size());
+    PagespeedInput* page_a = inputs[0];
+    PagespeedInput* page_b = inputs[1];
+    page_a->Freeze();
+    page_b->Freeze();
+
+    // The entry for the unknown page_c is dropped.
+    ASSERT_EQ(2, page_a->num_resources());
+    ASSERT_EQ(2, page_b->num_resources());
+    EXPECT_EQ("http://a.com/", page_a->GetResource(0).GetRequestUrl());
+    EXPECT_EQ("http://a.com/s.css", page_a->GetResource(1).GetRequestUrl());
+    EXPECT_EQ("http://a.com/b", page_b->GetResource(0).GetRequestUrl());
+    EXPECT_EQ("http://a.com/s.css", page_b->GetResource(1).GetRequestUrl());
+
+    // Request start times are relative to each resource's own page.
+    EXPECT_FALSE(page_a->IsResourceLoadedAfterOnload(page_a->GetResource(0)));
+    EXPECT_TRUE(page_a->IsResourceLoadedAfterOnload(page_a->GetResource(1)));
+    // Onload has not yet fired for page_b.
+    EXPECT_FALSE(page_b->IsResourceLoadedAfterOnload(page_b->GetResource(1)));
+
+    // The minimum connect time for a host is shared by every page.
+    EXPECT_EQ(40, page_a->GetResource(0).GetFirstByteMillis());
+    EXPECT_EQ(30, page_b->GetResource(0).GetFirstByteMillis());
+
+    // The identical stylesheet bodies share a single copy, even though
+    // one was base64 encoded.
+    const base::StringPiece body_a =
+        page_a->GetResource(1).GetResponseBodyPiece();
+    const base::StringPiece body_b =
+        page_b->GetResource(1).GetResponseBodyPiece();
+    EXPECT_EQ("body{color:red}", body_a.as_string());
+    EXPECT_EQ(body_a.data(), body_b.data());
+    EXPECT_NE(page_a->GetResource(0).GetResponseBodyPiece().data(),
+              page_b->GetResource(0).GetResponseBodyPiece().data());
+
+    STLDeleteElements(&inputs);
+  }
+}
+
+TEST(HttpArchiveTest, MultiplePagesWithoutPages) {
+  std::vector<PagespeedInput*> inputs;
+  ASSERT_TRUE(ParseMultiPageHttpArchive(kHarInputBase64, 1, &inputs));
+  ASSERT_EQ(1U, inputs.size());
+  EXPECT_EQ(1, inputs[0]->num_resources());
+  STLDeleteElements(&inputs);
+}
+
+TEST(HttpArchiveTest, MultiplePagesInvalid) {
+  std::vector<PagespeedInput*> inputs;
+  EXPECT_FALSE(ParseMultiPageHttpArchive("{\"log\":}", 1, &inputs));
+  EXPECT_FALSE(ParseMultiPageHttpArchive(
+      "{\"log\":{\"pages\":[{\"id\":\"a\",\"startedDateTime\":\"bad\"}],"
+      "\"entries\":[]}}", 1, &inputs));
+  EXPECT_TRUE(inputs.empty());
+}
+
 class Iso8601Test : public testing::Test {
  protected:
   void ExpectValid(const std::string& input, int64 output) {
@@ -27,6 +27,7 @@
         '<(DEPTH)/<(instaweb_src_root)/instaweb_core.gyp:instaweb_rewriter_html',
         '<(pagespeed_root)/pagespeed/css/css.gyp:pagespeed_cssmin',
         '<(pagespeed_root)/pagespeed/js/js.gyp:pagespeed_jsminify',
+        '<(pagespeed_root)/pagespeed/util/util.gyp:pagespeed_util',
       ],
       'sources': [
         'html_minifier.cc',
@@ -14,9 +14,19 @@
 
 #include "pagespeed/html/html_minifier.h"
 
+#include <algorithm>
+
 #include "net/instaweb/http/public/content_type.h"
 #include "net/instaweb/util/public/google_message_handler.h"
 #include "net/instaweb/util/public/string_writer.h"
+#include "pagespeed/util/deadline.h"
+
+namespace {
+
+// Number of bytes to pass to the parser between checks of the deadline.
+const size_t kParseChunkSize = 64 * 1024;
+
+}  // namespace
 
 namespace pagespeed {
 
@@ -30,7 +40,8 @@ HtmlMinifier::HtmlMinifier()
       quote_removal_filter_(&html_parse_),
       collapse_whitespace_filter_(&html_parse_),
       minify_js_css_filter_(&html_parse_),
-      html_writer_filter_(&html_parse_) {
+      html_writer_filter_(&html_parse_),
+      deadline_(NULL) {
   // The instaweb parser emits warnings when it encounters malformed
   // content. We do not want to see these warnings; we only want to
   // see errors that occur due to unexpected conditions encountered in
@@ -47,15 +58,20 @@ HtmlMinifier::HtmlMinifier()
 
 HtmlMinifier::~HtmlMinifier() {}
 
+void HtmlMinifier::set_deadline(const Deadline* deadline) {
+  deadline_ = deadline;
+  minify_js_css_filter_.set_deadline(deadline);
+}
+
 bool HtmlMinifier::MinifyHtml(const std::string& input_name,
-                              const std::string& input,
+                              const base::StringPiece& input,
                               std::string* output) {
   return MinifyHtmlWithType(input_name, "text/html", input, output);
 }
 
 bool HtmlMinifier::MinifyHtmlWithType(const std::string& input_name,
                                       const std::string& input_content_type,
-                                      const std::string& input,
+                                      const base::StringPiece& input,
                                       std::string* output) {
   net_instaweb::StringWriter string_writer(output);
   html_writer_filter_.set_writer(&string_writer);
@@ -68,12 +84,20 @@ bool HtmlMinifier::MinifyHtmlWithType(const std::string& input_name,
   html_parse_.StartParseWithType(input_name,
                                  (content_type != NULL ? *content_type :
                                   net_instaweb::kContentTypeHtml));
-  html_parse_.ParseText(input.data(), input.size());
+  // Feed the parser in chunks, so we can give up early on large
+  // documents if the deadline expires.
+  for (size_t offset = 0; offset < input.size(); offset += kParseChunkSize) {
+    if (Deadline::IsExpired(deadline_)) {
+      break;
+    }
+    html_parse_.ParseText(input.data() + offset,
+                          std::min(kParseChunkSize, input.size() - offset));
+  }
   html_parse_.FinishParse();
 
   html_writer_filter_.set_writer(NULL);
 
-  return true;
+  return !Deadline::IsExpired(deadline_);
 }
 
 }  // namespace html
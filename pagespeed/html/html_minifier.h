@@ -22,6 +22,7 @@
 
 #include "base/basictypes.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/string_piece.h"
 #include "net/instaweb/htmlparse/public/html_parse.h"
 #include "net/instaweb/htmlparse/public/html_writer_filter.h"
 #include "net/instaweb/rewriter/public/collapse_whitespace_filter.h"
@@ -34,6 +35,8 @@
 
 namespace pagespeed {
 
+class Deadline;
+
 namespace html {
 
 class HtmlMinifier {
@@ -41,15 +44,20 @@ class HtmlMinifier {
   explicit HtmlMinifier();
   ~HtmlMinifier();
 
+  // Give up (and return false from MinifyHtml) if the given deadline
+  // (which may be NULL) expires before minification is complete. The
+  // deadline must outlive this object, or be reset.
+  void set_deadline(const Deadline* deadline);
+
   // Return true if successful, false on error.
   bool MinifyHtml(const std::string& input_name,
-                  const std::string& input,
+                  const base::StringPiece& input,
                   std::string* output);
   // Same as above, but accept an explicit Content-Type header, which may be
   // used to disambiguate between HTML and XHTML.
   bool MinifyHtmlWithType(const std::string& input_name,
                           const std::string& input_content_type,
-                          const std::string& input,
+                          const base::StringPiece& input,
                           std::string* output);
 
  private:
@@ -61,6 +69,7 @@ class HtmlMinifier {
   net_instaweb::CollapseWhitespaceFilter collapse_whitespace_filter_;
   MinifyJsCssFilter minify_js_css_filter_;
   net_instaweb::HtmlWriterFilter html_writer_filter_;
+  const Deadline* deadline_;
 
   DISALLOW_COPY_AND_ASSIGN(HtmlMinifier);
 };
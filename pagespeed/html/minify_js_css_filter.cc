@@ -21,24 +21,26 @@
 #include "net/instaweb/htmlparse/public/html_parse.h"
 #include "pagespeed/css/cssmin.h"
 #include "pagespeed/js/js_minify.h"
+#include "pagespeed/util/deadline.h"
 
 namespace pagespeed {
 
 namespace html {
 
 MinifyJsCssFilter::MinifyJsCssFilter(net_instaweb::HtmlParse* html_parse)
-    : html_parse_(html_parse) {
+    : html_parse_(html_parse), deadline_(NULL) {
 }
 
 void MinifyJsCssFilter::Characters(
     net_instaweb::HtmlCharactersNode* characters) {
   net_instaweb::HtmlElement* parent = characters->parent();
-  if (parent != NULL) {
+  if (parent != NULL && !Deadline::IsExpired(deadline_)) {
     net_instaweb::HtmlName::Keyword keyword = parent->keyword();
     bool did_minify = false;
     std::string minified;
     if (keyword == net_instaweb::HtmlName::kScript) {
-      did_minify = js::MinifyJs(characters->contents(), &minified);
+      did_minify = js::MinifyJsWithDeadline(characters->contents(), deadline_,
+                                            &minified);
       if (!did_minify) {
         LOG(INFO) << "Inline JS minification failed.";
       }
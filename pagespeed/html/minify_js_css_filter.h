@@ -20,17 +20,25 @@
 
 namespace pagespeed {
 
+class Deadline;
+
 namespace html {
 
 class MinifyJsCssFilter : public net_instaweb::EmptyHtmlFilter {
  public:
   explicit MinifyJsCssFilter(net_instaweb::HtmlParse* html_parse);
 
+  // Stop minifying inline JavaScript and CSS once the given deadline
+  // (which may be NULL) expires. Once expired, inline content is left
+  // unmodified. The deadline must outlive this filter, or be reset.
+  void set_deadline(const Deadline* deadline) { deadline_ = deadline; }
+
   virtual void Characters(net_instaweb::HtmlCharactersNode* characters);
   virtual const char* Name() const { return "MinifyJsCss"; }
 
  private:
   net_instaweb::HtmlParse* html_parse_;
+  const Deadline* deadline_;
 
   DISALLOW_COPY_AND_ASSIGN(MinifyJsCssFilter);
 };
@@ -51,7 +51,7 @@ static const int kInterlaceJumps[] = { 8, 8, 4, 2 };
 static const unsigned char kTransparentFlag = 0x01;
 
 struct GifInput {
-  const std::string* data_;
+  const base::StringPiece* data_;
   int offset_;
 };
 
@@ -470,7 +470,7 @@ GifReader::GifReader() {
 GifReader::~GifReader() {
 }
 
-bool GifReader::ReadPng(const std::string& body,
+bool GifReader::ReadPng(const base::StringPiece& body,
                         png_structp png_ptr,
                         png_infop info_ptr,
                         int transforms,
@@ -520,7 +520,7 @@ bool GifReader::ReadPng(const std::string& body,
   return result;
 }
 
-bool GifReader::GetAttributes(const std::string& body,
+bool GifReader::GetAttributes(const base::StringPiece& body,
                               int* out_width,
                               int* out_height,
                               int* out_bit_depth,
@@ -35,13 +35,13 @@ class GifReader : public PngReaderInterface {
   GifReader();
   virtual ~GifReader();
 
-  virtual bool ReadPng(const std::string& body,
+  virtual bool ReadPng(const base::StringPiece& body,
                        png_structp png_ptr,
                        png_infop info_ptr,
                        int transforms,
                        bool require_opaque) const;
 
-  virtual bool GetAttributes(const std::string& body,
+  virtual bool GetAttributes(const base::StringPiece& body,
                              int* out_width,
                              int* out_height,
                              int* out_bit_depth,
@@ -37,6 +37,7 @@ extern "C" {
 #include <setjmp.h>
 #endif
 
+#include "base/string_piece.h"
 #include "pagespeed/core/resource.h"
 
 #include "pagespeed/image_compression/gif_reader.h"
@@ -61,7 +62,7 @@ bool GetJpegWidthAndHeight(const pagespeed::Resource* resource,
   }
 
   jpeg_decompress->client_data = static_cast<void*>(&env);
-  const std::string& image_string = resource->GetResponseBody();
+  const base::StringPiece image_string = resource->GetResponseBodyPiece();
   reader.PrepareForRead(image_string.data(), image_string.size());
   jpeg_read_header(jpeg_decompress, TRUE);
   *out_width = jpeg_decompress->image_width;
@@ -80,7 +81,7 @@ bool GetWidthAndHeightFromPngReader(
     int* out_width,
     int* out_height) {
   int bit_depth, color_type;
-  if (!reader->GetAttributes(resource->GetResponseBody(),
+  if (!reader->GetAttributes(resource->GetResponseBodyPiece(),
                              out_width,
                              out_height,
                              &bit_depth,
@@ -111,9 +112,9 @@ bool GetGifWidthAndHeight(const pagespeed::Resource* resource,
                                         out_height);
 }
 
-bool GetWebpWidthAndHeight(const std::string image_string,
-                          int* out_width,
-                          int* out_height) {
+bool GetWebpWidthAndHeight(const base::StringPiece& image_string,
+                           int* out_width,
+                           int* out_height) {
   pagespeed::image_compression::WebpScanlineReader reader;
   if (reader.InitializeWithStatus(image_string.data(), image_string.length())) {
     *out_height = static_cast<unsigned int>(reader.GetImageHeight());
@@ -156,7 +157,8 @@ ImageAttributes * ImageAttributesFactory::NewImageAttributes(
       }
       break;
     case pagespeed::WEBP:
-      if (!GetWebpWidthAndHeight(resource->GetResponseBody(), &width, &height)) {
+      if (!GetWebpWidthAndHeight(resource->GetResponseBodyPiece(),
+                                 &width, &height)) {
         return NULL;
       }
       break;
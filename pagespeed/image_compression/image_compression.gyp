@@ -111,6 +111,7 @@
         'pagespeed_jpeg_reader',
         '<(DEPTH)/base/base.gyp:base',
         '<(DEPTH)/third_party/libjpeg_turbo/libjpeg_turbo.gyp:libjpeg_turbo',
+        '<(pagespeed_root)/pagespeed/util/util.gyp:pagespeed_util',
       ],
       'sources': [
         'jpeg_optimizer.cc',
@@ -155,6 +156,7 @@
         '<(DEPTH)/third_party/libpng/libpng.gyp:libpng',
         '<(DEPTH)/third_party/optipng/optipng.gyp:opngreduc',
         '<(DEPTH)/third_party/zlib/zlib.gyp:zlib',
+        '<(pagespeed_root)/pagespeed/util/util.gyp:pagespeed_util',
       ],
       'sources': [
         'gif_reader.cc',
@@ -37,6 +37,7 @@ extern "C" {
 }
 
 #include "pagespeed/image_compression/jpeg_reader.h"
+#include "pagespeed/util/deadline.h"
 
 using pagespeed::image_compression::ColorSampling;
 using pagespeed::image_compression::JpegCompressionOptions;
@@ -122,6 +123,22 @@ void ErrorExit(j_common_ptr jpeg_state_struct) {
     longjmp(*env, 1);
 }
 
+// A libjpeg progress monitor that aborts (via the error_exit
+// callback, which longjmps out of libjpeg) once a deadline expires.
+// libjpeg invokes the progress monitor periodically during each pass
+// over the image data.
+struct DeadlineProgressMonitor : public jpeg_progress_mgr {
+  const pagespeed::Deadline* deadline;
+};
+
+void CheckDeadline(j_common_ptr cinfo) {
+  const DeadlineProgressMonitor* monitor =
+      static_cast<const DeadlineProgressMonitor*>(cinfo->progress);
+  if (pagespeed::Deadline::IsExpired(monitor->deadline)) {
+    (*cinfo->err->error_exit)(cinfo);
+  }
+}
+
 // OutputMessageFromReader is called by libjpeg code on an error when reading.
 // Without this function, a default function would print to standard error.
 void OutputMessage(j_common_ptr jpeg_decompress) {
@@ -228,12 +245,18 @@ class JpegOptimizer {
   // null, in which case the default options are used.
   // If this function fails (returns false), it can be called again.
   // @return true on success, false on failure.
-  bool CreateOptimizedJpeg(const std::string &original,
+  bool CreateOptimizedJpeg(const base::StringPiece& original,
                            std::string *compressed,
                            const JpegCompressionOptions& options);
 
+  // Give up (and fail) if the given deadline (which may be NULL)
+  // expires before optimization is complete.
+  void set_deadline(const pagespeed::Deadline* deadline) {
+    progress_monitor_.deadline = deadline;
+  }
+
  private:
-  bool DoCreateOptimizedJpeg(const std::string &original,
+  bool DoCreateOptimizedJpeg(const base::StringPiece& original,
                              jpeg_decompress_struct *jpeg_decompress,
                              std::string *compressed,
                              const JpegCompressionOptions& options);
@@ -252,11 +275,16 @@ class JpegOptimizer {
   jpeg_compress_struct jpeg_compress_;
   jpeg_error_mgr compress_error_;
 
+  DeadlineProgressMonitor progress_monitor_;
+
   DISALLOW_COPY_AND_ASSIGN(JpegOptimizer);
 };
 
 JpegOptimizer::JpegOptimizer() {
   InitJpegCompress(&jpeg_compress_, &compress_error_);
+  memset(&progress_monitor_, 0, sizeof(progress_monitor_));
+  progress_monitor_.progress_monitor = &CheckDeadline;
+  progress_monitor_.deadline = NULL;
 }
 
 JpegOptimizer::~JpegOptimizer() {
@@ -365,7 +393,7 @@ bool JpegOptimizer::OptimizeLossless(jpeg_decompress_struct *jpeg_decompress,
 // Helper for JpegOptimizer::CreateOptimizedJpeg().  This function does the
 // work, and CreateOptimizedJpeg() does some cleanup.
 bool JpegOptimizer::DoCreateOptimizedJpeg(
-    const std::string &original,
+    const base::StringPiece& original,
     jpeg_decompress_struct *jpeg_decompress,
     std::string *compressed,
     const pagespeed::image_compression::JpegCompressionOptions& options) {
@@ -384,6 +412,11 @@ bool JpegOptimizer::DoCreateOptimizedJpeg(
   jpeg_decompress->client_data = static_cast<void *>(&env);
   jpeg_compress_.client_data = static_cast<void *>(&env);
 
+  if (progress_monitor_.deadline != NULL) {
+    jpeg_decompress->progress = &progress_monitor_;
+    jpeg_compress_.progress = &progress_monitor_;
+  }
+
   reader_.PrepareForRead(original.data(), original.size());
 
   if (options.retain_color_profile) {
@@ -411,7 +444,7 @@ bool JpegOptimizer::DoCreateOptimizedJpeg(
   return valid_jpeg;
 }
 
-bool JpegOptimizer::CreateOptimizedJpeg(const std::string &original,
+bool JpegOptimizer::CreateOptimizedJpeg(const base::StringPiece& original,
     std::string *compressed, const JpegCompressionOptions& options) {
   jpeg_decompress_struct* jpeg_decompress = reader_.decompress_struct();
 
@@ -420,6 +453,8 @@ bool JpegOptimizer::CreateOptimizedJpeg(const std::string &original,
 
   jpeg_decompress->client_data = NULL;
   jpeg_compress_.client_data = NULL;
+  jpeg_decompress->progress = NULL;
+  jpeg_compress_.progress = NULL;
 
   if (!result) {
     // Clean up the state of jpeglib structures.  It is okay to abort even if
@@ -518,14 +553,23 @@ void JpegScanlineWriter::AbortWrite() {
   jpeg_abort_compress(&data_->jpeg_compress_);
 }
 
-bool OptimizeJpeg(const std::string &original,
+bool OptimizeJpeg(const base::StringPiece& original,
                   std::string *compressed) {
   JpegOptimizer optimizer;
   JpegCompressionOptions options;
   return optimizer.CreateOptimizedJpeg(original, compressed, options);
 }
 
-bool OptimizeJpegWithOptions(const std::string &original,
+bool OptimizeJpegWithDeadline(const base::StringPiece& original,
+                              const Deadline *deadline,
+                              std::string *compressed) {
+  JpegOptimizer optimizer;
+  optimizer.set_deadline(deadline);
+  JpegCompressionOptions options;
+  return optimizer.CreateOptimizedJpeg(original, compressed, options);
+}
+
+bool OptimizeJpegWithOptions(const base::StringPiece& original,
                              std::string *compressed,
                              const JpegCompressionOptions &options) {
   JpegOptimizer optimizer;
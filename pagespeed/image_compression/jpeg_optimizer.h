@@ -22,6 +22,7 @@
 #include <string>
 #include <setjmp.h>
 
+#include "base/string_piece.h"
 #include "pagespeed/image_compression/scanline_interface.h"
 
 // DO NOT INCLUDE LIBJPEG HEADERS HERE. Doing so causes build errors
@@ -29,6 +30,8 @@
 
 namespace pagespeed {
 
+class Deadline;
+
 namespace image_compression {
 
 enum ColorSampling {
@@ -79,11 +82,17 @@ struct JpegCompressionOptions {
 
 // Performs lossless optimization, that is, the output image will be
 // pixel-for-pixel identical to the input image.
-bool OptimizeJpeg(const std::string &original,
+bool OptimizeJpeg(const base::StringPiece& original,
                   std::string *compressed);
 
+// Same as OptimizeJpeg, but fail if the given deadline (which may be
+// NULL) expires before optimization is complete.
+bool OptimizeJpegWithDeadline(const base::StringPiece& original,
+                              const Deadline *deadline,
+                              std::string *compressed);
+
 // Performs JPEG optimizations with the provided options.
-bool OptimizeJpegWithOptions(const std::string &original,
+bool OptimizeJpegWithOptions(const base::StringPiece& original,
                              std::string *compressed,
                              const JpegCompressionOptions &options);
 
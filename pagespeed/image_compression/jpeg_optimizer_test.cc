@@ -25,6 +25,7 @@
 #include "pagespeed/image_compression/jpeg_optimizer.h"
 #include "pagespeed/image_compression/jpeg_optimizer_test_helper.h"
 #include "pagespeed/testing/pagespeed_test.h"
+#include "pagespeed/util/deadline.h"
 
 // DO NOT INCLUDE LIBJPEG HEADERS HERE. Doing so causes build errors
 // on Windows. If you need to call out to libjpeg, please add helper
@@ -36,6 +37,7 @@ using pagespeed::image_compression::ColorSampling;
 using pagespeed::image_compression::JpegCompressionOptions;
 using pagespeed::image_compression::JpegLossyOptions;
 using pagespeed::image_compression::OptimizeJpeg;
+using pagespeed::image_compression::OptimizeJpegWithDeadline;
 using pagespeed::image_compression::OptimizeJpegWithOptions;
 using pagespeed_testing::image_compression::GetJpegNumComponentsAndSamplingFactors;
 using pagespeed_testing::image_compression::GetNumScansInJpeg;
@@ -138,6 +140,19 @@ TEST(JpegOptimizerTest, ValidJpegs) {
   }
 }
 
+TEST(JpegOptimizerTest, ExpiredDeadline) {
+  std::string src_data;
+  ReadJpegToString(kValidImages[0].filename, &src_data);
+  pagespeed::Deadline deadline;
+  std::string dest_data;
+  ASSERT_TRUE(OptimizeJpegWithDeadline(src_data, &deadline, &dest_data));
+  EXPECT_EQ(kValidImages[0].compressed_size, dest_data.size());
+
+  deadline.Cancel();
+  dest_data.clear();
+  ASSERT_FALSE(OptimizeJpegWithDeadline(src_data, &deadline, &dest_data));
+}
+
 TEST(JpegOptimizerTest, ValidJpegsLossy) {
   for (size_t i = 0; i < kValidImageCount; ++i) {
     std::string src_data;
@@ -24,6 +24,7 @@
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "pagespeed/image_compression/scanline_utils.h"
+#include "pagespeed/util/deadline.h"
 
 #ifdef __native_client__
 // For some reason that is not yet clear, invoking png_longjmp on
@@ -70,7 +71,7 @@ class PngInput {
     offset_ = 0;
   }
 
-  void Initialize(const std::string& image_string) {
+  void Initialize(const base::StringPiece& image_string) {
     data_ = static_cast<const char*>(image_string.data());
     length_ = image_string.length();
     offset_ = 0;
@@ -145,12 +146,23 @@ void ReadPngFromStream(png_structp read_ptr,
   }
 }
 
+// Destination for PngOptimizer::WritePng. libpng does not give us a
+// hook into the compression loop itself, so the deadline is checked
+// each time libpng flushes compressed data to us.
+struct PngStringSink {
+  std::string* buffer;
+  const pagespeed::Deadline* deadline;
+};
+
 void WritePngToString(png_structp write_ptr,
                       png_bytep data,
                       png_size_t length) {
-  std::string& buffer =
-      *reinterpret_cast<std::string*>(png_get_io_ptr(write_ptr));
-  buffer.append(reinterpret_cast<char*>(data), length);
+  PngStringSink& sink =
+      *reinterpret_cast<PngStringSink*>(png_get_io_ptr(write_ptr));
+  sink.buffer->append(reinterpret_cast<char*>(data), length);
+  if (pagespeed::Deadline::IsExpired(sink.deadline)) {
+    png_error(write_ptr, "Deadline expired.");
+  }
 }
 
 void PngErrorFn(png_structp png_ptr, png_const_charp msg) {
@@ -276,14 +288,15 @@ PngReaderInterface::~PngReaderInterface() {
 PngOptimizer::PngOptimizer()
     : read_(ScopedPngStruct::READ),
       write_(ScopedPngStruct::WRITE),
-      best_compression_(false) {
+      best_compression_(false),
+      deadline_(NULL) {
 }
 
 PngOptimizer::~PngOptimizer() {
 }
 
 bool PngOptimizer::CreateOptimizedPng(const PngReaderInterface& reader,
-                                      const std::string& in,
+                                      const base::StringPiece& in,
                                       std::string* out) {
   if (!read_.valid() || !write_.valid()) {
     LOG(DFATAL) << "Invalid ScopedPngStruct r: "
@@ -309,6 +322,10 @@ bool PngOptimizer::CreateOptimizedPng(const PngReaderInterface& reader,
     return false;
   }
 
+  if (Deadline::IsExpired(deadline_)) {
+    return false;
+  }
+
   if (!opng_validate_image(read_.png_ptr(), read_.info_ptr())) {
     return false;
   }
@@ -322,6 +339,10 @@ bool PngOptimizer::CreateOptimizedPng(const PngReaderInterface& reader,
   // (e.g. RGB->palette, etc).
   opng_reduce_image(write_.png_ptr(), write_.info_ptr(), OPNG_REDUCE_ALL);
 
+  if (Deadline::IsExpired(deadline_)) {
+    return false;
+  }
+
   if (best_compression_) {
     return CreateBestOptimizedPngForParams(kPngCompressionParams, kParamCount,
                                            out);
@@ -336,6 +357,9 @@ bool PngOptimizer::CreateBestOptimizedPngForParams(
     std::string* out) {
   bool success = false;
   for (size_t idx = 0; idx < param_list_size; ++idx) {
+    if (Deadline::IsExpired(deadline_)) {
+      return false;
+    }
     ScopedPngStruct write(ScopedPngStruct::WRITE);
     std::string temp_output;
     // libpng doesn't allow for reuse of the write structs, so we must copy on
@@ -369,27 +393,36 @@ bool PngOptimizer::CreateOptimizedPngWithParams(ScopedPngStruct* write,
 }
 
 bool PngOptimizer::OptimizePng(const PngReaderInterface& reader,
-                               const std::string& in,
+                               const base::StringPiece& in,
                                std::string* out) {
   PngOptimizer o;
   return o.CreateOptimizedPng(reader, in, out);
 }
 
 bool PngOptimizer::OptimizePngBestCompression(const PngReaderInterface& reader,
-                                              const std::string& in,
+                                              const base::StringPiece& in,
                                               std::string* out) {
   PngOptimizer o;
   o.EnableBestCompression();
   return o.CreateOptimizedPng(reader, in, out);
 }
 
+bool PngOptimizer::OptimizePngWithDeadline(const PngReaderInterface& reader,
+                                           const base::StringPiece& in,
+                                           const Deadline* deadline,
+                                           std::string* out) {
+  PngOptimizer o;
+  o.set_deadline(deadline);
+  return o.CreateOptimizedPng(reader, in, out);
+}
+
 PngReader::PngReader() {
 }
 
 PngReader::~PngReader() {
 }
 
-bool PngReader::ReadPng(const std::string& body,
+bool PngReader::ReadPng(const base::StringPiece& body,
                         png_structp png_ptr,
                         png_infop info_ptr,
                         int transforms,
@@ -425,7 +458,7 @@ bool PngReader::ReadPng(const std::string& body,
     return true;
 }
 
-bool PngReader::GetAttributes(const std::string& body,
+bool PngReader::GetAttributes(const base::StringPiece& body,
                               int* out_width,
                               int* out_height,
                               int* out_bit_depth,
@@ -513,7 +546,10 @@ bool PngOptimizer::WritePng(ScopedPngStruct* write, std::string* buffer) {
   if (setjmp(png_jmpbuf(write->png_ptr()))) {
     return false;
   }
-  png_set_write_fn(write->png_ptr(), buffer, &WritePngToString, &PngFlush);
+  PngStringSink sink;
+  sink.buffer = buffer;
+  sink.deadline = deadline_;
+  png_set_write_fn(write->png_ptr(), &sink, &WritePngToString, &PngFlush);
   png_write_png(
       write->png_ptr(), write->info_ptr(), PNG_TRANSFORM_IDENTITY, NULL);
 
@@ -767,13 +803,13 @@ bool PngScanlineReader::Reset() {
 }
 
 bool PngScanlineReader::InitializeRead(const PngReaderInterface& reader,
-                                       const std::string& in) {
+                                       const base::StringPiece& in) {
   bool is_opaque = false;
   return InitializeRead(reader, in, &is_opaque);
 }
 
 bool PngScanlineReader::InitializeRead(const PngReaderInterface& reader,
-                                       const std::string& in,
+                                       const base::StringPiece& in,
                                        bool* is_opaque) {
   if (!read_.valid()) {
     LOG(DFATAL) << "Invalid ScopedPngStruct r: " << read_.valid();
@@ -33,11 +33,14 @@ extern "C" {
 
 #include "base/basictypes.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/string_piece.h"
 
 #include "pagespeed/image_compression/scanline_interface.h"
 
 namespace pagespeed {
 
+class Deadline;
+
 namespace image_compression {
 
 class PngInput;
@@ -102,7 +105,7 @@ class PngReaderInterface {
   // is true, returns an image without an alpha channel if the
   // original image has no transparent pixels, and fails
   // otherwise. Returns true on success, false on failure.
-  virtual bool ReadPng(const std::string& body,
+  virtual bool ReadPng(const base::StringPiece& body,
                        png_structp png_ptr,
                        png_infop info_ptr,
                        int transforms,
@@ -111,7 +114,7 @@ class PngReaderInterface {
   // Parse the contents of body, convert to a PNG, and populate the
   // PNG structures with the PNG representation. Returns true on
   // success, false on failure.
-  bool ReadPng(const std::string& body,
+  bool ReadPng(const base::StringPiece& body,
                png_structp png_ptr,
                png_infop info_ptr,
                int transforms) const {
@@ -122,7 +125,7 @@ class PngReaderInterface {
   // number of bits per channel. out_color_type is one of the
   // PNG_COLOR_TYPE_* declared in png.h.
   // TODO(bmcquade): consider merging this with ImageAttributes.
-  virtual bool GetAttributes(const std::string& body,
+  virtual bool GetAttributes(const base::StringPiece& body,
                              int* out_width,
                              int* out_height,
                              int* out_bit_depth,
@@ -172,8 +175,10 @@ class PngScanlineReader : public ScanlineReaderInterface {
   virtual bool Reset();
 
   // Initializes the read structures with the given input.
-  bool InitializeRead(const PngReaderInterface& reader, const std::string& in);
-  bool InitializeRead(const PngReaderInterface& reader, const std::string& in,
+  bool InitializeRead(const PngReaderInterface& reader,
+                      const base::StringPiece& in);
+  bool InitializeRead(const PngReaderInterface& reader,
+                      const base::StringPiece& in,
                       bool* is_opaque);
 
   virtual size_t GetBytesPerScanline();
@@ -201,22 +206,31 @@ class PngScanlineReader : public ScanlineReaderInterface {
 class PngOptimizer {
  public:
   static bool OptimizePng(const PngReaderInterface& reader,
-                          const std::string& in,
+                          const base::StringPiece& in,
                           std::string* out);
 
   static bool OptimizePngBestCompression(const PngReaderInterface& reader,
-                                         const std::string& in,
+                                         const base::StringPiece& in,
                                          std::string* out);
 
+  // Same as OptimizePng, but fail if the given deadline (which may be
+  // NULL) expires before optimization is complete.
+  static bool OptimizePngWithDeadline(const PngReaderInterface& reader,
+                                      const base::StringPiece& in,
+                                      const Deadline* deadline,
+                                      std::string* out);
+
  private:
   PngOptimizer();
   ~PngOptimizer();
 
+  void set_deadline(const Deadline* deadline) { deadline_ = deadline; }
+
   // Take the given input and losslessly compress it by removing
   // all unnecessary chunks, and by choosing an optimal PNG encoding.
   // @return true on success, false on failure.
   bool CreateOptimizedPng(const PngReaderInterface& reader,
-                          const std::string& in,
+                          const base::StringPiece& in,
                           std::string* out);
 
   // Turn on best compression. Requires additional CPU but produces
@@ -237,6 +251,7 @@ class PngOptimizer {
   ScopedPngStruct read_;
   ScopedPngStruct write_;
   bool best_compression_;
+  const Deadline* deadline_;
 
   DISALLOW_COPY_AND_ASSIGN(PngOptimizer);
 };
@@ -246,13 +261,13 @@ class PngReader : public PngReaderInterface {
  public:
   PngReader();
   virtual ~PngReader();
-  virtual bool ReadPng(const std::string& body,
+  virtual bool ReadPng(const base::StringPiece& body,
                        png_structp png_ptr,
                        png_infop info_ptr,
                        int transforms,
                        bool require_opaque) const;
 
-  virtual bool GetAttributes(const std::string& body,
+  virtual bool GetAttributes(const base::StringPiece& body,
                              int* out_width,
                              int* out_height,
                              int* out_bit_depth,
@@ -26,6 +26,7 @@
 #include "pagespeed/image_compression/read_image.h"
 #include "pagespeed/image_compression/scanline_utils.h"
 #include "pagespeed/testing/pagespeed_test.h"
+#include "pagespeed/util/deadline.h"
 #include "third_party/libpng/png.h"
 
 namespace {
@@ -598,6 +599,23 @@ TEST(PngOptimizerTest, LargerPng) {
   EXPECT_EQ(0, color_type);
 }
 
+TEST(PngOptimizerTest, ExpiredDeadline) {
+  PngReader reader;
+  std::string in, out;
+  ReadImageToString(kPngTestDir, "this_is_a_test", "png", &in);
+  pagespeed::Deadline deadline;
+  ASSERT_TRUE(PngOptimizer::OptimizePngWithDeadline(reader, in, &deadline,
+                                                    &out));
+  std::string expected;
+  ASSERT_TRUE(PngOptimizer::OptimizePng(reader, in, &expected));
+  EXPECT_EQ(expected, out);
+
+  deadline.Cancel();
+  out.clear();
+  ASSERT_FALSE(PngOptimizer::OptimizePngWithDeadline(reader, in, &deadline,
+                                                     &out));
+}
+
 TEST(PngOptimizerTest, InvalidPngs) {
   PngReader reader;
   for (size_t i = 0; i < kInvalidFileCount; i++) {
@@ -33,6 +33,7 @@
       ],
       'dependencies': [
         '<(DEPTH)/base/base.gyp:base',
+        '<(pagespeed_root)/pagespeed/util/util.gyp:pagespeed_util',
         'pagespeed_javascript_gperf',
       ],
       'direct_dependent_settings': {
@@ -19,7 +19,9 @@
 
 #include "base/logging.h"
 #include "base/string_piece.h"
+#include "pagespeed/util/deadline.h"
 
+using pagespeed::Deadline;
 using pagespeed::JsKeywords;
 
 namespace {
@@ -32,6 +34,11 @@ namespace {
 
 const int kEOF = -1;  // represents the end of the input
 
+// Number of iterations of the main minification loop between checks of
+// the deadline. Checking the deadline requires reading the clock, so we
+// do not want to do it for every character.
+const int kDeadlineCheckInterval = 4096;
+
 // A token can either be a character (0-255) or one of these constants:
 const int kStartToken = 256;  // the start of the input
 const int kCCCommentToken = 257;  // a conditional compilation comment
@@ -170,6 +177,11 @@ class Minifier {
   // and before calling GetOutput().
   void EnableStringCollapse() { collapse_string_ = true; }
 
+  // Give up (and fail) if the given deadline expires before
+  // minification is complete. Should call after constructor, and before
+  // calling GetOutput().
+  void SetDeadline(const Deadline* deadline) { deadline_ = deadline; }
+
  private:
   int Peek();
   void ChangeToken(int next_token);
@@ -194,6 +206,7 @@ class Minifier {
   int prev_token_;
   bool error_;
   bool collapse_string_;
+  const Deadline* deadline_;
 };
 
 template<typename OutputConsumer>
@@ -205,7 +218,8 @@ Minifier<OutputConsumer>::Minifier(const base::StringPiece& input,
     whitespace_(NO_WHITESPACE),
     prev_token_(kStartToken),
     error_(false),
-    collapse_string_(false) {}
+    collapse_string_(false),
+    deadline_(NULL) {}
 
 // Return the next character after index_, or kEOF if there aren't any more.
 template<typename OutputConsumer>
@@ -380,7 +394,15 @@ void Minifier<OutputConsumer>::ConsumeString() {
 
 template<typename OutputConsumer>
 void Minifier<OutputConsumer>::Minify() {
+  int iterations_until_deadline_check = 1;
   while (index_ < input_.size() && !error_) {
+    if (deadline_ != NULL && --iterations_until_deadline_check == 0) {
+      if (deadline_->IsExpired()) {
+        error_ = true;
+        break;
+      }
+      iterations_until_deadline_check = kDeadlineCheckInterval;
+    }
     const char ch = input_[index_];
     // Track whitespace since the previous token.  NO_WHITESPACE means no
     // whitespace; LINEBREAK means there's been at least one linebreak; SPACE
@@ -508,12 +530,26 @@ namespace pagespeed {
 namespace js {
 
 bool MinifyJs(const base::StringPiece& input, std::string* out) {
+  return MinifyJsWithDeadline(input, NULL, out);
+}
+
+bool MinifyJsWithDeadline(const base::StringPiece& input,
+                          const Deadline* deadline,
+                          std::string* out) {
   Minifier<StringConsumer> minifier(input, out);
+  minifier.SetDeadline(deadline);
   return (minifier.GetOutput() != NULL);
 }
 
 bool GetMinifiedJsSize(const base::StringPiece& input, int* minimized_size) {
+  return GetMinifiedJsSizeWithDeadline(input, NULL, minimized_size);
+}
+
+bool GetMinifiedJsSizeWithDeadline(const base::StringPiece& input,
+                                   const Deadline* deadline,
+                                   int* minimized_size) {
   Minifier<SizeConsumer> minifier(input, NULL);
+  minifier.SetDeadline(deadline);
   SizeConsumer* output = minifier.GetOutput();
   if (output) {
     *minimized_size = output->size_;
@@ -532,8 +568,17 @@ bool MinifyJsAndCollapseStrings(const base::StringPiece& input,
 
 bool GetMinifiedStringCollapsedJsSize(const base::StringPiece& input,
                                       int* minimized_size) {
+  return GetMinifiedStringCollapsedJsSizeWithDeadline(input, NULL,
+                                                      minimized_size);
+}
+
+bool GetMinifiedStringCollapsedJsSizeWithDeadline(
+    const base::StringPiece& input,
+    const Deadline* deadline,
+    int* minimized_size) {
   Minifier<SizeConsumer> minifier(input, NULL);
   minifier.EnableStringCollapse();
+  minifier.SetDeadline(deadline);
   SizeConsumer* output = minifier.GetOutput();
   if (output) {
     *minimized_size = output->size_;
@@ -21,14 +21,28 @@
 
 namespace pagespeed {
 
+class Deadline;
+
 namespace js {
 
 // Return true if minification was successful, false otherwise.
 bool MinifyJs(const base::StringPiece& input, std::string* out);
 
+// Same as above, but fail if the given deadline (which may be NULL)
+// expires before minification is complete.
+bool MinifyJsWithDeadline(const base::StringPiece& input,
+                          const Deadline* deadline,
+                          std::string* out);
+
 // Return true if minification was successful, false otherwise.
 bool GetMinifiedJsSize(const base::StringPiece& input, int* minimized_size);
 
+// Same as above, but fail if the given deadline (which may be NULL)
+// expires before minification is complete.
+bool GetMinifiedJsSizeWithDeadline(const base::StringPiece& input,
+                                   const Deadline* deadline,
+                                   int* minimized_size);
+
 // Return true if minification and collapsing string was successful, false
 // otherwise. This functin is a special use of js_minify. It minifies the JS
 // and removes all the string literals. Example:
@@ -39,6 +53,13 @@ bool MinifyJsAndCollapseStrings(const base::StringPiece& input,
 bool GetMinifiedStringCollapsedJsSize(const base::StringPiece& input,
                                       int* minimized_size);
 
+// Same as above, but fail if the given deadline (which may be NULL)
+// expires before minification is complete.
+bool GetMinifiedStringCollapsedJsSizeWithDeadline(
+    const base::StringPiece& input,
+    const Deadline* deadline,
+    int* minimized_size);
+
 }  // namespace js
 
 }  // namespace pagespeed
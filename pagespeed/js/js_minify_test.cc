@@ -16,6 +16,7 @@
 
 #include "base/string_piece.h"
 #include "pagespeed/js/js_minify.h"
+#include "pagespeed/util/deadline.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace {
@@ -397,4 +398,22 @@ TEST_F(JsMinifyTest, CollapsingStringTest) {
     ASSERT_EQ(static_cast<int>(strlen(kCollapsedTestString)), size);
 }
 
+TEST_F(JsMinifyTest, ExpiredDeadline) {
+  pagespeed::Deadline deadline;
+  std::string output;
+  ASSERT_TRUE(pagespeed::js::MinifyJsWithDeadline(
+      kBeforeCompilation, &deadline, &output));
+  ASSERT_EQ(kAfterCompilation, output);
+
+  deadline.Cancel();
+  output.clear();
+  ASSERT_FALSE(pagespeed::js::MinifyJsWithDeadline(
+      kBeforeCompilation, &deadline, &output));
+  int size = 0;
+  ASSERT_FALSE(pagespeed::js::GetMinifiedJsSizeWithDeadline(
+      kBeforeCompilation, &deadline, &size));
+  ASSERT_FALSE(pagespeed::js::GetMinifiedStringCollapsedJsSizeWithDeadline(
+      kCollapsingStringTestString, &deadline, &size));
+}
+
 }  // namespace
@@ -36,6 +36,7 @@
         '<(pagespeed_root)/pagespeed/js/js.gyp:pagespeed_jsminify',
         '<(pagespeed_root)/pagespeed/l10n/l10n.gyp:pagespeed_l10n',
         '<(pagespeed_root)/pagespeed/proto/proto_gen.gyp:pagespeed_output_pb',
+        '<(pagespeed_root)/pagespeed/util/util.gyp:pagespeed_util',
       ],
       'sources': [
         'rules/avoid_bad_requests.cc',
@@ -55,6 +56,7 @@
         'rules/leverage_browser_caching.cc',
         'rules/load_visible_images_first.cc',
         'rules/make_landing_page_redirects_cacheable.cc',
+        'rules/minifier_artifact_computer.cc',
         'rules/minify_css.cc',
         'rules/minify_html.cc',
         'rules/minify_javascript.cc',
@@ -128,22 +130,31 @@
       'sources': [
         'browsing_context/browsing_context_factory_test.cc',
         'core/browsing_context_test.cc',
+        'core/cache_policy_test.cc',
+        'core/concurrent_memo_test.cc',
+        'core/cost_timer_test.cc',
         'core/dom_test.cc',
         'core/engine_test.cc',
         'core/file_util_test.cc',
         'core/formatter_test.cc',
+        'core/header_map_test.cc',
+        'core/input_archive_test.cc',
         'core/input_capabilities_test.cc',
         'core/instrumentation_data_test.cc',
+        'core/json_stream_parser_test.cc',
         'core/pagespeed_input_test.cc',
         'core/resource_test.cc',
         'core/resource_collection_test.cc',
         'core/resource_evaluation_test.cc',
         'core/resource_fetch_test.cc',
         'core/resource_filter_test.cc',
+        'core/resource_result_cache_test.cc',
         'core/resource_util_test.cc',
         'core/rule_input_test.cc',
+        'core/shared_buffer_test.cc',
         'core/string_tokenizer_test.cc',
         'core/string_util_test.cc',
+        'core/thread_pool_test.cc',
         'core/uri_util_test.cc',
         'css/cssmin_test.cc',
         'css/external_resource_finder_test.cc',
@@ -153,10 +164,12 @@
         'filters/landing_page_redirection_filter_test.cc',
         'filters/protocol_filter_test.cc',
         'filters/response_byte_result_filter_test.cc',
+        'filters/rule_name_result_filter_test.cc',
         'filters/tracker_filter_test.cc',
         'filters/url_regex_filter_test.cc',
         'formatters/formatter_util_test.cc',
         'formatters/proto_formatter_test.cc',
+        'har/base64_decoder_test.cc',
         'har/http_archive_test.cc',
         'html/external_resource_filter_test.cc',
         'html/html_minifier_test.cc',
@@ -185,6 +198,7 @@
         'rules/leverage_browser_caching_test.cc',
         'rules/load_visible_images_first_test.cc',
         'rules/make_landing_page_redirects_cacheable_test.cc',
+        'rules/minifier_artifact_computer_test.cc',
         'rules/minify_css_test.cc',
         'rules/minify_html_test.cc',
         'rules/minify_javascript_test.cc',
@@ -211,6 +225,7 @@
         'testing/fake_dom_test.cc',
         'testing/instrumentation_data_builder_test.cc',
         'timeline/json_importer_test.cc',
+        'util/deadline_test.cc',
         'util/regex_test.cc',
       ],
       'defines': [
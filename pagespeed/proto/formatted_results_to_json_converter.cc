@@ -68,6 +68,53 @@ bool FormattedResultsToJsonConverter::Convert(
   return true;
 }
 
+// The keys of a DictionaryValue are written in sorted order, so Convert
+// writes "locale", then "rule_results", then "score".
+bool FormattedResultsToJsonConverter::ConvertStreamingBegin(
+    const std::string& locale, std::string* out) {
+  base::StringValue locale_value(locale);
+  std::string json;
+  base::JSONWriter::Write(&locale_value, &json);
+  out->append("{\"locale\":");
+  out->append(json);
+  return true;
+}
+
+bool FormattedResultsToJsonConverter::ConvertStreamingRuleResults(
+    const pagespeed::FormattedRuleResults& rule_results,
+    bool is_first_rule,
+    std::string* out) {
+  scoped_ptr<Value> value(ConvertFormattedRuleResults(rule_results));
+  if (value == NULL) {
+    return false;
+  }
+  std::string json;
+  base::JSONWriter::Write(value.get(), &json);
+  out->append(is_first_rule ? ",\"rule_results\":[" : ",");
+  out->append(json);
+  return true;
+}
+
+bool FormattedResultsToJsonConverter::ConvertStreamingEnd(
+    const pagespeed::FormattedResults& results, std::string* out) {
+  if (!results.IsInitialized()) {
+    LOG(ERROR) << "FormattedResults instance not fully initialized.";
+    return false;
+  }
+  if (results.rule_results_size() > 0) {
+    out->append("]");
+  }
+  if (results.has_score()) {
+    base::FundamentalValue score_value(results.score());
+    std::string json;
+    base::JSONWriter::Write(&score_value, &json);
+    out->append(",\"score\":");
+    out->append(json);
+  }
+  out->append("}");
+  return true;
+}
+
 Value* FormattedResultsToJsonConverter::ConvertFormattedResults(
     const pagespeed::FormattedResults& results) {
   if (!results.IsInitialized()) {
@@ -44,6 +44,22 @@ class FormattedResultsToJsonConverter {
   static bool Convert(const pagespeed::FormattedResults& results,
                       std::string* out);
 
+  // Helpers that generate the same JSON as Convert incrementally, so
+  // the results of each rule can be written out as soon as they are
+  // formatted. Call ConvertStreamingBegin with the locale of the
+  // results, then ConvertStreamingRuleResults with each rule's results
+  // in order, then ConvertStreamingEnd with the finalized results. The
+  // concatenation of their outputs is identical to the output of
+  // Convert. Each returns false on failure.
+  static bool ConvertStreamingBegin(const std::string& locale,
+                                    std::string* out);
+  static bool ConvertStreamingRuleResults(
+      const pagespeed::FormattedRuleResults& rule_results,
+      bool is_first_rule,
+      std::string* out);
+  static bool ConvertStreamingEnd(const pagespeed::FormattedResults& results,
+                                  std::string* out);
+
   // Converts the various protocol buffers in a FormattedResults
   // structure into a base::Value* object, whsich can be converted to
   // JSON with a JSONWriter. Ownership of the returned base::Value* is
@@ -466,6 +466,60 @@ TEST(FormattedResultsToJsonConverterTest, ConvertFormattedResults) {
   ASSERT_EQ(NULL, value.get());
 }
 
+// Generate the JSON for the given results with the streaming helpers.
+std::string ConvertStreaming(const FormattedResults& results) {
+  std::string json;
+  EXPECT_TRUE(FormattedResultsToJsonConverter::ConvertStreamingBegin(
+      results.locale(), &json));
+  for (int i = 0; i < results.rule_results_size(); ++i) {
+    EXPECT_TRUE(FormattedResultsToJsonConverter::ConvertStreamingRuleResults(
+        results.rule_results(i), i == 0, &json));
+  }
+  EXPECT_TRUE(FormattedResultsToJsonConverter::ConvertStreamingEnd(
+      results, &json));
+  return json;
+}
+
+TEST(FormattedResultsToJsonConverterTest, Streaming) {
+  FormattedResults results;
+  results.set_locale("te\"st");
+
+  std::string expected;
+  ASSERT_TRUE(FormattedResultsToJsonConverter::Convert(results, &expected));
+  ASSERT_EQ(expected, ConvertStreaming(results));
+
+  results.set_score(42);
+  expected.clear();
+  ASSERT_TRUE(FormattedResultsToJsonConverter::Convert(results, &expected));
+  ASSERT_EQ(expected, ConvertStreaming(results));
+
+  for (int i = 0; i < 2; ++i) {
+    FormattedRuleResults* rule_results = results.add_rule_results();
+    rule_results->set_rule_name("RuleName");
+    rule_results->set_localized_rule_name("LocalizedRuleName");
+    rule_results->set_rule_impact(i);
+    rule_results->add_url_blocks()->mutable_header()->set_format("Header");
+    expected.clear();
+    ASSERT_TRUE(FormattedResultsToJsonConverter::Convert(results, &expected));
+    ASSERT_EQ(expected, ConvertStreaming(results));
+  }
+
+  results.clear_score();
+  expected.clear();
+  ASSERT_TRUE(FormattedResultsToJsonConverter::Convert(results, &expected));
+  ASSERT_EQ(expected, ConvertStreaming(results));
+}
+
+TEST(FormattedResultsToJsonConverterTest, StreamingNotInitialized) {
+  FormattedRuleResults rule_results;
+  std::string json;
+  ASSERT_FALSE(FormattedResultsToJsonConverter::ConvertStreamingRuleResults(
+      rule_results, true, &json));
+  FormattedResults results;
+  ASSERT_FALSE(FormattedResultsToJsonConverter::ConvertStreamingEnd(
+      results, &json));
+}
+
 TEST(FormattedResultsToJsonConverterTest, InvalidUtf8) {
   // The bytes 0xc2 and 0xc3 indicate the start of a 2-character UTF8
   // character. However, when the following character is ' ' (0x20),
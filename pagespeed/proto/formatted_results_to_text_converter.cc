@@ -43,13 +43,17 @@ bool FormattedResultsToTextConverter::ConvertFormattedResults(
     }
   }
 
+  ConvertScore(results, out);
+  return true;
+}
+
+void FormattedResultsToTextConverter::ConvertScore(
+    const FormattedResults& results, std::string* out) {
   if (results.has_score()) {
     out->append("**[");
     out->append(pagespeed::string_util::IntToString(results.score()));
     out->append("/100]**\n");
   }
-
-  return true;
 }
 
 bool FormattedResultsToTextConverter::ConvertFormattedRuleResults(
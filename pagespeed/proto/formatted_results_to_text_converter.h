@@ -55,6 +55,12 @@ class FormattedResultsToTextConverter {
       const pagespeed::FormattedUrlResult& url_result, std::string* out);
   static void ConvertFormatString(
       const pagespeed::FormatString& format_string, std::string* out);
+  // Converts the overall score of the results, if any. This is the last
+  // part of the output of ConvertFormattedResults, so it can be used to
+  // complete output generated one ConvertFormattedRuleResults at a
+  // time.
+  static void ConvertScore(const pagespeed::FormattedResults& results,
+                           std::string* out);
 
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(FormattedResultsToTextConverter);
@@ -77,7 +77,8 @@ void PopulateProtoResource(const Resource& input, ProtoResource* output) {
   output->set_request_body(input.GetRequestBody());
   output->set_response_protocol(input.GetResponseProtocolString());
   output->set_response_status_code(input.GetResponseStatusCode());
-  output->set_response_body(input.GetResponseBody());
+  const base::StringPiece response_body = input.GetResponseBodyPiece();
+  output->set_response_body(response_body.data(), response_body.size());
 
   const Resource::HeaderMap& request_headers = *input.GetRequestHeaders();
   for (Resource::HeaderMap::const_iterator iter = request_headers.begin(),
@@ -85,8 +86,8 @@ void PopulateProtoResource(const Resource& input, ProtoResource* output) {
        iter != end;
        ++iter) {
     ProtoResource::Header* header = output->add_request_headers();
-    header->set_key(iter->first);
-    header->set_value(iter->second);
+    header->set_key(iter->name());
+    header->set_value(iter->value());
   }
 
   const Resource::HeaderMap& response_headers = *input.GetResponseHeaders();
@@ -95,8 +96,8 @@ void PopulateProtoResource(const Resource& input, ProtoResource* output) {
        iter != end;
        ++iter) {
     ProtoResource::Header* header = output->add_response_headers();
-    header->set_key(iter->first);
-    header->set_value(iter->second);
+    header->set_key(iter->name());
+    header->set_value(iter->value());
   }
 }
 
@@ -164,7 +164,7 @@ bool AvoidCharsetInMetaTag::AppendResults(const RuleInput& rule_input,
     const Resource& resource = input.GetResource(idx);
     const ResourceType resource_type = resource.GetResourceType();
     const std::string& content_type =
-        resource.GetResponseHeader("Content-Type");
+        resource.GetResponseHeader(HEADER_CONTENT_TYPE);
 
     if (resource_type != HTML) {
       const bool might_be_html = resource_type == OTHER && content_type.empty();
@@ -187,7 +187,7 @@ bool AvoidCharsetInMetaTag::AppendResults(const RuleInput& rule_input,
     std::string meta_charset_content;
     int meta_charset_begin_line_number;
     if (!HasMetaCharsetTag(resource.GetRequestUrl(),
-                           resource.GetResponseBody(),
+                           resource.GetResponseBodyPiece(),
                            &meta_charset_content,
                            &meta_charset_begin_line_number)) {
       continue;
@@ -253,7 +253,7 @@ void AvoidCharsetInMetaTag::FormatResults(const ResultVector& results,
 /* static */
 bool AvoidCharsetInMetaTag::HasMetaCharsetTag(
     const std::string& url,
-    const std::string& html_body,
+    const base::StringPiece& html_body,
     std::string* out_meta_charset_content,
     int* out_meta_charset_begin_line_number) {
   net_instaweb::GoogleMessageHandler message_handler;
@@ -263,7 +263,7 @@ bool AvoidCharsetInMetaTag::HasMetaCharsetTag(
   html_parse.AddFilter(&filter);
 
   html_parse.StartParse(url.c_str());
-  html_parse.ParseText(html_body.c_str(), html_body.size());
+  html_parse.ParseText(html_body.data(), html_body.size());
   html_parse.FinishParse();
 
   *out_meta_charset_begin_line_number = filter.meta_charset_begin_line_number();
@@ -17,6 +17,7 @@
 
 #include <string>
 #include "base/basictypes.h"
+#include "base/string_piece.h"
 #include "pagespeed/core/rule.h"
 
 namespace pagespeed {
@@ -42,7 +43,7 @@ class AvoidCharsetInMetaTag : public Rule {
   // Exposed only for testing.
   static bool HasMetaCharsetTag(
       const std::string& url,
-      const std::string& html_body,
+      const base::StringPiece& html_body,
       std::string* out_meta_charset_content,
       int* out_meta_charset_begin_line_number);
 
@@ -240,6 +240,11 @@ void AvoidExcessSerialization::FormatResults(const ResultVector& results,
   }
 }
 
+void AvoidExcessSerialization::AppendTimelineRecordTypes(
+    std::vector<InstrumentationData::RecordType>* out) const {
+  out->push_back(InstrumentationData::RESOURCE_SEND_REQUEST);
+}
+
 bool AvoidExcessSerialization::IsExperimental() const {
   // TODO(michschn): Before graduating from experimental:
   // 1. write unit tests!
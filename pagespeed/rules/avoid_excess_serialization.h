@@ -15,6 +15,8 @@
 #ifndef PAGESPEED_RULES_AVOID_EXCESS_SERIALIZATION_H_
 #define PAGESPEED_RULES_AVOID_EXCESS_SERIALIZATION_H_
 
+#include <vector>
+
 #include "base/basictypes.h"
 #include "pagespeed/core/rule.h"
 
@@ -37,6 +39,8 @@ class AvoidExcessSerialization : public Rule {
   virtual bool AppendResults(const RuleInput& input, ResultProvider* provider);
   virtual void FormatResults(const ResultVector& results,
                              RuleFormatter* formatter);
+  virtual void AppendTimelineRecordTypes(
+      std::vector<InstrumentationData::RecordType>* out) const;
   virtual bool IsExperimental() const;
 
  private:
@@ -198,6 +198,12 @@ void AvoidLongRunningScripts::FormatResults(const ResultVector& results,
   }
 }
 
+void AvoidLongRunningScripts::AppendTimelineRecordTypes(
+    std::vector<InstrumentationData::RecordType>* out) const {
+  out->push_back(InstrumentationData::EVALUATE_SCRIPT);
+  out->push_back(InstrumentationData::FUNCTION_CALL);
+}
+
 bool AvoidLongRunningScripts::IsExperimental() const {
   // TODO(mdsteele): Before graduating from experimental:
   // * implement ComputeResultImpact
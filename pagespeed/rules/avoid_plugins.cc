@@ -248,18 +248,31 @@ bool DetermineAllowedFromExtension(const std::string& url) {
   return false;
 }
 
-class PluginElementVisitor : public pagespeed::DomElementVisitor {
+class PluginElementVisitor : public pagespeed::DomTraversalVisitor {
  public:
   PluginElementVisitor(const pagespeed::RuleInput* rule_input,
-               const pagespeed::DomDocument* document,
-               pagespeed::ResultProvider* provider);
-
-  void SetFrameVisible(bool visible);
-  void SetFrameBounds(int x1, int y1, int x2, int y2);
+                       pagespeed::ResultProvider* provider);
 
+  virtual bool EnterDocument(const pagespeed::DomDocument& document,
+                             const pagespeed::DomElement* frame);
+  virtual void LeaveDocument(const pagespeed::DomDocument& document);
   virtual void Visit(const pagespeed::DomElement& node);
 
  private:
+  // The state of the frame being visited, saved while visiting the
+  // frames nested within it.
+  struct FrameState {
+    const pagespeed::DomDocument* document;
+    bool visible;
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+  };
+
+  void SetFrameVisible(bool visible);
+  void SetFrameBounds(int x1, int y1, int x2, int y2);
+
   void AddResult(const pagespeed::DomElement& node,
                  AvoidPluginsDetails_PluginType type,
                  const std::string& mime,
@@ -302,6 +315,7 @@ class PluginElementVisitor : public pagespeed::DomElementVisitor {
   int frame_y1_;
   int frame_x2_;
   int frame_y2_;
+  std::vector<FrameState> parent_frames_;
   pagespeed::ResultProvider* provider_;
 
   DISALLOW_COPY_AND_ASSIGN(PluginElementVisitor);
@@ -309,10 +323,9 @@ class PluginElementVisitor : public pagespeed::DomElementVisitor {
 
 PluginElementVisitor::PluginElementVisitor(
     const pagespeed::RuleInput* rule_input,
-    const pagespeed::DomDocument* document,
     pagespeed::ResultProvider* provider) :
         rule_input_(rule_input),
-        document_(document),
+        document_(NULL),
         frame_visible_(true),
         frame_x1_(0),
         frame_y1_(0),
@@ -341,38 +354,60 @@ void PluginElementVisitor::SetFrameVisible(bool visible) {
   frame_visible_ = visible;
 }
 
-void PluginElementVisitor::Visit(const pagespeed::DomElement& node) {
-  std::string tag_name = node.GetTagName();
+bool PluginElementVisitor::EnterDocument(
+    const pagespeed::DomDocument& document,
+    const pagespeed::DomElement* frame) {
+  if (frame == NULL) {
+    // The root document fills the window.
+    document_ = &document;
+    return true;
+  }
 
-  // Do a recursive document traversal for iframes.
-  if (tag_name == "IFRAME") {
-    scoped_ptr<pagespeed::DomDocument> child_doc(node.GetContentDocument());
-    if (child_doc.get()) {
-      PluginElementVisitor checker(rule_input_, child_doc.get(), provider_);
-      int x, y, width, height;
-      if (frame_visible_ &&
-          node.GetX(&x) == pagespeed::DomElement::SUCCESS &&
-          node.GetY(&y) == pagespeed::DomElement::SUCCESS &&
-          node.GetActualWidth(&width) == pagespeed::DomElement::SUCCESS &&
-          node.GetActualHeight(&height) == pagespeed::DomElement::SUCCESS) {
-        const int x1 = frame_x1_ + x;
-        const int y1 = frame_y1_ + y;
-        int x2 = x1 + width;
-        int y2 = y1 + height;
-        // If the x2 and y2 coordinates of the frame containing this iframe are
-        // bounded, clip the iframe's x2 and y2 coordinates to match.
-        if (frame_x2_ >= 0 && frame_y2_ >= 0) {
-          x2 = std::min(x2, frame_x2_);
-          y2 = std::min(y2, frame_y2_);
-        }
-        checker.SetFrameBounds(x1, y1, x2, y2);
-      } else {
-        checker.SetFrameVisible(false);
-      }
-      child_doc->Traverse(&checker);
+  const FrameState parent_frame = {
+    document_, frame_visible_, frame_x1_, frame_y1_, frame_x2_, frame_y2_
+  };
+  parent_frames_.push_back(parent_frame);
+  document_ = &document;
+
+  int x, y, width, height;
+  if (frame_visible_ &&
+      frame->GetX(&x) == pagespeed::DomElement::SUCCESS &&
+      frame->GetY(&y) == pagespeed::DomElement::SUCCESS &&
+      frame->GetActualWidth(&width) == pagespeed::DomElement::SUCCESS &&
+      frame->GetActualHeight(&height) == pagespeed::DomElement::SUCCESS) {
+    const int x1 = frame_x1_ + x;
+    const int y1 = frame_y1_ + y;
+    int x2 = x1 + width;
+    int y2 = y1 + height;
+    // If the x2 and y2 coordinates of the frame containing this iframe are
+    // bounded, clip the iframe's x2 and y2 coordinates to match.
+    if (frame_x2_ >= 0 && frame_y2_ >= 0) {
+      x2 = std::min(x2, frame_x2_);
+      y2 = std::min(y2, frame_y2_);
     }
+    SetFrameBounds(x1, y1, x2, y2);
+  } else {
+    SetFrameVisible(false);
+  }
+  return true;
+}
+
+void PluginElementVisitor::LeaveDocument(
+    const pagespeed::DomDocument& document) {
+  if (parent_frames_.empty()) {
+    return;
   }
+  const FrameState& parent_frame = parent_frames_.back();
+  document_ = parent_frame.document;
+  frame_visible_ = parent_frame.visible;
+  frame_x1_ = parent_frame.x1;
+  frame_y1_ = parent_frame.y1;
+  frame_x2_ = parent_frame.x2;
+  frame_y2_ = parent_frame.y2;
+  parent_frames_.pop_back();
+}
 
+void PluginElementVisitor::Visit(const pagespeed::DomElement& node) {
   // Check if this node contains a plugin, and record it if it does.
   AvoidPluginsDetails_PluginType type = AvoidPluginsDetails_PluginType_UNKNOWN;
   std::string mime;
@@ -715,7 +750,8 @@ void PluginElementVisitor::DetermineTypeFromUrl(
   }
 
   if (resource != NULL) {
-    std::string content_type = resource->GetResponseHeader("Content-Type");
+    std::string content_type =
+        resource->GetResponseHeader(pagespeed::HEADER_CONTENT_TYPE);
     if (!content_type.empty()) {
       *out_mime = content_type;
       *out_type = DetermineTypeFromMime(content_type);
@@ -832,13 +868,14 @@ UserFacingString AvoidPlugins::header() const {
   return _("Avoid plugins");
 }
 
+DomTraversalVisitor* AvoidPlugins::NewDomVisitor(
+    const RuleInput& rule_input, ResultProvider* provider) const {
+  return new PluginElementVisitor(&rule_input, provider);
+}
+
 bool AvoidPlugins::AppendResults(const RuleInput& rule_input,
                                        ResultProvider* provider) {
-  const DomDocument* document = rule_input.pagespeed_input().dom_document();
-  if (document) {
-    PluginElementVisitor visitor(&rule_input, document, provider);
-    document->Traverse(&visitor);
-  }
+  AppendDomVisitorResults(rule_input, provider);
   return true;
 }
 
@@ -69,9 +69,10 @@ class JavaScriptFilter : public net_instaweb::EmptyHtmlFilter {
   typedef std::map<std::string, JavaScriptBlock> UrlToJavaScriptBlockMap;
 
   JavaScriptFilter(net_instaweb::HtmlParse* html_parse,
-                   const pagespeed::PagespeedInput* input)
+                   const pagespeed::RuleInput* rule_input)
     : html_parse_(html_parse),
-      pagespeed_input_(input),
+      rule_input_(rule_input),
+      pagespeed_input_(&rule_input->pagespeed_input()),
       total_size_(0) {}
   virtual ~JavaScriptFilter() {}
 
@@ -95,10 +96,11 @@ class JavaScriptFilter : public net_instaweb::EmptyHtmlFilter {
 
  private:
   void AddJavascriptBlock(
-      const std::string& url, const std::string& content, bool is_inline);
+      const std::string& url, int size, bool is_inline);
   JavaScriptBlock* FindExistingBlockForUrl(const std::string& url);
   void FlushPendingJavascriptBlocks();
   net_instaweb::HtmlParse* html_parse_;
+  const pagespeed::RuleInput* rule_input_;
   UrlToJavaScriptBlockMap pending_javascript_blocks_;
   UrlToJavaScriptBlockMap problem_javascript_blocks_;
   const pagespeed::PagespeedInput* pagespeed_input_;
@@ -108,15 +110,7 @@ class JavaScriptFilter : public net_instaweb::EmptyHtmlFilter {
 };
 
 void JavaScriptFilter::AddJavascriptBlock(
-    const std::string& url, const std::string& content, bool is_inline) {
-  std::string minified;
-  int size = 0;
-  bool did_minify = js::GetMinifiedStringCollapsedJsSize(content,
-                                                         &size);
-  if (!did_minify) {
-    LOG(INFO) << "Minify JS failed. Original size is used.";
-    size = content.size();
-  }
+    const std::string& url, int size, bool is_inline) {
   if (size == 0) {
     return;
   }
@@ -204,7 +198,15 @@ void JavaScriptFilter::StartElement(net_instaweb::HtmlElement* element) {
       if (async == NULL && defer == NULL) {
         // Note that this leaves the block pending. The rule may still be OK if
         // this script tag occured at the bottom of the body.
-        AddJavascriptBlock(resolved_src, resource->GetResponseBody(), false);
+        // External scripts may be referenced from several documents,
+        // so use the RuleInput's cached minified size.
+        int size = 0;
+        if (!rule_input_->GetStringCollapsedMinifiedJavaScriptSize(*resource,
+                                                                   &size)) {
+          LOG(INFO) << "Minify JS failed. Original size is used.";
+          size = resource->GetResponseBodyPiece().size();
+        }
+        AddJavascriptBlock(resolved_src, size, false);
       }
     }
   } else {
@@ -221,14 +223,19 @@ void JavaScriptFilter::Characters(
     keyword = parent->keyword();
   }
 
+  const std::string& contents = characters->contents();
   // inline script
   if (keyword == net_instaweb::HtmlName::kScript) {
-    AddJavascriptBlock(html_parse_->url(), characters->contents(), true);
+    int size = 0;
+    if (!js::GetMinifiedStringCollapsedJsSize(contents, &size)) {
+      LOG(INFO) << "Minify JS failed. Original size is used.";
+      size = contents.size();
+    }
+    AddJavascriptBlock(html_parse_->url(), size, true);
   } else {
     // Whitespace at the end of a body does not cause flushing. Other characters
     // should, however. Note that comments are fed through a different callback
     // which is not overriden, thus they also do not cause flushing.
-    const std::string& contents = characters->contents();
     if (!string_util::ContainsOnlyWhitespaceASCII(contents)) {
       FlushPendingJavascriptBlocks();
     }
@@ -320,7 +327,7 @@ bool DeferParsingJavaScript::AppendResults(const RuleInput& rule_input,
   net_instaweb::GoogleMessageHandler message_handler;
   message_handler.set_min_message_type(net_instaweb::kError);
   net_instaweb::HtmlParse html_parse(&message_handler);
-  JavaScriptFilter filter(&html_parse, &input);
+  JavaScriptFilter filter(&html_parse, &rule_input);
   html_parse.AddFilter(&filter);
 
   for (int i = 0, num = input.num_resources(); i < num; ++i) {
@@ -334,8 +341,8 @@ bool DeferParsingJavaScript::AppendResults(const RuleInput& rule_input,
     }
 
     html_parse.StartParse(resource.GetRequestUrl().c_str());
-    html_parse.ParseText(
-        resource.GetResponseBody().data(), resource.GetResponseBody().length());
+    const base::StringPiece body = resource.GetResponseBodyPiece();
+    html_parse.ParseText(body.data(), body.length());
     html_parse.FinishParse();
 
     const JavaScriptFilter::UrlToJavaScriptBlockMap& problem_javascript_blocks =
@@ -22,6 +22,7 @@
 #include "pagespeed/core/string_util.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
 #include "pagespeed/rules/defer_parsing_javascript.h"
+#include "pagespeed/rules/minifier_artifact_computer.h"
 #include "pagespeed/testing/pagespeed_test.h"
 
 using pagespeed::PagespeedInput;
@@ -32,6 +33,7 @@ using pagespeed::ResultProvider;
 using pagespeed::ResultVector;
 using pagespeed::RuleResults;
 using pagespeed::rules::DeferParsingJavaScript;
+using pagespeed::rules::MinifierArtifactComputer;
 using pagespeed_testing::FakeDomElement;
 
 namespace {
@@ -49,6 +51,7 @@ class DeferParsingJavaScriptTest : public
     ::pagespeed_testing::PagespeedRuleTest<DeferParsingJavaScript> {
  protected:
   virtual void DoSetUp() {
+    set_artifact_computer(&artifact_computer_);
     NewPrimaryResource(kRootUrl);
     CreateHtmlHeadBodyElements();
   }
@@ -108,6 +111,9 @@ class DeferParsingJavaScriptTest : public
     }
     p_resource->SetResponseBody(primary_body);
   }
+
+ private:
+  MinifierArtifactComputer artifact_computer_;
 };
 
 TEST_F(DeferParsingJavaScriptTest, Basic) {
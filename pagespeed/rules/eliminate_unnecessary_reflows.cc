@@ -433,6 +433,11 @@ void EliminateUnnecessaryReflows::SortResultsInPresentationOrder(
                    SortRuleResultsByDuration);
 }
 
+void EliminateUnnecessaryReflows::AppendTimelineRecordTypes(
+    std::vector<InstrumentationData::RecordType>* out) const {
+  out->push_back(InstrumentationData::LAYOUT);
+}
+
 bool EliminateUnnecessaryReflows::IsExperimental() const {
   // TODO(bmcquade): Before graduating from experimental:
   // * implement ComputeResultImpact
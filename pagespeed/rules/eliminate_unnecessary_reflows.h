@@ -15,6 +15,8 @@
 #ifndef PAGESPEED_RULES_ELIMINATE_UNNECESSARY_REFLOWS_H_
 #define PAGESPEED_RULES_ELIMINATE_UNNECESSARY_REFLOWS_H_
 
+#include <vector>
+
 #include "base/basictypes.h"
 #include "pagespeed/core/rule.h"
 
@@ -33,6 +35,8 @@ class EliminateUnnecessaryReflows : public Rule {
   virtual void FormatResults(const ResultVector& results,
                              RuleFormatter* formatter);
   virtual void SortResultsInPresentationOrder(ResultVector* rule_results) const;
+  virtual void AppendTimelineRecordTypes(
+      std::vector<InstrumentationData::RecordType>* out) const;
   virtual bool IsExperimental() const;
 
  private:
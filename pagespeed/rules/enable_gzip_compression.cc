@@ -150,7 +150,7 @@ const MinifierOutput* GzipMinifier::Minify(const Resource& resource,
 bool GzipMinifier::IsViolation(const Resource& resource) const {
   return (!resource_util::IsCompressedResource(resource) &&
           resource_util::IsCompressibleResource(resource) &&
-          resource.GetResponseBody().size() >= kMinGzipSize);
+          resource.GetResponseBodyPiece().size() >= kMinGzipSize);
 }
 
 }  // namespace
@@ -63,7 +63,8 @@ bool EnableKeepAlive::AppendResults(const RuleInput& rule_input,
   for (int idx = 0, num = input.num_resources(); idx < num; ++idx) {
     const Resource& resource = input.GetResource(idx);
 
-    const std::string& connection = resource.GetResponseHeader("Connection");
+    const std::string& connection =
+        resource.GetResponseHeader(HEADER_CONNECTION);
     pagespeed::resource_util::DirectiveMap directives;
     if (!pagespeed::resource_util::GetHeaderDirectives(connection,
                                                        &directives)) {
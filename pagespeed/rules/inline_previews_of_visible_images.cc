@@ -73,7 +73,8 @@ bool InlinePreviewsOfVisibleImages::AppendResults(const RuleInput& rule_input,
     // TODO(bmcquade): look at the optimized image size here. If it
     // can be minified to under the threshold we should do that
     // instead.
-    if (candidate.GetResponseBody().size() < kMinimumInlineThresholdBytes) {
+    if (candidate.GetResponseBodyPiece().size() <
+        kMinimumInlineThresholdBytes) {
       continue;
     }
 
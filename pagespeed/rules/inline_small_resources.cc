@@ -25,10 +25,8 @@
 #include "pagespeed/core/result_provider.h"
 #include "pagespeed/core/rule_input.h"
 #include "pagespeed/core/uri_util.h"
-#include "pagespeed/css/cssmin.h"
 #include "pagespeed/html/external_resource_filter.h"
 #include "pagespeed/l10n/l10n.h"
-#include "pagespeed/js/js_minify.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
 
 namespace pagespeed {
@@ -78,8 +76,8 @@ bool InlineSmallResources::AppendResults(const RuleInput& rule_input,
     }
 
     html_parse.StartParse(resource.GetRequestUrl().c_str());
-    html_parse.ParseText(
-        resource.GetResponseBody().data(), resource.GetResponseBody().length());
+    const base::StringPiece body = resource.GetResponseBodyPiece();
+    html_parse.ParseText(body.data(), body.length());
     html_parse.FinishParse();
 
     std::vector<std::string> external_resource_urls;
@@ -102,7 +100,7 @@ bool InlineSmallResources::AppendResults(const RuleInput& rule_input,
          it != end;
          ++it) {
       const Resource* external_resource = input.GetResourceWithUrlOrNull(*it);
-      if (IsInlineCandidate(external_resource, resource_domain)) {
+      if (IsInlineCandidate(rule_input, external_resource, resource_domain)) {
         inline_candidates[resource.GetRequestUrl()].insert(external_resource);
         num_referring_documents[external_resource]++;
       }
@@ -162,7 +160,8 @@ bool InlineSmallResources::AppendResults(const RuleInput& rule_input,
 }
 
 // Is this resource a candidate for inlining into the HTML document?
-bool InlineSmallResources::IsInlineCandidate(const Resource* resource,
+bool InlineSmallResources::IsInlineCandidate(const RuleInput& rule_input,
+                                             const Resource* resource,
                                              const std::string& html_domain) {
   if (resource == NULL) {
     return false;
@@ -198,10 +197,9 @@ bool InlineSmallResources::IsInlineCandidate(const Resource* resource,
   }
 
   // Compute the minified size of the resource.
-  const std::string& body = resource->GetResponseBody();
   int resource_size = 0;
-  if (!ComputeMinifiedSize(body, &resource_size)) {
-    resource_size = body.size();
+  if (!ComputeMinifiedSize(rule_input, *resource, &resource_size)) {
+    resource_size = resource->GetResponseBodyPiece().size();
   }
 
   return (resource_size < kInlineThresholdBytes);
@@ -266,9 +264,15 @@ UserFacingString InlineSmallCss::header() const {
   return _("Inline Small CSS");
 }
 
-bool InlineSmallCss::ComputeMinifiedSize(
-    const std::string& body, int* out_minified_size) const {
-  return css::GetMinifiedCssSize(body, out_minified_size);
+bool InlineSmallCss::ComputeMinifiedSize(const RuleInput& rule_input,
+                                         const Resource& resource,
+                                         int* out_minified_size) const {
+  const std::string* minified_css = rule_input.GetMinifiedCss(resource);
+  if (minified_css == NULL) {
+    return false;
+  }
+  *out_minified_size = minified_css->size();
+  return true;
 }
 
 int InlineSmallCss::GetTotalResourcesOfSameType(
@@ -292,8 +296,15 @@ UserFacingString InlineSmallJavaScript::header() const {
 }
 
 bool InlineSmallJavaScript::ComputeMinifiedSize(
-    const std::string& body, int* out_minified_size) const {
-  return js::GetMinifiedJsSize(body, out_minified_size);
+    const RuleInput& rule_input,
+    const Resource& resource,
+    int* out_minified_size) const {
+  const std::string* minified_js = rule_input.GetMinifiedJavaScript(resource);
+  if (minified_js == NULL) {
+    return false;
+  }
+  *out_minified_size = minified_js->size();
+  return true;
 }
 
 int InlineSmallJavaScript::GetTotalResourcesOfSameType(
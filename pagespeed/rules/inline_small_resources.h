@@ -37,14 +37,16 @@ class InlineSmallResources : public Rule {
                              RuleFormatter* formatter);
 
  protected:
-  virtual bool ComputeMinifiedSize(
-      const std::string& body, int* out_minified_size) const = 0;
+  virtual bool ComputeMinifiedSize(const RuleInput& rule_input,
+                                   const Resource& resource,
+                                   int* out_minified_size) const = 0;
 
   virtual int GetTotalResourcesOfSameType(
       const InputInformation& input_info) const = 0;
 
  private:
-  bool IsInlineCandidate(const Resource* resource,
+  bool IsInlineCandidate(const RuleInput& rule_input,
+                         const Resource* resource,
                          const std::string& html_domain);
 
   const ResourceType resource_type_;
@@ -58,8 +60,9 @@ class InlineSmallJavaScript : public InlineSmallResources {
   virtual UserFacingString header() const;
 
  protected:
-  virtual bool ComputeMinifiedSize(
-      const std::string& body, int* out_minified_size) const;
+  virtual bool ComputeMinifiedSize(const RuleInput& rule_input,
+                                   const Resource& resource,
+                                   int* out_minified_size) const;
 
   virtual int GetTotalResourcesOfSameType(
       const InputInformation& input_info) const;
@@ -75,8 +78,9 @@ class InlineSmallCss : public InlineSmallResources {
   virtual UserFacingString header() const;
 
  protected:
-  virtual bool ComputeMinifiedSize(
-      const std::string& body, int* out_minified_size) const;
+  virtual bool ComputeMinifiedSize(const RuleInput& rule_input,
+                                   const Resource& resource,
+                                   int* out_minified_size) const;
 
   virtual int GetTotalResourcesOfSameType(
       const InputInformation& input_info) const;
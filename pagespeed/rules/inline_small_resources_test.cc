@@ -16,6 +16,7 @@
 #include <vector>
 
 #include "pagespeed/rules/inline_small_resources.h"
+#include "pagespeed/rules/minifier_artifact_computer.h"
 #include "pagespeed/testing/pagespeed_test.h"
 
 using pagespeed::InlineSmallResourcesDetails;
@@ -24,6 +25,7 @@ using pagespeed::Resource;
 using pagespeed::rules::InlineSmallCss;
 using pagespeed::rules::InlineSmallJavaScript;
 using pagespeed::rules::InlineSmallResources;
+using pagespeed::rules::MinifierArtifactComputer;
 
 namespace {
 
@@ -91,6 +93,7 @@ template <class RULE> class InlineSmallResourcesTest :
       public pagespeed_testing::PagespeedRuleTest<RULE> {
  protected:
   virtual void DoSetUp() {
+    this->set_artifact_computer(&artifact_computer_);
     this->NewPrimaryResource(kRootUrl);
   }
 
@@ -135,6 +138,8 @@ template <class RULE> class InlineSmallResourcesTest :
       ASSERT_EQ(expected[idx], isr_details.inline_candidates(idx));
     }
   }
+
+  MinifierArtifactComputer artifact_computer_;
 };
 
 // Since the logic in InlineSmallCss and InlineSmallJavaScript is the
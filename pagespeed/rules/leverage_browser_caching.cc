@@ -20,6 +20,7 @@
 #include "pagespeed/core/formatter.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
+#include "pagespeed/core/resource_cache_computer.h"
 #include "pagespeed/core/resource_util.h"
 #include "pagespeed/core/result_provider.h"
 #include "pagespeed/core/rule_input.h"
@@ -137,8 +138,9 @@ bool LeverageBrowserCaching::AppendResults(const RuleInput& rule_input,
     }
 
     int64 freshness_lifetime_millis = 0;
-    bool has_freshness_lifetime = resource_util::GetFreshnessLifetimeMillis(
-        resource, &freshness_lifetime_millis);
+    ResourceCacheComputer comp(&resource);
+    bool has_freshness_lifetime =
+        comp.GetFreshnessLifetimeMillis(&freshness_lifetime_millis);
 
     if (has_freshness_lifetime) {
       if (freshness_lifetime_millis <= 0) {
@@ -25,6 +25,7 @@
 #include "pagespeed/core/formatter.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
+#include "pagespeed/core/resource_cache_computer.h"
 #include "pagespeed/core/resource_util.h"
 #include "pagespeed/core/result_provider.h"
 #include "pagespeed/core/rule_input.h"
@@ -145,7 +146,7 @@ bool MakeLandingPageRedirectsCacheable::AppendResults(
       continue;
     }
     if (resource->GetResponseStatusCode() != 301 &&
-        !pagespeed::resource_util::HasExplicitFreshnessLifetime(*resource)) {
+        !ResourceCacheComputer(resource).HasExplicitFreshnessLifetime()) {
       // We want to record the redirect and its destination so we can
       // present that information in the UI.
       pagespeed::RedirectRegistry::RedirectChain::const_iterator next = it;
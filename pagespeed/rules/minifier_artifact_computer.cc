@@ -0,0 +1,76 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pagespeed/rules/minifier_artifact_computer.h"
+
+#include "pagespeed/core/resource.h"
+#include "pagespeed/css/cssmin.h"
+#include "pagespeed/html/html_minifier.h"
+#include "pagespeed/js/js_minify.h"
+
+namespace pagespeed {
+
+namespace rules {
+
+MinifierArtifactComputer::MinifierArtifactComputer() {}
+MinifierArtifactComputer::~MinifierArtifactComputer() {}
+
+bool MinifierArtifactComputer::MinifyJavaScript(const Resource& resource,
+                                                const Deadline* deadline,
+                                                std::string* output) const {
+  return js::MinifyJsWithDeadline(resource.GetResponseBodyPiece(), deadline,
+                                  output);
+}
+
+bool MinifierArtifactComputer::GetMinifiedJavaScriptSize(
+    const Resource& resource, const Deadline* deadline, int* output) const {
+  return js::GetMinifiedJsSizeWithDeadline(resource.GetResponseBodyPiece(),
+                                           deadline, output);
+}
+
+bool MinifierArtifactComputer::GetStringCollapsedMinifiedJavaScriptSize(
+    const Resource& resource, const Deadline* deadline, int* output) const {
+  return js::GetMinifiedStringCollapsedJsSizeWithDeadline(
+      resource.GetResponseBodyPiece(), deadline, output);
+}
+
+bool MinifierArtifactComputer::MinifyCss(const Resource& resource,
+                                         const Deadline* deadline,
+                                         std::string* output) const {
+  return css::MinifyCssWithDeadline(resource.GetResponseBodyPiece(), deadline,
+                                    output);
+}
+
+bool MinifierArtifactComputer::GetMinifiedCssSize(const Resource& resource,
+                                                  const Deadline* deadline,
+                                                  int* output) const {
+  return css::GetMinifiedCssSizeWithDeadline(resource.GetResponseBodyPiece(),
+                                             deadline, output);
+}
+
+bool MinifierArtifactComputer::MinifyHtml(const Resource& resource,
+                                          const Deadline* deadline,
+                                          std::string* output) const {
+  html::HtmlMinifier html_minifier;
+  html_minifier.set_deadline(deadline);
+  return html_minifier.MinifyHtmlWithType(
+      resource.GetRequestUrl(),
+      resource.GetResponseHeader(HEADER_CONTENT_TYPE),
+      resource.GetResponseBodyPiece(),
+      output);
+}
+
+}  // namespace rules
+
+}  // namespace pagespeed
@@ -0,0 +1,64 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PAGESPEED_RULES_MINIFIER_ARTIFACT_COMPUTER_H_
+#define PAGESPEED_RULES_MINIFIER_ARTIFACT_COMPUTER_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "pagespeed/core/artifact_computer.h"
+
+namespace pagespeed {
+
+namespace rules {
+
+// ArtifactComputer that minifies with the JavaScript, CSS and HTML
+// minifiers. Engines that run rules which ask RuleInput for minified
+// content must be given one (see Engine::set_artifact_computer).
+class MinifierArtifactComputer : public ArtifactComputer {
+ public:
+  MinifierArtifactComputer();
+  virtual ~MinifierArtifactComputer();
+
+  // ArtifactComputer interface.
+  virtual bool MinifyJavaScript(const Resource& resource,
+                                const Deadline* deadline,
+                                std::string* output) const;
+  virtual bool GetMinifiedJavaScriptSize(const Resource& resource,
+                                         const Deadline* deadline,
+                                         int* output) const;
+  virtual bool GetStringCollapsedMinifiedJavaScriptSize(
+      const Resource& resource,
+      const Deadline* deadline,
+      int* output) const;
+  virtual bool MinifyCss(const Resource& resource,
+                         const Deadline* deadline,
+                         std::string* output) const;
+  virtual bool GetMinifiedCssSize(const Resource& resource,
+                                  const Deadline* deadline,
+                                  int* output) const;
+  virtual bool MinifyHtml(const Resource& resource,
+                          const Deadline* deadline,
+                          std::string* output) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MinifierArtifactComputer);
+};
+
+}  // namespace rules
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_RULES_MINIFIER_ARTIFACT_COMPUTER_H_
@@ -0,0 +1,85 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "pagespeed/core/resource.h"
+#include "pagespeed/core/rule_input.h"
+#include "pagespeed/rules/minifier_artifact_computer.h"
+#include "pagespeed/testing/pagespeed_test.h"
+#include "pagespeed/util/deadline.h"
+
+using pagespeed::Deadline;
+using pagespeed::Resource;
+using pagespeed::RuleInput;
+using pagespeed::rules::MinifierArtifactComputer;
+
+namespace {
+
+class MinifierArtifactComputerTest
+    : public ::pagespeed_testing::PagespeedTest {
+ protected:
+  MinifierArtifactComputer computer_;
+};
+
+TEST_F(MinifierArtifactComputerTest, JavaScript) {
+  Resource* resource = NewScriptResource(kUrl1, NULL, NULL);
+  resource->SetResponseBody("var a = 1;  // comment\n");
+
+  std::string minified;
+  ASSERT_TRUE(computer_.MinifyJavaScript(*resource, NULL, &minified));
+  ASSERT_EQ("var a=1;", minified);
+
+  int size = 0;
+  ASSERT_TRUE(computer_.GetMinifiedJavaScriptSize(*resource, NULL, &size));
+  ASSERT_EQ(8, size);
+
+  Deadline deadline;
+  deadline.Cancel();
+  ASSERT_FALSE(computer_.GetMinifiedJavaScriptSize(*resource, &deadline,
+                                                   &size));
+}
+
+TEST_F(MinifierArtifactComputerTest, Css) {
+  Resource* resource = NewCssResource(kUrl1, NULL, NULL);
+  resource->SetResponseBody("body {  color: red;  }\n");
+
+  std::string minified;
+  ASSERT_TRUE(computer_.MinifyCss(*resource, NULL, &minified));
+  ASSERT_EQ("body{color:red;}", minified);
+
+  int size = 0;
+  ASSERT_TRUE(computer_.GetMinifiedCssSize(*resource, NULL, &size));
+  ASSERT_EQ(16, size);
+
+  Deadline deadline;
+  deadline.Cancel();
+  ASSERT_FALSE(computer_.MinifyCss(*resource, &deadline, &minified));
+  ASSERT_FALSE(computer_.GetMinifiedCssSize(*resource, &deadline, &size));
+}
+
+TEST_F(MinifierArtifactComputerTest, RuleInput) {
+  Resource* resource = NewScriptResource(kUrl1, NULL, NULL);
+  resource->SetResponseBody("var a = 1;  // comment\n");
+  Freeze();
+
+  RuleInput rule_input(*pagespeed_input());
+  rule_input.set_artifact_computer(&computer_);
+  rule_input.Init();
+  const std::string* minified = rule_input.GetMinifiedJavaScript(*resource);
+  ASSERT_TRUE(minified != NULL);
+  ASSERT_EQ("var a=1;", *minified);
+}
+
+}  // namespace
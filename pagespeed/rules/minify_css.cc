@@ -20,7 +20,6 @@
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/resource_util.h"
 #include "pagespeed/core/rule_input.h"
-#include "pagespeed/css/cssmin.h"
 #include "pagespeed/l10n/l10n.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
 
@@ -46,6 +45,7 @@ class CssMinifier : public Minifier {
   virtual const char* additional_info_url() const;
   virtual const MinifierOutput* Minify(const Resource& resource,
                                        const RuleInput& input) const;
+  virtual std::string GetConfigurationFingerprint() const;
 
  private:
   bool save_optimized_content_;
@@ -116,29 +116,32 @@ UserFacingString CssMinifier::child_format_post_gzip() const {
            "reduction) after compression.");
 }
 
+std::string CssMinifier::GetConfigurationFingerprint() const {
+  return save_optimized_content_ ? "save_optimized_content" : "";
+}
+
 const MinifierOutput* CssMinifier::Minify(const Resource& resource,
                                           const RuleInput& rule_input) const {
   if (resource.GetResourceType() != CSS) {
     return MinifierOutput::CannotBeMinified();
   }
 
-  const std::string& input = resource.GetResponseBody();
   if (save_optimized_content_ ||
       resource_util::IsCompressedResource(resource)) {
-    std::string minified_css;
-    if (!css::MinifyCss(input, &minified_css)) {
+    const std::string* minified_css = rule_input.GetMinifiedCss(resource);
+    if (minified_css == NULL) {
       LOG(ERROR) << "MinifyCss failed for resource: "
                  << resource.GetRequestUrl();
       return MinifierOutput::Error();
     }
     if (save_optimized_content_) {
-      return MinifierOutput::SaveMinifiedContent(minified_css, "text/css");
+      return MinifierOutput::SaveMinifiedContent(*minified_css, "text/css");
     } else {
-      return MinifierOutput::DoNotSaveMinifiedContent(minified_css);
+      return MinifierOutput::DoNotSaveMinifiedContent(*minified_css);
     }
   } else {
     int minified_css_size = 0;
-    if (!css::GetMinifiedCssSize(input, &minified_css_size)) {
+    if (!rule_input.GetMinifiedCssSize(resource, &minified_css_size)) {
       LOG(ERROR) << "GetMinifiedCssSize failed for resource: "
                  << resource.GetRequestUrl();
       return MinifierOutput::Error();
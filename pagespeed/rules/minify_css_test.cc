@@ -19,9 +19,11 @@
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/result_provider.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
+#include "pagespeed/rules/minifier_artifact_computer.h"
 #include "pagespeed/rules/minify_css.h"
 #include "pagespeed/testing/pagespeed_test.h"
 
+using pagespeed::rules::MinifierArtifactComputer;
 using pagespeed::rules::MinifyCss;
 using pagespeed::PagespeedInput;
 using pagespeed::Resource;
@@ -42,6 +44,10 @@ const char* kMinified = "body{color:red;}";
 
 class MinifyCssTest : public PagespeedRuleTest<MinifyCss> {
  protected:
+  virtual void DoSetUp() {
+    set_artifact_computer(&artifact_computer_);
+  }
+
   void AddTestResource(const char* url,
                        const char* content_type,
                        const char* body) {
@@ -54,6 +60,9 @@ class MinifyCssTest : public PagespeedRuleTest<MinifyCss> {
       resource->SetResponseBody(body);
     }
   }
+
+ private:
+  MinifierArtifactComputer artifact_computer_;
 };
 
 TEST_F(MinifyCssTest, Basic) {
@@ -103,4 +112,13 @@ TEST_F(MinifyCssTest, FormatNoResults) {
       FormatResults());
 }
 
+TEST(MinifyCssConfigurationTest, FingerprintDependsOnSavedContent) {
+  // Only a rule that saves optimized content stores it in its results,
+  // so the two must never share cached results.
+  MinifyCss rule(false);
+  MinifyCss saving_rule(true);
+  ASSERT_NE(rule.GetConfigurationFingerprint(),
+            saving_rule.GetConfigurationFingerprint());
+}
+
 }  // namespace
@@ -19,7 +19,6 @@
 #include "base/logging.h"
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/rule_input.h"
-#include "pagespeed/html/html_minifier.h"
 #include "pagespeed/l10n/l10n.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
 
@@ -45,6 +44,7 @@ class HtmlMinifier : public Minifier {
   virtual const char* additional_info_url() const;
   virtual const MinifierOutput* Minify(const Resource& resource,
                                        const RuleInput& input) const;
+  virtual std::string GetConfigurationFingerprint() const;
 
  private:
   bool save_optimized_content_;
@@ -116,27 +116,29 @@ UserFacingString HtmlMinifier::child_format_post_gzip() const {
            "reduction) after compression.");
 }
 
+std::string HtmlMinifier::GetConfigurationFingerprint() const {
+  return save_optimized_content_ ? "save_optimized_content" : "";
+}
+
 const MinifierOutput* HtmlMinifier::Minify(const Resource& resource,
                                            const RuleInput& rule_input) const {
   if (resource.GetResourceType() != HTML) {
     return MinifierOutput::CannotBeMinified();
   }
 
-  const std::string& content_type = resource.GetResponseHeader("Content-Type");
-  const std::string& input = resource.GetResponseBody();
-  std::string minified_html;
-  ::pagespeed::html::HtmlMinifier html_minifier;
-  if (!html_minifier.MinifyHtmlWithType(resource.GetRequestUrl(), content_type,
-                                        input, &minified_html)) {
+  const std::string& content_type =
+      resource.GetResponseHeader(HEADER_CONTENT_TYPE);
+  const std::string* minified_html = rule_input.GetMinifiedHtml(resource);
+  if (minified_html == NULL) {
     LOG(ERROR) << "MinifyHtml failed for resource: "
                << resource.GetRequestUrl();
     return MinifierOutput::Error();
   }
 
   if (save_optimized_content_ && !content_type.empty()) {
-    return MinifierOutput::SaveMinifiedContent(minified_html, content_type);
+    return MinifierOutput::SaveMinifiedContent(*minified_html, content_type);
   } else {
-    return MinifierOutput::DoNotSaveMinifiedContent(minified_html);
+    return MinifierOutput::DoNotSaveMinifiedContent(*minified_html);
   }
 };
 
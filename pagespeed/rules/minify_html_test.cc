@@ -19,9 +19,11 @@
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/result_provider.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
+#include "pagespeed/rules/minifier_artifact_computer.h"
 #include "pagespeed/rules/minify_html.h"
 #include "pagespeed/testing/pagespeed_test.h"
 
+using pagespeed::rules::MinifierArtifactComputer;
 using pagespeed::rules::MinifyHTML;
 using pagespeed::PagespeedInput;
 using pagespeed::Resource;
@@ -62,6 +64,10 @@ const char* kMinified =
 
 class MinifyHtmlTest : public PagespeedRuleTest<MinifyHTML> {
  protected:
+  virtual void DoSetUp() {
+    set_artifact_computer(&artifact_computer_);
+  }
+
   void AddTestResource(const char* url,
                        const char* content_type,
                        const char* body) {
@@ -74,6 +80,9 @@ class MinifyHtmlTest : public PagespeedRuleTest<MinifyHTML> {
       resource->SetResponseBody(body);
     }
   }
+
+ private:
+  MinifierArtifactComputer artifact_computer_;
 };
 
 TEST_F(MinifyHtmlTest, Basic) {
@@ -22,7 +22,6 @@
 #include "pagespeed/core/rule_input.h"
 #include "pagespeed/l10n/l10n.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
-#include "pagespeed/js/js_minify.h"
 
 namespace pagespeed {
 
@@ -46,6 +45,7 @@ class JsMinifier : public Minifier {
   virtual const char* additional_info_url() const;
   virtual const MinifierOutput* Minify(const Resource& resource,
                                        const RuleInput& input) const;
+  virtual std::string GetConfigurationFingerprint() const;
 
  private:
   bool save_optimized_content_;
@@ -116,30 +116,34 @@ UserFacingString JsMinifier::child_format_post_gzip() const {
            "reduction) after compression.");
 }
 
+std::string JsMinifier::GetConfigurationFingerprint() const {
+  return save_optimized_content_ ? "save_optimized_content" : "";
+}
+
 const MinifierOutput* JsMinifier::Minify(const Resource& resource,
                                          const RuleInput& rule_input) const {
   if (resource.GetResourceType() != JS) {
     return MinifierOutput::CannotBeMinified();
   }
 
-  const std::string& input = resource.GetResponseBody();
   if (save_optimized_content_ ||
       resource_util::IsCompressedResource(resource)) {
-    std::string minified_js;
-    if (!js::MinifyJs(input, &minified_js)) {
+    const std::string* minified_js =
+        rule_input.GetMinifiedJavaScript(resource);
+    if (minified_js == NULL) {
       LOG(ERROR) << "MinifyJs failed for resource: "
                  << resource.GetRequestUrl();
       return MinifierOutput::Error();
     }
     if (save_optimized_content_) {
-      return MinifierOutput::SaveMinifiedContent(minified_js,
+      return MinifierOutput::SaveMinifiedContent(*minified_js,
                                                  "text/javascript");
     } else {
-      return MinifierOutput::DoNotSaveMinifiedContent(minified_js);
+      return MinifierOutput::DoNotSaveMinifiedContent(*minified_js);
     }
   } else {
     int minified_js_size = 0;
-    if (!js::GetMinifiedJsSize(input, &minified_js_size)) {
+    if (!rule_input.GetMinifiedJavaScriptSize(resource, &minified_js_size)) {
       LOG(ERROR) << "GetMinifiedJsSize failed for resource: "
                  << resource.GetRequestUrl();
       return MinifierOutput::Error();
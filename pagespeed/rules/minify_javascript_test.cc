@@ -19,9 +19,11 @@
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/result_provider.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
+#include "pagespeed/rules/minifier_artifact_computer.h"
 #include "pagespeed/rules/minify_javascript.h"
 #include "pagespeed/testing/pagespeed_test.h"
 
+using pagespeed::rules::MinifierArtifactComputer;
 using pagespeed::rules::MinifyJavaScript;
 using pagespeed::PagespeedInput;
 using pagespeed::Resource;
@@ -44,6 +46,10 @@ const char* kMinified = "function(){foo();}";
 // (since there's a lot of common code).
 class MinifyJavaScriptTest : public PagespeedRuleTest<MinifyJavaScript> {
  protected:
+  virtual void DoSetUp() {
+    set_artifact_computer(&artifact_computer_);
+  }
+
   void AddTestResource(const char* url,
                        const char* content_type,
                        const char* body) {
@@ -56,6 +62,9 @@ class MinifyJavaScriptTest : public PagespeedRuleTest<MinifyJavaScript> {
       resource->SetResponseBody(body);
     }
   }
+
+ private:
+  MinifierArtifactComputer artifact_computer_;
 };
 
 TEST_F(MinifyJavaScriptTest, Basic) {
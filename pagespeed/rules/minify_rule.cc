@@ -28,6 +28,7 @@
 #include "pagespeed/core/rule_input.h"
 #include "pagespeed/l10n/l10n.h"
 #include "pagespeed/proto/pagespeed_output.pb.h"
+#include "pagespeed/util/deadline.h"
 
 namespace pagespeed {
 
@@ -69,17 +70,22 @@ MinifierOutput* MinifierOutput::SaveMinifiedContent(
                             minified_content_mime_type);
 }
 
-bool MinifierOutput::GetCompressedMinifiedSize(int* output) const {
+bool MinifierOutput::GetCompressedMinifiedSize(const RuleInput& rule_input,
+                                               int* output) const {
   if (minified_content_ == NULL) {
     return false;
   }
-  return resource_util::GetGzippedSize(*minified_content_, output);
+  return rule_input.GetCompressedSize(*minified_content_, output);
 }
 
 Minifier::Minifier() {}
 
 Minifier::~Minifier() {}
 
+std::string Minifier::GetConfigurationFingerprint() const {
+  return "";
+}
+
 MinifyRule::MinifyRule(Minifier* minifier)
     : pagespeed::Rule(pagespeed::InputCapabilities(
         pagespeed::InputCapabilities::RESPONSE_BODY)),
@@ -100,62 +106,82 @@ bool MinifyRule::AppendResults(const RuleInput& rule_input,
   bool error = false;
   const PagespeedInput& input = rule_input.pagespeed_input();
   for (int idx = 0, num = input.num_resources(); idx < num; ++idx) {
-    const Resource& resource = input.GetResource(idx);
-
-    scoped_ptr<const MinifierOutput> output(
-        minifier_->Minify(resource, rule_input));
-    if (output == NULL) {
+    if (Deadline::IsExpired(rule_input.deadline())) {
+      // Out of time. Keep the results we have so far.
+      error = true;
+      break;
+    }
+    if (!AppendResultsForResource(rule_input, input.GetResource(idx),
+                                  provider)) {
       error = true;
-      continue;
-    } else if (!output->can_be_minified()) {
-      continue;
     }
+  }
 
-    int bytes_saved = 0;
-    int bytes_original = 0;
-    bool is_post_gzip = false;
-    if (resource_util::IsCompressedResource(resource)) {
-      int new_size;
-      if (rule_input.GetCompressedResponseBodySize(resource, &bytes_original) &&
-          output->GetCompressedMinifiedSize(&new_size)) {
-        bytes_saved = bytes_original - new_size;
-        is_post_gzip = true;
-      } else {
-        LOG(ERROR) << "Unable to compare compressed sizes for "
-                   << resource.GetRequestUrl();
-        error = true;
-        continue;
-      }
+  return !error;
+}
+
+bool MinifyRule::IsResourceLocal() const {
+  return true;
+}
+
+std::string MinifyRule::GetConfigurationFingerprint() const {
+  return minifier_->GetConfigurationFingerprint();
+}
+
+bool MinifyRule::AppendResultsForResource(const RuleInput& rule_input,
+                                          const Resource& resource,
+                                          ResultProvider* provider) {
+  scoped_ptr<const MinifierOutput> output(
+      minifier_->Minify(resource, rule_input));
+  if (output == NULL) {
+    return false;
+  } else if (!output->can_be_minified()) {
+    return true;
+  }
+
+  int bytes_saved = 0;
+  int bytes_original = 0;
+  bool is_post_gzip = false;
+  if (resource_util::IsCompressedResource(resource)) {
+    int new_size;
+    if (rule_input.GetCompressedResponseBodySize(resource, &bytes_original) &&
+        output->GetCompressedMinifiedSize(rule_input, &new_size)) {
+      bytes_saved = bytes_original - new_size;
+      is_post_gzip = true;
     } else {
-      bytes_original = resource.GetResponseBody().size();
-      bytes_saved = bytes_original - output->plain_minified_size();
+      LOG(ERROR) << "Unable to compare compressed sizes for "
+                 << resource.GetRequestUrl();
+      return false;
     }
+  } else {
+    bytes_original = resource.GetResponseBodyPiece().size();
+    bytes_saved = bytes_original - output->plain_minified_size();
+  }
 
-    if (bytes_saved <= 0) {
-      continue;
-    }
+  if (bytes_saved <= 0) {
+    return true;
+  }
 
-    Result* result = provider->NewResult();
-    result->set_original_response_bytes(bytes_original);
-    result->add_resource_urls(resource.GetRequestUrl());
+  Result* result = provider->NewResult();
+  result->set_original_response_bytes(bytes_original);
+  result->add_resource_urls(resource.GetRequestUrl());
 
-    Savings* savings = result->mutable_savings();
-    savings->set_response_bytes_saved(bytes_saved);
+  Savings* savings = result->mutable_savings();
+  savings->set_response_bytes_saved(bytes_saved);
 
-    MinificationDetails* min_details =
-      result->mutable_details()->MutableExtension(
-          MinificationDetails::message_set_extension);
-    min_details->set_savings_are_post_gzip(is_post_gzip);
+  MinificationDetails* min_details =
+    result->mutable_details()->MutableExtension(
+        MinificationDetails::message_set_extension);
+  min_details->set_savings_are_post_gzip(is_post_gzip);
 
-    if (output->should_save_minified_content() &&
-        !resource.IsResponseBodyModified()) {
-      result->set_optimized_content(*output->minified_content());
-      result->set_optimized_content_mime_type(
-          output->minified_content_mime_type());
-    }
+  if (output->should_save_minified_content() &&
+      !resource.IsResponseBodyModified()) {
+    result->set_optimized_content(*output->minified_content());
+    result->set_optimized_content_mime_type(
+        output->minified_content_mime_type());
   }
 
-  return !error;
+  return true;
 }
 
 void MinifyRule::FormatResults(const ResultVector& results,
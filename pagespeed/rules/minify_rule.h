@@ -73,9 +73,11 @@ struct MinifierOutput {
     return minified_content_mime_type_;
   }
 
-  // Get the size of the minified resource after also being compressed.  Return
-  // true on success, false on failure.
-  bool GetCompressedMinifiedSize(int* output) const;
+  // Get the size of the minified resource after also being compressed,
+  // computed the same way as RuleInput::GetCompressedResponseBodySize.
+  // Return true on success, false on failure.
+  bool GetCompressedMinifiedSize(const RuleInput& rule_input,
+                                 int* output) const;
 
  private:
   MinifierOutput(bool can_be_minified,
@@ -109,6 +111,8 @@ class Minifier {
   virtual const char* additional_info_url() const = 0;
   virtual const MinifierOutput* Minify(const Resource& resource,
                                        const RuleInput& input) const = 0;
+  // See Rule::GetConfigurationFingerprint. Empty by default.
+  virtual std::string GetConfigurationFingerprint() const;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(Minifier);
@@ -126,6 +130,11 @@ class MinifyRule : public Rule {
   virtual const char* name() const;
   virtual UserFacingString header() const;
   virtual bool AppendResults(const RuleInput& input, ResultProvider* provider);
+  virtual bool IsResourceLocal() const;
+  virtual std::string GetConfigurationFingerprint() const;
+  virtual bool AppendResultsForResource(const RuleInput& input,
+                                        const Resource& resource,
+                                        ResultProvider* provider);
   virtual void FormatResults(const ResultVector& results,
                              RuleFormatter* formatter);
  private:
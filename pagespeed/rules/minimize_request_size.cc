@@ -87,9 +87,10 @@ bool MinimizeRequestSize::AppendResults(const RuleInput& rule_input,
               pagespeed::RequestDetails::message_set_extension);
       details->set_url_length(resource.GetRequestUrl().size());
       details->set_cookie_length(
-          std::max(resource.GetRequestHeader("cookie").size(),
+          std::max(resource.GetRequestHeader(HEADER_COOKIE).size(),
                    resource.GetCookies().size()));
-      details->set_referer_length(resource.GetRequestHeader("referer").size());
+      details->set_referer_length(
+          resource.GetRequestHeader(HEADER_REFERER).size());
       details->set_is_static(resource_util::IsLikelyStaticResource(resource));
     }
   }
@@ -153,8 +153,8 @@ bool MobileViewport::AppendResults(const RuleInput& rule_input,
   html_parse.AddFilter(&filter);
 
   html_parse.StartParse(primary_resource_url);
-  html_parse.ParseText(primary_resource->GetResponseBody().data(),
-                       primary_resource->GetResponseBody().length());
+  html_parse.ParseText(primary_resource->GetResponseBodyPiece().data(),
+                       primary_resource->GetResponseBodyPiece().length());
   html_parse.FinishParse();
 
   if (!filter.has_meta_viewport()) {
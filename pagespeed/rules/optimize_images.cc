@@ -16,6 +16,7 @@
 
 #include <string>
 
+#include "base/string_piece.h"
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/rule_input.h"
 
@@ -47,6 +48,7 @@ class ImageMinifier : public Minifier {
   virtual const char* additional_info_url() const;
   virtual const MinifierOutput* Minify(const Resource& resource,
                                        const RuleInput& input) const;
+  virtual std::string GetConfigurationFingerprint() const;
 
  private:
   bool save_optimized_content_;
@@ -116,6 +118,10 @@ UserFacingString ImageMinifier::child_format_post_gzip() const {
   return child_format();
 }
 
+std::string ImageMinifier::GetConfigurationFingerprint() const {
+  return save_optimized_content_ ? "save_optimized_content" : "";
+}
+
 const MinifierOutput* ImageMinifier::Minify(const Resource& resource,
                                             const RuleInput& input) const {
   if (resource.GetResourceType() != IMAGE) {
@@ -123,12 +129,13 @@ const MinifierOutput* ImageMinifier::Minify(const Resource& resource,
   }
 
   const ImageType type = resource.GetImageType();
-  const std::string& original = resource.GetResponseBody();
+  const base::StringPiece original = resource.GetResponseBodyPiece();
 
   std::string compressed;
   std::string output_mime_type;
   if (type == JPEG) {
-    if (!image_compression::OptimizeJpeg(original, &compressed)) {
+    if (!image_compression::OptimizeJpegWithDeadline(
+            original, input.deadline(), &compressed)) {
       DLOG(INFO) << "OptimizeJpeg failed for resource: "
                  << resource.GetRequestUrl();
       return MinifierOutput::Error();
@@ -136,9 +143,8 @@ const MinifierOutput* ImageMinifier::Minify(const Resource& resource,
     output_mime_type = "image/jpeg";
   } else if (type == PNG) {
     image_compression::PngReader reader;
-    if (!image_compression::PngOptimizer::OptimizePng(reader,
-                                                      original,
-                                                      &compressed)) {
+    if (!image_compression::PngOptimizer::OptimizePngWithDeadline(
+            reader, original, input.deadline(), &compressed)) {
       DLOG(INFO) << "OptimizePng(PngReader) failed for resource: "
                  << resource.GetRequestUrl();
       return MinifierOutput::Error();
@@ -146,9 +152,8 @@ const MinifierOutput* ImageMinifier::Minify(const Resource& resource,
     output_mime_type = "image/png";
   } else if (type == GIF) {
     image_compression::GifReader reader;
-    if (!image_compression::PngOptimizer::OptimizePng(reader,
-                                                      original,
-                                                      &compressed)) {
+    if (!image_compression::PngOptimizer::OptimizePngWithDeadline(
+            reader, original, input.deadline(), &compressed)) {
       DLOG(INFO) << "OptimizePng(GifReader) failed for resource: "
                  << resource.GetRequestUrl();
       return MinifierOutput::Error();
@@ -19,6 +19,7 @@
 
 #include "base/basictypes.h"
 #include "base/logging.h"
+#include "base/string_piece.h"
 #include "net/instaweb/htmlparse/public/html_parse.h"
 #include "net/instaweb/htmlparse/public/empty_html_filter.h"
 #include "net/instaweb/util/public/google_message_handler.h"
@@ -289,7 +290,7 @@ AppendResults(const RuleInput& rule_input, ResultProvider* provider) {
     StyleScriptVisitor visitor;
     filter.set_visitor(&visitor);
 
-    const std::string& response_body = resource.GetResponseBody();
+    const base::StringPiece response_body = resource.GetResponseBodyPiece();
     html_parse.StartParse(resource.GetRequestUrl().c_str());
     html_parse.ParseText(response_body.data(), response_body.size());
     html_parse.FinishParse();
@@ -153,61 +153,73 @@ bool IsBlockingScript(
   return is_blocking_script && (offset == stripped_resolved_src.size());
 }
 
-class ScriptVisitor : public pagespeed::DomElementVisitor {
+// Finds the blocking scripts of each document, and adds their results
+// once it has visited the document's elements, so that the results of
+// nested documents come first.
+class ScriptVisitor : public pagespeed::DomTraversalVisitor {
  public:
-  static void CheckDocument(const PagespeedInput* pagespeed_input,
-                            const DomDocument* document,
-                            ResultProvider* provider) {
-    if (document) {
-      ScriptVisitor visitor(pagespeed_input, document, provider);
-      document->Traverse(&visitor);
-      visitor.AddViolations(provider, document->GetDocumentUrl());
-    }
+  ScriptVisitor(const PagespeedInput* pagespeed_input,
+                ResultProvider* provider)
+      : pagespeed_input_(pagespeed_input), provider_(provider) {}
+
+  virtual bool EnterDocument(const DomDocument& document,
+                             const DomElement* frame) {
+    documents_.push_back(DocumentState(
+        &document,
+        pagespeed_input_->has_resource_with_url(document.GetDocumentUrl())));
+    return true;
   }
 
   virtual void Visit(const DomElement& node) {
-    const std::string tag_name(node.GetTagName());
-    if (tag_name == "IFRAME") {
-      scoped_ptr<pagespeed::DomDocument> child_doc(node.GetContentDocument());
-      CheckDocument(pagespeed_input_, child_doc.get(), provider_);
-    } else if (pagespeed_input_->has_resource_with_url(
-        document_->GetDocumentUrl())) {
-      if (tag_name == "SCRIPT") {
-        std::string script_src;
-        if (node.GetAttributeByName("src", &script_src)) {
-          std::string async;
-          // The presence of a boolean attribute on an element represents
-          // the true value.
-          if (!node.GetAttributeByName("async", &async)) {
-            VisitExternalScript(script_src);
-          }
+    if (!documents_.back().has_resource) {
+      return;
+    }
+    if (node.GetTagName() == "SCRIPT") {
+      std::string script_src;
+      if (node.GetAttributeByName("src", &script_src)) {
+        std::string async;
+        // The presence of a boolean attribute on an element represents
+        // the true value.
+        if (!node.GetAttributeByName("async", &async)) {
+          VisitExternalScript(script_src);
         }
       }
     }
   }
 
-  void VisitExternalScript(const std::string& script_src);
-
-  void AddViolations(ResultProvider* provider, const std::string& document_url);
+  virtual void LeaveDocument(const DomDocument& document) {
+    DCHECK(documents_.back().document == &document);
+    AddViolations(documents_.back());
+    documents_.pop_back();
+  }
 
  private:
-  ScriptVisitor(const PagespeedInput* pagespeed_input,
-                const DomDocument* document, ResultProvider* provider)
-      : pagespeed_input_(pagespeed_input),
-        document_(document), provider_(provider) {}
+  struct DocumentState {
+    DocumentState(const DomDocument* document, bool has_resource)
+        : document(document), has_resource(has_resource) {}
 
-  std::vector<std::string> blocking_scripts_;
+    const DomDocument* document;
+    bool has_resource;
+    std::vector<std::string> blocking_scripts;
+  };
+
+  void VisitExternalScript(const std::string& script_src);
+
+  void AddViolations(const DocumentState& state);
+
+  // The documents being visited, innermost last.
+  std::vector<DocumentState> documents_;
 
   const PagespeedInput* pagespeed_input_;
-  const DomDocument* document_;
   ResultProvider* provider_;
 
   DISALLOW_COPY_AND_ASSIGN(ScriptVisitor);
 };
 
 void ScriptVisitor::VisitExternalScript(const std::string& script_src) {
+  DocumentState& state = documents_.back();
   // Make sure to resolve the URI.
-  std::string resolved_src = document_->ResolveUri(script_src);
+  std::string resolved_src = state.document->ResolveUri(script_src);
   const pagespeed::Resource* resource =
       pagespeed_input_->GetResourceWithUrlOrNull(resolved_src);
   if (resource == NULL) {
@@ -218,18 +230,17 @@ void ScriptVisitor::VisitExternalScript(const std::string& script_src) {
   }
 
   if (rules::PreferAsyncResources::IsAsyncResourceCandidate(*resource)) {
-    blocking_scripts_.push_back(resolved_src);
+    state.blocking_scripts.push_back(resolved_src);
   }
 }
 
-void ScriptVisitor::AddViolations(ResultProvider* provider,
-                                  const std::string& document_url) {
-  int index = 0;
+void ScriptVisitor::AddViolations(const DocumentState& state) {
+  const std::string document_url = state.document->GetDocumentUrl();
   for (std::vector<std::string>::const_iterator
-       iter = blocking_scripts_.begin(),
-       end = blocking_scripts_.end();
-       iter != end; ++index, ++iter) {
-    Result* result = provider->NewResult();
+       iter = state.blocking_scripts.begin(),
+       end = state.blocking_scripts.end();
+       iter != end; ++iter) {
+    Result* result = provider_->NewResult();
     result->add_resource_urls(document_url);
     Savings* savings = result->mutable_savings();
     savings->set_critical_path_length_saved(1);
@@ -263,10 +274,14 @@ UserFacingString PreferAsyncResources::header() const {
   return _("Prefer asynchronous resources");
 }
 
+DomTraversalVisitor* PreferAsyncResources::NewDomVisitor(
+    const RuleInput& rule_input, ResultProvider* provider) const {
+  return new ScriptVisitor(&rule_input.pagespeed_input(), provider);
+}
+
 bool PreferAsyncResources::AppendResults(const RuleInput& rule_input,
                                          ResultProvider* provider) {
-  const PagespeedInput& input = rule_input.pagespeed_input();
-  ScriptVisitor::CheckDocument(&input, input.dom_document(), provider);
+  AppendDomVisitorResults(rule_input, provider);
   return true;
 }
 
@@ -283,7 +298,7 @@ void PreferAsyncResources::FormatResults(const ResultVector& results,
       _("The following resources are loaded synchronously. Load them "
         "asynchronously to reduce blocking of page rendering."));
 
-  // CheckDocument adds the results in post-order.
+  // ScriptVisitor adds the results in post-order.
 
   for (ResultVector::const_iterator i = results.begin(), end = results.end();
        i != end; ++i) {
@@ -33,6 +33,8 @@ class PreferAsyncResources : public Rule {
   // Rule interface.
   virtual const char* name() const;
   virtual UserFacingString header() const;
+  virtual DomTraversalVisitor* NewDomVisitor(const RuleInput& input,
+                                             ResultProvider* provider) const;
   virtual bool AppendResults(const RuleInput& input, ResultProvider* provider);
   virtual void FormatResults(const ResultVector& results,
                              RuleFormatter* formatter);
@@ -34,77 +34,88 @@ namespace {
 
 const char* kRuleName = "PutCssInTheDocumentHead";
 
-class StyleVisitor : public pagespeed::DomElementVisitor {
+// Finds the styles in the body of each document, and adds a result for
+// each document that has any once it has visited the document's
+// elements, so that the results of nested documents come first.
+class StyleVisitor : public pagespeed::DomTraversalVisitor {
  public:
-  static void CheckDocument(const PagespeedInput* pagespeed_input,
-                            const DomDocument* document,
-                            ResultProvider* provider) {
-    if (document) {
-      StyleVisitor visitor(pagespeed_input, document, provider);
-      document->Traverse(&visitor);
-      visitor.Finish();
-    }
+  StyleVisitor(const PagespeedInput* pagespeed_input,
+               ResultProvider* provider)
+      : pagespeed_input_(pagespeed_input), provider_(provider) {}
+
+  virtual bool EnterDocument(const DomDocument& document,
+                             const DomElement* frame) {
+    documents_.push_back(DocumentState(
+        &document,
+        pagespeed_input_->has_resource_with_url(document.GetDocumentUrl())));
+    return true;
   }
 
   virtual void Visit(const DomElement& node) {
+    DocumentState& state = documents_.back();
     const std::string tag_name(node.GetTagName());
-    if (tag_name == "IFRAME") {
-      scoped_ptr<pagespeed::DomDocument> child_doc(node.GetContentDocument());
-      CheckDocument(pagespeed_input_, child_doc.get(), provider_);
-    } else if (tag_name == "BODY") {
-      is_in_body_yet_ = true;
-    } else if (is_in_body_yet_) {
-      if (pagespeed_input_->has_resource_with_url(
-              document_->GetDocumentUrl())) {
-        if (tag_name == "LINK") {
-          std::string rel, href;
-          if (node.GetAttributeByName("rel", &rel) && rel == "stylesheet" &&
-              node.GetAttributeByName("href", &href)) {
-            external_styles_.push_back(document_->ResolveUri(href));
-          }
-        } else if (tag_name == "STYLE") {
-          ++num_inline_style_blocks_;
+    if (tag_name == "BODY") {
+      state.is_in_body_yet = true;
+    } else if (state.is_in_body_yet && state.has_resource) {
+      if (tag_name == "LINK") {
+        std::string rel, href;
+        if (node.GetAttributeByName("rel", &rel) && rel == "stylesheet" &&
+            node.GetAttributeByName("href", &href)) {
+          state.external_styles.push_back(state.document->ResolveUri(href));
         }
+      } else if (tag_name == "STYLE") {
+        ++state.num_inline_style_blocks;
       }
     }
   }
 
+  virtual void LeaveDocument(const DomDocument& document) {
+    DCHECK(documents_.back().document == &document);
+    AddResult(documents_.back());
+    documents_.pop_back();
+  }
+
  private:
-  StyleVisitor(const PagespeedInput* pagespeed_input,
-               const DomDocument* document, ResultProvider* provider)
-      : is_in_body_yet_(false), num_inline_style_blocks_(0),
-        pagespeed_input_(pagespeed_input), document_(document),
-        provider_(provider) {}
-
-  void Finish() {
-    DCHECK(num_inline_style_blocks_ >= 0);
-    if (num_inline_style_blocks_ == 0 && external_styles_.empty()) {
+  struct DocumentState {
+    DocumentState(const DomDocument* document, bool has_resource)
+        : document(document), has_resource(has_resource),
+          is_in_body_yet(false), num_inline_style_blocks(0) {}
+
+    const DomDocument* document;
+    bool has_resource;
+    bool is_in_body_yet;
+    int num_inline_style_blocks;
+    std::vector<std::string> external_styles;
+  };
+
+  void AddResult(const DocumentState& state) {
+    DCHECK(state.num_inline_style_blocks >= 0);
+    if (state.num_inline_style_blocks == 0 && state.external_styles.empty()) {
       return;
     }
 
     Result* result = provider_->NewResult();
-    result->add_resource_urls(document_->GetDocumentUrl());
+    result->add_resource_urls(state.document->GetDocumentUrl());
 
     Savings* savings = result->mutable_savings();
-    savings->set_page_reflows_saved(num_inline_style_blocks_ +
-                                    external_styles_.size());
+    savings->set_page_reflows_saved(state.num_inline_style_blocks +
+                                    state.external_styles.size());
 
     ResultDetails* details = result->mutable_details();
     StylesInBodyDetails* style_details =
         details->MutableExtension(StylesInBodyDetails::message_set_extension);
-    style_details->set_num_inline_style_blocks(num_inline_style_blocks_);
-    for (std::vector<std::string>::const_iterator i = external_styles_.begin(),
-             end = external_styles_.end(); i != end; ++i) {
+    style_details->set_num_inline_style_blocks(state.num_inline_style_blocks);
+    for (std::vector<std::string>::const_iterator
+             i = state.external_styles.begin(),
+             end = state.external_styles.end(); i != end; ++i) {
       style_details->add_external_styles(*i);
     }
   }
 
-  bool is_in_body_yet_;
-  int num_inline_style_blocks_;
-  std::vector<std::string> external_styles_;
+  // The documents being visited, innermost last.
+  std::vector<DocumentState> documents_;
 
   const PagespeedInput* pagespeed_input_;
-  const DomDocument* document_;
   ResultProvider* provider_;
 
   DISALLOW_COPY_AND_ASSIGN(StyleVisitor);
@@ -129,10 +140,14 @@ UserFacingString PutCssInTheDocumentHead::header() const {
   return _("Put CSS in the document head");
 }
 
+DomTraversalVisitor* PutCssInTheDocumentHead::NewDomVisitor(
+    const RuleInput& rule_input, ResultProvider* provider) const {
+  return new StyleVisitor(&rule_input.pagespeed_input(), provider);
+}
+
 bool PutCssInTheDocumentHead::AppendResults(const RuleInput& rule_input,
                                             ResultProvider* provider) {
-  const PagespeedInput& input = rule_input.pagespeed_input();
-  StyleVisitor::CheckDocument(&input, input.dom_document(), provider);
+  AppendDomVisitorResults(rule_input, provider);
   return true;
 }
 
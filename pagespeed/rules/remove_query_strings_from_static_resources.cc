@@ -20,6 +20,7 @@
 #include "pagespeed/core/formatter.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
+#include "pagespeed/core/resource_cache_computer.h"
 #include "pagespeed/core/resource_util.h"
 #include "pagespeed/core/result_provider.h"
 #include "pagespeed/core/rule_input.h"
@@ -55,7 +56,7 @@ AppendResults(const RuleInput& rule_input, ResultProvider* provider) {
     const Resource& resource = input.GetResource(i);
     if (resource.GetRequestUrl().find('?') != std::string::npos &&
         resource_util::IsLikelyStaticResource(resource) &&
-        resource_util::IsProxyCacheableResource(resource)) {
+        ResourceCacheComputer(&resource).IsProxyCacheable()) {
       Result* result = provider->NewResult();
       result->add_resource_urls(resource.GetRequestUrl());
     }
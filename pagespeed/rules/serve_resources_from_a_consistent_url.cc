@@ -18,6 +18,7 @@
 #include <string>
 #include <vector>
 
+#include "base/string_piece.h"
 #include "pagespeed/core/formatter.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
@@ -33,19 +34,20 @@ static const char* kCrossDomainXmlSuffix = "/crossdomain.xml";
 static const size_t kCrossDomainXmlSuffixLen = strlen(kCrossDomainXmlSuffix);
 
 struct ResourceBodyLessThan {
-  bool operator()(const std::string* a,
-                  const std::string* b) const {
-    if (a->size() != b->size()) {
+  bool operator()(const base::StringPiece& a,
+                  const base::StringPiece& b) const {
+    if (a.size() != b.size()) {
       // If the sizes differ, compare based on size. Comparing size is
       // more efficient than comparing actual string contents.
-      return a->size() < b->size();
+      return a.size() < b.size();
     }
-    return *a < *b;
+    return a < b;
   }
 };
 
-// Map of ResourceSets, keyed by Resource bodies.
-typedef std::map<const std::string*,
+// Map of ResourceSets, keyed by Resource bodies. The keys point into
+// the bodies owned by the resources.
+typedef std::map<base::StringPiece,
                  pagespeed::ResourceSet,
                  ResourceBodyLessThan> ResourcesWithSameBodyMap;
 
@@ -84,7 +86,7 @@ AppendResults(const RuleInput& rule_input, ResultProvider* provider) {
       // about.
       continue;
     }
-    if (resource.GetResponseBody().empty()) {
+    if (resource.GetResponseBodyPiece().empty()) {
       // Exclude responses with empty bodies.
       continue;
     }
@@ -104,7 +106,7 @@ AppendResults(const RuleInput& rule_input, ResultProvider* provider) {
         continue;
       }
     }
-    map[&resource.GetResponseBody()].insert(&resource);
+    map[resource.GetResponseBodyPiece()].insert(&resource);
   }
 
   for (ResourcesWithSameBodyMap::const_iterator map_iter = map.begin(),
@@ -117,7 +119,7 @@ AppendResults(const RuleInput& rule_input, ResultProvider* provider) {
       const Resource &first_resource = **resources.begin();
       const int requests_saved = resources.size() - 1;
       const int response_bytes_saved =
-          (first_resource.GetResponseBody().size() * requests_saved);
+          (first_resource.GetResponseBodyPiece().size() * requests_saved);
 
       Savings* savings = result->mutable_savings();
       savings->set_requests_saved(requests_saved);
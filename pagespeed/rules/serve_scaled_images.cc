@@ -16,13 +16,13 @@
 
 #include <algorithm>  // for max/min
 #include <map>
+#include <string>
+#include <vector>
 
 #include "base/logging.h"
-#include "base/memory/scoped_ptr.h"
 #include "base/stl_util.h"  // for STLDeleteContainerPairSecondPointers
 #include "pagespeed/core/dom.h"
 #include "pagespeed/core/formatter.h"
-#include "pagespeed/core/image_attributes.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/result_provider.h"
@@ -121,131 +121,108 @@ void ImageData::Update(int actual_width, int actual_height,
 
 typedef std::map<std::string, ImageData*> ImageDataMap;
 
-class ScaledImagesChecker : public pagespeed::DomElementVisitor {
+// Collects the client sizes of the images of the root document and the
+// documents nested within it, and adds the results for the images that
+// are scaled down once it has visited all of them.
+class ScaledImagesChecker : public pagespeed::DomTraversalVisitor {
  public:
-  // Ownership of document and image_data_map are _not_ transfered to the
-  // ScaledImagesChecker.
   ScaledImagesChecker(const pagespeed::RuleInput* rule_input,
-                      const pagespeed::DomDocument* document,
-                      ImageDataMap* image_data_map)
-      : rule_input_(rule_input), document_(document),
-        image_data_map_(image_data_map) {}
+                      pagespeed::ResultProvider* provider)
+      : rule_input_(rule_input), provider_(provider) {}
+
+  virtual ~ScaledImagesChecker() {
+    STLDeleteContainerPairSecondPointers(image_data_map_.begin(),
+                                         image_data_map_.end());
+  }
+
+  virtual bool EnterDocument(const pagespeed::DomDocument& document,
+                             const pagespeed::DomElement* frame) {
+    documents_.push_back(&document);
+    return true;
+  }
 
   virtual void Visit(const pagespeed::DomElement& node);
 
+  virtual void LeaveDocument(const pagespeed::DomDocument& document) {
+    documents_.pop_back();
+    if (documents_.empty()) {
+      AddResults(document.IsResponsive());
+    }
+  }
+
  private:
+  void AddResults(bool is_responsive);
+
   const pagespeed::RuleInput* rule_input_;
-  const pagespeed::DomDocument* document_;
-  ImageDataMap* image_data_map_;
+  pagespeed::ResultProvider* provider_;
+
+  // The documents being visited, innermost last.
+  std::vector<const pagespeed::DomDocument*> documents_;
+  ImageDataMap image_data_map_;
 
   DISALLOW_COPY_AND_ASSIGN(ScaledImagesChecker);
 };
 
 void ScaledImagesChecker::Visit(const pagespeed::DomElement& node) {
-  if (node.GetTagName() == "IMG") {
-    if (rule_input_->pagespeed_input().has_resource_with_url(
-            document_->GetDocumentUrl())) {
-      std::string src;
-      if (node.GetAttributeByName("src", &src)) {
-        const std::string url(document_->ResolveUri(src));
-        const pagespeed::Resource* resource =
-            rule_input_->pagespeed_input().GetResourceCollection()
-            .GetRedirectRegistry()->GetFinalRedirectTarget(
-                rule_input_->pagespeed_input().GetResourceWithUrlOrNull(url));
-        if (resource != NULL) {
-          scoped_ptr<pagespeed::ImageAttributes> image_attributes(
-              rule_input_->pagespeed_input().NewImageAttributes(resource));
-          if (image_attributes != NULL) {
-            const int actual_width = image_attributes->GetImageWidth();
-            const int actual_height = image_attributes->GetImageHeight();
-            int client_width = 0, client_height = 0;
-            if (node.GetActualWidth(&client_width) ==
-                pagespeed::DomElement::SUCCESS &&
-                node.GetActualHeight(&client_height) ==
-                pagespeed::DomElement::SUCCESS) {
-              ImageDataMap::iterator iter = image_data_map_->find(url);
-              if (iter == image_data_map_->end()) {
-                // Ownership of ImageData is transfered to the ImageDataMap.
-                (*image_data_map_)[url] =
-                    new ImageData(url, actual_width, actual_height,
-                                  client_width, client_height);
-              } else {
-                iter->second->Update(actual_width, actual_height,
-                                     client_width, client_height);
-              }
-            }
+  if (node.GetTagName() != "IMG") {
+    return;
+  }
+  const pagespeed::DomDocument* document = documents_.back();
+  if (!rule_input_->pagespeed_input().has_resource_with_url(
+          document->GetDocumentUrl())) {
+    return;
+  }
+  std::string src;
+  if (node.GetAttributeByName("src", &src)) {
+    const std::string url(document->ResolveUri(src));
+    const pagespeed::Resource* resource =
+        rule_input_->pagespeed_input().GetResourceCollection()
+        .GetRedirectRegistry()->GetFinalRedirectTarget(
+            rule_input_->pagespeed_input().GetResourceWithUrlOrNull(url));
+    if (resource != NULL) {
+      int actual_width = 0, actual_height = 0;
+      if (rule_input_->GetImageDimensions(*resource, &actual_width,
+                                          &actual_height)) {
+        int client_width = 0, client_height = 0;
+        if (node.GetActualWidth(&client_width) ==
+            pagespeed::DomElement::SUCCESS &&
+            node.GetActualHeight(&client_height) ==
+            pagespeed::DomElement::SUCCESS) {
+          ImageDataMap::iterator iter = image_data_map_.find(url);
+          if (iter == image_data_map_.end()) {
+            // Ownership of ImageData is transfered to the ImageDataMap.
+            image_data_map_[url] =
+                new ImageData(url, actual_width, actual_height,
+                              client_width, client_height);
+          } else {
+            iter->second->Update(actual_width, actual_height,
+                                 client_width, client_height);
           }
         }
       }
     }
-  } else if (node.GetTagName() == "IFRAME") {
-    // Do a recursive document traversal.
-    scoped_ptr<pagespeed::DomDocument> child_doc(node.GetContentDocument());
-    if (child_doc.get()) {
-      ScaledImagesChecker checker(rule_input_, child_doc.get(),
-                                  image_data_map_);
-      child_doc->Traverse(&checker);
-    }
   }
 }
 
-}  // namespace
-
-namespace pagespeed {
-
-namespace rules {
-
-ServeScaledImages::ServeScaledImages()
-    : pagespeed::Rule(pagespeed::InputCapabilities(
-        pagespeed::InputCapabilities::DOM |
-        pagespeed::InputCapabilities::RESPONSE_BODY)) {}
-
-const char* ServeScaledImages::name() const {
-  return "ServeScaledImages";
-}
-
-UserFacingString ServeScaledImages::header() const {
-  // TRANSLATOR: The name of a Page Speed rule that is triggered when users
-  // serve images, then rescale them in HTML or CSS to the final size (it is
-  // more efficient to serve the image with the dimensions it will be shown at).
-  // This is displayed at the top of a list of rules names that Page Speed
-  // generates.
-  return _("Serve scaled images");
-}
-
-bool ServeScaledImages::AppendResults(const RuleInput& rule_input,
-                                      ResultProvider* provider) {
-  // TODO Consider adding the ability to perform the resizing and provide
-  //      the resized image file to the user.
-
-  const PagespeedInput& input = rule_input.pagespeed_input();
-  const DomDocument* document = input.dom_document();
-  if (!document) {
-    return true;
-  }
-
-  bool ok = true;
-  bool is_responsive = document->IsResponsive();
-  ImageDataMap image_data_map;
-  ScaledImagesChecker visitor(&rule_input, document, &image_data_map);
-  document->Traverse(&visitor);
-
+void ScaledImagesChecker::AddResults(bool is_responsive) {
+  const pagespeed::PagespeedInput& input = rule_input_->pagespeed_input();
   typedef std::map<const std::string, int> OriginalSizesMap;
   OriginalSizesMap original_sizes_map;
   for (int idx = 0, num = input.num_resources(); idx < num; ++idx) {
-    const Resource& resource = input.GetResource(idx);
-    const Resource* target = input.GetResourceCollection().GetRedirectRegistry()
+    const pagespeed::Resource& resource = input.GetResource(idx);
+    const pagespeed::Resource* target =
+        input.GetResourceCollection().GetRedirectRegistry()
         ->GetFinalRedirectTarget(&resource);
     if (NULL == target) {
       LOG(DFATAL) << "target == NULL";
       continue;
     }
     original_sizes_map[resource.GetRequestUrl()] =
-        target->GetResponseBody().size();
+        target->GetResponseBodyPiece().size();
   }
 
-  for (ImageDataMap::const_iterator iter = image_data_map.begin(),
-           end = image_data_map.end(); iter != end; ++iter) {
+  for (ImageDataMap::const_iterator iter = image_data_map_.begin(),
+           end = image_data_map_.end(); iter != end; ++iter) {
     const ImageData* image_data = iter->second;
     if (!image_data->IsScalable()) {
       continue;
@@ -267,11 +244,11 @@ bool ServeScaledImages::AppendResults(const RuleInput& rule_input,
       continue;
     }
 
-    Result* result = provider->NewResult();
+    pagespeed::Result* result = provider_->NewResult();
     result->set_original_response_bytes(original_size);
     result->add_resource_urls(url);
 
-    Savings* savings = result->mutable_savings();
+    pagespeed::Savings* savings = result->mutable_savings();
     savings->set_response_bytes_saved(bytes_saved);
 
     pagespeed::ResultDetails* details = result->mutable_details();
@@ -283,11 +260,47 @@ bool ServeScaledImages::AppendResults(const RuleInput& rule_input,
     image_details->set_actual_height(image_data->client_height());
     image_details->set_actual_width(image_data->client_width());
   }
+}
+
+}  // namespace
+
+namespace pagespeed {
+
+namespace rules {
+
+ServeScaledImages::ServeScaledImages()
+    : pagespeed::Rule(pagespeed::InputCapabilities(
+        pagespeed::InputCapabilities::DOM |
+        pagespeed::InputCapabilities::RESPONSE_BODY)) {}
 
-  STLDeleteContainerPairSecondPointers(image_data_map.begin(),
-                                       image_data_map.end());
+const char* ServeScaledImages::name() const {
+  return "ServeScaledImages";
+}
+
+UserFacingString ServeScaledImages::header() const {
+  // TRANSLATOR: The name of a Page Speed rule that is triggered when users
+  // serve images, then rescale them in HTML or CSS to the final size (it is
+  // more efficient to serve the image with the dimensions it will be shown at).
+  // This is displayed at the top of a list of rules names that Page Speed
+  // generates.
+  return _("Serve scaled images");
+}
+
+DomTraversalVisitor* ServeScaledImages::NewDomVisitor(
+    const RuleInput& rule_input, ResultProvider* provider) const {
+  // TODO Consider adding the ability to perform the resizing and provide
+  //      the resized image file to the user.
+  return new ScaledImagesChecker(&rule_input, provider);
+}
+
+bool ServeScaledImages::DomVisitorUsesImageDimensions() const {
+  return true;
+}
 
-  return ok;
+bool ServeScaledImages::AppendResults(const RuleInput& rule_input,
+                                      ResultProvider* provider) {
+  AppendDomVisitorResults(rule_input, provider);
+  return true;
 }
 
 void ServeScaledImages::FormatResults(const ResultVector& results,
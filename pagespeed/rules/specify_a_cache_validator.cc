@@ -27,21 +27,11 @@
 namespace {
 
 bool HasValidLastModifiedHeader(const pagespeed::Resource& resource) {
-  const std::string& last_modified =
-      resource.GetResponseHeader("Last-Modified");
-  if (last_modified.empty()) {
-    return false;
-  }
-  int64 last_modified_value = 0;
-  if (!pagespeed::resource_util::ParseTimeValuedHeader(
-          last_modified.c_str(), &last_modified_value)) {
-    return false;
-  }
-  return true;
+  return resource.GetCachePolicy().has_valid_last_modified;
 }
 
 bool HasETagHeader(const pagespeed::Resource& resource) {
-  const std::string& etag = resource.GetResponseHeader("ETag");
+  const std::string& etag = resource.GetResponseHeader(pagespeed::HEADER_ETAG);
   return !etag.empty();
 }
 
@@ -72,24 +62,35 @@ bool SpecifyACacheValidator::AppendResults(const RuleInput& rule_input,
                                            ResultProvider* provider) {
   const PagespeedInput& input = rule_input.pagespeed_input();
   for (int i = 0, num = input.num_resources(); i < num; ++i) {
-    const Resource& resource = input.GetResource(i);
-    if (!resource_util::IsLikelyStaticResource(resource)) {
-      // Probably not a static resource, so don't suggest using a
-      // cache validator.
-      continue;
-    }
+    AppendResultsForResource(rule_input, input.GetResource(i), provider);
+  }
+  return true;
+}
 
-    if (HasValidLastModifiedHeader(resource) ||
-        HasETagHeader(resource)) {
-      // The response already has a valid cache validator.
-      continue;
-    }
+bool SpecifyACacheValidator::IsResourceLocal() const {
+  return true;
+}
 
-    // No savings data is needed for this resource. All cache
-    // validators have the same cost/benefit.
-    Result* result = provider->NewResult();
-    result->add_resource_urls(resource.GetRequestUrl());
+bool SpecifyACacheValidator::AppendResultsForResource(
+    const RuleInput& rule_input,
+    const Resource& resource,
+    ResultProvider* provider) {
+  if (!resource_util::IsLikelyStaticResource(resource)) {
+    // Probably not a static resource, so don't suggest using a
+    // cache validator.
+    return true;
   }
+
+  if (HasValidLastModifiedHeader(resource) ||
+      HasETagHeader(resource)) {
+    // The response already has a valid cache validator.
+    return true;
+  }
+
+  // No savings data is needed for this resource. All cache
+  // validators have the same cost/benefit.
+  Result* result = provider->NewResult();
+  result->add_resource_urls(resource.GetRequestUrl());
   return true;
 }
 
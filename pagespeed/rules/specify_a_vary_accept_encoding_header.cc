@@ -60,10 +60,10 @@ AppendResults(const RuleInput& rule_input, ResultProvider* provider) {
     //   2) The resource is compressible,
     //   3) The resource is proxy-cacheable, and
     //   4) Vary: accept-encoding is not already set.
-    if (resource.GetResponseHeader("Set-Cookie").empty() &&
+    if (resource.GetResponseHeader(HEADER_SET_COOKIE).empty() &&
         resource_util::IsCompressibleResource(resource) &&
         resource_util::IsProxyCacheableResource(resource)) {
-      const std::string& vary_header = resource.GetResponseHeader("Vary");
+      const std::string& vary_header = resource.GetResponseHeader(HEADER_VARY);
       resource_util::DirectiveMap directive_map;
       if (resource_util::GetHeaderDirectives(vary_header, &directive_map) &&
           !directive_map.count("accept-encoding")) {
@@ -19,7 +19,6 @@
 #include "pagespeed/core/formatter.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
-#include "pagespeed/core/resource_util.h"
 #include "pagespeed/core/result_provider.h"
 #include "pagespeed/core/rule_input.h"
 #include "pagespeed/l10n/l10n.h"
@@ -29,19 +28,6 @@ namespace {
 
 const size_t kLateThresholdBytes = 1024;
 
-bool HasCharsetInContentTypeHeader(const std::string& header) {
-  pagespeed::resource_util::DirectiveMap directives;
-  if (!pagespeed::resource_util::GetHeaderDirectives(header, &directives)) {
-    return false;
-  }
-
-  if (directives.find("charset") == directives.end()) {
-    return false;
-  }
-
-  return !directives["charset"].empty();
-}
-
 }  // namespace
 
 namespace pagespeed {
@@ -73,7 +59,7 @@ bool SpecifyCharsetEarly::AppendResults(const RuleInput& rule_input,
     const Resource& resource = input.GetResource(idx);
     const ResourceType resource_type = resource.GetResourceType();
     const std::string& content_type =
-        resource.GetResponseHeader("Content-Type");
+        resource.GetResponseHeader(HEADER_CONTENT_TYPE);
 
     if (resource_type != HTML) {
       const bool might_be_html = resource_type == OTHER && content_type.empty();
@@ -86,14 +72,13 @@ bool SpecifyCharsetEarly::AppendResults(const RuleInput& rule_input,
       }
     }
 
-    if (HasCharsetInContentTypeHeader(content_type)) {
+    if (!resource.GetCharset().empty()) {
       // There is a valid charset in the Content-Type header, so don't
       // flag this resource.
       continue;
     }
 
-    const std::string& body = resource.GetResponseBody();
-    if (body.size() < kLateThresholdBytes) {
+    if (resource.GetResponseBodyPiece().size() < kLateThresholdBytes) {
       // The response body is small, so this rule doesn't apply.
       continue;
     }
@@ -15,13 +15,13 @@
 #include "pagespeed/rules/specify_image_dimensions.h"
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "base/logging.h"
-#include "base/memory/scoped_ptr.h"
 #include "pagespeed/core/dom.h"
 #include "pagespeed/core/formatter.h"
-#include "pagespeed/core/image_attributes.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/result_provider.h"
@@ -34,27 +34,39 @@ namespace {
 
 const char* kRuleName = "SpecifyImageDimensions";
 
-class ImageDimensionsChecker : public pagespeed::DomElementVisitor {
+class ImageDimensionsChecker : public pagespeed::DomTraversalVisitor {
  public:
   ImageDimensionsChecker(const pagespeed::RuleInput* rule_input,
-                         const pagespeed::DomDocument* document,
                          pagespeed::ResultProvider* provider)
-      : rule_input_(rule_input), document_(document), provider_(provider) {}
+      : rule_input_(rule_input), provider_(provider) {}
+
+  virtual bool EnterDocument(const pagespeed::DomDocument& document,
+                             const pagespeed::DomElement* frame) {
+    documents_.push_back(&document);
+    return true;
+  }
 
   virtual void Visit(const pagespeed::DomElement& node);
 
+  virtual void LeaveDocument(const pagespeed::DomDocument& document) {
+    documents_.pop_back();
+  }
+
  private:
   const pagespeed::RuleInput* rule_input_;
-  const pagespeed::DomDocument* document_;
   pagespeed::ResultProvider* provider_;
 
+  // The documents being visited, innermost last.
+  std::vector<const pagespeed::DomDocument*> documents_;
+
   DISALLOW_COPY_AND_ASSIGN(ImageDimensionsChecker);
 };
 
 void ImageDimensionsChecker::Visit(const pagespeed::DomElement& node) {
   if (node.GetTagName() == "IMG") {
+    const pagespeed::DomDocument* document = documents_.back();
     if (rule_input_->pagespeed_input().has_resource_with_url(
-            document_->GetDocumentUrl())) {
+            document->GetDocumentUrl())) {
       bool height_specified = false;
       bool width_specified = false;
       if (pagespeed::DomElement::SUCCESS !=
@@ -70,7 +82,7 @@ void ImageDimensionsChecker::Visit(const pagespeed::DomElement& node) {
         if (!node.GetAttributeByName("src", &src)) {
           return;
         }
-        const std::string uri = document_->ResolveUri(src);
+        const std::string uri = document->ResolveUri(src);
 
         // Don't complain about image tags with non-external resource
         // URIs (e.g. data URIs), because the browser already knows
@@ -90,29 +102,19 @@ void ImageDimensionsChecker::Visit(const pagespeed::DomElement& node) {
             .GetRedirectRegistry()->GetFinalRedirectTarget(
                 rule_input_->pagespeed_input().GetResourceWithUrlOrNull(uri));
         if (resource != NULL) {
-          scoped_ptr<pagespeed::ImageAttributes> image_attributes(
-              rule_input_->pagespeed_input().NewImageAttributes(resource));
-          if (image_attributes != NULL) {
+          int image_width = 0, image_height = 0;
+          if (rule_input_->GetImageDimensions(*resource, &image_width,
+                                              &image_height)) {
             pagespeed::ResultDetails* details = result->mutable_details();
             pagespeed::ImageDimensionDetails* image_details =
                 details->MutableExtension(
                     pagespeed::ImageDimensionDetails::message_set_extension);
-            image_details->set_expected_height(
-                image_attributes->GetImageHeight());
-            image_details->set_expected_width(
-                image_attributes->GetImageWidth());
+            image_details->set_expected_height(image_height);
+            image_details->set_expected_width(image_width);
           }
         }
       }
     }
-  } else if (node.GetTagName() == "IFRAME") {
-    // Do a recursive document traversal.
-    scoped_ptr<pagespeed::DomDocument> child_doc(node.GetContentDocument());
-    if (child_doc.get()) {
-      ImageDimensionsChecker checker(rule_input_, child_doc.get(),
-                                     provider_);
-      child_doc->Traverse(&checker);
-    }
   }
 }
 
@@ -147,13 +149,18 @@ UserFacingString SpecifyImageDimensions::header() const {
   return _("Specify image dimensions");
 }
 
+DomTraversalVisitor* SpecifyImageDimensions::NewDomVisitor(
+    const RuleInput& rule_input, ResultProvider* provider) const {
+  return new ImageDimensionsChecker(&rule_input, provider);
+}
+
+bool SpecifyImageDimensions::DomVisitorUsesImageDimensions() const {
+  return true;
+}
+
 bool SpecifyImageDimensions::AppendResults(const RuleInput& rule_input,
                                            ResultProvider* provider) {
-  const DomDocument* document = rule_input.pagespeed_input().dom_document();
-  if (document) {
-    ImageDimensionsChecker visitor(&rule_input, document, provider);
-    document->Traverse(&visitor);
-  }
+  AppendDomVisitorResults(rule_input, provider);
   return true;
 }
 
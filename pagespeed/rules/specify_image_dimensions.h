@@ -32,6 +32,9 @@ class SpecifyImageDimensions : public Rule {
   // Rule interface.
   virtual const char* name() const;
   virtual UserFacingString header() const;
+  virtual DomTraversalVisitor* NewDomVisitor(const RuleInput& input,
+                                             ResultProvider* provider) const;
+  virtual bool DomVisitorUsesImageDimensions() const;
   virtual bool AppendResults(const RuleInput& input, ResultProvider* provider);
   virtual void FormatResults(const ResultVector& results,
                              RuleFormatter* formatter);
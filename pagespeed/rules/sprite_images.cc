@@ -19,7 +19,6 @@
 #include "base/logging.h"
 #include "googleurl/src/gurl.h"
 #include "pagespeed/core/formatter.h"
-#include "pagespeed/core/image_attributes.h"
 #include "pagespeed/core/pagespeed_input.h"
 #include "pagespeed/core/resource.h"
 #include "pagespeed/core/resource_util.h"
@@ -88,23 +87,20 @@ bool SpriteImages::AppendResults(const RuleInput& rule_input,
     }
 
     // Exclude big images.
-    if (resource.GetResponseBody().size() > kSpriteImageSizeLimit) {
+    if (resource.GetResponseBodyPiece().size() > kSpriteImageSizeLimit) {
       continue;
     }
 
     // Exclude images without attributes or 1x1 tracking images.
-    scoped_ptr<pagespeed::ImageAttributes> image_attributes(
-        input.NewImageAttributes(&resource));
-    if (image_attributes == NULL ||
-        (image_attributes->GetImageWidth() <= 1 &&
-         image_attributes->GetImageHeight() <= 1)) {
+    int image_width = 0, image_height = 0;
+    if (!rule_input.GetImageDimensions(resource, &image_width,
+                                       &image_height) ||
+        (image_width <= 1 && image_height <= 1)) {
       continue;
     }
 
     // Exclude large images from the set of candidates.
-    const size_t num_pixels =
-        image_attributes->GetImageWidth() *
-        image_attributes->GetImageHeight();
+    const size_t num_pixels = image_width * image_height;
     if (num_pixels > kSpriteImagePixelLimit) {
       continue;
     }
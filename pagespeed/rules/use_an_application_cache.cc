@@ -143,8 +143,8 @@ bool UseAnApplicationCache::AppendResults(const RuleInput& rule_input,
   html_parse.AddFilter(&filter);
 
   html_parse.StartParse(primary_resource_url);
-  html_parse.ParseText(primary_resource->GetResponseBody().data(),
-                       primary_resource->GetResponseBody().length());
+  html_parse.ParseText(primary_resource->GetResponseBodyPiece().data(),
+                       primary_resource->GetResponseBodyPiece().length());
   html_parse.FinishParse();
 
   if (filter.has_html() && filter.manifest_url().empty()) {
@@ -33,6 +33,7 @@
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace pagespeed {
+class ArtifactComputer;
 class Resource;
 class TopLevelBrowsingContext;
 }  // namespace pagespeed
@@ -238,7 +239,9 @@ class PagespeedTest : public ::testing::Test {
 template <class RULE> class PagespeedRuleTest : public PagespeedTest {
  protected:
   PagespeedRuleTest()
-      : rule_(new RULE()), provider_(*rule_.get(), &rule_results_, 0) {
+      : rule_(new RULE()),
+        artifact_computer_(NULL),
+        provider_(*rule_.get(), &rule_results_, 0) {
     rule_results_.set_rule_name(rule_->name());
   }
 
@@ -258,6 +261,12 @@ template <class RULE> class PagespeedRuleTest : public PagespeedTest {
     return details.GetExtension(DETAILS::message_set_extension);
   }
 
+  // Set the ArtifactComputer given to the RuleInput, for rules that
+  // need minified content. Must be called before Freeze().
+  void set_artifact_computer(const pagespeed::ArtifactComputer* computer) {
+    artifact_computer_ = computer;
+  }
+
   virtual void SetUp() {
     PagespeedTest::SetUp();
   }
@@ -270,6 +279,7 @@ template <class RULE> class PagespeedRuleTest : public PagespeedTest {
   virtual void Freeze(bool expected_result) {
     PagespeedTest::Freeze(expected_result);
     rule_input_.reset(new pagespeed::RuleInput(*pagespeed_input()));
+    rule_input_->set_artifact_computer(artifact_computer_);
     rule_input_->Init();
   }
 
@@ -350,6 +360,7 @@ template <class RULE> class PagespeedRuleTest : public PagespeedTest {
   scoped_ptr<RULE> rule_;
 
  private:
+  const pagespeed::ArtifactComputer* artifact_computer_;
   scoped_ptr<pagespeed::RuleInput> rule_input_;
   pagespeed::RuleResults rule_results_;
   pagespeed::ResultProvider provider_;
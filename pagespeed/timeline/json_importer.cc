@@ -14,27 +14,38 @@
 
 #include "pagespeed/timeline/json_importer.h"
 
+#include <set>
 #include <string>
 #include <vector>
 
 #include "base/basictypes.h"
-#include "base/json/json_reader.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/stl_util.h"
 #include "base/values.h"
+#include "pagespeed/core/json_stream_parser.h"
 #include "pagespeed/proto/timeline.pb.h"
 
 using pagespeed::InstrumentationData;
 
 namespace {
 
+typedef std::set<InstrumentationData::RecordType> RecordTypeSet;
+
 class ProtoPopulator {
  public:
-  ProtoPopulator() : error_(false) {}
+  // If record_types is non-NULL, only the records of those types, and
+  // the records they are nested within, are kept. Does not take
+  // ownership of record_types.
+  explicit ProtoPopulator(const RecordTypeSet* record_types)
+      : record_types_(record_types), error_(false) {}
 
   void PopulateToplevel(const base::ListValue& json,
                         std::vector<const InstrumentationData*>* proto_out);
-  void PopulateInstrumentationData(const base::DictionaryValue& json,
+  void PopulateToplevelItem(const Value* item,
+                            std::vector<const InstrumentationData*>* proto_out);
+  // Returns false if the record should be dropped.
+  bool PopulateInstrumentationData(const base::DictionaryValue& json,
                                    InstrumentationData* instr);
   void PopulateStackFrame(const base::DictionaryValue& json,
                           pagespeed::StackFrame* out);
@@ -45,30 +56,66 @@ class ProtoPopulator {
   bool error() { return error_; }
 
  private:
+  const RecordTypeSet* const record_types_;
   bool error_;
 
   DISALLOW_COPY_AND_ASSIGN(ProtoPopulator);
 };
 
+// Converts the records of a JSON timeline as the parser reaches each
+// one, so that the parsed JSON of the whole timeline is never held in
+// memory.
+class RecordStreamer : public pagespeed::JsonStreamParser::Delegate {
+ public:
+  RecordStreamer(ProtoPopulator* populator,
+                 std::vector<const InstrumentationData*>* proto_out)
+      : populator_(populator), proto_out_(proto_out) {}
+
+  virtual bool ShouldStreamArrayElements(
+      const pagespeed::JsonStreamParser::Path& path) {
+    // Only the top-level list holds records.
+    return path.empty();
+  }
+
+  virtual bool OnArrayElement(const pagespeed::JsonStreamParser::Path& path,
+                              base::Value* element) {
+    scoped_ptr<base::Value> value(element);
+    populator_->PopulateToplevelItem(value.get(), proto_out_);
+    return true;
+  }
+
+ private:
+  ProtoPopulator* const populator_;
+  std::vector<const InstrumentationData*>* const proto_out_;
+
+  DISALLOW_COPY_AND_ASSIGN(RecordStreamer);
+};
+
 void ProtoPopulator::PopulateToplevel(
     const base::ListValue& json,
     std::vector<const InstrumentationData*>* proto_out) {
   for (base::ListValue::const_iterator iter = json.begin(), end = json.end();
        iter != end; ++iter) {
-    const Value* item = *iter;
-    if (NULL == item || !item->IsType(base::Value::TYPE_DICTIONARY)) {
-      error_ = true;
-      LOG(WARNING) << "Top-level list item must be a dictionary";
-      continue;
-    }
-    scoped_ptr<InstrumentationData> instr(new InstrumentationData);
-    PopulateInstrumentationData(*static_cast<const base::DictionaryValue*>(item),
-                                instr.get());
+    PopulateToplevelItem(*iter, proto_out);
+  }
+}
+
+void ProtoPopulator::PopulateToplevelItem(
+    const Value* item,
+    std::vector<const InstrumentationData*>* proto_out) {
+  if (NULL == item || !item->IsType(base::Value::TYPE_DICTIONARY)) {
+    error_ = true;
+    LOG(WARNING) << "Top-level list item must be a dictionary";
+    return;
+  }
+  scoped_ptr<InstrumentationData> instr(new InstrumentationData);
+  if (PopulateInstrumentationData(
+          *static_cast<const base::DictionaryValue*>(item), instr.get())) {
     proto_out->push_back(instr.release());
   }
 }
 
-void ProtoPopulator::PopulateInstrumentationData(
+bool ProtoPopulator::PopulateInstrumentationData(
     const base::DictionaryValue& json,
     InstrumentationData* instr) {
   {
@@ -76,7 +123,7 @@ void ProtoPopulator::PopulateInstrumentationData(
     if (!json.GetString("type", &type_string)) {
       LOG(WARNING) << "Missing 'type' field";
       error_ = true;
-      return;
+      return record_types_ == NULL;
     }
 
     if (type_string == "EventDispatch") {
@@ -133,7 +180,7 @@ void ProtoPopulator::PopulateInstrumentationData(
       LOG(DFATAL) << "Unknown record type: " << type_string;
       // Don't treat this as an error since new types may be added as
       // the format evolves.
-      return;
+      return record_types_ == NULL;
     }
   }
 
@@ -193,6 +240,8 @@ void ProtoPopulator::PopulateInstrumentationData(
     }
   }
 
+  bool keep = record_types_ == NULL ||
+      record_types_->find(instr->type()) != record_types_->end();
   {
     const base::ListValue* children;
     if (json.GetList("children", &children)) {
@@ -204,12 +253,17 @@ void ProtoPopulator::PopulateInstrumentationData(
           LOG(WARNING) << "'children' list item must be a dictionary";
           continue;
         }
-        PopulateInstrumentationData(
-            *static_cast<const base::DictionaryValue*>(item),
-            instr->add_children());
+        if (PopulateInstrumentationData(
+                *static_cast<const base::DictionaryValue*>(item),
+                instr->add_children())) {
+          keep = true;
+        } else {
+          instr->mutable_children()->RemoveLast();
+        }
       }
     }
   }
+  return keep;
 }
 
 // This is a helper macro used to define the GET_*_DATA macros below.
@@ -352,28 +406,56 @@ namespace pagespeed {
 
 namespace timeline {
 
-bool CreateTimelineProtoFromJsonString(
-    const std::string& json_string,
-    std::vector<const InstrumentationData*>* proto_out) {
-  scoped_ptr<const Value> json(base::JSONReader::Read(
-      json_string,
-      true));  // allow_trailing_comma
+namespace {
+
+bool ParseTimeline(const base::StringPiece& json_string,
+                   const RecordTypeSet* record_types,
+                   std::vector<const InstrumentationData*>* proto_out) {
+  const size_t initial_size = proto_out->size();
+  ProtoPopulator populator(record_types);
+  RecordStreamer streamer(&populator, proto_out);
+  JsonStreamParser parser(&streamer);
+  std::string error_msg;
+  scoped_ptr<const Value> json(parser.Parse(json_string, &error_msg));
+  bool parsed = true;
   if (json == NULL) {
-    LOG(WARNING) << "JSON string failed to parse";
-    return false;
-  }
-  if (!json->IsType(base::Value::TYPE_LIST)) {
+    LOG(WARNING) << "JSON string failed to parse: " << error_msg;
+    parsed = false;
+  } else if (!json->IsType(base::Value::TYPE_LIST)) {
     LOG(WARNING) << "Top-level JSON value must be a list";
+    parsed = false;
+  }
+  if (!parsed) {
+    // Discard any records converted before the error was found.
+    STLDeleteContainerPointers(proto_out->begin() + initial_size,
+                               proto_out->end());
+    proto_out->resize(initial_size);
     return false;
   }
-  return CreateTimelineProtoFromJsonValue(
-      *static_cast<const base::ListValue*>(json.get()), proto_out);
+  return !populator.error();
+}
+
+}  // namespace
+
+bool CreateTimelineProtoFromJsonString(
+    const base::StringPiece& json_string,
+    std::vector<const InstrumentationData*>* proto_out) {
+  return ParseTimeline(json_string, NULL, proto_out);
+}
+
+bool CreateFilteredTimelineProtoFromJsonString(
+    const base::StringPiece& json_string,
+    const std::vector<InstrumentationData::RecordType>& record_types,
+    std::vector<const InstrumentationData*>* proto_out) {
+  const RecordTypeSet record_type_set(record_types.begin(),
+                                      record_types.end());
+  return ParseTimeline(json_string, &record_type_set, proto_out);
 }
 
 bool CreateTimelineProtoFromJsonValue(
     const base::ListValue& json,
     std::vector<const InstrumentationData*>* proto_out) {
-  ProtoPopulator populator;
+  ProtoPopulator populator(NULL);
   populator.PopulateToplevel(json, proto_out);
   return !populator.error();
 }
@@ -15,22 +15,36 @@
 #ifndef PAGESPEED_TIMELINE_JSON_IMPORTER_H_
 #define PAGESPEED_TIMELINE_JSON_IMPORTER_H_
 
-#include <string>
 #include <vector>
 
+#include "base/string_piece.h"
+#include "pagespeed/proto/timeline.pb.h"
+
 namespace base {
 class ListValue;
 }  // namespace base
 
 namespace pagespeed {
 
-class InstrumentationData;
-
 namespace timeline {
 
-// Return false if there were any errors, true otherwise.
+// Parse the given JSON list of timeline records, appending a proto for
+// each record to proto_out. Records are parsed and converted one at a
+// time, so only one top-level record is held as parsed JSON at once.
+// Return false if there were any errors, true otherwise. If the JSON is
+// malformed, nothing is appended to proto_out.
 bool CreateTimelineProtoFromJsonString(
-    const std::string& json_string,
+    const base::StringPiece& json_string,
+    std::vector<const InstrumentationData*>* proto_out);
+
+// Like CreateTimelineProtoFromJsonString, but only keep the records of
+// the given types, and the records they are nested within. All other
+// records are dropped as soon as they have been converted, which keeps
+// memory use down when only a few record types are of interest (see
+// Rule::AppendTimelineRecordTypes).
+bool CreateFilteredTimelineProtoFromJsonString(
+    const base::StringPiece& json_string,
+    const std::vector<InstrumentationData::RecordType>& record_types,
     std::vector<const InstrumentationData*>* proto_out);
 
 // Return false if there were any errors, true otherwise.
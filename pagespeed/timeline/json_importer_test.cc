@@ -25,6 +25,7 @@ using pagespeed::InstrumentationData;
 
 namespace {
 
+using pagespeed::timeline::CreateFilteredTimelineProtoFromJsonString;
 using pagespeed::timeline::CreateTimelineProtoFromJsonString;
 
 const std::string kTimelineJson =
@@ -128,4 +129,62 @@ TEST(TimelineTest, Basic) {
   ASSERT_EQ(2, record2b.stack_trace_size());
 }
 
+TEST(TimelineTest, FilterKeepsAncestors) {
+  std::vector<InstrumentationData::RecordType> record_types;
+  record_types.push_back(InstrumentationData::LAYOUT);
+  std::vector<const InstrumentationData*> records;
+  STLElementDeleter<std::vector<const InstrumentationData*> > deleter(&records);
+  ASSERT_TRUE(CreateFilteredTimelineProtoFromJsonString(
+      kTimelineJson, record_types, &records));
+  ASSERT_EQ(1u, records.size());
+
+  // The EvaluateScript record is kept since it contains a Layout record,
+  // but its RecalculateStyles child is dropped.
+  const InstrumentationData& record = *records[0];
+  EXPECT_EQ(InstrumentationData::EVALUATE_SCRIPT, record.type());
+  EXPECT_EQ("http://example.com/reflow.html", record.data().url());
+  ASSERT_EQ(1, record.children_size());
+  EXPECT_EQ(InstrumentationData::LAYOUT, record.children(0).type());
+  EXPECT_EQ(2, record.children(0).stack_trace_size());
+}
+
+TEST(TimelineTest, FilterKeepsTopLevelRecords) {
+  std::vector<InstrumentationData::RecordType> record_types;
+  record_types.push_back(InstrumentationData::RECALCULATE_STYLES);
+  std::vector<const InstrumentationData*> records;
+  STLElementDeleter<std::vector<const InstrumentationData*> > deleter(&records);
+  ASSERT_TRUE(CreateFilteredTimelineProtoFromJsonString(
+      kTimelineJson, record_types, &records));
+  ASSERT_EQ(2u, records.size());
+  EXPECT_EQ(InstrumentationData::RECALCULATE_STYLES, records[0]->type());
+  EXPECT_EQ(InstrumentationData::EVALUATE_SCRIPT, records[1]->type());
+  ASSERT_EQ(1, records[1]->children_size());
+  EXPECT_EQ(InstrumentationData::RECALCULATE_STYLES,
+            records[1]->children(0).type());
+}
+
+TEST(TimelineTest, FilterDropsEverything) {
+  std::vector<InstrumentationData::RecordType> record_types;
+  std::vector<const InstrumentationData*> records;
+  ASSERT_TRUE(CreateFilteredTimelineProtoFromJsonString(
+      kTimelineJson, record_types, &records));
+  EXPECT_TRUE(records.empty());
+}
+
+TEST(TimelineTest, MalformedJson) {
+  std::vector<const InstrumentationData*> records;
+  // The first record is converted before the error is reached, but is
+  // discarded.
+  EXPECT_FALSE(CreateTimelineProtoFromJsonString(
+      "[{\"type\":\"Layout\"},{\"type\":", &records));
+  EXPECT_TRUE(records.empty());
+}
+
+TEST(TimelineTest, NotAList) {
+  std::vector<const InstrumentationData*> records;
+  EXPECT_FALSE(CreateTimelineProtoFromJsonString(
+      "{\"type\":\"Layout\"}", &records));
+  EXPECT_TRUE(records.empty());
+}
+
 }  // namespace
@@ -0,0 +1,49 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pagespeed/util/deadline.h"
+
+namespace pagespeed {
+
+Deadline::Deadline() : expired_(0), expiry_observed_(0) {}
+
+Deadline::Deadline(base::TimeDelta time_budget)
+    : expiration_time_(base::TimeTicks::Now() + time_budget),
+      expired_(0),
+      expiry_observed_(0) {}
+
+Deadline::~Deadline() {}
+
+bool Deadline::IsExpired() const {
+  if (base::subtle::Acquire_Load(&expired_) == 0) {
+    if (expiration_time_.is_null() ||
+        base::TimeTicks::Now() < expiration_time_) {
+      return false;
+    }
+    // Remember that we've expired, so we needn't check the clock again.
+    base::subtle::Release_Store(&expired_, 1);
+  }
+  base::subtle::Release_Store(&expiry_observed_, 1);
+  return true;
+}
+
+void Deadline::Cancel() {
+  base::subtle::Release_Store(&expired_, 1);
+}
+
+bool Deadline::WasExpiryObserved() const {
+  return base::subtle::Acquire_Load(&expiry_observed_) != 0;
+}
+
+}  // namespace pagespeed
@@ -0,0 +1,74 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PAGESPEED_UTIL_DEADLINE_H_
+#define PAGESPEED_UTIL_DEADLINE_H_
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/time.h"
+
+namespace pagespeed {
+
+// Deadline tells long-running computations when to give up: either
+// once a time budget has elapsed, or once Cancel() has been called.
+// Computations should poll IsExpired() periodically, and stop early
+// (typically reporting failure) once it returns true. Functions that
+// accept a Deadline also accept NULL, meaning they should run to
+// completion.
+class Deadline {
+ public:
+  // Construct a Deadline that only expires when cancelled.
+  Deadline();
+
+  // Construct a Deadline that expires once the given time budget has
+  // elapsed, measured from construction.
+  explicit Deadline(base::TimeDelta time_budget);
+
+  ~Deadline();
+
+  // Whether the time budget has elapsed, or Cancel() was called. Once
+  // this returns true, it always returns true. Safe to call from any
+  // thread.
+  bool IsExpired() const;
+
+  // Expire this deadline immediately. Safe to call from any thread.
+  void Cancel();
+
+  // Whether IsExpired() has ever returned true, i.e. whether some
+  // computation polling this deadline saw it expire, and so may have
+  // stopped early. A computation that finished without polling after
+  // the deadline expired ran to completion. Safe to call from any
+  // thread.
+  bool WasExpiryObserved() const;
+
+  // Convenience method that returns false if deadline is NULL, and
+  // deadline->IsExpired() otherwise.
+  static bool IsExpired(const Deadline* deadline) {
+    return deadline != NULL && deadline->IsExpired();
+  }
+
+ private:
+  // The time at which this deadline expires, or a null TimeTicks if it
+  // only expires when cancelled.
+  const base::TimeTicks expiration_time_;
+  mutable volatile base::subtle::Atomic32 expired_;
+  mutable volatile base::subtle::Atomic32 expiry_observed_;
+
+  DISALLOW_COPY_AND_ASSIGN(Deadline);
+};
+
+}  // namespace pagespeed
+
+#endif  // PAGESPEED_UTIL_DEADLINE_H_
@@ -0,0 +1,66 @@
+// Copyright 2013 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/time.h"
+#include "pagespeed/util/deadline.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using pagespeed::Deadline;
+
+namespace {
+
+TEST(DeadlineTest, DefaultNeverExpires) {
+  Deadline deadline;
+  ASSERT_FALSE(deadline.IsExpired());
+  ASSERT_FALSE(Deadline::IsExpired(&deadline));
+}
+
+TEST(DeadlineTest, NullNeverExpires) {
+  ASSERT_FALSE(Deadline::IsExpired(NULL));
+}
+
+TEST(DeadlineTest, Cancel) {
+  Deadline deadline;
+  deadline.Cancel();
+  ASSERT_TRUE(deadline.IsExpired());
+  ASSERT_TRUE(Deadline::IsExpired(&deadline));
+}
+
+TEST(DeadlineTest, ZeroBudgetExpiresImmediately) {
+  Deadline deadline(base::TimeDelta::FromMilliseconds(0));
+  ASSERT_TRUE(deadline.IsExpired());
+}
+
+TEST(DeadlineTest, LargeBudgetDoesNotExpire) {
+  Deadline deadline(base::TimeDelta::FromDays(1));
+  ASSERT_FALSE(deadline.IsExpired());
+  deadline.Cancel();
+  ASSERT_TRUE(deadline.IsExpired());
+}
+
+TEST(DeadlineTest, WasExpiryObserved) {
+  Deadline deadline(base::TimeDelta::FromMilliseconds(0));
+  // Expiring is not the same as being seen to expire.
+  ASSERT_FALSE(deadline.WasExpiryObserved());
+  ASSERT_TRUE(deadline.IsExpired());
+  ASSERT_TRUE(deadline.WasExpiryObserved());
+
+  Deadline cancelled;
+  cancelled.Cancel();
+  ASSERT_FALSE(cancelled.WasExpiryObserved());
+  ASSERT_TRUE(Deadline::IsExpired(&cancelled));
+  ASSERT_TRUE(cancelled.WasExpiryObserved());
+}
+
+}  // namespace
@@ -25,6 +25,7 @@
         '<(DEPTH)/base/base.gyp:base',
       ],
       'sources': [
+        'deadline.cc',
         'regex.cc',
       ],
       'include_dirs': [